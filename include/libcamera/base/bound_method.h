@@ -8,6 +8,7 @@
 #pragma once
 
 #include <memory>
+#include <stddef.h>
 #include <tuple>
 #include <type_traits>
 #include <utility>
@@ -72,6 +73,9 @@ public:
 	}
 	virtual ~BoundMethodBase() = default;
 
+	static void *operator new(size_t size);
+	static void operator delete(void *ptr, size_t size);
+
 	template<typename T, std::enable_if_t<!std::is_same<Object, T>::value> * = nullptr>
 	bool match(T *obj) { return obj == obj_; }
 	bool match(Object *object) { return object == object_; }
@@ -81,6 +85,52 @@ public:
 	virtual void invokePack(BoundMethodPackBase *pack) = 0;
 
 protected:
+	template<typename T>
+	class PackAllocator
+	{
+	public:
+		using value_type = T;
+
+		PackAllocator() = default;
+
+		template<typename U>
+		PackAllocator([[maybe_unused]] const PackAllocator<U> &other)
+		{
+		}
+
+		T *allocate(size_t n)
+		{
+			if constexpr (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+				return std::allocator<T>().allocate(n);
+			else
+				return static_cast<T *>(allocatePack(n * sizeof(T)));
+		}
+
+		void deallocate(T *ptr, size_t n)
+		{
+			if constexpr (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+				std::allocator<T>().deallocate(ptr, n);
+			else
+				freePack(ptr, n * sizeof(T));
+		}
+
+		template<typename U>
+		bool operator==([[maybe_unused]] const PackAllocator<U> &other) const
+		{
+			return true;
+		}
+
+		template<typename U>
+		bool operator!=([[maybe_unused]] const PackAllocator<U> &other) const
+		{
+			return false;
+		}
+	};
+
+	static void *allocatePack(size_t size);
+	static void freePack(void *ptr, size_t size);
+
+	ConnectionType resolveConnectionType() const;
 	bool activatePack(std::shared_ptr<BoundMethodPackBase> pack,
 			  bool deleteMethod);
 
@@ -142,10 +192,12 @@ public:
 
 	R activate(Args... args, bool deleteMethod = false) override
 	{
-		if (!this->object_)
+		if (!this->object_ ||
+		    (!deleteMethod && this->resolveConnectionType() == ConnectionTypeDirect))
 			return func_(args...);
 
-		auto pack = std::make_shared<PackType>(args...);
+		auto pack = std::allocate_shared<PackType>(
+			BoundMethodBase::PackAllocator<PackType>(), args...);
 		bool sync = BoundMethodBase::activatePack(pack, deleteMethod);
 		return sync ? pack->returnValue() : R();
 	}
@@ -175,12 +227,14 @@ public:
 
 	R activate(Args... args, bool deleteMethod = false) override
 	{
-		if (!this->object_) {
+		if (!this->object_ ||
+		    (!deleteMethod && this->resolveConnectionType() == ConnectionTypeDirect)) {
 			T *obj = static_cast<T *>(this->obj_);
 			return (obj->*func_)(args...);
 		}
 
-		auto pack = std::make_shared<PackType>(args...);
+		auto pack = std::allocate_shared<PackType>(
+			BoundMethodBase::PackAllocator<PackType>(), args...);
 		bool sync = BoundMethodBase::activatePack(pack, deleteMethod);
 		return sync ? pack->returnValue() : R();
 	}
@@ -0,0 +1,76 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * event_dispatcher_epoll.h - Epoll-based event dispatcher
+ */
+
+#pragma once
+
+#include <map>
+#include <stdint.h>
+#include <vector>
+
+#include <libcamera/base/private.h>
+
+#include <libcamera/base/event_dispatcher.h>
+#include <libcamera/base/timer_wheel.h>
+#include <libcamera/base/unique_fd.h>
+#include <libcamera/base/utils.h>
+
+struct epoll_event;
+
+namespace libcamera {
+
+class EventNotifier;
+class Timer;
+
+class EventDispatcherEpoll final : public EventDispatcher
+{
+public:
+	EventDispatcherEpoll();
+	~EventDispatcherEpoll();
+
+	void registerEventNotifier(EventNotifier *notifier);
+	void unregisterEventNotifier(EventNotifier *notifier);
+
+	void registerTimer(Timer *timer);
+	void unregisterTimer(Timer *timer);
+
+	void processEvents();
+	void interrupt();
+
+private:
+	struct EventNotifierSetEpoll {
+		uint32_t events() const;
+		bool empty() const;
+
+		int fd;
+		EventNotifier *notifiers[3];
+	};
+
+	int updateInterest(EventNotifierSetEpoll *set, uint32_t oldEvents);
+	void releaseSet(std::map<int, EventNotifierSetEpoll>::iterator iter);
+
+	int wait(std::vector<struct epoll_event> *events);
+	void processInterrupt();
+	void processTimerFd();
+	void processNotifiers(EventNotifierSetEpoll *set, uint32_t events);
+	void processTimers();
+	void armTimerFd();
+
+	std::map<int, EventNotifierSetEpoll> notifiers_;
+	std::vector<int> staleSets_;
+	std::vector<struct epoll_event> events_;
+
+	TimerWheel timers_;
+	utils::time_point armedDeadline_;
+
+	UniqueFD epollfd_;
+	UniqueFD eventfd_;
+	UniqueFD timerfd_;
+
+	bool processingEvents_;
+};
+
+} /* namespace libcamera */
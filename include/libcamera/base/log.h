@@ -7,8 +7,11 @@
 
 #pragma once
 
+#include <atomic>
 #include <chrono>
 #include <sstream>
+#include <stdint.h>
+#include <utility>
 
 #include <libcamera/base/private.h>
 
@@ -70,7 +73,9 @@ public:
 	const utils::time_point &timestamp() const { return timestamp_; }
 	LogSeverity severity() const { return severity_; }
 	const LogCategory &category() const { return category_; }
-	const std::string &fileInfo() const { return fileInfo_; }
+	const char *fileName() const { return fileName_; }
+	unsigned int line() const { return line_; }
+	const std::string &fileInfo() const;
 	const std::string &prefix() const { return prefix_; }
 	const std::string msg() const { return msgStream_.str(); }
 
@@ -83,7 +88,9 @@ private:
 	const LogCategory &category_;
 	LogSeverity severity_;
 	utils::time_point timestamp_;
-	std::string fileInfo_;
+	const char *fileName_;
+	unsigned int line_;
+	mutable std::string fileInfo_;
 	std::string prefix_;
 };
 
@@ -104,6 +111,58 @@ LogMessage _log(const LogCategory *category, LogSeverity severity,
 		const char *fileName = __builtin_FILE(),
 		unsigned int line = __builtin_LINE());
 
+class LogRateLimiter
+{
+public:
+	static constexpr unsigned int kDefaultBurst = 5;
+
+	struct Result {
+		explicit operator bool() const { return limited; }
+
+		bool limited;
+		unsigned int suppressed;
+	};
+
+	LogRateLimiter(const LogCategory &category, LogSeverity severity,
+		       unsigned int burst = kDefaultBurst,
+		       const char *fileName = __builtin_FILE(),
+		       unsigned int line = __builtin_LINE());
+	~LogRateLimiter();
+
+	Result limit(utils::duration interval);
+
+private:
+	LIBCAMERA_DISABLE_COPY_AND_MOVE(LogRateLimiter)
+
+	const LogCategory &category_;
+	const LogSeverity severity_;
+	const unsigned int burst_;
+	const char *fileName_;
+	const unsigned int line_;
+
+	std::atomic<int64_t> arrival_;
+	std::atomic<unsigned int> suppressed_;
+};
+
+class LogRateLimitedMessage
+{
+public:
+	LogRateLimitedMessage(LogMessage &&msg, const LogRateLimiter::Result &result)
+		: msg_(std::move(msg)), suppressed_(result.suppressed)
+	{
+	}
+
+	~LogRateLimitedMessage();
+
+	std::ostream &stream() { return msg_.stream(); }
+
+private:
+	LIBCAMERA_DISABLE_COPY_AND_MOVE(LogRateLimitedMessage)
+
+	LogMessage msg_;
+	unsigned int suppressed_;
+};
+
 #ifndef __DOXYGEN__
 #define _LOG_CATEGORY(name) logCategory##name
 
@@ -118,8 +177,20 @@ LogMessage _log(const LogCategory *category, LogSeverity severity,
  */
 #define _LOG_MACRO(_1, _2, NAME, ...) NAME
 #define LOG(...) _LOG_MACRO(__VA_ARGS__, _LOG2, _LOG1)(__VA_ARGS__)
+
+#define LOG_RATELIMITED(category, severity, interval)			\
+	for (LogRateLimiter::Result _logResult = []() -> LogRateLimiter & { \
+		static LogRateLimiter limiter{ _LOG_CATEGORY(category)(), \
+					       Log##severity };		\
+		return limiter;						\
+	     }().limit(interval);					\
+	     !_logResult; _logResult.limited = true)			\
+		LogRateLimitedMessage(_log(&_LOG_CATEGORY(category)(),	\
+					   Log##severity),		\
+				      _logResult).stream()
 #else /* __DOXYGEN___ */
 #define LOG(category, severity)
+#define LOG_RATELIMITED(category, severity, interval)
 #endif /* __DOXYGEN__ */
 
 #ifndef NDEBUG
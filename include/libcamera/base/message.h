@@ -8,6 +8,8 @@
 #pragma once
 
 #include <atomic>
+#include <stddef.h>
+#include <stdint.h>
 
 #include <libcamera/base/private.h>
 
@@ -20,6 +22,20 @@ class Object;
 class Semaphore;
 class Thread;
 
+namespace details {
+
+struct MessagePoolStatistics {
+	uint64_t heapAllocations;
+	uint64_t heapFrees;
+	uint64_t oversizedAllocations;
+};
+
+void *messagePoolAllocate(size_t size);
+void messagePoolFree(void *ptr, size_t size);
+MessagePoolStatistics messagePoolStatistics();
+
+} /* namespace details */
+
 class Message
 {
 public:
@@ -34,16 +50,21 @@ public:
 	Message(Type type);
 	virtual ~Message();
 
+	static void *operator new(size_t size);
+	static void operator delete(void *ptr, size_t size);
+
 	Type type() const { return type_; }
 	Object *receiver() const { return receiver_; }
 
 	static Type registerMessageType();
 
 private:
+	friend class MessageQueue;
 	friend class Thread;
 
 	Type type_;
 	Object *receiver_;
+	Message *next_;
 
 	static std::atomic_uint nextUserType_;
 };
@@ -8,7 +8,7 @@
 #pragma once
 
 #include <functional>
-#include <list>
+#include <memory>
 #include <type_traits>
 #include <vector>
 
@@ -23,15 +23,15 @@ public:
 	void disconnect(Object *object);
 
 protected:
-	using SlotList = std::list<BoundMethodBase *>;
+	using SlotList = std::vector<std::shared_ptr<BoundMethodBase>>;
 
 	void connect(BoundMethodBase *slot);
-	void disconnect(std::function<bool(SlotList::iterator &)> match);
+	void disconnect(std::function<bool(BoundMethodBase *)> match);
 
-	SlotList slots();
+	std::shared_ptr<const SlotList> slots();
 
 private:
-	SlotList slots_;
+	std::shared_ptr<const SlotList> slots_;
 };
 
 template<typename... Args>
@@ -96,7 +96,7 @@ public:
 
 	void disconnect()
 	{
-		SignalBase::disconnect([]([[maybe_unused]] SlotList::iterator &iter) {
+		SignalBase::disconnect([]([[maybe_unused]] BoundMethodBase *slot) {
 			return true;
 		});
 	}
@@ -104,17 +104,17 @@ public:
 	template<typename T>
 	void disconnect(T *obj)
 	{
-		SignalBase::disconnect([obj](SlotList::iterator &iter) {
-			return (*iter)->match(obj);
+		SignalBase::disconnect([obj](BoundMethodBase *slot) {
+			return slot->match(obj);
 		});
 	}
 
 	template<typename T, typename R>
 	void disconnect(T *obj, R (T::*func)(Args...))
 	{
-		SignalBase::disconnect([obj, func](SlotList::iterator &iter) {
+		SignalBase::disconnect([obj, func](BoundMethodBase *base) {
 			BoundMethodArgs<R, Args...> *slot =
-				static_cast<BoundMethodArgs<R, Args...> *>(*iter);
+				static_cast<BoundMethodArgs<R, Args...> *>(base);
 
 			if (!slot->match(obj))
 				return false;
@@ -132,9 +132,9 @@ public:
 	template<typename R>
 	void disconnect(R (*func)(Args...))
 	{
-		SignalBase::disconnect([func](SlotList::iterator &iter) {
+		SignalBase::disconnect([func](BoundMethodBase *base) {
 			BoundMethodArgs<R, Args...> *slot =
-				static_cast<BoundMethodArgs<R, Args...> *>(*iter);
+				static_cast<BoundMethodArgs<R, Args...> *>(base);
 
 			if (!slot->match(nullptr))
 				return false;
@@ -146,11 +146,17 @@ public:
 	void emit(Args... args)
 	{
 		/*
-		 * Make a copy of the slots list as the slot could call the
-		 * disconnect operation, invalidating the iterator.
+		 * Take a reference to the immutable slots snapshot. The slots
+		 * could call the connect or disconnect operations, which
+		 * replace the snapshot instead of modifying it, so iterating
+		 * over the snapshot remains valid without copying it.
 		 */
-		for (BoundMethodBase *slot : slots())
-			static_cast<BoundMethodArgs<void, Args...> *>(slot)->activate(args...);
+		std::shared_ptr<const SlotList> slots = SignalBase::slots();
+		if (!slots)
+			return;
+
+		for (const std::shared_ptr<BoundMethodBase> &slot : *slots)
+			static_cast<BoundMethodArgs<void, Args...> *>(slot.get())->activate(args...);
 	}
 };
 
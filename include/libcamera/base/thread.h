@@ -43,6 +43,7 @@ public:
 	static pid_t currentId();
 
 	EventDispatcher *eventDispatcher();
+	int setEventDispatcher(std::unique_ptr<EventDispatcher> dispatcher);
 
 	void dispatchMessages(Message::Type type = Message::Type::None);
 
@@ -14,6 +14,7 @@
 
 #include <libcamera/base/object.h>
 #include <libcamera/base/signal.h>
+#include <libcamera/base/timer_wheel.h>
 
 namespace libcamera {
 
@@ -38,11 +39,15 @@ protected:
 	void message(Message *msg) override;
 
 private:
+	friend class TimerWheel;
+
 	void registerTimer();
 	void unregisterTimer();
 
 	bool running_;
 	std::chrono::steady_clock::time_point deadline_;
+
+	TimerWheel::Entry wheelEntry_;
 };
 
 } /* namespace libcamera */
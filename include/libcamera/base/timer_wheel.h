@@ -0,0 +1,77 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * timer_wheel.h - Hierarchical timer wheel
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <stdint.h>
+
+#include <libcamera/base/private.h>
+
+#include <libcamera/base/class.h>
+#include <libcamera/base/utils.h>
+
+namespace libcamera {
+
+class Timer;
+
+class TimerWheel
+{
+public:
+	struct Entry {
+		Entry *prev;
+		Entry *next;
+		Timer *timer;
+		uint64_t expires;
+		unsigned int slot;
+	};
+
+	static constexpr std::chrono::milliseconds kTick{ 1 };
+
+	TimerWheel();
+	~TimerWheel();
+
+	void insert(Timer *timer);
+	void remove(Timer *timer);
+
+	bool empty() const { return !count_; }
+	utils::time_point nextExpiry();
+
+	void expire(utils::time_point now);
+	Timer *takeExpired();
+
+private:
+	LIBCAMERA_DISABLE_COPY_AND_MOVE(TimerWheel)
+
+	static constexpr unsigned int kLevelBits = 6;
+	static constexpr unsigned int kLevelSize = 1 << kLevelBits;
+	static constexpr unsigned int kLevelMask = kLevelSize - 1;
+	static constexpr unsigned int kLevels = 4;
+
+	struct Level {
+		std::array<Entry, kLevelSize> slots;
+		uint64_t occupied;
+	};
+
+	static uint64_t toTicks(utils::time_point time);
+
+	void place(Entry *entry);
+	void cascade(unsigned int level);
+	unsigned int firstOccupied(unsigned int level, unsigned int from) const;
+
+	std::array<Level, kLevels> levels_;
+	Entry expired_;
+
+	uint64_t base_;
+	unsigned int count_;
+
+	bool nextExpiryValid_;
+	uint64_t nextExpiry_;
+};
+
+} /* namespace libcamera */
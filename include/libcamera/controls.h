@@ -7,12 +7,18 @@
 
 #pragma once
 
+#include <algorithm>
 #include <assert.h>
+#include <deque>
+#include <iterator>
+#include <memory>
 #include <optional>
 #include <set>
 #include <stdint.h>
+#include <string.h>
 #include <string>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <libcamera/base/class.h>
@@ -22,6 +28,8 @@
 
 namespace libcamera {
 
+class ControlArena;
+class ControlSerializer;
 class ControlValidator;
 
 enum ControlType {
@@ -104,7 +112,8 @@ public:
 					      !std::is_same<std::string, std::remove_cv_t<T>>::value,
 					      std::nullptr_t> = nullptr>
 	ControlValue(const T &value)
-		: type_(ControlTypeNone), numElements_(0)
+		: type_(ControlTypeNone), isArray_(false), external_(false),
+		  numElements_(0)
 	{
 		set(details::control_type<std::remove_cv_t<T>>::value, false,
 		    &value, 1, sizeof(T));
@@ -117,7 +126,8 @@ public:
 	template<typename T>
 #endif
 	ControlValue(const T &value)
-		: type_(ControlTypeNone), numElements_(0)
+		: type_(ControlTypeNone), isArray_(false), external_(false),
+		  numElements_(0)
 	{
 		set(details::control_type<std::remove_cv_t<T>>::value, true,
 		    value.data(), value.size(), sizeof(typename T::value_type));
@@ -127,6 +137,8 @@ public:
 
 	ControlValue(const ControlValue &other);
 	ControlValue &operator=(const ControlValue &other);
+	ControlValue(ControlValue &&other) noexcept;
+	ControlValue &operator=(ControlValue &&other) noexcept;
 
 	ControlType type() const { return type_; }
 	bool isNone() const { return type_ == ControlTypeNone; }
@@ -197,8 +209,11 @@ public:
 		     std::size_t numElements = 1);
 
 private:
+	friend class ControlList;
+
 	ControlType type_ : 8;
 	bool isArray_;
+	bool external_;
 	std::size_t numElements_ : 32;
 	union {
 		uint64_t value_;
@@ -206,8 +221,25 @@ private:
 	};
 
 	void release();
+	void allocate(ControlType type, bool isArray, std::size_t numElements,
+		      ControlArena *arena);
 	void set(ControlType type, bool isArray, const void *data,
-		 std::size_t numElements, std::size_t elementSize);
+		 std::size_t numElements, std::size_t elementSize,
+		 ControlArena *arena = nullptr);
+	void set(const ControlValue &other, ControlArena *arena);
+
+	template<typename T>
+	void set(const T &value, ControlArena *arena)
+	{
+		if constexpr (details::is_span<T>::value ||
+			      std::is_same<std::string, std::remove_cv_t<T>>::value)
+			set(details::control_type<std::remove_cv_t<T>>::value, true,
+			    value.data(), value.size(),
+			    sizeof(typename T::value_type), arena);
+		else
+			set(details::control_type<std::remove_cv_t<T>>::value, false,
+			    &value, 1, sizeof(T), arena);
+	}
 };
 
 class ControlId
@@ -349,20 +381,88 @@ private:
 class ControlList
 {
 private:
-	using ControlListMap = std::unordered_map<unsigned int, ControlValue>;
+	using ControlListMap = std::vector<std::pair<unsigned int, ControlValue>>;
+
+	template<typename Iter, typename Value>
+	class Iterator
+	{
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = std::pair<const unsigned int, ControlValue>;
+		using difference_type = std::ptrdiff_t;
+		using reference = std::pair<const unsigned int &, Value &>;
+
+		class pointer
+		{
+		public:
+			pointer(const reference &ref)
+				: ref_(ref)
+			{
+			}
+
+			const reference *operator->() const { return &ref_; }
+
+		private:
+			reference ref_;
+		};
+
+		Iterator() = default;
+
+		template<typename OtherIter, typename OtherValue>
+		Iterator(const Iterator<OtherIter, OtherValue> &other)
+			: iter_(other.iter_)
+		{
+		}
+
+		reference operator*() const { return { iter_->first, iter_->second }; }
+		pointer operator->() const { return **this; }
+
+		Iterator &operator++()
+		{
+			++iter_;
+			return *this;
+		}
+
+		Iterator operator++(int)
+		{
+			Iterator it = *this;
+			++iter_;
+			return it;
+		}
+
+		bool operator==(const Iterator &other) const { return iter_ == other.iter_; }
+		bool operator!=(const Iterator &other) const { return iter_ != other.iter_; }
+
+	private:
+		friend class ControlList;
+		template<typename, typename>
+		friend class Iterator;
+
+		Iterator(Iter iter)
+			: iter_(iter)
+		{
+		}
+
+		Iter iter_;
+	};
 
 public:
 	ControlList();
 	ControlList(const ControlIdMap &idmap, const ControlValidator *validator = nullptr);
 	ControlList(const ControlInfoMap &infoMap, const ControlValidator *validator = nullptr);
 
-	using iterator = ControlListMap::iterator;
-	using const_iterator = ControlListMap::const_iterator;
+	ControlList(const ControlList &other);
+	ControlList &operator=(const ControlList &other);
+	ControlList(ControlList &&other) noexcept;
+	ControlList &operator=(ControlList &&other) noexcept;
+
+	using iterator = Iterator<ControlListMap::iterator, ControlValue>;
+	using const_iterator = Iterator<ControlListMap::const_iterator, const ControlValue>;
 
 	iterator begin() { return controls_.begin(); }
 	iterator end() { return controls_.end(); }
-	const_iterator begin() const { return controls_.begin(); }
-	const_iterator end() const { return controls_.end(); }
+	const_iterator begin() const { return controls_.cbegin(); }
+	const_iterator end() const { return controls_.cend(); }
 
 	bool empty() const { return controls_.empty(); }
 	std::size_t size() const { return controls_.size(); }
@@ -375,7 +475,7 @@ public:
 	template<typename T>
 	std::optional<T> get(const Control<T> &ctrl) const
 	{
-		const auto entry = controls_.find(ctrl.id());
+		const auto entry = lookup(ctrl.id());
 		if (entry == controls_.end())
 			return std::nullopt;
 
@@ -390,7 +490,7 @@ public:
 		if (!val)
 			return;
 
-		val->set<T>(value);
+		val->set<T>(value, arena_);
 	}
 
 	template<typename T, typename V, size_t Size>
@@ -400,7 +500,8 @@ public:
 		if (!val)
 			return;
 
-		val->set(Span<const typename std::remove_cv_t<V>, Size>{ value.begin(), value.size() });
+		val->set(Span<const typename std::remove_cv_t<V>, Size>{ value.begin(), value.size() },
+			 arena_);
 	}
 
 	const ControlValue &get(unsigned int id) const;
@@ -410,14 +511,119 @@ public:
 	const ControlIdMap *idMap() const { return idmap_; }
 
 private:
+	friend class ControlArena;
+
+	ControlListMap::const_iterator lookup(unsigned int id) const
+	{
+		auto iter = std::lower_bound(controls_.begin(), controls_.end(), id,
+					     [](const auto &entry, unsigned int key) {
+						     return entry.first < key;
+					     });
+		if (iter == controls_.end() || iter->first != id)
+			return controls_.end();
+
+		return iter;
+	}
+
 	const ControlValue *find(unsigned int id) const;
 	ControlValue *find(unsigned int id);
 
 	const ControlValidator *validator_;
 	const ControlIdMap *idmap_;
 	const ControlInfoMap *infoMap_;
+	ControlArena *arena_;
 
 	ControlListMap controls_;
 };
 
+class ControlListView
+{
+public:
+	ControlListView();
+	ControlListView(ControlList list);
+
+	bool empty() const { return size() == 0; }
+	std::size_t size() const;
+
+	bool contains(unsigned int id) const;
+
+	template<typename T>
+	std::optional<T> get(const Control<T> &ctrl) const
+	{
+		if (list_)
+			return list_->get(ctrl);
+
+		Element element;
+		if (!find(ctrl.id(), &element))
+			return std::nullopt;
+
+		if constexpr (details::is_span<T>::value ||
+			      std::is_same<std::string, std::remove_cv_t<T>>::value) {
+			using V = std::remove_cv_t<typename T::value_type>;
+
+			if (element.type != details::control_type<V>::value ||
+			    !element.isArray)
+				return std::nullopt;
+
+			/* Decode values that are not suitably aligned. */
+			if (reinterpret_cast<uintptr_t>(element.data) % alignof(V))
+				return decode(ctrl.id(), element).template get<T>();
+
+			const V *value = reinterpret_cast<const V *>(element.data);
+			return T{ value, element.numElements };
+		} else {
+			using V = std::remove_cv_t<T>;
+
+			if (element.type != details::control_type<V>::value ||
+			    element.isArray)
+				return std::nullopt;
+
+			/* Not all byte values are valid bool representations. */
+			if constexpr (std::is_same<V, bool>::value) {
+				uint8_t value;
+				memcpy(&value, element.data, sizeof(value));
+				return value != 0;
+			} else {
+				V value;
+				memcpy(&value, element.data, sizeof(value));
+				return value;
+			}
+		}
+	}
+
+	ControlValue get(unsigned int id) const;
+
+	const ControlIdMap *idMap() const { return idmap_; }
+	const ControlInfoMap *infoMap() const { return list_ ? list_->infoMap() : infoMap_; }
+	ControlList toControlList() const;
+
+private:
+	friend class ControlSerializer;
+
+	struct Element {
+		ControlType type;
+		bool isArray;
+		std::size_t numElements;
+		const uint8_t *data;
+	};
+
+	ControlListView(const ControlIdMap &idmap, const ControlInfoMap *infoMap,
+			Span<const uint8_t> entries, unsigned int count,
+			Span<const uint8_t> values);
+
+	bool find(unsigned int id, Element *element) const;
+	const ControlValue &decode(unsigned int id, const Element &element) const;
+
+	const ControlIdMap *idmap_;
+	const ControlInfoMap *infoMap_;
+	std::shared_ptr<const ControlList> list_;
+
+	const uint8_t *entries_;
+	unsigned int count_;
+	Span<const uint8_t> values_;
+	bool sorted_;
+
+	mutable std::deque<std::pair<unsigned int, ControlValue>> decoded_;
+};
+
 } /* namespace libcamera */
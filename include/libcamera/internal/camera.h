@@ -38,6 +38,7 @@ public:
 	ControlList properties_;
 
 	uint32_t requestSequence_;
+	bool initialized_;
 
 	const CameraControlValidator *validator() const { return validator_.get(); }
 
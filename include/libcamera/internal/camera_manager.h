@@ -26,6 +26,7 @@ namespace libcamera {
 
 class Camera;
 class DeviceEnumerator;
+class V4L2FormatCache;
 
 class CameraManager::Private : public Extensible::Private, public Thread
 {
@@ -38,6 +39,8 @@ public:
 	void addCamera(std::shared_ptr<Camera> camera) LIBCAMERA_TSA_EXCLUDES(mutex_);
 	void removeCamera(std::shared_ptr<Camera> camera) LIBCAMERA_TSA_EXCLUDES(mutex_);
 
+	bool lazyCameraInit() const { return lazyCameraInit_; }
+
 protected:
 	void run() override;
 
@@ -60,9 +63,12 @@ private:
 	int status_ LIBCAMERA_TSA_GUARDED_BY(mutex_);
 
 	std::unique_ptr<DeviceEnumerator> enumerator_;
+	std::unique_ptr<V4L2FormatCache> formatCache_;
+	bool lazyCameraInit_;
 
-	IPAManager ipaManager_;
+	/* The IPAManager may start processes when constructed. */
 	ProcessManager processManager_;
+	IPAManager ipaManager_;
 };
 
 } /* namespace libcamera */
@@ -0,0 +1,47 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * control_arena.h - Arena allocator for control values
+ */
+
+#pragma once
+
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include <libcamera/base/class.h>
+
+namespace libcamera {
+
+class ControlList;
+
+class ControlArena
+{
+public:
+	ControlArena(size_t blockSize = 1024);
+
+	void attach(ControlList *list);
+	bool isAttached(const ControlList &list) const;
+
+	void *allocate(size_t size);
+	void reset();
+
+	size_t capacity() const;
+
+private:
+	LIBCAMERA_DISABLE_COPY_AND_MOVE(ControlArena)
+
+	struct Block {
+		std::unique_ptr<uint8_t[]> data;
+		size_t size;
+	};
+
+	size_t blockSize_;
+	std::vector<Block> blocks_;
+	size_t used_;
+};
+
+} /* namespace libcamera */
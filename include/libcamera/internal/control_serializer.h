@@ -9,6 +9,8 @@
 
 #include <map>
 #include <memory>
+#include <stdint.h>
+#include <utility>
 #include <vector>
 
 #include <libcamera/controls.h>
@@ -16,6 +18,7 @@
 namespace libcamera {
 
 class ByteStreamBuffer;
+struct ipa_controls_header;
 
 class ControlSerializer
 {
@@ -25,15 +28,22 @@ public:
 		Worker
 	};
 
+	static constexpr unsigned int kDefaultKeyframeInterval = 30;
+
 	ControlSerializer(Role role);
 
 	void reset();
 
+	void setDeltaEncoding(unsigned int keyframeInterval);
+	void forceKeyframe();
+
 	static size_t binarySize(const ControlInfoMap &infoMap);
 	static size_t binarySize(const ControlList &list);
+	static size_t binarySize(const ControlListView &view);
 
 	int serialize(const ControlInfoMap &infoMap, ByteStreamBuffer &buffer);
 	int serialize(const ControlList &list, ByteStreamBuffer &buffer);
+	int serialize(const ControlListView &view, ByteStreamBuffer &buffer);
 
 	template<typename T>
 	T deserialize(ByteStreamBuffer &buffer);
@@ -41,6 +51,15 @@ public:
 	bool isCached(const ControlInfoMap &infoMap);
 
 private:
+	struct DeltaState {
+		ControlList list;
+		std::vector<uint8_t> keyframe;
+		uint32_t sequence = 0;
+		unsigned int sinceKeyframe = 0;
+	};
+
+	using DeltaKey = std::pair<uint32_t, uint32_t>;
+
 	static size_t binarySize(const ControlValue &value);
 	static size_t binarySize(const ControlInfo &info);
 
@@ -51,12 +70,21 @@ private:
 				      bool isArray = false, unsigned int count = 1);
 	ControlInfo loadControlInfo(ByteStreamBuffer &buffer);
 
+	bool computeDelta(const ControlList &previous, const ControlList &list);
+	const ControlInfoMap *listInfoMap(const struct ipa_controls_header *hdr);
+	const ControlIdMap *listIdMap(const struct ipa_controls_header *hdr);
+
 	unsigned int serial_;
 	unsigned int serialSeed_;
 	std::vector<std::unique_ptr<ControlId>> controlIds_;
 	std::vector<std::unique_ptr<ControlIdMap>> controlIdMaps_;
 	std::map<unsigned int, ControlInfoMap> infoMaps_;
 	std::map<const ControlInfoMap *, unsigned int> infoMapHandles_;
+
+	unsigned int keyframeInterval_;
+	std::map<DeltaKey, DeltaState> txDeltas_;
+	std::map<DeltaKey, DeltaState> rxDeltas_;
+	std::vector<std::pair<unsigned int, const ControlValue *>> entries_;
 };
 
 } /* namespace libcamera */
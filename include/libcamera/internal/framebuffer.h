@@ -8,7 +8,9 @@
 #pragma once
 
 #include <memory>
+#include <sys/types.h>
 #include <utility>
+#include <vector>
 
 #include <libcamera/base/class.h>
 
@@ -27,6 +29,7 @@ public:
 
 	void setRequest(Request *request) { request_ = request; }
 	bool isContiguous() const { return isContiguous_; }
+	ino_t inode(unsigned int plane) const { return inodes_[plane]; }
 
 	Fence *fence() const { return fence_.get(); }
 	void setFence(std::unique_ptr<Fence> fence) { fence_ = std::move(fence); }
@@ -37,6 +40,7 @@ public:
 
 private:
 	std::vector<Plane> planes_;
+	std::vector<ino_t> inodes_;
 	FrameMetadata metadata_;
 	uint64_t cookie_;
 
@@ -41,6 +41,15 @@ void appendPOD(std::vector<uint8_t> &vec, T val)
 	memcpy(&*(vec.end() - byteWidth), &val, byteWidth);
 }
 
+template<typename T,
+	 std::enable_if_t<std::is_arithmetic_v<T>> * = nullptr>
+void writePOD(std::vector<uint8_t> &vec, size_t pos, T val)
+{
+	ASSERT(pos + sizeof(val) <= vec.size());
+
+	memcpy(vec.data() + pos, &val, sizeof(val));
+}
+
 template<typename T,
 	 std::enable_if_t<std::is_arithmetic_v<T>> * = nullptr>
 T readPOD(std::vector<uint8_t>::const_iterator it, size_t pos,
@@ -69,6 +78,11 @@ class IPADataSerializer
 public:
 	static std::tuple<std::vector<uint8_t>, std::vector<SharedFD>>
 	serialize(const T &data, ControlSerializer *cs = nullptr);
+	static void serialize(const T &data, std::vector<uint8_t> &dataVec,
+			      std::vector<SharedFD> &fdsVec,
+			      ControlSerializer *cs = nullptr);
+
+	static size_t binarySize(const T &data, ControlSerializer *cs = nullptr);
 
 	static T deserialize(const std::vector<uint8_t> &data,
 			     ControlSerializer *cs = nullptr);
@@ -88,6 +102,26 @@ public:
 
 #ifndef __DOXYGEN__
 
+/*
+ * Serialize an element of a container, preceded by its size in bytes and its
+ * number of fds. The sizes are patched after serializing the element in place.
+ */
+template<typename V>
+void serializeElement(const V &data, std::vector<uint8_t> &dataVec,
+		      std::vector<SharedFD> &fdsVec, ControlSerializer *cs)
+{
+	size_t offset = dataVec.size();
+	size_t fdsOffset = fdsVec.size();
+
+	appendPOD<uint32_t>(dataVec, 0);
+	appendPOD<uint32_t>(dataVec, 0);
+
+	IPADataSerializer<V>::serialize(data, dataVec, fdsVec, cs);
+
+	writePOD<uint32_t>(dataVec, offset, dataVec.size() - offset - 8);
+	writePOD<uint32_t>(dataVec, offset + 4, fdsVec.size() - fdsOffset);
+}
+
 /*
  * Serialization format for vector of type V:
  *
@@ -111,26 +145,32 @@ public:
 		std::vector<uint8_t> dataVec;
 		std::vector<SharedFD> fdsVec;
 
+		dataVec.reserve(binarySize(data, cs));
+		serialize(data, dataVec, fdsVec, cs);
+
+		return { std::move(dataVec), std::move(fdsVec) };
+	}
+
+	static void serialize(const std::vector<V> &data, std::vector<uint8_t> &dataVec,
+			      std::vector<SharedFD> &fdsVec, ControlSerializer *cs = nullptr)
+	{
 		/* Serialize the length. */
 		uint32_t vecLen = data.size();
 		appendPOD<uint32_t>(dataVec, vecLen);
 
-		/* Serialize the members. */
-		for (auto const &it : data) {
-			std::vector<uint8_t> dvec;
-			std::vector<SharedFD> fvec;
-
-			std::tie(dvec, fvec) =
-				IPADataSerializer<V>::serialize(it, cs);
+		/* Serialize the members, and patch their size afterwards. */
+		for (auto const &it : data)
+			serializeElement<V>(it, dataVec, fdsVec, cs);
+	}
 
-			appendPOD<uint32_t>(dataVec, dvec.size());
-			appendPOD<uint32_t>(dataVec, fvec.size());
+	static size_t binarySize(const std::vector<V> &data, ControlSerializer *cs = nullptr)
+	{
+		size_t size = 4;
 
-			dataVec.insert(dataVec.end(), dvec.begin(), dvec.end());
-			fdsVec.insert(fdsVec.end(), fvec.begin(), fvec.end());
-		}
+		for (auto const &it : data)
+			size += 8 + IPADataSerializer<V>::binarySize(it, cs);
 
-		return { dataVec, fdsVec };
+		return size;
 	}
 
 	static std::vector<V> deserialize(std::vector<uint8_t> &data, ControlSerializer *cs = nullptr)
@@ -208,35 +248,35 @@ public:
 		std::vector<uint8_t> dataVec;
 		std::vector<SharedFD> fdsVec;
 
+		dataVec.reserve(binarySize(data, cs));
+		serialize(data, dataVec, fdsVec, cs);
+
+		return { std::move(dataVec), std::move(fdsVec) };
+	}
+
+	static void serialize(const std::map<K, V> &data, std::vector<uint8_t> &dataVec,
+			      std::vector<SharedFD> &fdsVec, ControlSerializer *cs = nullptr)
+	{
 		/* Serialize the length. */
 		uint32_t mapLen = data.size();
 		appendPOD<uint32_t>(dataVec, mapLen);
 
-		/* Serialize the members. */
+		/* Serialize the members, and patch their size afterwards. */
 		for (auto const &it : data) {
-			std::vector<uint8_t> dvec;
-			std::vector<SharedFD> fvec;
-
-			std::tie(dvec, fvec) =
-				IPADataSerializer<K>::serialize(it.first, cs);
-
-			appendPOD<uint32_t>(dataVec, dvec.size());
-			appendPOD<uint32_t>(dataVec, fvec.size());
-
-			dataVec.insert(dataVec.end(), dvec.begin(), dvec.end());
-			fdsVec.insert(fdsVec.end(), fvec.begin(), fvec.end());
-
-			std::tie(dvec, fvec) =
-				IPADataSerializer<V>::serialize(it.second, cs);
+			serializeElement<K>(it.first, dataVec, fdsVec, cs);
+			serializeElement<V>(it.second, dataVec, fdsVec, cs);
+		}
+	}
 
-			appendPOD<uint32_t>(dataVec, dvec.size());
-			appendPOD<uint32_t>(dataVec, fvec.size());
+	static size_t binarySize(const std::map<K, V> &data, ControlSerializer *cs = nullptr)
+	{
+		size_t size = 4;
 
-			dataVec.insert(dataVec.end(), dvec.begin(), dvec.end());
-			fdsVec.insert(fdsVec.end(), fvec.begin(), fvec.end());
-		}
+		for (auto const &it : data)
+			size += 16 + IPADataSerializer<K>::binarySize(it.first, cs)
+			      + IPADataSerializer<V>::binarySize(it.second, cs);
 
-		return { dataVec, fdsVec };
+		return size;
 	}
 
 	static std::map<K, V> deserialize(std::vector<uint8_t> &data, ControlSerializer *cs = nullptr)
@@ -314,7 +354,20 @@ public:
 		dataVec.reserve(sizeof(Flags<E>));
 		appendPOD<uint32_t>(dataVec, static_cast<typename Flags<E>::Type>(data));
 
-		return { dataVec, {} };
+		return { std::move(dataVec), {} };
+	}
+
+	static void serialize(const Flags<E> &data, std::vector<uint8_t> &dataVec,
+			      [[maybe_unused]] std::vector<SharedFD> &fdsVec,
+			      [[maybe_unused]] ControlSerializer *cs = nullptr)
+	{
+		appendPOD<uint32_t>(dataVec, static_cast<typename Flags<E>::Type>(data));
+	}
+
+	static size_t binarySize([[maybe_unused]] const Flags<E> &data,
+				 [[maybe_unused]] ControlSerializer *cs = nullptr)
+	{
+		return sizeof(uint32_t);
 	}
 
 	static Flags<E> deserialize(std::vector<uint8_t> &data,
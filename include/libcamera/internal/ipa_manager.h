@@ -7,7 +7,9 @@
 
 #pragma once
 
+#include <memory>
 #include <stdint.h>
+#include <string>
 #include <vector>
 
 #include <libcamera/base/log.h>
@@ -16,6 +18,8 @@
 #include <libcamera/ipa/ipa_module_info.h>
 
 #include "libcamera/internal/ipa_module.h"
+#include "libcamera/internal/ipa_module_cache.h"
+#include "libcamera/internal/ipc_pipe.h"
 #include "libcamera/internal/pipeline_handler.h"
 #include "libcamera/internal/pub_key.h"
 
@@ -38,7 +42,12 @@ public:
 		if (!m)
 			return nullptr;
 
-		std::unique_ptr<T> proxy = std::make_unique<T>(m, !self_->isSignatureValid(m));
+		bool isolate = !self_->isSignatureValid(m);
+		std::unique_ptr<T> proxy = std::make_unique<T>(m, isolate,
+							       self_->transport_,
+							       self_->batching_,
+							       !isolate && self_->isInline(m),
+							       self_->deltaEncoding_);
 		if (!proxy->isValid()) {
 			LOG(IPAManager, Error) << "Failed to load proxy";
 			return nullptr;
@@ -47,6 +56,11 @@ public:
 		return proxy;
 	}
 
+	static std::unique_ptr<IPCPipe> createPipe(const std::string &modulePath,
+						   const std::string &workerPath,
+						   IPCPipe::Transport transport);
+	void releaseWorkers();
+
 #if HAVE_IPA_PUBKEY
 	static const PubKey &pubKey()
 	{
@@ -55,6 +69,8 @@ public:
 #endif
 
 private:
+	class WorkerPool;
+
 	static IPAManager *self_;
 
 	void parseDir(const char *libDir, unsigned int maxDepth,
@@ -65,11 +81,21 @@ private:
 			  uint32_t maxVersion);
 
 	bool isSignatureValid(IPAModule *ipa) const;
+	bool isInline(IPAModule *ipa) const;
 
 	std::vector<IPAModule *> modules_;
+	std::unique_ptr<IPAModuleCache> moduleCache_;
+	IPCPipe::Transport transport_;
+	bool batching_;
+	bool deltaEncoding_;
+	std::vector<std::string> inlineModules_;
+
+	unsigned int workerPoolSize_;
+	std::unique_ptr<WorkerPool> workerPool_;
 
 #if HAVE_IPA_PUBKEY
 	static const uint8_t publicKeyData_[];
+	static const Span<const uint8_t> publicKey_;
 	static const PubKey pubKey_;
 #endif
 };
@@ -24,6 +24,7 @@ class IPAModule : public Loggable
 {
 public:
 	explicit IPAModule(const std::string &libPath);
+	IPAModule(const std::string &libPath, const struct IPAModuleInfo &info);
 	~IPAModule();
 
 	bool isValid() const;
@@ -44,6 +45,7 @@ protected:
 
 private:
 	int loadIPAModuleInfo();
+	void loadSignature();
 
 	struct IPAModuleInfo info_;
 	std::vector<uint8_t> signature_;
@@ -0,0 +1,79 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * ipa_module_cache.h - Persistent cache of IPA module information
+ */
+
+#pragma once
+
+#include <map>
+#include <optional>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <libcamera/base/class.h>
+#include <libcamera/base/span.h>
+
+#include <libcamera/ipa/ipa_module_info.h>
+
+namespace libcamera {
+
+class IPAModule;
+
+class IPAModuleCache
+{
+public:
+	IPAModuleCache(const std::string &path, Span<const uint8_t> key);
+
+	const std::string &path() const { return path_; }
+	bool isDirty() const { return dirty_; }
+
+	int load();
+	int save();
+	void invalidate();
+
+	IPAModule *module(const std::string &libPath);
+	void addModule(const IPAModule &module);
+
+	std::optional<bool> signatureValid(const IPAModule &module);
+	void setSignatureValid(const IPAModule &module, bool valid);
+
+private:
+	LIBCAMERA_DISABLE_COPY(IPAModuleCache)
+
+	struct FileId {
+		uint64_t dev;
+		uint64_t ino;
+		uint64_t size;
+		uint64_t mtime;
+		uint64_t ctime;
+
+		bool operator==(const FileId &other) const;
+	};
+
+	enum class Verification : uint32_t {
+		Unknown = 0,
+		Invalid = 1,
+		Valid = 2,
+	};
+
+	struct Entry {
+		FileId id;
+		struct IPAModuleInfo info;
+		std::vector<uint8_t> signature;
+		Verification verification;
+		bool used;
+	};
+
+	static int fileId(const std::string &path, FileId *id);
+	Entry *find(const IPAModule &module);
+
+	std::string path_;
+	uint64_t keyHash_;
+	std::map<std::string, Entry> entries_;
+	bool dirty_;
+};
+
+} /* namespace libcamera */
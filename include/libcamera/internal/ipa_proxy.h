@@ -33,8 +33,9 @@ public:
 
 	std::string configurationFile(const std::string &file) const;
 
+	static std::string resolvePath(const std::string &file);
+
 protected:
-	std::string resolvePath(const std::string &file) const;
 
 	bool valid_;
 	ProxyState state_;
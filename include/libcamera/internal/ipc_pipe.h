@@ -7,8 +7,12 @@
 
 #pragma once
 
+#include <array>
+#include <memory>
+#include <sys/uio.h>
 #include <vector>
 
+#include <libcamera/base/object.h>
 #include <libcamera/base/shared_fd.h>
 #include <libcamera/base/signal.h>
 
@@ -24,12 +28,19 @@ public:
 		uint32_t cookie;
 	};
 
+	static constexpr uint32_t kBatchCmd = 0xffffffff;
+
 	IPCMessage();
 	IPCMessage(uint32_t cmd);
 	IPCMessage(const Header &header);
 	IPCMessage(IPCUnixSocket::Payload &payload);
 
 	IPCUnixSocket::Payload payload() const;
+	std::array<struct iovec, 2> iov() const;
+	std::vector<int32_t> fdNumbers() const;
+
+	void append(const IPCMessage &message);
+	int split(std::vector<IPCMessage> *messages) const;
 
 	Header &header() { return header_; }
 	std::vector<uint8_t> &data() { return data_; }
@@ -46,23 +57,40 @@ private:
 	std::vector<SharedFD> fds_;
 };
 
-class IPCPipe
+class IPCPipe : public Object
 {
 public:
+	enum class Transport {
+		UnixSocket,
+		SharedMemory,
+	};
+
 	IPCPipe();
 	virtual ~IPCPipe();
 
 	bool isConnected() const { return connected_; }
 
+	void setBatching(bool enable);
+
 	virtual int sendSync(const IPCMessage &in,
-			     IPCMessage *out) = 0;
+			     IPCMessage *out = nullptr) = 0;
 
 	virtual int sendAsync(const IPCMessage &data) = 0;
 
 	Signal<const IPCMessage &> recv;
 
 protected:
+	static constexpr size_t kMaxBatchSize = 64 * 1024;
+	static constexpr size_t kMaxBatchFds = 64;
+
+	bool batch(const IPCMessage &message);
+	void flush();
+
 	bool connected_;
+
+private:
+	bool batching_;
+	std::unique_ptr<IPCMessage> batch_;
 };
 
 } /* namespace libcamera */
@@ -0,0 +1,46 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * ipc_pipe_shm.h - Image Processing Algorithm IPC module using shared memory
+ */
+
+#pragma once
+
+#include <map>
+#include <memory>
+
+#include "libcamera/internal/ipc_pipe.h"
+#include "libcamera/internal/ipc_shm_channel.h"
+
+namespace libcamera {
+
+class Process;
+
+class IPCPipeShm : public IPCPipe
+{
+public:
+	IPCPipeShm(const char *ipaModulePath, const char *ipaProxyWorkerPath);
+	~IPCPipeShm();
+
+	int sendSync(const IPCMessage &in,
+		     IPCMessage *out = nullptr) override;
+
+	int sendAsync(const IPCMessage &data) override;
+
+private:
+	struct CallData {
+		IPCShmChannel::Payload *response;
+		bool done;
+	};
+
+	void readyRead();
+	int call(const IPCMessage &message,
+		 IPCShmChannel::Payload *response, uint32_t cookie);
+
+	std::unique_ptr<Process> proc_;
+	std::unique_ptr<IPCShmChannel> channel_;
+	std::map<uint32_t, CallData> callData_;
+};
+
+} /* namespace libcamera */
@@ -36,7 +36,7 @@ private:
 	};
 
 	void readyRead();
-	int call(const IPCUnixSocket::Payload &message,
+	int call(const IPCMessage &message,
 		 IPCUnixSocket::Payload *response, uint32_t seq);
 
 	std::unique_ptr<Process> proc_;
@@ -0,0 +1,76 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * ipc_shm_channel.h - IPC mechanism based on shared memory rings
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+#include <vector>
+
+#include <libcamera/base/class.h>
+#include <libcamera/base/signal.h>
+#include <libcamera/base/span.h>
+#include <libcamera/base/unique_fd.h>
+
+#include "libcamera/internal/ipc_unixsocket.h"
+
+namespace libcamera {
+
+class EventNotifier;
+class Object;
+
+class IPCShmChannel
+{
+public:
+	using Payload = IPCUnixSocket::Payload;
+
+	static constexpr size_t kDefaultRingSize = 256 * 1024;
+
+	IPCShmChannel(Object *parent = nullptr);
+	~IPCShmChannel();
+
+	UniqueFD create(size_t ringSize = kDefaultRingSize);
+	int bind(UniqueFD fd);
+	void close();
+	bool isBound() const;
+
+	int send(const Payload &payload);
+	int send(Span<const struct iovec> iov, Span<const int32_t> fds);
+	int receive(Payload *payload);
+
+	Signal<> readyRead;
+
+private:
+	LIBCAMERA_DISABLE_COPY_AND_MOVE(IPCShmChannel)
+
+	struct Ring;
+
+	void drop();
+	int map(UniqueFD memfd, size_t ringSize, unsigned int tx);
+	int sendSocket(Span<const struct iovec> iov,
+		       const int32_t *fds, unsigned int num);
+	int recvSocket(void *data, size_t length,
+		       int32_t *fds, unsigned int num);
+
+	void doorbell();
+	void dispatch();
+
+	UniqueFD socket_;
+	UniqueFD txDoorbell_;
+	UniqueFD rxDoorbell_;
+	Object *parent_;
+	EventNotifier *notifier_;
+
+	void *mem_;
+	size_t memSize_;
+	size_t ringSize_;
+	Ring *tx_;
+	Ring *rx_;
+};
+
+} /* namespace libcamera */
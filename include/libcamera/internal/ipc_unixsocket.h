@@ -9,14 +9,17 @@
 
 #include <stdint.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <vector>
 
 #include <libcamera/base/signal.h>
+#include <libcamera/base/span.h>
 #include <libcamera/base/unique_fd.h>
 
 namespace libcamera {
 
 class EventNotifier;
+class Object;
 
 class IPCUnixSocket
 {
@@ -26,7 +29,7 @@ public:
 		std::vector<int32_t> fds;
 	};
 
-	IPCUnixSocket();
+	IPCUnixSocket(Object *parent = nullptr);
 	~IPCUnixSocket();
 
 	UniqueFD create();
@@ -35,6 +38,7 @@ public:
 	bool isBound() const;
 
 	int send(const Payload &payload);
+	int send(Span<const struct iovec> iov, Span<const int32_t> fds);
 	int receive(Payload *payload);
 
 	Signal<> readyRead;
@@ -45,7 +49,7 @@ private:
 		uint8_t fds;
 	};
 
-	int sendData(const void *buffer, size_t length, const int32_t *fds, unsigned int num);
+	int sendData(Span<const struct iovec> iov, const int32_t *fds, unsigned int num);
 	int recvData(void *buffer, size_t length, int32_t *fds, unsigned int num);
 
 	void dataNotifier();
@@ -53,6 +57,7 @@ private:
 	UniqueFD fd_;
 	bool headerReceived_;
 	struct Header header_;
+	Object *parent_;
 	EventNotifier *notifier_;
 };
 
@@ -48,6 +48,8 @@ public:
 	bool acquire();
 	void release(Camera *camera);
 
+	int initialize(Camera *camera);
+
 	virtual std::unique_ptr<CameraConfiguration> generateConfiguration(Camera *camera,
 									   Span<const StreamRole> roles) = 0;
 	virtual int configure(Camera *camera, CameraConfiguration *config) = 0;
@@ -71,13 +73,16 @@ public:
 	const char *name() const { return name_; }
 
 protected:
-	void registerCamera(std::shared_ptr<Camera> camera);
+	void registerCamera(std::shared_ptr<Camera> camera, bool initialized = true);
 	void hotplugMediaDevice(MediaDevice *media);
 
+	bool lazyCameraInit() const;
+
 	virtual int queueRequestDevice(Camera *camera, Request *request) = 0;
 	virtual void stopDevice(Camera *camera) = 0;
 
 	virtual void releaseDevice(Camera *camera);
+	virtual int initializeDevice(Camera *camera);
 
 	CameraManager *manager_;
 
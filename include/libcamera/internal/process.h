@@ -7,10 +7,12 @@
 
 #pragma once
 
+#include <list>
 #include <signal.h>
 #include <string>
 #include <vector>
 
+#include <libcamera/base/mutex.h>
 #include <libcamera/base/signal.h>
 #include <libcamera/base/unique_fd.h>
 
@@ -73,6 +75,7 @@ private:
 
 	void sighandler();
 
+	Mutex mutex_;
 	std::list<Process *> processes_;
 
 	struct sigaction oldsa_;
@@ -16,6 +16,8 @@
 
 #include <libcamera/request.h>
 
+#include "libcamera/internal/control_arena.h"
+
 using namespace std::chrono_literals;
 
 namespace libcamera {
@@ -59,6 +61,9 @@ private:
 	std::unordered_set<FrameBuffer *> pending_;
 	std::map<FrameBuffer *, std::unique_ptr<EventNotifier>> notifiers_;
 	std::unique_ptr<Timer> timer_;
+
+	ControlArena controlsArena_;
+	ControlArena metadataArena_;
 };
 
 } /* namespace libcamera */
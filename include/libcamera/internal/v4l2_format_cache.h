@@ -0,0 +1,57 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * v4l2_format_cache.h - Persistent cache of V4L2 format enumeration results
+ */
+
+#pragma once
+
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <libcamera/base/class.h>
+
+#include <libcamera/geometry.h>
+
+namespace libcamera {
+
+class MediaEntity;
+
+class V4L2FormatCache
+{
+public:
+	using Formats = std::map<uint32_t, std::vector<SizeRange>>;
+
+	V4L2FormatCache(const std::string &path);
+	~V4L2FormatCache();
+
+	static V4L2FormatCache *instance() { return self_; }
+
+	const std::string &path() const { return path_; }
+	bool isDirty() const { return dirty_; }
+
+	int load();
+	int save();
+	void invalidate();
+
+	static std::string key(const MediaEntity *entity, const char *type,
+			       unsigned int index);
+
+	const Formats *formats(const std::string &key) const;
+	void setFormats(const std::string &key, const Formats &formats);
+
+private:
+	LIBCAMERA_DISABLE_COPY(V4L2FormatCache)
+
+	static V4L2FormatCache *self_;
+
+	std::string path_;
+	std::string kernel_;
+	std::map<std::string, Formats> entries_;
+	bool dirty_;
+};
+
+} /* namespace libcamera */
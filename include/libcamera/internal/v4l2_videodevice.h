@@ -9,11 +9,14 @@
 
 #include <array>
 #include <atomic>
+#include <limits>
 #include <memory>
 #include <optional>
 #include <ostream>
 #include <stdint.h>
 #include <string>
+#include <sys/types.h>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
@@ -22,6 +25,7 @@
 #include <libcamera/base/class.h>
 #include <libcamera/base/log.h>
 #include <libcamera/base/signal.h>
+#include <libcamera/base/span.h>
 #include <libcamera/base/timer.h>
 #include <libcamera/base/unique_fd.h>
 #include <libcamera/base/utils.h>
@@ -124,6 +128,12 @@ struct V4L2Capability final : v4l2_capability {
 class V4L2BufferCache
 {
 public:
+	struct Statistics {
+		uint64_t hits;
+		uint64_t misses;
+		uint64_t evictions;
+	};
+
 	V4L2BufferCache(unsigned int numEntries);
 	V4L2BufferCache(const std::vector<std::unique_ptr<FrameBuffer>> &buffers);
 	~V4L2BufferCache();
@@ -132,36 +142,49 @@ public:
 	int get(const FrameBuffer &buffer);
 	void put(unsigned int index);
 
+	const Statistics &statistics() const { return stats_; }
+
 private:
+	static constexpr unsigned int kNoEntry = std::numeric_limits<unsigned int>::max();
+
 	class Entry
 	{
 	public:
 		Entry();
-		Entry(bool free, uint64_t lastUsed, const FrameBuffer &buffer);
 
+		static uint64_t hash(const FrameBuffer &buffer);
+
+		bool isValid() const { return !planes_.empty(); }
+		void set(const FrameBuffer &buffer, uint64_t key);
 		bool operator==(const FrameBuffer &buffer) const;
 
 		bool free_;
-		uint64_t lastUsed_;
+		uint64_t key_;
+
+		/* Links in the list of free entries, in release order. */
+		unsigned int prev_;
+		unsigned int next_;
 
 	private:
 		struct Plane {
-			Plane(const FrameBuffer::Plane &plane)
-				: fd(plane.fd.get()), length(plane.length)
-			{
-			}
-
-			int fd;
+			ino_t inode;
+			unsigned int offset;
 			unsigned int length;
 		};
 
 		std::vector<Plane> planes_;
 	};
 
-	std::atomic<uint64_t> lastUsedCounter_;
+	void take(unsigned int index);
+	void release(unsigned int index);
+
 	std::vector<Entry> cache_;
-	/* \todo Expose the miss counter through an instrumentation API. */
-	unsigned int missCounter_;
+	std::unordered_multimap<uint64_t, unsigned int> index_;
+	unsigned int freeHead_;
+	unsigned int freeTail_;
+	unsigned int used_;
+
+	Statistics stats_;
 };
 
 class V4L2DeviceFormat
@@ -218,14 +241,26 @@ public:
 	int releaseBuffers();
 
 	int queueBuffer(FrameBuffer *buffer);
+	int queueBuffers(Span<FrameBuffer *const> buffers,
+			 unsigned int *queued = nullptr);
 	Signal<FrameBuffer *> bufferReady;
 
+	struct DequeueStatistics {
+		unsigned int wakeups;
+		unsigned int buffers;
+	};
+
+	V4L2BufferCache::Statistics bufferCacheStatistics() const;
+	const DequeueStatistics &dequeueStatistics() const { return dequeueStats_; }
+
 	int streamOn();
 	int streamOff();
 
 	void setDequeueTimeout(utils::Duration timeout);
 	Signal<> dequeueTimeout;
 
+	void setDequeueDrain(bool drain) { drain_ = drain; }
+
 	static std::unique_ptr<V4L2VideoDevice>
 	fromEntityName(const MediaDevice *media, const std::string &entity);
 
@@ -263,6 +298,8 @@ private:
 	std::unique_ptr<FrameBuffer> createBuffer(unsigned int index);
 	UniqueFD exportDmabufFd(unsigned int index, unsigned int plane);
 
+	int doQueueBuffer(FrameBuffer *buffer);
+
 	void bufferAvailable();
 	FrameBuffer *dequeueBuffer();
 
@@ -271,6 +308,7 @@ private:
 	template<typename T>
 	static std::optional<ColorSpace> toColorSpace(const T &v4l2Format);
 
+	const MediaEntity *entity_;
 	V4L2Capability caps_;
 	V4L2DeviceFormat format_;
 	const PixelFormatInfo *formatInfo_;
@@ -283,6 +321,8 @@ private:
 	std::map<unsigned int, FrameBuffer *> queuedBuffers_;
 
 	EventNotifier *fdBufferNotifier_;
+	bool drain_;
+	DequeueStatistics dequeueStats_;
 
 	State state_;
 	std::optional<unsigned int> firstFrame_;
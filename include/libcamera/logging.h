@@ -14,10 +14,12 @@ enum LoggingTarget {
 	LoggingTargetSyslog,
 	LoggingTargetFile,
 	LoggingTargetStream,
+	LoggingTargetBinary,
 };
 
 int logSetFile(const char *path, bool color = false);
 int logSetStream(std::ostream *stream, bool color = false);
+int logSetBinaryFile(const char *path);
 int logSetTarget(LoggingTarget target);
 void logSetLevel(const char *category, const char *level);
 
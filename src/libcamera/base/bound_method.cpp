@@ -6,7 +6,12 @@
  */
 
 #include <libcamera/base/bound_method.h>
+
+#include <atomic>
+#include <new>
+
 #include <libcamera/base/message.h>
+#include <libcamera/base/mutex.h>
 #include <libcamera/base/semaphore.h>
 #include <libcamera/base/thread.h>
 
@@ -17,6 +22,155 @@
 
 namespace libcamera {
 
+namespace details {
+
+namespace {
+
+/*
+ * The message pool recycles the memory of the messages, bound methods and
+ * argument packs used for cross-thread invocation, to avoid heap allocations
+ * in the common case of small argument lists. Blocks are grouped in power of
+ * two size classes. Freed blocks are pushed to a lock-free stack per size
+ * class, as they are typically freed by the thread receiving messages. Popping
+ * blocks is serialized by a mutex, which prevents the ABA problem without
+ * involving the receiving thread. The pool is not tied to any thread, blocks
+ * freed by a thread that has since exited are reused by other threads. Each
+ * free list is capped to kPoolMaxFreeBlocks, blocks freed beyond the cap are
+ * returned to the heap, to bound the memory retained after a burst of
+ * in-flight messages.
+ */
+constexpr size_t kPoolMinBlockSize = 32;
+constexpr unsigned int kPoolSizeClasses = 5;
+constexpr unsigned int kPoolMaxFreeBlocks = 256;
+
+struct PoolBlock {
+	PoolBlock *next;
+};
+
+struct PoolSizeClass {
+	std::atomic<PoolBlock *> freeList;
+	std::atomic<unsigned int> freeBlocks;
+	Mutex mutex;
+};
+
+PoolSizeClass poolSizeClasses[kPoolSizeClasses];
+std::atomic<uint64_t> poolHeapAllocations;
+std::atomic<uint64_t> poolHeapFrees;
+std::atomic<uint64_t> poolOversizedAllocations;
+
+int poolSizeClass(size_t size)
+{
+	size_t blockSize = kPoolMinBlockSize;
+
+	for (unsigned int i = 0; i < kPoolSizeClasses; ++i, blockSize <<= 1) {
+		if (size <= blockSize)
+			return i;
+	}
+
+	return -1;
+}
+
+} /* namespace */
+
+/**
+ * \brief Allocate memory from the message pool
+ * \param[in] size The allocation size in bytes
+ *
+ * Allocations that are too large for the pool are forwarded to the global
+ * operator new.
+ *
+ * \context This function is \threadsafe.
+ *
+ * \return A pointer to the allocated memory
+ */
+void *messagePoolAllocate(size_t size)
+{
+	int index = poolSizeClass(size);
+	if (index < 0) {
+		poolOversizedAllocations.fetch_add(1, std::memory_order_relaxed);
+		return ::operator new(size);
+	}
+
+	PoolSizeClass &sizeClass = poolSizeClasses[index];
+
+	{
+		MutexLocker locker(sizeClass.mutex);
+
+		PoolBlock *block = sizeClass.freeList.load(std::memory_order_acquire);
+		while (block) {
+			if (sizeClass.freeList.compare_exchange_weak(block, block->next,
+								     std::memory_order_acquire)) {
+				sizeClass.freeBlocks.fetch_sub(1, std::memory_order_relaxed);
+				return block;
+			}
+		}
+	}
+
+	poolHeapAllocations.fetch_add(1, std::memory_order_relaxed);
+	return ::operator new(kPoolMinBlockSize << index);
+}
+
+/**
+ * \brief Free memory allocated with messagePoolAllocate()
+ * \param[in] ptr The memory to free
+ * \param[in] size The size passed to messagePoolAllocate()
+ *
+ * The memory is returned to the heap if the free list of the size class is
+ * full.
+ *
+ * \context This function is \threadsafe and lock-free.
+ */
+void messagePoolFree(void *ptr, size_t size)
+{
+	int index = poolSizeClass(size);
+	if (index < 0) {
+		::operator delete(ptr);
+		return;
+	}
+
+	PoolSizeClass &sizeClass = poolSizeClasses[index];
+
+	if (sizeClass.freeBlocks.fetch_add(1, std::memory_order_relaxed) >=
+	    kPoolMaxFreeBlocks) {
+		sizeClass.freeBlocks.fetch_sub(1, std::memory_order_relaxed);
+		poolHeapFrees.fetch_add(1, std::memory_order_relaxed);
+		::operator delete(ptr);
+		return;
+	}
+
+	PoolBlock *block = static_cast<PoolBlock *>(ptr);
+
+	PoolBlock *head = sizeClass.freeList.load(std::memory_order_relaxed);
+	do {
+		block->next = head;
+	} while (!sizeClass.freeList.compare_exchange_weak(head, block,
+							   std::memory_order_release,
+							   std::memory_order_relaxed));
+}
+
+/**
+ * \brief Retrieve the message pool allocation counters
+ *
+ * The heapAllocations counter reports the number of allocations that could
+ * not be served from the pool and had to grow it. In steady state, it is
+ * expected to remain constant. The heapFrees counter reports the number of
+ * blocks returned to the heap because their free list was full. The
+ * oversizedAllocations counter reports the number of allocations too large to
+ * be handled by the pool.
+ *
+ * \return The message pool allocation counters
+ */
+MessagePoolStatistics messagePoolStatistics()
+{
+	return {
+		poolHeapAllocations.load(std::memory_order_relaxed),
+		poolHeapFrees.load(std::memory_order_relaxed),
+		poolOversizedAllocations.load(std::memory_order_relaxed),
+	};
+}
+
+} /* namespace details */
+
 /**
  * \enum ConnectionType
  * \brief Connection type for asynchronous communication
@@ -49,6 +203,85 @@ namespace libcamera {
  * blocks until the receiver signals the completion of the invocation.
  */
 
+/**
+ * \brief Allocate memory for a bound method from the message pool
+ * \param[in] size The allocation size in bytes
+ *
+ * Bound methods created for queued invocations are allocated from the pool of
+ * recycled memory blocks shared with messages.
+ *
+ * \return A pointer to the allocated memory
+ */
+void *BoundMethodBase::operator new(size_t size)
+{
+	return details::messagePoolAllocate(size);
+}
+
+/**
+ * \brief Return the memory of a bound method to the message pool
+ * \param[in] ptr The memory to free
+ * \param[in] size The allocation size in bytes
+ */
+void BoundMethodBase::operator delete(void *ptr, size_t size)
+{
+	details::messagePoolFree(ptr, size);
+}
+
+/**
+ * \class BoundMethodBase::PackAllocator
+ * \brief Allocator for argument packs of queued invocations
+ *
+ * The PackAllocator is used with std::allocate_shared() to allocate argument
+ * packs from the message pool. Types with extended alignment requirements are
+ * allocated with std::allocator.
+ */
+
+/**
+ * \brief Allocate memory for an argument pack from the message pool
+ * \param[in] size The allocation size in bytes
+ * \return A pointer to the allocated memory
+ */
+void *BoundMethodBase::allocatePack(size_t size)
+{
+	return details::messagePoolAllocate(size);
+}
+
+/**
+ * \brief Return the memory of an argument pack to the message pool
+ * \param[in] ptr The memory to free
+ * \param[in] size The size passed to allocatePack()
+ */
+void BoundMethodBase::freePack(void *ptr, size_t size)
+{
+	details::messagePoolFree(ptr, size);
+}
+
+/**
+ * \brief Resolve the connection type for an invocation from the current thread
+ *
+ * ConnectionTypeAuto is resolved to ConnectionTypeDirect or
+ * ConnectionTypeQueued, and ConnectionTypeBlocking to ConnectionTypeDirect,
+ * depending on whether the caller runs in the thread of the bound object.
+ * Direct invocations can then call the method without packing the arguments.
+ *
+ * \return The effective connection type
+ */
+ConnectionType BoundMethodBase::resolveConnectionType() const
+{
+	ConnectionType type = connectionType_;
+	if (type == ConnectionTypeAuto) {
+		if (Thread::current() == object_->thread())
+			type = ConnectionTypeDirect;
+		else
+			type = ConnectionTypeQueued;
+	} else if (type == ConnectionTypeBlocking) {
+		if (Thread::current() == object_->thread())
+			type = ConnectionTypeDirect;
+	}
+
+	return type;
+}
+
 /**
  * \brief Invoke the bound method with packed arguments
  * \param[in] pack Packed arguments
@@ -67,16 +300,7 @@ namespace libcamera {
 bool BoundMethodBase::activatePack(std::shared_ptr<BoundMethodPackBase> pack,
 				   bool deleteMethod)
 {
-	ConnectionType type = connectionType_;
-	if (type == ConnectionTypeAuto) {
-		if (Thread::current() == object_->thread())
-			type = ConnectionTypeDirect;
-		else
-			type = ConnectionTypeQueued;
-	} else if (type == ConnectionTypeBlocking) {
-		if (Thread::current() == object_->thread())
-			type = ConnectionTypeDirect;
-	}
+	ConnectionType type = resolveConnectionType();
 
 	switch (type) {
 	case ConnectionTypeDirect:
@@ -88,7 +312,8 @@ bool BoundMethodBase::activatePack(std::shared_ptr<BoundMethodPackBase> pack,
 
 	case ConnectionTypeQueued: {
 		std::unique_ptr<Message> msg =
-			std::make_unique<InvokeMessage>(this, pack, nullptr, deleteMethod);
+			std::make_unique<InvokeMessage>(this, std::move(pack), nullptr,
+							deleteMethod);
 		object_->postMessage(std::move(msg));
 		return false;
 	}
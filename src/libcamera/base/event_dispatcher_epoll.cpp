@@ -0,0 +1,414 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * event_dispatcher_epoll.cpp - Epoll-based event dispatcher
+ */
+
+#include <libcamera/base/event_dispatcher_epoll.h>
+
+#include <errno.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <libcamera/base/event_notifier.h>
+#include <libcamera/base/log.h>
+#include <libcamera/base/thread.h>
+#include <libcamera/base/timer.h>
+
+/**
+ * \file base/event_dispatcher_epoll.h
+ */
+
+namespace libcamera {
+
+LOG_DECLARE_CATEGORY(Event)
+
+static const char *notifierType(EventNotifier::Type type)
+{
+	if (type == EventNotifier::Read)
+		return "read";
+	if (type == EventNotifier::Write)
+		return "write";
+	if (type == EventNotifier::Exception)
+		return "exception";
+
+	return "";
+}
+
+/**
+ * \class EventDispatcherEpoll
+ * \brief An epoll-based event dispatcher
+ *
+ * The EventDispatcherEpoll class implements the EventDispatcher interface on
+ * top of the Linux epoll API. Unlike the EventDispatcherPoll, which rebuilds
+ * the array of monitored file descriptors on every iteration of the event
+ * loop, this dispatcher keeps a persistent epoll interest set that is only
+ * updated when event notifiers are registered or unregistered. Events reported
+ * by epoll carry a pointer to the notifiers associated with the file
+ * descriptor, which are then signalled without any further lookup. The cost of
+ * an event loop iteration is thus proportional to the number of active file
+ * descriptors instead of the number of monitored file descriptors.
+ *
+ * Timers are stored in a TimerWheel, and the expiry time of the first timer is
+ * programmed on a timerfd included in the interest set.
+ *
+ * As epoll doesn't report invalid file descriptors, closing a file descriptor
+ * without first disabling the notifiers that monitor it silently stops event
+ * delivery, instead of disabling the notifiers as EventDispatcherPoll does.
+ *
+ * The dispatcher can be selected for a thread with Thread::setEventDispatcher().
+ */
+
+EventDispatcherEpoll::EventDispatcherEpoll()
+	: processingEvents_(false)
+{
+	/*
+	 * Create the epoll, event and timer fds. Failures are fatal as we can't
+	 * implement an interruptible dispatcher without them.
+	 */
+	epollfd_ = UniqueFD(epoll_create1(EPOLL_CLOEXEC));
+	if (!epollfd_.isValid())
+		LOG(Event, Fatal) << "Unable to create epoll fd";
+
+	eventfd_ = UniqueFD(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK));
+	if (!eventfd_.isValid())
+		LOG(Event, Fatal) << "Unable to create eventfd";
+
+	timerfd_ = UniqueFD(timerfd_create(CLOCK_MONOTONIC,
+					   TFD_CLOEXEC | TFD_NONBLOCK));
+	if (!timerfd_.isValid())
+		LOG(Event, Fatal) << "Unable to create timerfd";
+
+	/*
+	 * The internal file descriptors are identified in the epoll events by
+	 * the address of the corresponding UniqueFD member, which can't clash
+	 * with the address of a notifiers set.
+	 */
+	struct epoll_event event = {};
+	event.events = EPOLLIN;
+	event.data.ptr = &eventfd_;
+	if (epoll_ctl(epollfd_.get(), EPOLL_CTL_ADD, eventfd_.get(), &event) < 0)
+		LOG(Event, Fatal) << "Unable to monitor eventfd";
+
+	event.data.ptr = &timerfd_;
+	if (epoll_ctl(epollfd_.get(), EPOLL_CTL_ADD, timerfd_.get(), &event) < 0)
+		LOG(Event, Fatal) << "Unable to monitor timerfd";
+}
+
+EventDispatcherEpoll::~EventDispatcherEpoll()
+{
+}
+
+void EventDispatcherEpoll::registerEventNotifier(EventNotifier *notifier)
+{
+	auto result = notifiers_.try_emplace(notifier->fd());
+	EventNotifierSetEpoll &set = result.first->second;
+	EventNotifier::Type type = notifier->type();
+
+	if (result.second)
+		set = { notifier->fd(), { nullptr, nullptr, nullptr } };
+
+	if (set.notifiers[type] && set.notifiers[type] != notifier) {
+		LOG(Event, Warning)
+			<< "Ignoring duplicate " << notifierType(type)
+			<< " notifier for fd " << notifier->fd();
+		return;
+	}
+
+	uint32_t oldEvents = set.events();
+	set.notifiers[type] = notifier;
+
+	if (set.events() == oldEvents)
+		return;
+
+	int ret = updateInterest(&set, oldEvents);
+	if (ret < 0) {
+		LOG(Event, Error)
+			<< "Failed to register " << notifierType(type)
+			<< " notifier for fd " << notifier->fd() << ": "
+			<< strerror(-ret);
+
+		set.notifiers[type] = nullptr;
+		if (set.empty())
+			releaseSet(result.first);
+	}
+}
+
+void EventDispatcherEpoll::unregisterEventNotifier(EventNotifier *notifier)
+{
+	auto iter = notifiers_.find(notifier->fd());
+	if (iter == notifiers_.end())
+		return;
+
+	EventNotifierSetEpoll &set = iter->second;
+	EventNotifier::Type type = notifier->type();
+
+	if (!set.notifiers[type])
+		return;
+
+	if (set.notifiers[type] != notifier) {
+		LOG(Event, Warning)
+			<< notifierType(type) << " notifier for fd "
+			<< notifier->fd() << " is not registered";
+		return;
+	}
+
+	uint32_t oldEvents = set.events();
+	set.notifiers[type] = nullptr;
+
+	/*
+	 * The file descriptor may already have been closed, in which case the
+	 * kernel has removed it from the interest set already. Ignore errors.
+	 */
+	updateInterest(&set, oldEvents);
+
+	if (set.empty())
+		releaseSet(iter);
+}
+
+void EventDispatcherEpoll::registerTimer(Timer *timer)
+{
+	timers_.insert(timer);
+}
+
+void EventDispatcherEpoll::unregisterTimer(Timer *timer)
+{
+	timers_.remove(timer);
+}
+
+void EventDispatcherEpoll::processEvents()
+{
+	int ret;
+
+	Thread::current()->dispatchMessages();
+
+	armTimerFd();
+
+	/* Wait for events and process notifiers and timers. */
+	do {
+		ret = wait(&events_);
+	} while (ret == -1 && errno == EINTR);
+
+	if (ret < 0) {
+		ret = -errno;
+		LOG(Event, Warning) << "epoll_wait() failed with " << strerror(-ret);
+	} else if (ret > 0) {
+		processingEvents_ = true;
+
+		for (int i = 0; i < ret; ++i) {
+			const struct epoll_event &event = events_[i];
+
+			if (event.data.ptr == &eventfd_)
+				processInterrupt();
+			else if (event.data.ptr == &timerfd_)
+				processTimerFd();
+			else
+				processNotifiers(static_cast<EventNotifierSetEpoll *>(event.data.ptr),
+						 event.events);
+		}
+
+		processingEvents_ = false;
+
+		/*
+		 * Erase the notifiers sets that have been emptied while
+		 * processing events, unless they have been reused in the
+		 * meantime.
+		 */
+		for (int fd : staleSets_) {
+			auto iter = notifiers_.find(fd);
+			if (iter != notifiers_.end() && iter->second.empty())
+				notifiers_.erase(iter);
+		}
+
+		staleSets_.clear();
+	}
+
+	processTimers();
+}
+
+void EventDispatcherEpoll::interrupt()
+{
+	uint64_t value = 1;
+	ssize_t ret = write(eventfd_.get(), &value, sizeof(value));
+	if (ret != sizeof(value)) {
+		if (ret < 0)
+			ret = -errno;
+		LOG(Event, Error)
+			<< "Failed to interrupt event dispatcher ("
+			<< ret << ")";
+	}
+}
+
+uint32_t EventDispatcherEpoll::EventNotifierSetEpoll::events() const
+{
+	uint32_t events = 0;
+
+	if (notifiers[EventNotifier::Read])
+		events |= EPOLLIN;
+	if (notifiers[EventNotifier::Write])
+		events |= EPOLLOUT;
+	if (notifiers[EventNotifier::Exception])
+		events |= EPOLLPRI;
+
+	return events;
+}
+
+bool EventDispatcherEpoll::EventNotifierSetEpoll::empty() const
+{
+	return !notifiers[0] && !notifiers[1] && !notifiers[2];
+}
+
+int EventDispatcherEpoll::updateInterest(EventNotifierSetEpoll *set,
+					 uint32_t oldEvents)
+{
+	struct epoll_event event = {};
+	event.events = set->events();
+	event.data.ptr = set;
+
+	int op;
+	if (!oldEvents)
+		op = EPOLL_CTL_ADD;
+	else if (!event.events)
+		op = EPOLL_CTL_DEL;
+	else
+		op = EPOLL_CTL_MOD;
+
+	int ret = epoll_ctl(epollfd_.get(), op, set->fd, &event);
+	if (ret < 0)
+		return -errno;
+
+	return 0;
+}
+
+void EventDispatcherEpoll::releaseSet(std::map<int, EventNotifierSetEpoll>::iterator iter)
+{
+	/*
+	 * Don't race with event processing if this function is called from an
+	 * event notifier, as pending events may still reference the set. The
+	 * notifiers_ entry will be erased by processEvents().
+	 */
+	if (processingEvents_) {
+		staleSets_.push_back(iter->first);
+		return;
+	}
+
+	notifiers_.erase(iter);
+}
+
+int EventDispatcherEpoll::wait(std::vector<struct epoll_event> *events)
+{
+	/*
+	 * Size the events array to report all file descriptors in one go. The
+	 * array only grows, and is reused across iterations.
+	 */
+	size_t size = notifiers_.size() + 2;
+	if (events->size() < size)
+		events->resize(size);
+
+	return epoll_wait(epollfd_.get(), events->data(), events->size(), -1);
+}
+
+void EventDispatcherEpoll::processInterrupt()
+{
+	uint64_t value;
+	ssize_t ret = read(eventfd_.get(), &value, sizeof(value));
+	if (ret != sizeof(value)) {
+		if (ret < 0)
+			ret = -errno;
+		LOG(Event, Error)
+			<< "Failed to process interrupt (" << ret << ")";
+	}
+}
+
+void EventDispatcherEpoll::processTimerFd()
+{
+	uint64_t expirations;
+	ssize_t ret = read(timerfd_.get(), &expirations, sizeof(expirations));
+	if (ret < 0 && errno == EAGAIN)
+		return;
+
+	if (ret != sizeof(expirations)) {
+		if (ret < 0)
+			ret = -errno;
+		LOG(Event, Error)
+			<< "Failed to process timer expiration (" << ret << ")";
+	}
+
+	/* The timerfd is a one-shot timer, it needs to be rearmed. */
+	armedDeadline_ = {};
+}
+
+void EventDispatcherEpoll::processNotifiers(EventNotifierSetEpoll *set,
+					    uint32_t events)
+{
+	static const struct {
+		EventNotifier::Type type;
+		uint32_t events;
+	} types[] = {
+		{ EventNotifier::Read, EPOLLIN },
+		{ EventNotifier::Write, EPOLLOUT },
+		{ EventNotifier::Exception, EPOLLPRI },
+	};
+
+	for (const auto &type : types) {
+		/*
+		 * The notifier may have been unregistered by a previous
+		 * activation, including from the same loop iteration.
+		 */
+		EventNotifier *notifier = set->notifiers[type.type];
+		if (!notifier)
+			continue;
+
+		if (events & type.events)
+			notifier->activated.emit();
+	}
+}
+
+void EventDispatcherEpoll::processTimers()
+{
+	timers_.expire(utils::clock::now());
+
+	while (Timer *timer = timers_.takeExpired()) {
+		timer->stop();
+		timer->timeout.emit();
+	}
+}
+
+void EventDispatcherEpoll::armTimerFd()
+{
+	/*
+	 * Program the timerfd with the expiry time of the first timer. Skip the
+	 * system call if the deadline hasn't changed. If there's no timer
+	 * left, leave the timerfd armed, a spurious wakeup is cheaper than
+	 * disarming it.
+	 */
+	if (timers_.empty())
+		return;
+
+	utils::time_point deadline = timers_.nextExpiry();
+	if (deadline == armedDeadline_)
+		return;
+
+	struct itimerspec spec = {};
+	spec.it_value = utils::duration_to_timespec(deadline.time_since_epoch());
+
+	/* A zero it_value disarms the timer, make sure it expires instead. */
+	if (!spec.it_value.tv_sec && !spec.it_value.tv_nsec)
+		spec.it_value.tv_nsec = 1;
+
+	int ret = timerfd_settime(timerfd_.get(), TFD_TIMER_ABSTIME, &spec, nullptr);
+	if (ret < 0) {
+		ret = -errno;
+		LOG(Event, Error)
+			<< "Failed to arm timer: " << strerror(-ret);
+		return;
+	}
+
+	armedDeadline_ = deadline;
+}
+
+} /* namespace libcamera */
@@ -113,31 +113,12 @@ void EventDispatcherPoll::unregisterEventNotifier(EventNotifier *notifier)
 
 void EventDispatcherPoll::registerTimer(Timer *timer)
 {
-	for (auto iter = timers_.begin(); iter != timers_.end(); ++iter) {
-		if ((*iter)->deadline() > timer->deadline()) {
-			timers_.insert(iter, timer);
-			return;
-		}
-	}
-
-	timers_.push_back(timer);
+	timers_.insert(timer);
 }
 
 void EventDispatcherPoll::unregisterTimer(Timer *timer)
 {
-	for (auto iter = timers_.begin(); iter != timers_.end(); ++iter) {
-		if (*iter == timer) {
-			timers_.erase(iter);
-			return;
-		}
-
-		/*
-		 * As the timers list is ordered, we can stop as soon as we go
-		 * past the deadline.
-		 */
-		if ((*iter)->deadline() > timer->deadline())
-			break;
-	}
+	timers_.remove(timer);
 }
 
 void EventDispatcherPoll::processEvents()
@@ -202,26 +183,27 @@ short EventDispatcherPoll::EventNotifierSetPoll::events() const
 int EventDispatcherPoll::poll(std::vector<struct pollfd> *pollfds)
 {
 	/* Compute the timeout. */
-	Timer *nextTimer = !timers_.empty() ? timers_.front() : nullptr;
+	utils::time_point nextExpiry = timers_.nextExpiry();
+	bool hasTimer = nextExpiry != utils::time_point::max();
 	struct timespec timeout;
 
-	if (nextTimer) {
+	if (hasTimer) {
 		utils::time_point now = utils::clock::now();
 
-		if (nextTimer->deadline() > now)
-			timeout = utils::duration_to_timespec(nextTimer->deadline() - now);
+		if (nextExpiry > now)
+			timeout = utils::duration_to_timespec(nextExpiry - now);
 		else
 			timeout = { 0, 0 };
 
 		LOG(Event, Debug)
-			<< "next timer " << nextTimer << " expires in "
+			<< "next timer expires in "
 			<< timeout.tv_sec << "."
 			<< std::setfill('0') << std::setw(9)
 			<< timeout.tv_nsec;
 	}
 
 	return ppoll(pollfds->data(), pollfds->size(),
-		     nextTimer ? &timeout : nullptr, nullptr);
+		     hasTimer ? &timeout : nullptr, nullptr);
 }
 
 void EventDispatcherPoll::processInterrupt(const struct pollfd &pfd)
@@ -291,14 +273,9 @@ void EventDispatcherPoll::processNotifiers(const std::vector<struct pollfd> &pol
 
 void EventDispatcherPoll::processTimers()
 {
-	utils::time_point now = utils::clock::now();
-
-	while (!timers_.empty()) {
-		Timer *timer = timers_.front();
-		if (timer->deadline() > now)
-			break;
+	timers_.expire(utils::clock::now());
 
-		timers_.pop_front();
+	while (Timer *timer = timers_.takeExpired()) {
 		timer->stop();
 		timer->timeout.emit();
 	}
@@ -8,15 +8,20 @@
 #include <libcamera/base/log.h>
 
 #include <array>
+#include <atomic>
 #include <fstream>
 #include <iostream>
 #include <list>
+#include <memory>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <syslog.h>
+#include <thread>
 #include <time.h>
+#include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include <libcamera/logging.h>
 
@@ -52,6 +57,24 @@
  * of the file. The file must be writable and is truncated if it exists. If any
  * error occurs when opening the file, the file is ignored and the log is output
  * to std::cerr.
+ *
+ * Writing to a file or stream is synchronous by default, and thus blocks the
+ * thread that logs the message until the message has been written. Setting the
+ * LIBCAMERA_LOG_ASYNC environment variable moves the writes to a dedicated
+ * thread. Messages are formatted by the thread that logs them and queued to a
+ * bounded ring buffer, whose size in messages can be set with the
+ * LIBCAMERA_LOG_ASYNC_SIZE environment variable. The value of LIBCAMERA_LOG_ASYNC
+ * selects the policy applied when the ring buffer is full, either "drop-oldest"
+ * to discard the oldest queued message, or "block" to wait until the writer
+ * thread frees space. The number of dropped messages is reported in the log.
+ *
+ * Formatting messages as text is costly. Setting the LIBCAMERA_LOG_FORMAT
+ * environment variable to "binary" writes the log file in a compact binary
+ * format instead, which can be converted back to text with the
+ * utils/decode-log.py script. Binary log files are only flushed when a message
+ * of severity Error or higher is written, and when the log file is closed.
+ * When written asynchronously, binary log files always use the "block" policy,
+ * as dropping records would corrupt the file.
  */
 
 /**
@@ -97,6 +120,531 @@ static const char *log_severity_name(LogSeverity severity)
 		return "UNKWN";
 }
 
+/**
+ * \brief Overflow policy of the asynchronous log writer
+ * \var LogOverflowPolicy::DropOldest
+ * \brief Discard the oldest queued message to make room for the new one
+ * \var LogOverflowPolicy::Block
+ * \brief Wait until the writer thread frees space
+ */
+enum class LogOverflowPolicy {
+	DropOldest,
+	Block,
+};
+
+/**
+ * \brief Asynchronous log writer
+ *
+ * The AsyncLogWriter class writes log messages to a stream from a dedicated
+ * thread. Messages are queued to a bounded lock-free ring buffer, allowing
+ * multiple threads to log concurrently without contending on a lock or waiting
+ * for I/O. The writer thread drains the ring buffer and writes messages to the
+ * stream in batches.
+ *
+ * When the ring buffer is full, messages are handled according to the overflow
+ * policy. With LogOverflowPolicy::DropOldest, the oldest message is discarded
+ * to make room for the new one. With LogOverflowPolicy::Block, the logging
+ * thread waits for the writer thread to free space. Dropped messages are
+ * counted and reported in the log by the writer thread.
+ *
+ * The stream is flushed after writing a batch of messages if any of them has
+ * been queued with the flush flag set, and when the writer is destroyed.
+ */
+class AsyncLogWriter
+{
+public:
+	AsyncLogWriter(std::ostream *stream, LogOverflowPolicy policy,
+		       unsigned int size);
+	~AsyncLogWriter();
+
+	void write(std::string &&msg, bool flush);
+	void flush();
+
+private:
+	/*
+	 * The ring buffer is a bounded multi-producer multi-consumer queue.
+	 * Each cell stores a sequence number that tells whether the cell is
+	 * free for the producer or ready for the consumer at a given position.
+	 * Producers dequeue the oldest message themselves when applying the
+	 * drop-oldest policy, hence the need for multiple consumers.
+	 */
+	struct Cell {
+		std::atomic<size_t> sequence;
+		std::string msg;
+		bool flush;
+	};
+
+	bool push(std::string &msg, bool flush);
+	bool pop(std::string *msg, bool *flush);
+	bool empty() const;
+
+	void wakeWriter();
+	void run();
+	void writeDropped(uint64_t count, pid_t tid);
+
+	std::ostream *stream_;
+	LogOverflowPolicy policy_;
+
+	std::unique_ptr<Cell[]> cells_;
+	size_t mask_;
+
+	alignas(64) std::atomic<size_t> enqueuePos_;
+	alignas(64) std::atomic<size_t> dequeuePos_;
+
+	std::atomic<uint64_t> queued_;
+	std::atomic<uint64_t> written_;
+	std::atomic<uint64_t> dropped_;
+	std::atomic<pid_t> droppedTid_;
+
+	Mutex mutex_;
+	ConditionVariable dataCv_;
+	ConditionVariable spaceCv_;
+	std::atomic<bool> sleeping_;
+	std::atomic<unsigned int> waiters_;
+	bool stop_ LIBCAMERA_TSA_GUARDED_BY(mutex_);
+
+	std::thread thread_;
+};
+
+/**
+ * \brief Construct an asynchronous log writer
+ * \param[in] stream The stream to write log messages to
+ * \param[in] policy The ring buffer overflow policy
+ * \param[in] size The ring buffer size in messages, rounded up to a power of 2
+ */
+AsyncLogWriter::AsyncLogWriter(std::ostream *stream, LogOverflowPolicy policy,
+			       unsigned int size)
+	: stream_(stream), policy_(policy), enqueuePos_(0), dequeuePos_(0),
+	  queued_(0), written_(0), dropped_(0), droppedTid_(0), sleeping_(false),
+	  waiters_(0),
+	  stop_(false)
+{
+	size_t capacity = 2;
+	while (capacity < size)
+		capacity <<= 1;
+
+	cells_ = std::make_unique<Cell[]>(capacity);
+	mask_ = capacity - 1;
+
+	for (size_t i = 0; i < capacity; ++i)
+		cells_[i].sequence.store(i, std::memory_order_relaxed);
+
+	thread_ = std::thread(&AsyncLogWriter::run, this);
+}
+
+/**
+ * \brief Destroy the asynchronous log writer
+ *
+ * All queued messages are written to the stream, and the stream is flushed,
+ * before the writer thread stops.
+ */
+AsyncLogWriter::~AsyncLogWriter()
+{
+	{
+		MutexLocker locker(mutex_);
+		stop_ = true;
+	}
+
+	dataCv_.notify_one();
+	thread_.join();
+}
+
+/**
+ * \brief Queue a message for writing
+ * \param[in] msg The formatted message
+ * \param[in] flush Flush the stream after writing the message
+ *
+ * \context This function is \threadsafe.
+ */
+void AsyncLogWriter::write(std::string &&msg, bool flush)
+{
+	if (push(msg, flush)) {
+		wakeWriter();
+		return;
+	}
+
+	if (policy_ == LogOverflowPolicy::DropOldest) {
+		std::string oldest;
+		bool oldestFlush;
+
+		/*
+		 * The writer thread isn't a libcamera Thread and can't call
+		 * Thread::currentId(), record the ID of the thread that drops
+		 * messages for the report.
+		 */
+		droppedTid_.store(Thread::currentId(), std::memory_order_relaxed);
+
+		do {
+			if (pop(&oldest, &oldestFlush))
+				dropped_.fetch_add(1, std::memory_order_relaxed);
+		} while (!push(msg, flush));
+
+		wakeWriter();
+		return;
+	}
+
+	waiters_.fetch_add(1, std::memory_order_seq_cst);
+
+	{
+		MutexLocker locker(mutex_);
+		while (!push(msg, flush)) {
+			uint64_t written = written_.load(std::memory_order_acquire);
+
+			dataCv_.notify_one();
+			spaceCv_.wait_for(locker, std::chrono::milliseconds(10), [&]() {
+				return written_.load(std::memory_order_acquire) != written;
+			});
+		}
+	}
+
+	waiters_.fetch_sub(1, std::memory_order_relaxed);
+	wakeWriter();
+}
+
+/**
+ * \brief Wait until all messages queued so far have been written
+ *
+ * \context This function is \threadsafe.
+ */
+void AsyncLogWriter::flush()
+{
+	uint64_t target = queued_.load(std::memory_order_acquire);
+
+	waiters_.fetch_add(1, std::memory_order_seq_cst);
+
+	{
+		MutexLocker locker(mutex_);
+		dataCv_.notify_one();
+		spaceCv_.wait(locker, [&]() {
+			return written_.load(std::memory_order_acquire) +
+			       dropped_.load(std::memory_order_relaxed) >= target;
+		});
+	}
+
+	waiters_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+bool AsyncLogWriter::push(std::string &msg, bool flush)
+{
+	size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+	Cell *cell;
+
+	while (true) {
+		cell = &cells_[pos & mask_];
+		size_t seq = cell->sequence.load(std::memory_order_acquire);
+		intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+
+		if (diff == 0) {
+			if (enqueuePos_.compare_exchange_weak(pos, pos + 1,
+							      std::memory_order_relaxed))
+				break;
+		} else if (diff < 0) {
+			return false;
+		} else {
+			pos = enqueuePos_.load(std::memory_order_relaxed);
+		}
+	}
+
+	cell->msg = std::move(msg);
+	cell->flush = flush;
+	cell->sequence.store(pos + 1, std::memory_order_release);
+	queued_.fetch_add(1, std::memory_order_release);
+
+	return true;
+}
+
+bool AsyncLogWriter::pop(std::string *msg, bool *flush)
+{
+	size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+	Cell *cell;
+
+	while (true) {
+		cell = &cells_[pos & mask_];
+		size_t seq = cell->sequence.load(std::memory_order_acquire);
+		intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+
+		if (diff == 0) {
+			if (dequeuePos_.compare_exchange_weak(pos, pos + 1,
+							      std::memory_order_relaxed))
+				break;
+		} else if (diff < 0) {
+			return false;
+		} else {
+			pos = dequeuePos_.load(std::memory_order_relaxed);
+		}
+	}
+
+	*msg = std::move(cell->msg);
+	*flush = cell->flush;
+	cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+
+	return true;
+}
+
+bool AsyncLogWriter::empty() const
+{
+	size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+	size_t seq = cells_[pos & mask_].sequence.load(std::memory_order_acquire);
+
+	return seq != pos + 1;
+}
+
+void AsyncLogWriter::wakeWriter()
+{
+	/*
+	 * Only take the lock when the writer thread is sleeping, to keep the
+	 * fast path lock-free. The fence pairs with the one in run() and
+	 * guarantees that either the writer sees the new message before going
+	 * to sleep, or we see it sleeping.
+	 */
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (!sleeping_.load(std::memory_order_relaxed))
+		return;
+
+	MutexLocker locker(mutex_);
+	dataCv_.notify_one();
+}
+
+void AsyncLogWriter::run()
+{
+	static constexpr size_t kBatchSize = 64 * 1024;
+
+	uint64_t reported = 0;
+	std::string batch;
+	std::string msg;
+	bool flush;
+
+	batch.reserve(kBatchSize);
+
+	while (true) {
+		uint64_t count = 0;
+		bool needFlush = false;
+
+		while (pop(&msg, &flush)) {
+			batch += msg;
+			needFlush |= flush;
+			count++;
+
+			if (batch.size() >= kBatchSize) {
+				stream_->write(batch.data(), batch.size());
+				batch.clear();
+			}
+		}
+
+		if (!batch.empty()) {
+			stream_->write(batch.data(), batch.size());
+			batch.clear();
+		}
+
+		uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+		if (dropped != reported) {
+			writeDropped(dropped - reported,
+				     droppedTid_.load(std::memory_order_relaxed));
+			reported = dropped;
+			stream_->flush();
+		} else if (needFlush) {
+			stream_->flush();
+		}
+
+		written_.fetch_add(count, std::memory_order_release);
+
+		if (waiters_.load(std::memory_order_seq_cst)) {
+			MutexLocker locker(mutex_);
+			spaceCv_.notify_all();
+		}
+
+		MutexLocker locker(mutex_);
+
+		sleeping_.store(true, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		if (empty()) {
+			if (stop_) {
+				stream_->flush();
+				break;
+			}
+
+			dataCv_.wait_for(locker, std::chrono::milliseconds(100),
+					 [&]() { return stop_ || !empty(); });
+		}
+
+		sleeping_.store(false, std::memory_order_relaxed);
+	}
+}
+
+void AsyncLogWriter::writeDropped(uint64_t count, pid_t tid)
+{
+	std::string str;
+
+	str += "[";
+	str += utils::time_point_to_string(utils::clock::now());
+	str += "] [";
+	str += std::to_string(tid);
+	str += "]  WARN Log ";
+	str += std::to_string(count);
+	str += " log messages dropped\n";
+
+	stream_->write(str.data(), str.size());
+}
+
+/**
+ * \brief Binary log encoder
+ *
+ * The BinaryLogEncoder class encodes log messages in the binary log format.
+ * The format starts with a header containing a magic number and a version,
+ * both 32-bit values stored in the host byte order, allowing the byte order to
+ * be detected when decoding. The header is followed by a sequence of records,
+ * each starting with an 8-bit record type.
+ *
+ * Category names and file:line locations are interned: the first time they are
+ * used, a definition record assigns them an index, and message records then
+ * refer to them by index. Message records store the timestamp in nanoseconds,
+ * the thread ID, the category index, the severity, the location index, and the
+ * prefix and message text. Text records store free-form text such as
+ * backtraces.
+ *
+ * The encoder isn't thread-safe, callers must serialize calls to encode() and
+ * write the records in the order they have been encoded.
+ */
+class BinaryLogEncoder
+{
+public:
+	static constexpr uint32_t kMagic = 0x4c42434c; /* "LCBL" */
+	static constexpr uint32_t kVersion = 1;
+
+	enum RecordType : uint8_t {
+		RecordCategory = 1,
+		RecordLocation = 2,
+		RecordMessage = 3,
+		RecordText = 4,
+	};
+
+	std::string header() const;
+	std::string encode(const LogMessage &msg);
+	std::string encode(const std::string &text);
+
+private:
+	struct LocationHash {
+		size_t operator()(const std::pair<const char *, unsigned int> &location) const
+		{
+			return std::hash<const char *>()(location.first) ^ location.second;
+		}
+	};
+
+	template<typename T>
+	static void append(std::string *record, T value)
+	{
+		record->append(reinterpret_cast<const char *>(&value), sizeof(value));
+	}
+
+	uint16_t category(std::string *record, const LogCategory &category);
+	uint32_t location(std::string *record, const LogMessage &msg);
+
+	std::unordered_map<const LogCategory *, uint16_t> categories_;
+	std::unordered_map<std::pair<const char *, unsigned int>, uint32_t,
+			   LocationHash> locations_;
+};
+
+/**
+ * \brief Create the binary log header
+ * \return The header
+ */
+std::string BinaryLogEncoder::header() const
+{
+	std::string header;
+
+	append(&header, kMagic);
+	append(&header, kVersion);
+
+	return header;
+}
+
+/**
+ * \brief Encode a log message
+ * \param[in] msg The log message
+ *
+ * If the message category or location haven't been encoded yet, the returned
+ * data contains their definition records followed by the message record.
+ *
+ * \return The encoded records
+ */
+std::string BinaryLogEncoder::encode(const LogMessage &msg)
+{
+	std::string record;
+	uint16_t categoryIndex = category(&record, msg.category());
+	uint32_t locationIndex = location(&record, msg);
+
+	const std::string &prefix = msg.prefix();
+	std::string text = msg.msg();
+	if (!text.empty() && text.back() == '\n')
+		text.pop_back();
+
+	uint64_t timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+		msg.timestamp().time_since_epoch()).count();
+
+	record.reserve(record.size() + 32 + prefix.size() + text.size());
+
+	append(&record, RecordMessage);
+	append(&record, timestamp);
+	append<uint32_t>(&record, Thread::currentId());
+	append(&record, categoryIndex);
+	append<uint8_t>(&record, msg.severity());
+	append(&record, locationIndex);
+	append<uint16_t>(&record, prefix.size());
+	append<uint32_t>(&record, text.size());
+	record += prefix;
+	record += text;
+
+	return record;
+}
+
+/**
+ * \brief Encode free-form text
+ * \param[in] text The text
+ * \return The encoded record
+ */
+std::string BinaryLogEncoder::encode(const std::string &text)
+{
+	std::string record;
+
+	append(&record, RecordText);
+	append<uint32_t>(&record, text.size());
+	record += text;
+
+	return record;
+}
+
+uint16_t BinaryLogEncoder::category(std::string *record, const LogCategory &category)
+{
+	auto [iter, inserted] = categories_.try_emplace(&category, categories_.size());
+	if (inserted) {
+		const std::string &name = category.name();
+
+		append(record, RecordCategory);
+		append(record, iter->second);
+		append<uint16_t>(record, name.size());
+		*record += name;
+	}
+
+	return iter->second;
+}
+
+uint32_t BinaryLogEncoder::location(std::string *record, const LogMessage &msg)
+{
+	auto [iter, inserted] = locations_.try_emplace({ msg.fileName(), msg.line() },
+						       locations_.size());
+	if (inserted) {
+		const std::string &fileInfo = msg.fileInfo();
+
+		append(record, RecordLocation);
+		append(record, iter->second);
+		append<uint16_t>(record, fileInfo.size());
+		*record += fileInfo;
+	}
+
+	return iter->second;
+}
+
 /**
  * \brief Log output
  *
@@ -107,20 +655,29 @@ class LogOutput
 public:
 	LogOutput(const char *path, bool color);
 	LogOutput(std::ostream *stream, bool color);
+	LogOutput(const char *path);
 	LogOutput();
 	~LogOutput();
 
 	bool isValid() const;
+	void setAsync(LogOverflowPolicy policy, unsigned int size);
+
 	void write(const LogMessage &msg);
 	void write(const std::string &msg);
+	void flush();
 
 private:
 	void writeSyslog(LogSeverity severity, const std::string &msg);
-	void writeStream(const std::string &msg);
+	void writeStream(std::string msg, bool flush = true);
 
 	std::ostream *stream_;
 	LoggingTarget target_;
 	bool color_;
+
+	std::unique_ptr<AsyncLogWriter> writer_;
+
+	Mutex encoderLock_;
+	std::unique_ptr<BinaryLogEncoder> encoder_ LIBCAMERA_TSA_GUARDED_BY(encoderLock_);
 };
 
 /**
@@ -144,6 +701,23 @@ LogOutput::LogOutput(std::ostream *stream, bool color)
 {
 }
 
+/**
+ * \brief Construct a log output based on a binary file
+ * \param[in] path Full path to log file
+ */
+LogOutput::LogOutput(const char *path)
+	: target_(LoggingTargetBinary), color_(false)
+{
+	stream_ = new std::ofstream(path, std::ios::binary);
+
+	MutexLocker locker(encoderLock_);
+	encoder_ = std::make_unique<BinaryLogEncoder>();
+
+	std::string header = encoder_->header();
+	stream_->write(header.data(), header.size());
+	stream_->flush();
+}
+
 /**
  * \brief Construct a log output to syslog
  */
@@ -155,8 +729,12 @@ LogOutput::LogOutput()
 
 LogOutput::~LogOutput()
 {
+	/* Drain the queued messages before closing the stream. */
+	writer_.reset();
+
 	switch (target_) {
 	case LoggingTargetFile:
+	case LoggingTargetBinary:
 		delete stream_;
 		break;
 	case LoggingTargetSyslog:
@@ -175,6 +753,7 @@ bool LogOutput::isValid() const
 {
 	switch (target_) {
 	case LoggingTargetFile:
+	case LoggingTargetBinary:
 		return stream_->good();
 	case LoggingTargetStream:
 		return stream_ != nullptr;
@@ -183,6 +762,36 @@ bool LogOutput::isValid() const
 	}
 }
 
+/**
+ * \brief Write messages asynchronously
+ * \param[in] policy The ring buffer overflow policy
+ * \param[in] size The ring buffer size in messages
+ *
+ * Move writing to the file or stream to a dedicated thread. This function
+ * shall be called before the log output is used, and has no effect on syslog
+ * outputs, as the syslog daemon already decouples logging from I/O.
+ *
+ * Binary outputs always use the LogOverflowPolicy::Block policy regardless of
+ * \a policy. Dropping records would lose the category and location definition
+ * records that later messages refer to, and the dropped messages report is
+ * written as text, both of which would corrupt the binary stream.
+ */
+void LogOutput::setAsync(LogOverflowPolicy policy, unsigned int size)
+{
+	switch (target_) {
+	case LoggingTargetFile:
+	case LoggingTargetStream:
+		break;
+	case LoggingTargetBinary:
+		policy = LogOverflowPolicy::Block;
+		break;
+	default:
+		return;
+	}
+
+	writer_ = std::make_unique<AsyncLogWriter>(stream_, policy, size);
+}
+
 namespace {
 
 /*
@@ -240,17 +849,51 @@ void LogOutput::write(const LogMessage &msg)
 		writeSyslog(severity, str);
 		break;
 	case LoggingTargetStream:
-	case LoggingTargetFile:
-		str = "[" + utils::time_point_to_string(msg.timestamp()) + "] ["
-		    + std::to_string(Thread::currentId()) + "] "
-		    + severityColor + log_severity_name(severity) + " "
-		    + categoryColor + msg.category().name() + " "
-		    + fileColor + msg.fileInfo() + " ";
-		if (!msg.prefix().empty())
-			str += prefixColor + msg.prefix() + ": ";
-		str += resetColor + msg.msg();
-		writeStream(str);
+	case LoggingTargetFile: {
+		const std::string &category = msg.category().name();
+		const std::string &fileInfo = msg.fileInfo();
+		const std::string &prefix = msg.prefix();
+		const std::string &text = msg.msg();
+
+		/* Format the message in a single allocation. */
+		str.reserve(64 + category.size() + fileInfo.size() +
+			    prefix.size() + text.size());
+
+		str += '[';
+		str += utils::time_point_to_string(msg.timestamp());
+		str += "] [";
+		str += std::to_string(Thread::currentId());
+		str += "] ";
+		str += severityColor;
+		str += log_severity_name(severity);
+		str += ' ';
+		str += categoryColor;
+		str += category;
+		str += ' ';
+		str += fileColor;
+		str += fileInfo;
+		str += ' ';
+		if (!prefix.empty()) {
+			str += prefixColor;
+			str += prefix;
+			str += ": ";
+		}
+		str += resetColor;
+		str += text;
+		writeStream(std::move(str));
+		break;
+	}
+	case LoggingTargetBinary: {
+		/*
+		 * Hold the lock while writing to ensure that definition
+		 * records are written before the messages that use them.
+		 * Binary records are meant to be cheap, only flush the stream
+		 * for errors, to make sure they reach the file before a crash.
+		 */
+		MutexLocker locker(encoderLock_);
+		writeStream(encoder_->encode(msg), severity >= LogError);
 		break;
+	}
 	default:
 		break;
 	}
@@ -270,6 +913,11 @@ void LogOutput::write(const std::string &str)
 	case LoggingTargetFile:
 		writeStream(str);
 		break;
+	case LoggingTargetBinary: {
+		MutexLocker locker(encoderLock_);
+		writeStream(encoder_->encode(str));
+		break;
+	}
 	default:
 		break;
 	}
@@ -280,10 +928,25 @@ void LogOutput::writeSyslog(LogSeverity severity, const std::string &str)
 	syslog(log_severity_to_syslog(severity), "%s", str.c_str());
 }
 
-void LogOutput::writeStream(const std::string &str)
+/**
+ * \brief Wait until all messages have been written to the log output
+ */
+void LogOutput::flush()
+{
+	if (writer_)
+		writer_->flush();
+}
+
+void LogOutput::writeStream(std::string str, bool flush)
 {
+	if (writer_) {
+		writer_->write(std::move(str), flush);
+		return;
+	}
+
 	stream_->write(str.c_str(), str.size());
-	stream_->flush();
+	if (flush)
+		stream_->flush();
 }
 
 /**
@@ -300,15 +963,18 @@ public:
 
 	void write(const LogMessage &msg);
 	void backtrace();
+	void flush();
 
 	int logSetFile(const char *path, bool color);
 	int logSetStream(std::ostream *stream, bool color);
+	int logSetBinaryFile(const char *path);
 	int logSetTarget(LoggingTarget target);
 	void logSetLevel(const char *category, const char *level);
 
 private:
 	Logger();
 
+	void parseLogAsync();
 	void parseLogFile();
 	void parseLogLevels();
 	static LogSeverity parseLogLevel(const std::string &level);
@@ -322,6 +988,10 @@ private:
 	std::vector<LogCategory *> categories_;
 	std::list<std::pair<std::string, LogSeverity>> levels_;
 
+	bool async_;
+	LogOverflowPolicy asyncPolicy_;
+	unsigned int asyncSize_;
+
 	std::shared_ptr<LogOutput> output_;
 };
 
@@ -342,6 +1012,9 @@ bool Logger::destroyed_ = false;
  * \var LoggingTargetStream
  * \brief Log to stream
  * \sa Logger::logSetStream
+ * \var LoggingTargetBinary
+ * \brief Log to file in binary format
+ * \sa Logger::logSetBinaryFile
  */
 
 /**
@@ -390,6 +1063,27 @@ int logSetStream(std::ostream *stream, bool color)
 	return Logger::instance()->logSetStream(stream, color);
 }
 
+/**
+ * \brief Direct logging to a file in binary format
+ * \param[in] path Full path to the log file
+ *
+ * This function directs the log output to the file identified by \a path, in
+ * a compact binary format that avoids formatting log messages as text. The
+ * previous log target, if any, is closed, and all new log messages will be
+ * written to the new log file.
+ *
+ * The binary log file can be converted to the text format with the
+ * utils/decode-log.py script.
+ *
+ * If the function returns an error, the log target is not changed.
+ *
+ * \return Zero on success, or a negative error code otherwise
+ */
+int logSetBinaryFile(const char *path)
+{
+	return Logger::instance()->logSetBinaryFile(path);
+}
+
 /**
  * \brief Set the logging target
  * \param[in] target Logging destination
@@ -401,8 +1095,9 @@ int logSetStream(std::ostream *stream, bool color)
  * log target, if any, is closed, and all new log messages will be written to
  * the new log destination.
  *
- * LoggingTargetFile and LoggingTargetStream are not valid values for \a target.
- * Use logSetFile() and logSetStream() instead, respectively.
+ * LoggingTargetFile, LoggingTargetStream and LoggingTargetBinary are not valid
+ * values for \a target. Use logSetFile(), logSetStream() and logSetBinaryFile()
+ * instead, respectively.
  *
  * If the function returns an error, the log file is not changed.
  *
@@ -495,6 +1190,18 @@ void Logger::backtrace()
 	output->write(backtrace);
 }
 
+/**
+ * \brief Wait until all messages have been written to the log output
+ */
+void Logger::flush()
+{
+	std::shared_ptr<LogOutput> output = std::atomic_load(&output_);
+	if (!output)
+		return;
+
+	output->flush();
+}
+
 /**
  * \brief Set the log file
  * \param[in] path Full path to the log file
@@ -511,6 +1218,9 @@ int Logger::logSetFile(const char *path, bool color)
 	if (!output->isValid())
 		return -EINVAL;
 
+	if (async_)
+		output->setAsync(asyncPolicy_, asyncSize_);
+
 	std::atomic_store(&output_, output);
 	return 0;
 }
@@ -528,6 +1238,30 @@ int Logger::logSetStream(std::ostream *stream, bool color)
 {
 	std::shared_ptr<LogOutput> output =
 		std::make_shared<LogOutput>(stream, color);
+	if (async_)
+		output->setAsync(asyncPolicy_, asyncSize_);
+
+	std::atomic_store(&output_, output);
+	return 0;
+}
+
+/**
+ * \brief Set the binary log file
+ * \param[in] path Full path to the log file
+ *
+ * \sa libcamera::logSetBinaryFile()
+ *
+ * \return Zero on success, or a negative error code otherwise.
+ */
+int Logger::logSetBinaryFile(const char *path)
+{
+	std::shared_ptr<LogOutput> output = std::make_shared<LogOutput>(path);
+	if (!output->isValid())
+		return -EINVAL;
+
+	if (async_)
+		output->setAsync(asyncPolicy_, asyncSize_);
+
 	std::atomic_store(&output_, output);
 	return 0;
 }
@@ -585,7 +1319,11 @@ void Logger::logSetLevel(const char *category, const char *level)
  * LIBCAMERA_LOG_NO_COLOR environment variable to disable coloring.
  */
 Logger::Logger()
+	: async_(false), asyncPolicy_(LogOverflowPolicy::DropOldest),
+	  asyncSize_(4096)
 {
+	parseLogAsync();
+
 	bool color = !utils::secure_getenv("LIBCAMERA_LOG_NO_COLOR");
 	logSetStream(&std::cerr, color);
 
@@ -593,14 +1331,47 @@ Logger::Logger()
 	parseLogLevels();
 }
 
+/**
+ * \brief Parse the asynchronous output configuration from the environment
+ *
+ * If the LIBCAMERA_LOG_ASYNC environment variable is set to "drop-oldest" or
+ * "block", write messages to files and streams asynchronously with the
+ * corresponding overflow policy. The ring buffer size is read from the
+ * LIBCAMERA_LOG_ASYNC_SIZE environment variable. Invalid values are ignored.
+ */
+void Logger::parseLogAsync()
+{
+	const char *async = utils::secure_getenv("LIBCAMERA_LOG_ASYNC");
+	if (!async)
+		return;
+
+	if (!strcmp(async, "drop-oldest"))
+		asyncPolicy_ = LogOverflowPolicy::DropOldest;
+	else if (!strcmp(async, "block"))
+		asyncPolicy_ = LogOverflowPolicy::Block;
+	else
+		return;
+
+	async_ = true;
+
+	const char *size = utils::secure_getenv("LIBCAMERA_LOG_ASYNC_SIZE");
+	if (size) {
+		char *endptr;
+		unsigned long value = strtoul(size, &endptr, 10);
+		if (*endptr == '\0' && value > 0 && value <= (1 << 20))
+			asyncSize_ = value;
+	}
+}
+
 /**
  * \brief Parse the log output file from the environment
  *
  * If the LIBCAMERA_LOG_FILE environment variable is set, open the file it
  * points to and redirect the logger output to it. If the environment variable
- * is set to "syslog", then the logger output will be directed to syslog. Errors
- * are silently ignored and don't affect the logger output (set to std::cerr by
- * default).
+ * is set to "syslog", then the logger output will be directed to syslog. If the
+ * LIBCAMERA_LOG_FORMAT environment variable is set to "binary", the file is
+ * written in binary format. Errors are silently ignored and don't affect the
+ * logger output (set to std::cerr by default).
  */
 void Logger::parseLogFile()
 {
@@ -613,6 +1384,12 @@ void Logger::parseLogFile()
 		return;
 	}
 
+	const char *format = utils::secure_getenv("LIBCAMERA_LOG_FORMAT");
+	if (format && !strcmp(format, "binary")) {
+		logSetBinaryFile(file);
+		return;
+	}
+
 	logSetFile(file, false);
 }
 
@@ -894,19 +1671,23 @@ LogMessage::LogMessage(const char *fileName, unsigned int line,
  */
 LogMessage::LogMessage(LogMessage &&other)
 	: msgStream_(std::move(other.msgStream_)), category_(other.category_),
-	  severity_(other.severity_)
+	  severity_(other.severity_), timestamp_(other.timestamp_),
+	  fileName_(other.fileName_), line_(other.line_),
+	  fileInfo_(std::move(other.fileInfo_)),
+	  prefix_(std::move(other.prefix_))
 {
 	other.severity_ = LogInvalid;
 }
 
 void LogMessage::init(const char *fileName, unsigned int line)
 {
-	/* Log the timestamp, severity and file information. */
+	/*
+	 * Log the timestamp and file information. The file information is
+	 * formatted on demand, as not all log outputs need it.
+	 */
 	timestamp_ = utils::clock::now();
-
-	std::ostringstream ossFileInfo;
-	ossFileInfo << utils::basename(fileName) << ":" << line;
-	fileInfo_ = ossFileInfo.str();
+	fileName_ = fileName;
+	line_ = line;
 }
 
 LogMessage::~LogMessage()
@@ -926,6 +1707,7 @@ LogMessage::~LogMessage()
 
 	if (severity_ == LogSeverity::LogFatal) {
 		logger->backtrace();
+		logger->flush();
 		std::abort();
 	}
 }
@@ -959,10 +1741,38 @@ LogMessage::~LogMessage()
  */
 
 /**
- * \fn LogMessage::fileInfo()
+ * \fn LogMessage::fileName()
+ * \brief Retrieve the name of the file the message is logged from
+ * \return The file name, as passed to the constructor
+ */
+
+/**
+ * \fn LogMessage::line()
+ * \brief Retrieve the line number the message is logged from
+ * \return The line number
+ */
+
+/**
  * \brief Retrieve the file info of the log message
+ *
+ * The file info is formatted as the file base name and the line number,
+ * separated by a colon.
+ *
  * \return The file info of the message
  */
+const std::string &LogMessage::fileInfo() const
+{
+	if (fileInfo_.empty()) {
+		const char *name = utils::basename(fileName_);
+
+		fileInfo_.reserve(strlen(name) + 12);
+		fileInfo_ += name;
+		fileInfo_ += ':';
+		fileInfo_ += std::to_string(line_);
+	}
+
+	return fileInfo_;
+}
 
 /**
  * \fn LogMessage::prefix()
@@ -1042,6 +1852,151 @@ LogMessage _log(const LogCategory *category, LogSeverity severity,
 			  severity);
 }
 
+/**
+ * \class LogRateLimiter
+ * \brief Rate limiter for log messages
+ *
+ * The LogRateLimiter class limits the rate of messages logged from a single
+ * location in the source code, to prevent a repeated error condition from
+ * flooding the log. It implements a token bucket that holds up to \a burst
+ * tokens and is refilled with one token every \a interval. Each message
+ * consumes one token, and messages are suppressed when the bucket is empty.
+ *
+ * The token bucket is implemented as a generic cell rate algorithm, which only
+ * needs to store a single timestamp and can thus be updated atomically without
+ * locking. The rate limiter is thread-safe.
+ *
+ * A rate limiter is bound to a single location, and thus to a single category
+ * and severity. It is not bound to an object instance: all objects that log
+ * from the same location share the same token bucket. The refill interval is
+ * passed to every limit() call and may thus vary between calls.
+ *
+ * Messages suppressed since the last logged message are reported with the next
+ * logged message. The messages still suppressed when the rate limiter is
+ * destroyed, which for the LOG_RATELIMITED() macro happens when the program
+ * exits, are reported in a summary message.
+ *
+ * This class should not be used directly, use the LOG_RATELIMITED() macro
+ * instead.
+ */
+
+/**
+ * \var LogRateLimiter::kDefaultBurst
+ * \brief The default number of messages that can be logged in a burst
+ */
+
+/**
+ * \struct LogRateLimiter::Result
+ * \brief The result of a rate limiting check
+ *
+ * \var LogRateLimiter::Result::limited
+ * \brief True if the message shall not be logged
+ *
+ * \var LogRateLimiter::Result::suppressed
+ * \brief The number of messages suppressed since the last logged message
+ *
+ * \fn LogRateLimiter::Result::operator bool()
+ * \brief Check if the message shall not be logged
+ * \return True if the message shall not be logged, false otherwise
+ */
+
+/**
+ * \brief Construct a log rate limiter
+ * \param[in] category The category of the rate-limited messages
+ * \param[in] severity The severity of the rate-limited messages
+ * \param[in] burst The bucket size
+ * \param[in] fileName The file name where the messages are logged from
+ * \param[in] line The line number where the messages are logged from
+ */
+LogRateLimiter::LogRateLimiter(const LogCategory &category, LogSeverity severity,
+			       unsigned int burst, const char *fileName,
+			       unsigned int line)
+	: category_(category), severity_(severity), burst_(burst),
+	  fileName_(fileName), line_(line), arrival_(0), suppressed_(0)
+{
+}
+
+/**
+ * \brief Destroy the log rate limiter
+ *
+ * Log a summary of the messages suppressed since the last logged message, if
+ * any.
+ */
+LogRateLimiter::~LogRateLimiter()
+{
+	unsigned int suppressed = suppressed_.load(std::memory_order_relaxed);
+	if (!suppressed)
+		return;
+
+	LogMessage(fileName_, line_, category_, severity_).stream()
+		<< suppressed << " similar messages suppressed";
+}
+
+/**
+ * \brief Check if a message shall be logged
+ * \param[in] interval The interval at which tokens are added to the bucket
+ *
+ * Messages that would be discarded due to the category log level don't
+ * consume tokens, and are reported as limited to skip formatting them. Fatal
+ * messages are never limited.
+ *
+ * \return The rate limiting result
+ */
+LogRateLimiter::Result LogRateLimiter::limit(utils::duration interval)
+{
+	if (severity_ < category_.severity())
+		return { true, 0 };
+
+	if (severity_ != LogFatal) {
+		int64_t period = std::chrono::duration_cast<std::chrono::nanoseconds>(interval).count();
+		int64_t tolerance = period * (burst_ ? burst_ - 1 : 0);
+		int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+			utils::clock::now().time_since_epoch()).count();
+		int64_t arrival = arrival_.load(std::memory_order_relaxed);
+		int64_t next;
+
+		do {
+			next = std::max(arrival, now);
+			if (next - now > tolerance) {
+				suppressed_.fetch_add(1, std::memory_order_relaxed);
+				return { true, 0 };
+			}
+		} while (!arrival_.compare_exchange_weak(arrival, next + period,
+							 std::memory_order_relaxed));
+	}
+
+	return { false, suppressed_.exchange(0, std::memory_order_relaxed) };
+}
+
+/**
+ * \class LogRateLimitedMessage
+ * \brief Log message wrapper reporting suppressed messages
+ *
+ * The LogRateLimitedMessage class takes ownership of a LogMessage logged
+ * through the LOG_RATELIMITED() macro, and appends the number of messages
+ * suppressed by the rate limiter since the previous message to the message
+ * text before the message is logged.
+ */
+
+/**
+ * \fn LogRateLimitedMessage::LogRateLimitedMessage()
+ * \brief Construct a rate-limited log message
+ * \param[in] msg The log message
+ * \param[in] result The rate limiting result
+ */
+
+LogRateLimitedMessage::~LogRateLimitedMessage()
+{
+	if (suppressed_)
+		msg_.stream() << " (" << suppressed_ << " similar messages suppressed)";
+}
+
+/**
+ * \fn LogRateLimitedMessage::stream()
+ * \brief Retrieve the stream of the wrapped log message
+ * \return A reference to the log message stream
+ */
+
 /**
  * \def LOG_DECLARE_CATEGORY(name)
  * \hideinitializer
@@ -1092,6 +2047,33 @@ LogMessage _log(const LogCategory *category, LogSeverity severity,
  * possible extent
  */
 
+/**
+ * \def LOG_RATELIMITED(category, severity, interval)
+ * \hideinitializer
+ * \brief Log a message with rate limiting
+ * \param[in] category Category
+ * \param[in] severity Severity
+ * \param[in] interval Minimum average interval between messages
+ *
+ * Log a message in the same way as LOG(), but limit the rate of messages
+ * logged from this location. Up to LogRateLimiter::kDefaultBurst messages can
+ * be logged back to back, after which messages are logged at most once every
+ * \a interval. The number of messages suppressed in-between is appended to the
+ * next logged message.
+ *
+ * The rate limit is scoped to the call site: it is shared by all callers of the
+ * same location, regardless of the object instance or thread. Two objects
+ * logging from the same location thus consume tokens from the same bucket, and
+ * messages from one of them may suppress messages from the other. Suppressed
+ * messages are not formatted, this macro is thus suitable for error paths that
+ * may be hit at every frame. Messages still suppressed when the program exits
+ * are reported in a summary message.
+ *
+ * The rate limiter is a function-local static variable of a lambda function
+ * defined by the macro, and is thus unique to each location. As the macro
+ * expands to a for statement, it can't be used as an expression.
+ */
+
 /**
  * \def ASSERT(condition)
  * \hideinitializer
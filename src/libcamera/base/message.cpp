@@ -59,7 +59,7 @@ std::atomic_uint Message::nextUserType_{ Message::UserMessage };
  * \param[in] type The message type
  */
 Message::Message(Message::Type type)
-	: type_(type)
+	: type_(type), receiver_(nullptr), next_(nullptr)
 {
 }
 
@@ -67,6 +67,30 @@ Message::~Message()
 {
 }
 
+/**
+ * \brief Allocate memory for a message from the message pool
+ * \param[in] size The allocation size in bytes
+ *
+ * Messages are allocated from a pool of recycled memory blocks, avoiding heap
+ * allocations in steady state for messages of moderate size.
+ *
+ * \return A pointer to the allocated memory
+ */
+void *Message::operator new(size_t size)
+{
+	return details::messagePoolAllocate(size);
+}
+
+/**
+ * \brief Return the memory of a message to the message pool
+ * \param[in] ptr The memory to free
+ * \param[in] size The allocation size in bytes
+ */
+void Message::operator delete(void *ptr, size_t size)
+{
+	details::messagePoolFree(ptr, size);
+}
+
 /**
  * \fn Message::type()
  * \brief Retrieve the message type
@@ -127,7 +151,7 @@ Message::Type Message::registerMessageType()
 InvokeMessage::InvokeMessage(BoundMethodBase *method,
 			     std::shared_ptr<BoundMethodPackBase> pack,
 			     Semaphore *semaphore, bool deleteMethod)
-	: Message(Message::InvokeMessage), method_(method), pack_(pack),
+	: Message(Message::InvokeMessage), method_(method), pack_(std::move(pack)),
 	  semaphore_(semaphore), deleteMethod_(deleteMethod)
 {
 }
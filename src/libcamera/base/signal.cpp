@@ -34,35 +34,64 @@ void SignalBase::connect(BoundMethodBase *slot)
 	Object *object = slot->object();
 	if (object)
 		object->connect(this);
-	slots_.push_back(slot);
+
+	/*
+	 * The slots list is never modified in place, as it may be in use by
+	 * an emission in progress. Create a new snapshot instead.
+	 */
+	auto slots = std::make_shared<SlotList>();
+	if (slots_) {
+		slots->reserve(slots_->size() + 1);
+		*slots = *slots_;
+	}
+
+	slots->emplace_back(slot);
+	slots_ = std::move(slots);
 }
 
 void SignalBase::disconnect(Object *object)
 {
-	disconnect([object](SlotList::iterator &iter) {
-		return (*iter)->match(object);
+	disconnect([object](BoundMethodBase *slot) {
+		return slot->match(object);
 	});
 }
 
-void SignalBase::disconnect(std::function<bool(SlotList::iterator &)> match)
+void SignalBase::disconnect(std::function<bool(BoundMethodBase *)> match)
 {
 	MutexLocker locker(signalsLock);
 
-	for (auto iter = slots_.begin(); iter != slots_.end(); ) {
-		if (match(iter)) {
-			Object *object = (*iter)->object();
+	if (!slots_)
+		return;
+
+	SlotList slots;
+	bool modified = false;
+
+	for (const std::shared_ptr<BoundMethodBase> &slot : *slots_) {
+		if (match(slot.get())) {
+			Object *object = slot->object();
 			if (object)
 				object->disconnect(this);
 
-			delete *iter;
-			iter = slots_.erase(iter);
+			modified = true;
 		} else {
-			++iter;
+			slots.push_back(slot);
 		}
 	}
+
+	if (!modified)
+		return;
+
+	/*
+	 * Replace the snapshot. The disconnected slots are deleted when the
+	 * last emission referencing the previous snapshot completes.
+	 */
+	if (slots.empty())
+		slots_.reset();
+	else
+		slots_ = std::make_shared<const SlotList>(std::move(slots));
 }
 
-SignalBase::SlotList SignalBase::slots()
+std::shared_ptr<const SignalBase::SlotList> SignalBase::slots()
 {
 	MutexLocker locker(signalsLock);
 	return slots_;
@@ -199,6 +228,12 @@ SignalBase::SlotList SignalBase::slots()
  *
  * This function is not \threadsafe, but thread-safety is guaranteed against
  * concurrent connect() and disconnect() calls.
+ *
+ * The slots are called from an immutable snapshot of the connections, which is
+ * only rebuilt by connect() and disconnect(). Emitting a signal is thus free of
+ * memory allocations when all slots are called synchronously. Connections
+ * created or removed during emission, including from the slots themselves,
+ * take effect for the next emission.
  */
 
 } /* namespace libcamera */
@@ -8,9 +8,10 @@
 #include <libcamera/base/thread.h>
 
 #include <atomic>
-#include <list>
+#include <errno.h>
 #include <sys/syscall.h>
 #include <sys/types.h>
+#include <thread>
 #include <unistd.h>
 
 #include <libcamera/base/event_dispatcher.h>
@@ -114,25 +115,232 @@ class ThreadMain;
 
 /**
  * \brief A queue of posted messages
+ *
+ * The message queue is split in two parts. Messages are posted to a lock-free
+ * intrusive stack, linked through the Message::next_ field, that producers
+ * update with a compare-and-swap operation without taking any lock. The
+ * consumer side atomically detaches the whole stack and appends it, in posting
+ * order, to an intrusive FIFO list protected by the \ref mutex_. The mutex is
+ * thus never contended by producers, but only by the infrequent removal of
+ * messages from other threads.
  */
 class MessageQueue
 {
 public:
+	MessageQueue()
+		: posted_(nullptr), head_(nullptr), tail_(nullptr),
+		  cursor_(nullptr), cursorType_(Message::Type::None)
+	{
+	}
+
+	~MessageQueue()
+	{
+		collect();
+
+		while (head_) {
+			Message *next = head_->next_;
+			delete head_;
+			head_ = next;
+		}
+	}
+
+	void post(Message *msg);
+	std::unique_ptr<Message> take(Message::Type type)
+		LIBCAMERA_TSA_REQUIRES(mutex_);
+	Message *remove(Object *receiver) LIBCAMERA_TSA_REQUIRES(mutex_);
+	void append(Message *messages) LIBCAMERA_TSA_REQUIRES(mutex_);
+
 	/**
-	 * \brief List of queued Message instances
-	 */
-	std::list<std::unique_ptr<Message>> list_;
-	/**
-	 * \brief Protects the \ref list_
+	 * \brief Protects the list of messages collected from the posted
+	 * messages stack
 	 */
 	Mutex mutex_;
-	/**
-	 * \brief The recursion level for recursive Thread::dispatchMessages()
-	 * calls
-	 */
-	unsigned int recursion_ = 0;
+
+private:
+	void collect() LIBCAMERA_TSA_REQUIRES(mutex_);
+
+	std::atomic<Message *> posted_;
+	Message *head_ LIBCAMERA_TSA_GUARDED_BY(mutex_);
+	Message *tail_ LIBCAMERA_TSA_GUARDED_BY(mutex_);
+
+	Message *cursor_ LIBCAMERA_TSA_GUARDED_BY(mutex_);
+	Message::Type cursorType_ LIBCAMERA_TSA_GUARDED_BY(mutex_);
 };
 
+/**
+ * \brief Post a message to the queue
+ * \param[in] msg The message
+ *
+ * Ownership of the message is transferred to the queue.
+ *
+ * \context This function is \threadsafe and lock-free.
+ */
+void MessageQueue::post(Message *msg)
+{
+	Message *head = posted_.load(std::memory_order_relaxed);
+
+	do {
+		msg->next_ = head;
+	} while (!posted_.compare_exchange_weak(head, msg,
+						std::memory_order_release,
+						std::memory_order_relaxed));
+}
+
+/**
+ * \brief Take the first queued message matching \a type
+ * \param[in] type The message type, or Message::Type::None to match all types
+ *
+ * Messages that don't match the \a type are left in the queue in their
+ * original order.
+ *
+ * When taking messages of a given \a type, the queue records the last message
+ * known not to match, and the next search for the same type resumes after it.
+ * Messages are only added at the end of the queue, so taking all messages of a
+ * type one at a time scans the queue once instead of once per message.
+ *
+ * \return The message, or nullptr if no message matches
+ */
+std::unique_ptr<Message> MessageQueue::take(Message::Type type)
+{
+	collect();
+
+	Message *prev = nullptr;
+	Message *msg = head_;
+
+	if (type != Message::Type::None && cursor_ && cursorType_ == type) {
+		prev = cursor_;
+		msg = cursor_->next_;
+	}
+
+	for (; msg; prev = msg, msg = msg->next_) {
+		if (type != Message::Type::None && msg->type() != type)
+			continue;
+
+		if (prev)
+			prev->next_ = msg->next_;
+		else
+			head_ = msg->next_;
+
+		if (tail_ == msg)
+			tail_ = prev;
+
+		if (cursor_ == msg)
+			cursor_ = nullptr;
+
+		break;
+	}
+
+	if (type != Message::Type::None) {
+		cursor_ = prev;
+		cursorType_ = type;
+	}
+
+	if (!msg)
+		return nullptr;
+
+	msg->next_ = nullptr;
+	return std::unique_ptr<Message>(msg);
+}
+
+/**
+ * \brief Remove all queued messages for the \a receiver
+ * \param[in] receiver The receiver
+ *
+ * The removed messages are returned as a list linked through the
+ * Message::next_ field, in posting order. Ownership of the messages is
+ * transferred to the caller.
+ *
+ * \return The first removed message, or nullptr if no message was removed
+ */
+Message *MessageQueue::remove(Object *receiver)
+{
+	collect();
+
+	/* The cursor may be removed, restart the next search from the head. */
+	cursor_ = nullptr;
+
+	Message *removed = nullptr;
+	Message **removedTail = &removed;
+	Message *prev = nullptr;
+
+	for (Message *msg = head_; msg;) {
+		Message *next = msg->next_;
+
+		if (msg->receiver_ != receiver) {
+			prev = msg;
+			msg = next;
+			continue;
+		}
+
+		if (prev)
+			prev->next_ = next;
+		else
+			head_ = next;
+
+		if (tail_ == msg)
+			tail_ = prev;
+
+		msg->next_ = nullptr;
+		*removedTail = msg;
+		removedTail = &msg->next_;
+
+		msg = next;
+	}
+
+	return removed;
+}
+
+/**
+ * \brief Append a list of messages to the queue
+ * \param[in] messages The first message of the list
+ *
+ * The \a messages are linked through the Message::next_ field, as returned
+ * by remove(). They are appended after all messages already posted to the
+ * queue.
+ */
+void MessageQueue::append(Message *messages)
+{
+	collect();
+
+	if (tail_)
+		tail_->next_ = messages;
+	else
+		head_ = messages;
+
+	tail_ = messages;
+	while (tail_->next_)
+		tail_ = tail_->next_;
+}
+
+/*
+ * Move the messages posted to the lock-free stack to the end of the list. The
+ * stack is ordered from the most recent message to the oldest one, reverse it
+ * to restore the posting order.
+ */
+void MessageQueue::collect()
+{
+	Message *msg = posted_.exchange(nullptr, std::memory_order_acquire);
+	if (!msg)
+		return;
+
+	Message *last = msg;
+	Message *first = nullptr;
+
+	while (msg) {
+		Message *next = msg->next_;
+		msg->next_ = first;
+		first = msg;
+		msg = next;
+	}
+
+	if (tail_)
+		tail_->next_ = first;
+	else
+		head_ = first;
+
+	tail_ = last;
+}
+
 /**
  * \brief Thread-local internal data
  */
@@ -507,6 +715,42 @@ EventDispatcher *Thread::eventDispatcher()
 	return data_->dispatcher_.load(std::memory_order_relaxed);
 }
 
+/**
+ * \brief Set the event dispatcher
+ * \param[in] dispatcher The event dispatcher
+ *
+ * This function sets the event dispatcher for the thread, overriding the
+ * default EventDispatcherPoll. It allows selecting a different dispatcher
+ * implementation, such as EventDispatcherEpoll, on a per-thread basis.
+ *
+ * The event dispatcher can only be set before it gets used for the first time,
+ * as event notifiers and timers registered with the default dispatcher can't
+ * be transferred to a new dispatcher. This function should thus be called
+ * before starting the thread and before creating any EventNotifier or Timer
+ * bound to the thread. Ownership of the \a dispatcher is transferred to the
+ * thread, which will delete it when the thread is destroyed.
+ *
+ * \context This function is \threadsafe.
+ *
+ * \return 0 on success, or -EBUSY if the thread already has an event
+ * dispatcher
+ */
+int Thread::setEventDispatcher(std::unique_ptr<EventDispatcher> dispatcher)
+{
+	EventDispatcher *expected = nullptr;
+
+	if (!data_->dispatcher_.compare_exchange_strong(expected, dispatcher.get(),
+							std::memory_order_release,
+							std::memory_order_relaxed)) {
+		LOG(Thread, Error) << "Event dispatcher already set";
+		return -EBUSY;
+	}
+
+	dispatcher.release();
+
+	return 0;
+}
+
 /**
  * \brief Post a message to the thread for the \a receiver
  * \param[in] msg The message
@@ -535,10 +779,12 @@ void Thread::postMessage(std::unique_ptr<Message> msg, Object *receiver)
 
 	ASSERT(data_ == receiver->thread()->data_);
 
-	MutexLocker locker(data_->messages_.mutex_);
-	data_->messages_.list_.push_back(std::move(msg));
+	/*
+	 * Account for the message before queuing it, to ensure the counter
+	 * can't underflow when the message gets dispatched.
+	 */
 	receiver->pendingMessages_++;
-	locker.unlock();
+	data_->messages_.post(msg.release());
 
 	EventDispatcher *dispatcher =
 		data_->dispatcher_.load(std::memory_order_acquire);
@@ -560,27 +806,39 @@ void Thread::removeMessages(Object *receiver)
 	if (!receiver->pendingMessages_)
 		return;
 
-	std::vector<std::unique_ptr<Message>> toDelete;
-	for (std::unique_ptr<Message> &msg : data_->messages_.list_) {
-		if (!msg)
-			continue;
-		if (msg->receiver_ != receiver)
+	/*
+	 * Detach the messages from the queue and delete them after releasing
+	 * the lock.
+	 *
+	 * postMessage() accounts for a message before pushing it to the queue,
+	 * without taking the lock. A message being posted concurrently may thus
+	 * be counted in pendingMessages_ but not be found by remove() yet. The
+	 * lock prevents the messages from being dispatched, collect them again
+	 * until all the accounted messages have been found. The window only
+	 * covers the compare-and-swap loop in MessageQueue::post().
+	 */
+	Message *removed = nullptr;
+	Message **tail = &removed;
+
+	while (receiver->pendingMessages_) {
+		*tail = data_->messages_.remove(receiver);
+		if (!*tail) {
+			std::this_thread::yield();
 			continue;
+		}
 
-		/*
-		 * Move the message to the pending deletion list to delete it
-		 * after releasing the lock. The messages list element will
-		 * contain a null pointer, and will be removed when dispatching
-		 * messages.
-		 */
-		toDelete.push_back(std::move(msg));
-		receiver->pendingMessages_--;
+		for (; *tail; tail = &(*tail)->next_)
+			receiver->pendingMessages_--;
 	}
 
 	ASSERT(!receiver->pendingMessages_);
 	locker.unlock();
 
-	toDelete.clear();
+	while (removed) {
+		Message *next = removed->next_;
+		delete removed;
+		removed = next;
+	}
 }
 
 /**
@@ -603,26 +861,14 @@ void Thread::dispatchMessages(Message::Type type)
 {
 	ASSERT(data_ == ThreadData::current());
 
-	++data_->messages_.recursion_;
-
 	MutexLocker locker(data_->messages_.mutex_);
 
-	std::list<std::unique_ptr<Message>> &messages = data_->messages_.list_;
-
-	for (std::unique_ptr<Message> &msg : messages) {
-		if (!msg)
-			continue;
-
-		if (type != Message::Type::None && msg->type() != type)
-			continue;
-
-		/*
-		 * Move the message, setting the entry in the list to null. It
-		 * will cause recursive calls to ignore the entry, and the erase
-		 * loop at the end of the function to delete it from the list.
-		 */
-		std::unique_ptr<Message> message = std::move(msg);
-
+	/*
+	 * Messages are taken from the head of the queue one at a time, which
+	 * guarantees ordered delivery even when this function is called
+	 * recursively from a message handler.
+	 */
+	while (std::unique_ptr<Message> message = data_->messages_.take(type)) {
 		Object *receiver = message->receiver_;
 		ASSERT(data_ == receiver->thread()->data_);
 		receiver->pendingMessages_--;
@@ -632,20 +878,6 @@ void Thread::dispatchMessages(Message::Type type)
 		message.reset();
 		locker.lock();
 	}
-
-	/*
-	 * If the recursion level is 0, erase all null messages in the list. We
-	 * can't do so during recursion, as it would invalidate the iterator of
-	 * the outer calls.
-	 */
-	if (!--data_->messages_.recursion_) {
-		for (auto iter = messages.begin(); iter != messages.end(); ) {
-			if (!*iter)
-				iter = messages.erase(iter);
-			else
-				++iter;
-		}
-	}
 }
 
 /**
@@ -669,19 +901,11 @@ void Thread::moveObject(Object *object, ThreadData *currentData,
 {
 	/* Move pending messages to the message queue of the new thread. */
 	if (object->pendingMessages_) {
-		unsigned int movedMessages = 0;
+		Message *moved = currentData->messages_.remove(object);
 
-		for (std::unique_ptr<Message> &msg : currentData->messages_.list_) {
-			if (!msg)
-				continue;
-			if (msg->receiver_ != object)
-				continue;
-
-			targetData->messages_.list_.push_back(std::move(msg));
-			movedMessages++;
-		}
+		if (moved) {
+			targetData->messages_.append(moved);
 
-		if (movedMessages) {
 			EventDispatcher *dispatcher =
 				targetData->dispatcher_.load(std::memory_order_acquire);
 			if (dispatcher)
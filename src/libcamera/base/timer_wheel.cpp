@@ -0,0 +1,408 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * timer_wheel.cpp - Hierarchical timer wheel
+ */
+
+#include <libcamera/base/timer_wheel.h>
+
+#include <algorithm>
+#include <limits>
+
+#include <libcamera/base/timer.h>
+
+/**
+ * \file base/timer_wheel.h
+ * \brief Hierarchical timer wheel
+ */
+
+namespace libcamera {
+
+namespace {
+
+constexpr unsigned int kSlotExpired = std::numeric_limits<unsigned int>::max();
+
+void listInit(TimerWheel::Entry *head)
+{
+	head->prev = head;
+	head->next = head;
+	head->timer = nullptr;
+}
+
+bool listEmpty(const TimerWheel::Entry *head)
+{
+	return head->next == head;
+}
+
+void listAppend(TimerWheel::Entry *head, TimerWheel::Entry *entry)
+{
+	entry->prev = head->prev;
+	entry->next = head;
+	head->prev->next = entry;
+	head->prev = entry;
+}
+
+void listUnlink(TimerWheel::Entry *entry)
+{
+	entry->prev->next = entry->next;
+	entry->next->prev = entry->prev;
+	entry->prev = nullptr;
+	entry->next = nullptr;
+}
+
+} /* namespace */
+
+/**
+ * \class TimerWheel
+ * \brief Hierarchical timer wheel storing the timers of an event dispatcher
+ *
+ * The TimerWheel class stores timers in a hierarchy of wheels, in the spirit of
+ * the Linux kernel timer wheel. Each level of the hierarchy contains 64 slots,
+ * with the first level slots spanning one tick each and the slots of each
+ * following level spanning 64 times more ticks than the previous level. Timers
+ * are stored in the slot corresponding to their expiry time at the lowest
+ * level that can hold it, and are cascaded to lower levels as time advances.
+ * Timers with an expiry time beyond the range of the wheel are kept in the
+ * last slot of the highest level until they get in range.
+ *
+ * Inserting and removing a timer is O(1), as each timer embeds its list entry.
+ * This makes re-arming timers, such as watchdogs restarted for every frame,
+ * cheap regardless of the number of running timers.
+ *
+ * Deadlines are rounded up to the wheel tick (kTick). Timers never expire
+ * before their deadline, but may expire up to one tick late. All timers
+ * expiring within the same tick are coalesced and processed together, which
+ * limits the number of event loop wakeups.
+ */
+
+/**
+ * \struct TimerWheel::Entry
+ * \brief Intrusive list entry linking a Timer in the wheel
+ *
+ * \var TimerWheel::Entry::prev
+ * \brief The previous entry in the list
+ *
+ * \var TimerWheel::Entry::next
+ * \brief The next entry in the list, or nullptr if the entry isn't linked
+ *
+ * \var TimerWheel::Entry::timer
+ * \brief The timer owning the entry
+ *
+ * \var TimerWheel::Entry::expires
+ * \brief The timer expiry time, in ticks
+ *
+ * \var TimerWheel::Entry::slot
+ * \brief The index of the slot the entry is stored in
+ */
+
+/**
+ * \var TimerWheel::kTick
+ * \brief The duration of a wheel tick, which defines the timers resolution
+ */
+
+/**
+ * \brief Construct an empty timer wheel
+ */
+TimerWheel::TimerWheel()
+	: count_(0), nextExpiryValid_(true),
+	  nextExpiry_(std::numeric_limits<uint64_t>::max())
+{
+	for (Level &level : levels_) {
+		for (Entry &slot : level.slots)
+			listInit(&slot);
+		level.occupied = 0;
+	}
+
+	listInit(&expired_);
+
+	base_ = std::chrono::floor<std::chrono::milliseconds>(
+		utils::clock::now().time_since_epoch()).count();
+}
+
+TimerWheel::~TimerWheel()
+{
+	/* Detach all remaining entries from the wheel. */
+	for (Level &level : levels_) {
+		for (Entry &slot : level.slots) {
+			while (!listEmpty(&slot))
+				listUnlink(slot.next);
+		}
+	}
+
+	while (!listEmpty(&expired_))
+		listUnlink(expired_.next);
+}
+
+/**
+ * \brief Insert a \a timer in the wheel
+ * \param[in] timer The timer
+ *
+ * The timer expiry time is computed from its deadline. The timer shall not
+ * already be stored in the wheel.
+ */
+void TimerWheel::insert(Timer *timer)
+{
+	Entry *entry = &timer->wheelEntry_;
+	entry->timer = timer;
+	entry->expires = toTicks(timer->deadline());
+
+	place(entry);
+	count_++;
+
+	if (nextExpiryValid_)
+		nextExpiry_ = std::min(nextExpiry_, std::max(entry->expires, base_));
+}
+
+/**
+ * \brief Remove a \a timer from the wheel
+ * \param[in] timer The timer
+ *
+ * If the timer isn't stored in the wheel, this function performs no operation.
+ */
+void TimerWheel::remove(Timer *timer)
+{
+	Entry *entry = &timer->wheelEntry_;
+	if (!entry->next)
+		return;
+
+	Entry *prev = entry->prev;
+	listUnlink(entry);
+
+	if (entry->slot == kSlotExpired)
+		return;
+
+	count_--;
+
+	/* If the slot is now empty, clear its occupancy bit. */
+	if (listEmpty(prev)) {
+		Level &level = levels_[entry->slot / kLevelSize];
+		level.occupied &= ~(uint64_t(1) << (entry->slot % kLevelSize));
+	}
+
+	if (entry->expires <= nextExpiry_)
+		nextExpiryValid_ = false;
+}
+
+/**
+ * \fn TimerWheel::empty()
+ * \brief Check if the wheel contains no pending timer
+ * \return True if the wheel contains no pending timer, false otherwise
+ */
+
+/**
+ * \brief Retrieve the expiry time of the first pending timer
+ *
+ * The expiry time is rounded up to the wheel tick. If expired timers haven't
+ * been taken with takeExpired(), the returned time is in the past.
+ *
+ * \return The expiry time of the first timer, or utils::time_point::max() if
+ * the wheel is empty
+ */
+utils::time_point TimerWheel::nextExpiry()
+{
+	if (!listEmpty(&expired_))
+		return utils::time_point();
+
+	if (!count_)
+		return utils::time_point::max();
+
+	if (!nextExpiryValid_) {
+		uint64_t next = std::numeric_limits<uint64_t>::max();
+
+		/*
+		 * Timers in the first level all expire within the next 64
+		 * ticks, the first occupied slot from the current position
+		 * thus gives the exact expiry time.
+		 */
+		if (levels_[0].occupied) {
+			unsigned int index = base_ & kLevelMask;
+			unsigned int slot = firstOccupied(0, index);
+			next = base_ + ((slot - index) & kLevelMask);
+		}
+
+		/*
+		 * For the higher levels, the first occupied slot after the
+		 * current position contains the earliest timers of the level,
+		 * scan it to find the exact expiry time. If the current
+		 * position is at the start of the slot, it hasn't been
+		 * cascaded yet and needs to be considered first.
+		 */
+		for (unsigned int i = 1; i < kLevels; ++i) {
+			const Level &level = levels_[i];
+			if (!level.occupied)
+				continue;
+
+			unsigned int shift = kLevelBits * i;
+			bool pending = !(base_ & ((uint64_t(1) << shift) - 1));
+			unsigned int index = ((base_ >> shift) + (pending ? 0 : 1)) & kLevelMask;
+			unsigned int slot = firstOccupied(i, index);
+
+			const Entry *head = &level.slots[slot];
+			for (const Entry *entry = head->next; entry != head; entry = entry->next)
+				next = std::min(next, std::max(entry->expires, base_));
+		}
+
+		nextExpiry_ = next;
+		nextExpiryValid_ = true;
+	}
+
+	return utils::time_point(std::chrono::duration_cast<utils::duration>(kTick * nextExpiry_));
+}
+
+/**
+ * \brief Expire all timers whose deadline is before \a now
+ * \param[in] now The current time
+ *
+ * The expired timers are removed from the wheel and can then be retrieved in
+ * expiry order with takeExpired().
+ */
+void TimerWheel::expire(utils::time_point now)
+{
+	uint64_t ticks = std::chrono::floor<std::chrono::milliseconds>(
+		now.time_since_epoch()).count();
+
+	while (base_ <= ticks) {
+		if (!count_) {
+			base_ = ticks + 1;
+			break;
+		}
+
+		unsigned int index = base_ & kLevelMask;
+
+		/*
+		 * At the start of each round of the first level, cascade the
+		 * timers of the next slot of the higher levels.
+		 */
+		if (!index) {
+			for (unsigned int i = 1; i < kLevels; ++i) {
+				cascade(i);
+				if ((base_ >> (kLevelBits * i)) & kLevelMask)
+					break;
+			}
+		}
+
+		Level &level = levels_[0];
+		if (level.occupied & (uint64_t(1) << index)) {
+			Entry *head = &level.slots[index];
+
+			while (!listEmpty(head)) {
+				Entry *entry = head->next;
+				listUnlink(entry);
+				listAppend(&expired_, entry);
+				entry->slot = kSlotExpired;
+				count_--;
+			}
+
+			level.occupied &= ~(uint64_t(1) << index);
+			nextExpiryValid_ = false;
+		}
+
+		base_++;
+
+		/*
+		 * Skip empty slots up to the next occupied slot or the end of
+		 * the round, whichever comes first.
+		 */
+		index = base_ & kLevelMask;
+		if (index) {
+			uint64_t pending = level.occupied >> index;
+			if (pending)
+				base_ += __builtin_ctzll(pending);
+			else
+				base_ += kLevelSize - index;
+
+			base_ = std::min(base_, ticks + 1);
+		}
+	}
+}
+
+/**
+ * \brief Take the next expired timer
+ *
+ * The timer is removed from the list of expired timers.
+ *
+ * \return The next expired timer, or nullptr if no timer has expired
+ */
+Timer *TimerWheel::takeExpired()
+{
+	if (listEmpty(&expired_))
+		return nullptr;
+
+	Entry *entry = expired_.next;
+	listUnlink(entry);
+
+	return entry->timer;
+}
+
+uint64_t TimerWheel::toTicks(utils::time_point time)
+{
+	return std::chrono::ceil<std::chrono::milliseconds>(time.time_since_epoch()).count();
+}
+
+void TimerWheel::place(Entry *entry)
+{
+	static constexpr uint64_t kRange = uint64_t(1) << (kLevelBits * kLevels);
+
+	uint64_t expires = std::max(entry->expires, base_);
+	uint64_t delta = expires - base_;
+
+	/* Clamp timers beyond the wheel range to the last slot. */
+	if (delta >= kRange) {
+		expires = base_ + kRange - 1;
+		delta = kRange - 1;
+	}
+
+	unsigned int i = 0;
+	while (delta >= uint64_t(1) << (kLevelBits * (i + 1)))
+		i++;
+
+	unsigned int index = (expires >> (kLevelBits * i)) & kLevelMask;
+	Level &level = levels_[i];
+
+	listAppend(&level.slots[index], entry);
+	entry->slot = i * kLevelSize + index;
+	level.occupied |= uint64_t(1) << index;
+}
+
+void TimerWheel::cascade(unsigned int level)
+{
+	unsigned int index = (base_ >> (kLevelBits * level)) & kLevelMask;
+	Level &lvl = levels_[level];
+
+	if (!(lvl.occupied & (uint64_t(1) << index)))
+		return;
+
+	/*
+	 * Detach the slot before re-placing its timers, as timers clamped to
+	 * the last slot may be placed back in the same slot.
+	 */
+	Entry *head = &lvl.slots[index];
+	Entry list;
+	listInit(&list);
+
+	while (!listEmpty(head)) {
+		Entry *entry = head->next;
+		listUnlink(entry);
+		listAppend(&list, entry);
+	}
+
+	lvl.occupied &= ~(uint64_t(1) << index);
+
+	while (!listEmpty(&list)) {
+		Entry *entry = list.next;
+		listUnlink(entry);
+		place(entry);
+	}
+}
+
+unsigned int TimerWheel::firstOccupied(unsigned int level, unsigned int from) const
+{
+	uint64_t occupied = levels_[level].occupied;
+	uint64_t rotated = from ? (occupied >> from) | (occupied << (kLevelSize - from))
+				: occupied;
+
+	return (__builtin_ctzll(rotated) + from) & kLevelMask;
+}
+
+} /* namespace libcamera */
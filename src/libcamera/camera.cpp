@@ -576,7 +576,8 @@ CameraConfiguration::Status CameraConfiguration::validateColorSpaces(ColorSpaceF
  * \param[in] pipe The pipeline handler responsible for the camera device
  */
 Camera::Private::Private(PipelineHandler *pipe)
-	: requestSequence_(0), pipe_(pipe->shared_from_this()),
+	: requestSequence_(0), initialized_(true),
+	  pipe_(pipe->shared_from_this()),
 	  disconnected_(false), state_(CameraAvailable)
 {
 }
@@ -642,6 +643,16 @@ Camera::Private::~Private()
  * over a single capture session.
  */
 
+/**
+ * \var Camera::Private::initialized_
+ * \brief Whether the pipeline handler has fully initialized the camera
+ *
+ * Pipeline handlers may defer the expensive part of the camera initialization
+ * until the camera is acquired, see PipelineHandler::initialize(). This flag
+ * is false for cameras whose initialization has been deferred and not
+ * completed yet.
+ */
+
 static const char *const camera_state_names[] = {
 	"Available",
 	"Acquired",
@@ -970,6 +981,11 @@ int Camera::exportFrameBuffers(Stream *stream,
  * \context This function is \threadsafe. It may only be called when the camera
  * is in the Available state as defined in \ref camera_operation.
  *
+ * If the pipeline handler has deferred initialization of the camera, the
+ * initialization is completed by this function the first time the camera is
+ * acquired. Acquiring the camera may then take significantly longer than
+ * usual, and can fail with any error reported by the initialization.
+ *
  * \return 0 on success or a negative error code otherwise
  * \retval -ENODEV The camera has been disconnected from the system
  * \retval -EBUSY The camera is not free and can't be acquired by the caller
@@ -992,6 +1008,13 @@ int Camera::acquire()
 		return -EBUSY;
 	}
 
+	ret = d->pipe_->invokeMethod(&PipelineHandler::initialize,
+				     ConnectionTypeBlocking, this);
+	if (ret) {
+		d->pipe_->release(this);
+		return ret;
+	}
+
 	d->setState(Private::CameraAcquired);
 
 	return 0;
@@ -7,6 +7,10 @@
 
 #include "libcamera/internal/camera_manager.h"
 
+#include <chrono>
+#include <stdint.h>
+#include <string.h>
+
 #include <libcamera/base/log.h>
 #include <libcamera/base/utils.h>
 
@@ -16,6 +20,7 @@
 #include "libcamera/internal/camera.h"
 #include "libcamera/internal/device_enumerator.h"
 #include "libcamera/internal/pipeline_handler.h"
+#include "libcamera/internal/v4l2_format_cache.h"
 
 /**
  * \file libcamera/camera_manager.h
@@ -34,8 +39,18 @@ namespace libcamera {
 
 LOG_DEFINE_CATEGORY(Camera)
 
+namespace {
+
+int64_t elapsed(std::chrono::steady_clock::time_point start,
+		std::chrono::steady_clock::time_point end)
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+}
+
+} /* namespace */
+
 CameraManager::Private::Private()
-	: initialized_(false)
+	: initialized_(false), lazyCameraInit_(false)
 {
 }
 
@@ -87,13 +102,38 @@ void CameraManager::Private::run()
 
 int CameraManager::Private::init()
 {
+	const char *cachePath = utils::secure_getenv("LIBCAMERA_V4L2_FORMAT_CACHE");
+	if (cachePath && cachePath[0] != '\0') {
+		formatCache_ = std::make_unique<V4L2FormatCache>(cachePath);
+
+		const char *invalidate = utils::secure_getenv("LIBCAMERA_V4L2_FORMAT_CACHE_INVALIDATE");
+		if (invalidate && !strcmp(invalidate, "1"))
+			formatCache_->invalidate();
+		else
+			formatCache_->load();
+	}
+
+	const char *lazy = utils::secure_getenv("LIBCAMERA_LAZY_CAMERA_INIT");
+	lazyCameraInit_ = lazy && !strcmp(lazy, "1");
+
+	auto start = std::chrono::steady_clock::now();
+
 	enumerator_ = DeviceEnumerator::create();
 	if (!enumerator_ || enumerator_->enumerate())
 		return -ENODEV;
 
+	auto enumerated = std::chrono::steady_clock::now();
+
 	createPipelineHandlers();
 	enumerator_->devicesAdded.connect(this, &Private::createPipelineHandlers);
 
+	auto end = std::chrono::steady_clock::now();
+
+	LOG(Camera, Debug)
+		<< "Startup took " << elapsed(start, end) << " us: device enumeration "
+		<< elapsed(start, enumerated) << " us, pipeline handler matching "
+		<< elapsed(enumerated, end) << " us";
+
 	return 0;
 }
 
@@ -118,15 +158,29 @@ void CameraManager::Private::createPipelineHandlers()
 		 * all pipelines it can provide.
 		 */
 		while (1) {
+			auto start = std::chrono::steady_clock::now();
+
 			std::shared_ptr<PipelineHandler> pipe = factory->create(o);
-			if (!pipe->match(enumerator_.get()))
+			bool matched = pipe->match(enumerator_.get());
+
+			auto end = std::chrono::steady_clock::now();
+
+			if (!matched) {
+				LOG(Camera, Debug)
+					<< "Pipeline handler \"" << factory->name()
+					<< "\" match attempt took "
+					<< elapsed(start, end) << " us";
 				break;
+			}
 
 			LOG(Camera, Debug)
 				<< "Pipeline handler \"" << factory->name()
-				<< "\" matched";
+				<< "\" matched in " << elapsed(start, end) << " us";
 		}
 	}
+
+	if (formatCache_ && formatCache_->isDirty())
+		formatCache_->save();
 }
 
 void CameraManager::Private::cleanup()
@@ -147,7 +201,15 @@ void CameraManager::Private::cleanup()
 
 	dispatchMessages(Message::Type::DeferredDelete);
 
+	/* Terminate the pre-started IPA workers from the thread they belong to. */
+	ipaManager_.releaseWorkers();
+
 	enumerator_.reset(nullptr);
+
+	/* Store the formats enumerated since the pipeline handlers matched. */
+	if (formatCache_ && formatCache_->isDirty())
+		formatCache_->save();
+	formatCache_.reset();
 }
 
 /**
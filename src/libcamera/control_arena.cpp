@@ -0,0 +1,147 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * control_arena.cpp - Arena allocator for control values
+ */
+
+#include "libcamera/internal/control_arena.h"
+
+#include <algorithm>
+#include <stddef.h>
+
+#include <libcamera/controls.h>
+
+/**
+ * \file control_arena.h
+ * \brief Arena allocator for control values
+ */
+
+namespace libcamera {
+
+/**
+ * \class ControlArena
+ * \brief Bump allocator for the storage of ControlValue arrays
+ *
+ * ControlValue instances store values larger than 8 bytes, such as arrays of
+ * colour gains or lens shading tables, in memory allocated on the heap. When a
+ * ControlList is attached to an arena with attach(), the storage for its values
+ * is instead allocated from the arena, and released all at once when the arena
+ * is reset.
+ *
+ * The arena allocates memory in blocks. When a block is exhausted, a new block
+ * is allocated, and reset() coalesces all blocks into a single block large
+ * enough to hold the memory used since the previous reset. An arena that is
+ * reset between successive uses with similar allocation patterns, such as the
+ * control lists of a request that is reused for every frame, thus stops
+ * allocating memory after the first few uses.
+ *
+ * Memory allocated from the arena is not freed individually. Callers shall
+ * ensure that no ControlValue referencing the arena memory is accessed after
+ * the arena is reset or destroyed.
+ *
+ * The ControlArena class is not thread-safe. Lists that are accessed from
+ * different threads, such as the controls and metadata of a request, shall be
+ * attached to different arenas.
+ */
+
+/**
+ * \brief Construct a ControlArena
+ * \param[in] blockSize The minimum size of the memory blocks, in bytes
+ *
+ * No memory is allocated until the first call to allocate().
+ */
+ControlArena::ControlArena(size_t blockSize)
+	: blockSize_(blockSize), used_(0)
+{
+}
+
+/**
+ * \brief Attach a control list to the arena
+ * \param[in] list The control list
+ *
+ * After this call, storage for the values set in the \a list is allocated from
+ * the arena. Values already stored in the list are not affected. Lists copied
+ * or moved from the \a list are not attached to the arena.
+ *
+ * The caller is responsible for clearing the list before resetting or
+ * destroying the arena.
+ */
+void ControlArena::attach(ControlList *list)
+{
+	list->arena_ = this;
+}
+
+/**
+ * \brief Check if a control list is attached to the arena
+ * \param[in] list The control list
+ * \return True if the \a list allocates value storage from the arena, false
+ * otherwise
+ */
+bool ControlArena::isAttached(const ControlList &list) const
+{
+	return list.arena_ == this;
+}
+
+/**
+ * \brief Allocate memory from the arena
+ * \param[in] size The number of bytes to allocate
+ *
+ * The returned memory is suitably aligned for any control type, and remains
+ * valid until the arena is reset or destroyed.
+ *
+ * \return A pointer to the allocated memory
+ */
+void *ControlArena::allocate(size_t size)
+{
+	constexpr size_t kAlignment = alignof(max_align_t);
+
+	size = (size + kAlignment - 1) & ~(kAlignment - 1);
+
+	if (blocks_.empty() || blocks_.back().size - used_ < size) {
+		size_t blockSize = std::max(blockSize_, size);
+		blocks_.push_back({ std::make_unique<uint8_t[]>(blockSize), blockSize });
+		used_ = 0;
+	}
+
+	void *mem = blocks_.back().data.get() + used_;
+	used_ += size;
+
+	return mem;
+}
+
+/**
+ * \brief Release all memory allocated from the arena
+ *
+ * All pointers returned by allocate() become invalid. If the memory allocated
+ * since the last reset spans multiple blocks, they are replaced by a single
+ * block large enough to hold all of them, to avoid further allocations when
+ * the arena is reused.
+ */
+void ControlArena::reset()
+{
+	used_ = 0;
+
+	if (blocks_.size() <= 1)
+		return;
+
+	size_t size = capacity();
+	blocks_.clear();
+	blocks_.push_back({ std::make_unique<uint8_t[]>(size), size });
+}
+
+/**
+ * \brief Retrieve the total size of the memory blocks owned by the arena
+ * \return The arena capacity, in bytes
+ */
+size_t ControlArena::capacity() const
+{
+	size_t size = 0;
+
+	for (const Block &block : blocks_)
+		size += block.size;
+
+	return size;
+}
+
+} /* namespace libcamera */
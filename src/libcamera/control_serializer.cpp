@@ -83,6 +83,22 @@ LOG_DEFINE_CATEGORY(Serializer)
  * that time. A reset of the serializer invalidates all ControlList and
  * ControlInfoMap that have been previously deserialized. The caller shall thus
  * proceed with care to avoid stale references.
+ *
+ * Control lists exchanged with IPA modules on every frame usually differ only
+ * in a few values from one frame to the next. When delta encoding is enabled
+ * with setDeltaEncoding(), the serializer remembers the last ControlList it has
+ * serialized for each ControlInfoMap handle, and only serializes the controls
+ * that have changed since then. A full list (a keyframe) is serialized
+ * periodically, and whenever it would be smaller than the delta. The
+ * deserializer tracks the lists it receives in the same way to reconstruct
+ * full lists from deltas. Delta packets are self-describing, deserialization
+ * of delta packets is thus always supported and doesn't need to be enabled.
+ *
+ * Delta encoding requires every serialized ControlList to be deserialized, in
+ * the same order, by the peer serializer. Deserialization of a delta packet
+ * fails if the previous packet in the same stream hasn't been deserialized.
+ * Users of delta encoding shall call forceKeyframe() when a serialized list
+ * may not have been delivered to the peer.
  */
 
 /**
@@ -99,11 +115,18 @@ LOG_DEFINE_CATEGORY(Serializer)
  * \brief The control serializer is used by the IPC ProxyWorker classes
  */
 
+/**
+ * \var ControlSerializer::kDefaultKeyframeInterval
+ * \brief Default maximum number of delta packets between two full control
+ * lists, for use with setDeltaEncoding()
+ */
+
 /**
  * \brief Construct a new ControlSerializer
  * \param[in] role The role of the IPC component using the serializer
  */
 ControlSerializer::ControlSerializer(Role role)
+	: keyframeInterval_(0)
 {
 	/*
 	 * Initialize the handle numerical space using the role of the
@@ -140,6 +163,42 @@ void ControlSerializer::reset()
 	infoMaps_.clear();
 	controlIds_.clear();
 	controlIdMaps_.clear();
+
+	txDeltas_.clear();
+	rxDeltas_.clear();
+}
+
+/**
+ * \brief Enable or disable delta encoding of control lists
+ * \param[in] keyframeInterval The maximum number of delta packets between two
+ * full control lists, or 0 to disable delta encoding
+ *
+ * When delta encoding is enabled, serialize() only stores the controls that
+ * differ from the previous ControlList serialized for the same ControlInfoMap
+ * handle. At most \a keyframeInterval delta packets are produced before a full
+ * list is serialized again.
+ *
+ * The next ControlList serialized for each handle after this call is a full
+ * list.
+ */
+void ControlSerializer::setDeltaEncoding(unsigned int keyframeInterval)
+{
+	keyframeInterval_ = keyframeInterval;
+	txDeltas_.clear();
+}
+
+/**
+ * \brief Serialize the next ControlList of each handle as a full list
+ *
+ * Delta encoding assumes that the peer has deserialized every ControlList
+ * serialized before. When a serialized list may not have reached the peer,
+ * for instance because its transmission failed, the caller shall call this
+ * function to restart all streams with a full list. This function has no
+ * effect when delta encoding is disabled.
+ */
+void ControlSerializer::forceKeyframe()
+{
+	txDeltas_.clear();
 }
 
 size_t ControlSerializer::binarySize(const ControlValue &value)
@@ -177,7 +236,8 @@ size_t ControlSerializer::binarySize(const ControlInfoMap &infoMap)
  * \param[in] list The control list
  *
  * Compute and return the size in bytes required to store the serialized
- * ControlList.
+ * ControlList. When delta encoding is enabled, the serialized list may be
+ * smaller, the returned size is then an upper bound.
  *
  * \return The size in bytes required to store the serialized ControlList
  */
@@ -192,6 +252,29 @@ size_t ControlSerializer::binarySize(const ControlList &list)
 	return size;
 }
 
+/**
+ * \brief Retrieve the size in bytes required to serialize a ControlListView
+ * \param[in] view The control list view
+ *
+ * Compute and return the size in bytes required to store the serialized
+ * ControlListView. When delta encoding is enabled, the serialized list may be
+ * smaller, the returned size is then an upper bound.
+ *
+ * \return The size in bytes required to store the serialized ControlListView
+ */
+size_t ControlSerializer::binarySize(const ControlListView &view)
+{
+	if (view.list_)
+		return binarySize(*view.list_);
+
+	if (!view.idmap_)
+		return binarySize(ControlList());
+
+	return sizeof(struct ipa_controls_header)
+	     + view.count_ * sizeof(struct ipa_control_value_entry)
+	     + view.values_.size();
+}
+
 void ControlSerializer::store(const ControlValue &value,
 			      ByteStreamBuffer &buffer)
 {
@@ -254,6 +337,8 @@ int ControlSerializer::serialize(const ControlInfoMap &infoMap,
 	hdr.size = sizeof(hdr) + entriesSize + valuesSize;
 	hdr.data_offset = sizeof(hdr) + entriesSize;
 	hdr.id_map_type = idMapType;
+	hdr.flags = 0;
+	hdr.sequence = 0;
 
 	buffer.write(&hdr);
 
@@ -340,47 +425,223 @@ int ControlSerializer::serialize(const ControlList &list,
 	else
 		idMapType = IPA_CONTROL_ID_MAP_V4L2;
 
-	size_t entriesSize = list.size() * sizeof(struct ipa_control_value_entry);
+	/*
+	 * In delta mode, serialize the controls that differ from the previous
+	 * list for the same handle, unless a keyframe is due.
+	 */
+	DeltaState *state = nullptr;
+	uint32_t flags = 0;
+	uint32_t sequence = 0;
+
+	if (keyframeInterval_) {
+		state = &txDeltas_[{ infoMapHandle, static_cast<uint32_t>(idMapType) }];
+		sequence = state->sequence + 1;
+
+		if (state->sequence && sequence &&
+		    state->sinceKeyframe < keyframeInterval_ &&
+		    computeDelta(state->list, list))
+			flags |= IPA_CONTROLS_FLAG_DELTA;
+		else if (!sequence)
+			sequence = 1;
+	}
+
+	if (!(flags & IPA_CONTROLS_FLAG_DELTA)) {
+		entries_.clear();
+		for (const auto &ctrl : list)
+			entries_.emplace_back(ctrl.first, &ctrl.second);
+	}
+
+	size_t entriesSize = entries_.size() * sizeof(struct ipa_control_value_entry);
 	size_t valuesSize = 0;
-	for (const auto &ctrl : list)
-		valuesSize += binarySize(ctrl.second);
+	for (const auto &ctrl : entries_) {
+		if (ctrl.second)
+			valuesSize += binarySize(*ctrl.second);
+	}
 
 	/* Prepare the packet header. */
 	struct ipa_controls_header hdr;
 	hdr.version = IPA_CONTROLS_FORMAT_VERSION;
 	hdr.handle = infoMapHandle;
-	hdr.entries = list.size();
+	hdr.entries = entries_.size();
 	hdr.size = sizeof(hdr) + entriesSize + valuesSize;
 	hdr.data_offset = sizeof(hdr) + entriesSize;
 	hdr.id_map_type = idMapType;
+	hdr.flags = flags;
+	hdr.sequence = sequence;
 
 	buffer.write(&hdr);
 
 	ByteStreamBuffer entries = buffer.carveOut(entriesSize);
 	ByteStreamBuffer values = buffer.carveOut(valuesSize);
 
-	/* Serialize all entries. */
-	for (const auto &ctrl : list) {
+	/*
+	 * Serialize all entries. Controls removed since the previous list are
+	 * stored as entries without value data.
+	 */
+	for (const auto &ctrl : entries_) {
 		unsigned int id = ctrl.first;
-		const ControlValue &value = ctrl.second;
+		const ControlValue *value = ctrl.second;
 
 		struct ipa_control_value_entry entry;
 		entry.id = id;
-		entry.type = value.type();
-		entry.is_array = value.isArray();
-		entry.count = value.numElements();
 		entry.offset = values.offset();
+
+		if (value) {
+			entry.type = value->type();
+			entry.is_array = value->isArray();
+			entry.count = value->numElements();
+			entry.flags = 0;
+		} else {
+			entry.type = ControlTypeNone;
+			entry.is_array = false;
+			entry.count = 0;
+			entry.flags = IPA_CONTROL_ENTRY_FLAG_REMOVED;
+		}
+
 		entries.write(&entry);
 
-		store(value, values);
+		if (value)
+			store(*value, values);
 	}
 
+	entries_.clear();
+
 	if (buffer.overflow())
 		return -ENOSPC;
 
+	if (state) {
+		state->list = list;
+		state->sequence = sequence;
+		state->sinceKeyframe = flags & IPA_CONTROLS_FLAG_DELTA
+				     ? state->sinceKeyframe + 1 : 0;
+	}
+
 	return 0;
 }
 
+/**
+ * \brief Serialize a ControlListView in a buffer
+ * \param[in] view The control list view to serialize
+ * \param[in] buffer The memory buffer where to serialize the ControlListView
+ *
+ * Serialize the \a view into the \a buffer using the serialization format
+ * defined by the IPA context interface in ipa_controls.h. Views that reference
+ * a serialized list are serialized by copying the serialized entries and
+ * values without decoding them, unless delta encoding is enabled.
+ *
+ * Lists of V4L2 controls can only be deserialized with their ControlInfoMap,
+ * views of such lists that have no ControlInfoMap are rejected.
+ *
+ * \return 0 on success, a negative error code otherwise
+ * \retval -EINVAL The view holds V4L2 controls without a ControlInfoMap
+ * \retval -ENOENT The ControlList is related to an unknown ControlInfoMap
+ * \retval -ENOSPC Not enough space is available in the buffer
+ */
+int ControlSerializer::serialize(const ControlListView &view,
+				 ByteStreamBuffer &buffer)
+{
+	const ControlIdMap *idmap = view.idMap();
+	enum ipa_controls_id_map_type idMapType;
+	if (!idmap || idmap == &controls::controls)
+		idMapType = IPA_CONTROL_ID_MAP_CONTROLS;
+	else if (idmap == &properties::properties)
+		idMapType = IPA_CONTROL_ID_MAP_PROPERTIES;
+	else
+		idMapType = IPA_CONTROL_ID_MAP_V4L2;
+
+	if (idMapType == IPA_CONTROL_ID_MAP_V4L2 && !view.infoMap()) {
+		LOG(Serializer, Error)
+			<< "Can't serialize ControlListView: V4L2 controls require a ControlInfoMap";
+		return -EINVAL;
+	}
+
+	if (view.list_)
+		return serialize(*view.list_, buffer);
+
+	/* Delta encoding needs to track the full list. */
+	if (!idmap || keyframeInterval_)
+		return serialize(view.toControlList(), buffer);
+
+	unsigned int infoMapHandle = 0;
+	if (view.infoMap_) {
+		auto iter = infoMapHandles_.find(view.infoMap_);
+		if (iter == infoMapHandles_.end()) {
+			LOG(Serializer, Error)
+				<< "Can't serialize ControlListView: unknown ControlInfoMap";
+			return -ENOENT;
+		}
+
+		infoMapHandle = iter->second;
+	}
+
+	size_t entriesSize = view.count_ * sizeof(struct ipa_control_value_entry);
+
+	struct ipa_controls_header hdr;
+	hdr.version = IPA_CONTROLS_FORMAT_VERSION;
+	hdr.handle = infoMapHandle;
+	hdr.entries = view.count_;
+	hdr.size = sizeof(hdr) + entriesSize + view.values_.size();
+	hdr.data_offset = sizeof(hdr) + entriesSize;
+	hdr.id_map_type = idMapType;
+	hdr.flags = 0;
+	hdr.sequence = 0;
+
+	buffer.write(&hdr);
+
+	/*
+	 * The entry offsets are relative to the data section, copy the
+	 * entries and the data section verbatim.
+	 */
+	buffer.write(Span<const uint8_t>{ view.entries_, entriesSize });
+	buffer.write(view.values_);
+
+	if (buffer.overflow())
+		return -ENOSPC;
+
+	return 0;
+}
+
+/*
+ * Fill entries_ with the controls of \a list that differ from \a previous,
+ * and with null values for the controls that have been removed. Return true if
+ * the delta is smaller than the full list.
+ */
+bool ControlSerializer::computeDelta(const ControlList &previous,
+				     const ControlList &list)
+{
+	size_t deltaSize = 0;
+
+	entries_.clear();
+
+	auto add = [&](unsigned int id, const ControlValue *value) {
+		entries_.emplace_back(id, value);
+		deltaSize += sizeof(struct ipa_control_value_entry)
+			   + (value ? binarySize(*value) : 0);
+	};
+
+	/* Both lists are sorted by ID, walk them in parallel. */
+	auto prev = previous.begin();
+
+	for (const auto &[id, value] : list) {
+		for (; prev != previous.end() && prev->first < id; ++prev)
+			add(prev->first, nullptr);
+
+		if (prev != previous.end() && prev->first == id) {
+			bool changed = prev->second != value;
+			++prev;
+			if (!changed)
+				continue;
+		}
+
+		add(id, &value);
+	}
+
+	for (; prev != previous.end(); ++prev)
+		add(prev->first, nullptr);
+
+	return deltaSize < binarySize(list) - sizeof(struct ipa_controls_header);
+}
+
 ControlValue ControlSerializer::loadControlValue(ByteStreamBuffer &buffer,
 						 bool isArray,
 						 unsigned int count)
@@ -405,6 +666,59 @@ ControlInfo ControlSerializer::loadControlInfo(ByteStreamBuffer &b)
 	return ControlInfo(min, max, def);
 }
 
+const ControlInfoMap *ControlSerializer::listInfoMap(const struct ipa_controls_header *hdr)
+{
+	/*
+	 * Retrieve the ControlInfoMap associated with the ControlList, if a
+	 * valid handle has been initialized at serialization time.
+	 */
+	if (!hdr->handle)
+		return nullptr;
+
+	auto iter = std::find_if(infoMapHandles_.begin(), infoMapHandles_.end(),
+				 [&](decltype(infoMapHandles_)::value_type &entry) {
+					 return entry.second == hdr->handle;
+				 });
+	if (iter == infoMapHandles_.end()) {
+		LOG(Serializer, Error)
+			<< "Can't deserialize ControlList: unknown ControlInfoMap";
+		return nullptr;
+	}
+
+	return iter->first;
+}
+
+const ControlIdMap *ControlSerializer::listIdMap(const struct ipa_controls_header *hdr)
+{
+	/*
+	 * Retrieve the ControlIdMap associated with the ControlList.
+	 *
+	 * The idmap is either retrieved from the list's ControlInfoMap when
+	 * a valid handle has been initialized at serialization time, or by
+	 * using the header's id_map_type field for lists that refer to the
+	 * globally defined libcamera controls and properties, for which no
+	 * ControlInfoMap is available.
+	 */
+	if (hdr->handle) {
+		const ControlInfoMap *infoMap = listInfoMap(hdr);
+		return infoMap ? &infoMap->idmap() : nullptr;
+	}
+
+	switch (hdr->id_map_type) {
+	case IPA_CONTROL_ID_MAP_CONTROLS:
+		return &controls::controls;
+
+	case IPA_CONTROL_ID_MAP_PROPERTIES:
+		return &properties::properties;
+
+	case IPA_CONTROL_ID_MAP_V4L2:
+	default:
+		LOG(Serializer, Fatal)
+			<< "A list of V4L2 controls requires an ControlInfoMap";
+		return nullptr;
+	}
+}
+
 /**
  * \fn template<typename T> T ControlSerializer::deserialize(ByteStreamBuffer &buffer)
  * \brief Deserialize an object from a binary buffer
@@ -560,54 +874,60 @@ ControlList ControlSerializer::deserialize<ControlList>(ByteStreamBuffer &buffer
 		return {};
 	}
 
+	const ControlIdMap *idMap = listIdMap(hdr);
+	if (!idMap)
+		return {};
+
 	/*
-	 * Retrieve the ControlIdMap associated with the ControlList.
-	 *
-	 * The idmap is either retrieved from the list's ControlInfoMap when
-	 * a valid handle has been initialized at serialization time, or by
-	 * using the header's id_map_type field for lists that refer to the
-	 * globally defined libcamera controls and properties, for which no
-	 * ControlInfoMap is available.
+	 * Lists with a sequence number are tracked to reconstruct the lists
+	 * sent as deltas.
 	 */
-	const ControlIdMap *idMap;
-	if (hdr->handle) {
-		auto iter = std::find_if(infoMapHandles_.begin(), infoMapHandles_.end(),
-					 [&](decltype(infoMapHandles_)::value_type &entry) {
-						 return entry.second == hdr->handle;
-					 });
-		if (iter == infoMapHandles_.end()) {
+	bool delta = hdr->flags & IPA_CONTROLS_FLAG_DELTA;
+	DeltaState *state = nullptr;
+
+	if (hdr->sequence) {
+		state = &rxDeltas_[{ hdr->handle, static_cast<uint32_t>(hdr->id_map_type) }];
+
+		if (delta && state->sequence + 1 != hdr->sequence) {
 			LOG(Serializer, Error)
-				<< "Can't deserialize ControlList: unknown ControlInfoMap";
+				<< "Can't deserialize ControlList: delta "
+				<< hdr->sequence << " doesn't apply to "
+				<< state->sequence;
 			return {};
 		}
+	} else if (delta) {
+		LOG(Serializer, Error)
+			<< "Can't deserialize ControlList: delta without sequence";
+		return {};
+	}
 
-		const ControlInfoMap *infoMap = iter->first;
-		idMap = &infoMap->idmap();
-	} else {
-		switch (hdr->id_map_type) {
-		case IPA_CONTROL_ID_MAP_CONTROLS:
-			idMap = &controls::controls;
-			break;
-
-		case IPA_CONTROL_ID_MAP_PROPERTIES:
-			idMap = &properties::properties;
-			break;
-
-		case IPA_CONTROL_ID_MAP_V4L2:
-		default:
-			LOG(Serializer, Fatal)
-				<< "A list of V4L2 controls requires an ControlInfoMap";
+	/*
+	 * Keyframes deserialized as a ControlListView are stored in their
+	 * serialized form, decode them before applying the first delta.
+	 */
+	if (delta && !state->keyframe.empty()) {
+		std::vector<uint8_t> keyframe = std::move(state->keyframe);
+		state->keyframe.clear();
+
+		ByteStreamBuffer packet(const_cast<const uint8_t *>(keyframe.data()),
+					keyframe.size());
+		deserialize<ControlList>(packet);
+		if (packet.overflow() || state->sequence + 1 != hdr->sequence) {
+			LOG(Serializer, Error)
+				<< "Can't deserialize ControlList: invalid keyframe";
 			return {};
 		}
 	}
 
 	/*
-	 * \todo When available, initialize the list with the ControlInfoMap
-	 * so that controls can be validated against their limits.
-	 * Currently no validation is performed, so it's fine relying on the
-	 * idmap only.
+	 * Initialize the list with the ControlInfoMap when available, so that
+	 * it can be serialized again.
+	 *
+	 * \todo Validate the controls against the limits of the ControlInfoMap.
 	 */
-	ControlList ctrls(*idMap);
+	const ControlInfoMap *infoMap = listInfoMap(hdr);
+	ControlList ctrls = infoMap ? ControlList(*infoMap) : ControlList(*idMap);
+	std::vector<unsigned int> removed;
 
 	for (unsigned int i = 0; i < hdr->entries; ++i) {
 		const struct ipa_control_value_entry *entry =
@@ -624,13 +944,136 @@ ControlList ControlSerializer::deserialize<ControlList>(ByteStreamBuffer &buffer
 			return {};
 		}
 
+		if (entry->flags & IPA_CONTROL_ENTRY_FLAG_REMOVED) {
+			if (!delta) {
+				LOG(Serializer, Error)
+					<< "Bad data, removed control in full list (entry "
+					<< i << ")";
+				return {};
+			}
+
+			removed.push_back(entry->id);
+			continue;
+		}
+
 		ctrls.set(entry->id,
 			  loadControlValue(values, entry->is_array, entry->count));
 	}
 
+	if (delta) {
+		/*
+		 * Apply the delta to the previous list. All lists are sorted
+		 * by ID, walk them in parallel.
+		 */
+		std::sort(removed.begin(), removed.end());
+
+		ControlList list = infoMap ? ControlList(*infoMap) : ControlList(*idMap);
+		auto changes = ctrls.begin();
+		auto removal = removed.cbegin();
+
+		for (const auto &[id, value] : state->list) {
+			for (; changes != ctrls.end() && changes->first < id; ++changes)
+				list.set(changes->first, changes->second);
+
+			if (changes != ctrls.end() && changes->first == id) {
+				list.set(id, changes->second);
+				++changes;
+				continue;
+			}
+
+			while (removal != removed.cend() && *removal < id)
+				++removal;
+			if (removal != removed.cend() && *removal == id)
+				continue;
+
+			list.set(id, value);
+		}
+
+		for (; changes != ctrls.end(); ++changes)
+			list.set(changes->first, changes->second);
+
+		ctrls = std::move(list);
+	}
+
+	if (state) {
+		state->list = ctrls;
+		state->keyframe.clear();
+		state->sequence = hdr->sequence;
+	}
+
 	return ctrls;
 }
 
+/**
+ * \brief Deserialize a ControlListView from a binary buffer
+ * \param[in] buffer The memory buffer that contains the serialized list
+ *
+ * Create a ControlListView that references the ControlList serialized in
+ * \a buffer using the serialize() function, without copying the control
+ * values. The view is only valid as long as the memory of \a buffer.
+ *
+ * Delta packets are deserialized in full to reconstruct the list, the view
+ * then owns a copy of the deserialized list. Full lists serialized in delta
+ * mode are referenced in place, and copied in their serialized form to
+ * reconstruct the next delta.
+ *
+ * \return The deserialized ControlListView
+ */
+template<>
+ControlListView ControlSerializer::deserialize<ControlListView>(ByteStreamBuffer &buffer)
+{
+	const uint8_t *start = buffer.base() + buffer.offset();
+	const struct ipa_controls_header *hdr = buffer.read<decltype(*hdr)>();
+	if (!hdr) {
+		LOG(Serializer, Error) << "Out of data";
+		return {};
+	}
+
+	if (hdr->flags & IPA_CONTROLS_FLAG_DELTA) {
+		if (hdr->size < sizeof(*hdr) ||
+		    buffer.skip(hdr->size - sizeof(*hdr)) < 0) {
+			LOG(Serializer, Error) << "Out of data";
+			return {};
+		}
+
+		ByteStreamBuffer packet(start, hdr->size);
+		return ControlListView(deserialize<ControlList>(packet));
+	}
+
+	if (hdr->version != IPA_CONTROLS_FORMAT_VERSION) {
+		LOG(Serializer, Error)
+			<< "Unsupported controls format version "
+			<< hdr->version;
+		return {};
+	}
+
+	ByteStreamBuffer entries = buffer.carveOut(hdr->data_offset - sizeof(*hdr));
+	ByteStreamBuffer values = buffer.carveOut(hdr->size - hdr->data_offset);
+
+	if (buffer.overflow()) {
+		LOG(Serializer, Error) << "Out of data";
+		return {};
+	}
+
+	const ControlIdMap *idMap = listIdMap(hdr);
+	if (!idMap)
+		return {};
+
+	ControlListView view(*idMap, listInfoMap(hdr),
+			     { entries.base(), entries.size() },
+			     hdr->entries, { values.base(), values.size() });
+
+	if (hdr->sequence) {
+		DeltaState &state =
+			rxDeltas_[{ hdr->handle, static_cast<uint32_t>(hdr->id_map_type) }];
+		state.list.clear();
+		state.keyframe.assign(start, start + hdr->size);
+		state.sequence = hdr->sequence;
+	}
+
+	return view;
+}
+
 /**
  * \brief Check if a ControlInfoMap is cached
  * \param[in] infoMap The ControlInfoMap to check
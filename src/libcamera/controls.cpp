@@ -7,6 +7,8 @@
 
 #include <libcamera/controls.h>
 
+#include <algorithm>
+#include <functional>
 #include <iomanip>
 #include <sstream>
 #include <string>
@@ -15,6 +17,9 @@
 #include <libcamera/base/log.h>
 #include <libcamera/base/utils.h>
 
+#include <libcamera/ipa/ipa_controls.h>
+
+#include "libcamera/internal/control_arena.h"
 #include "libcamera/internal/control_validator.h"
 
 /**
@@ -96,7 +101,7 @@ static_assert(sizeof(ControlValue) == 16, "Invalid size of ControlValue class");
  * \brief Construct an empty ControlValue.
  */
 ControlValue::ControlValue()
-	: type_(ControlTypeNone), isArray_(false), numElements_(0)
+	: type_(ControlTypeNone), isArray_(false), external_(false), numElements_(0)
 {
 }
 
@@ -117,9 +122,13 @@ void ControlValue::release()
 	std::size_t size = numElements_ * ControlValueSize[type_];
 
 	if (size > sizeof(value_)) {
-		delete[] reinterpret_cast<uint8_t *>(storage_);
+		/* Memory allocated from a ControlArena is owned by the arena. */
+		if (!external_)
+			delete[] reinterpret_cast<uint8_t *>(storage_);
 		storage_ = nullptr;
 	}
+
+	external_ = false;
 }
 
 ControlValue::~ControlValue()
@@ -132,7 +141,7 @@ ControlValue::~ControlValue()
  * \param[in] other The ControlValue to copy content from
  */
 ControlValue::ControlValue(const ControlValue &other)
-	: type_(ControlTypeNone), numElements_(0)
+	: type_(ControlTypeNone), isArray_(false), external_(false), numElements_(0)
 {
 	*this = other;
 }
@@ -145,8 +154,58 @@ ControlValue::ControlValue(const ControlValue &other)
  */
 ControlValue &ControlValue::operator=(const ControlValue &other)
 {
-	set(other.type_, other.isArray_, other.data().data(),
-	    other.numElements_, ControlValueSize[other.type_]);
+	set(other, nullptr);
+	return *this;
+}
+
+/**
+ * \brief Construct a ControlValue by moving the content of \a other
+ * \param[in] other The ControlValue to move content from
+ *
+ * The content of \a other is moved to the new instance without copying the
+ * value, and \a other is left with no value (ControlTypeNone).
+ *
+ * If the value of \a other is stored in memory allocated from a ControlArena,
+ * the new instance references the same memory, and shall not be accessed after
+ * the arena is reset.
+ */
+ControlValue::ControlValue(ControlValue &&other) noexcept
+	: type_(other.type_), isArray_(other.isArray_), external_(other.external_),
+	  numElements_(other.numElements_), value_(other.value_)
+{
+	other.type_ = ControlTypeNone;
+	other.isArray_ = false;
+	other.external_ = false;
+	other.numElements_ = 0;
+}
+
+/**
+ * \brief Replace the content of the ControlValue with the content of \a other
+ * \param[in] other The ControlValue to move content from
+ *
+ * The content of \a other is moved to the instance without copying the value,
+ * and \a other is left with no value (ControlTypeNone).
+ *
+ * \return The ControlValue with its content replaced with the one of \a other
+ */
+ControlValue &ControlValue::operator=(ControlValue &&other) noexcept
+{
+	if (this == &other)
+		return *this;
+
+	release();
+
+	type_ = other.type_;
+	isArray_ = other.isArray_;
+	external_ = other.external_;
+	numElements_ = other.numElements_;
+	value_ = other.value_;
+
+	other.type_ = ControlTypeNone;
+	other.isArray_ = false;
+	other.external_ = false;
+	other.numElements_ = 0;
+
 	return *this;
 }
 
@@ -330,16 +389,23 @@ bool ControlValue::operator==(const ControlValue &other) const
  */
 
 void ControlValue::set(ControlType type, bool isArray, const void *data,
-		       std::size_t numElements, std::size_t elementSize)
+		       std::size_t numElements, std::size_t elementSize,
+		       ControlArena *arena)
 {
 	ASSERT(elementSize == ControlValueSize[type]);
 
-	reserve(type, isArray, numElements);
+	allocate(type, isArray, numElements, arena);
 
 	Span<uint8_t> storage = ControlValue::data();
 	memcpy(storage.data(), data, storage.size());
 }
 
+void ControlValue::set(const ControlValue &other, ControlArena *arena)
+{
+	set(other.type_, other.isArray_, other.data().data(),
+	    other.numElements_, ControlValueSize[other.type_], arena);
+}
+
 /**
  * \brief Set the control type and reserve memory
  * \param[in] type The control type
@@ -353,6 +419,12 @@ void ControlValue::set(ControlType type, bool isArray, const void *data,
  * storage for the single element is reserved.
  */
 void ControlValue::reserve(ControlType type, bool isArray, std::size_t numElements)
+{
+	allocate(type, isArray, numElements, nullptr);
+}
+
+void ControlValue::allocate(ControlType type, bool isArray,
+			    std::size_t numElements, ControlArena *arena)
 {
 	if (!isArray)
 		numElements = 1;
@@ -370,8 +442,15 @@ void ControlValue::reserve(ControlType type, bool isArray, std::size_t numElemen
 	if (oldSize == newSize)
 		return;
 
-	if (newSize > sizeof(value_))
+	if (newSize <= sizeof(value_))
+		return;
+
+	if (arena) {
+		storage_ = arena->allocate(newSize);
+		external_ = true;
+	} else {
 		storage_ = reinterpret_cast<void *>(new uint8_t[newSize]);
+	}
 }
 
 /**
@@ -815,6 +894,26 @@ ControlInfoMap::const_iterator ControlInfoMap::find(unsigned int id) const
  * Control lists are constructed with a map of all the controls supported by
  * their object, and an optional ControlValidator to further validate the
  * controls.
+ *
+ * Controls are stored in a vector sorted by numerical ID. Lookups use a binary
+ * search, iteration visits controls in increasing ID order, and a list that is
+ * cleared and refilled with the same controls, as is typical for per-frame
+ * metadata, doesn't allocate memory for the list itself. Adding a control to
+ * the list moves the controls that follow it, and invalidates all iterators as
+ * well as the references to values returned by get(). Unlike with a node-based
+ * container, such references are thus not stable across insertions, and shall
+ * be retrieved again after adding a control. Setting a control to a value
+ * retrieved from the same list with get(unsigned int id) is supported.
+ * Iterators only give access to constant control IDs, as modifying them would
+ * break the ordering of the list.
+ *
+ * Values that don't fit in the ControlValue instance, such as arrays, are
+ * stored in memory allocated on the heap for each value. Internally, a list can
+ * instead be attached to a ControlArena, in which case the storage for the
+ * values set through the list is allocated from the arena. This is used by the
+ * Request class to avoid memory allocations for the controls and metadata of
+ * requests that are reused. Lists copied or moved from a list attached to an
+ * arena store their values on the heap, and stay valid when the arena is reset.
  */
 
 /**
@@ -824,7 +923,8 @@ ControlInfoMap::const_iterator ControlInfoMap::find(unsigned int id) const
  * be used directly by application.
  */
 ControlList::ControlList()
-	: validator_(nullptr), idmap_(nullptr), infoMap_(nullptr)
+	: validator_(nullptr), idmap_(nullptr), infoMap_(nullptr),
+	  arena_(nullptr)
 {
 }
 
@@ -839,7 +939,8 @@ ControlList::ControlList()
  */
 ControlList::ControlList(const ControlIdMap &idmap,
 			 const ControlValidator *validator)
-	: validator_(validator), idmap_(&idmap), infoMap_(nullptr)
+	: validator_(validator), idmap_(&idmap), infoMap_(nullptr),
+	  arena_(nullptr)
 {
 }
 
@@ -850,13 +951,118 @@ ControlList::ControlList(const ControlIdMap &idmap,
  */
 ControlList::ControlList(const ControlInfoMap &infoMap,
 			 const ControlValidator *validator)
-	: validator_(validator), idmap_(&infoMap.idmap()), infoMap_(&infoMap)
+	: validator_(validator), idmap_(&infoMap.idmap()), infoMap_(&infoMap),
+	  arena_(nullptr)
+{
+}
+
+/**
+ * \brief Construct a ControlList with a copy of the content of \a other
+ * \param[in] other The ControlList to copy content from
+ *
+ * The new list is not attached to the arena of \a other, if any. The values it
+ * contains are stored in memory allocated on the heap, and stay valid after
+ * the arena of \a other is reset.
+ */
+ControlList::ControlList(const ControlList &other)
+	: validator_(other.validator_), idmap_(other.idmap_),
+	  infoMap_(other.infoMap_), arena_(nullptr), controls_(other.controls_)
+{
+}
+
+/**
+ * \brief Replace the content of the ControlList with a copy of the content of
+ * \a other
+ * \param[in] other The ControlList to copy content from
+ *
+ * The list stays attached to its arena, if any, and the values copied from
+ * \a other are allocated from that arena.
+ *
+ * \return The ControlList with its content replaced with the one of \a other
+ */
+ControlList &ControlList::operator=(const ControlList &other)
+{
+	if (this == &other)
+		return *this;
+
+	validator_ = other.validator_;
+	idmap_ = other.idmap_;
+	infoMap_ = other.infoMap_;
+
+	controls_.clear();
+	controls_.reserve(other.controls_.size());
+
+	for (const auto &[id, value] : other.controls_)
+		controls_.emplace_back(id, ControlValue{}).second.set(value, arena_);
+
+	return *this;
+}
+
+/**
+ * \brief Construct a ControlList by moving the content of \a other
+ * \param[in] other The ControlList to move content from
+ *
+ * The new list is not attached to the arena of \a other, if any. If \a other is
+ * attached to an arena, its values are copied to memory allocated on the heap
+ * and \a other is cleared, otherwise they are moved without copy.
+ *
+ * The copy from an arena allocates memory. libcamera doesn't handle allocation
+ * failures, which are fatal, the constructor is thus noexcept to let
+ * containers of ControlList move their elements instead of copying them.
+ */
+ControlList::ControlList(ControlList &&other) noexcept
+	: validator_(other.validator_), idmap_(other.idmap_),
+	  infoMap_(other.infoMap_), arena_(nullptr)
 {
+	if (other.arena_) {
+		ControlListMap(other.controls_).swap(controls_);
+		other.clear();
+	} else {
+		controls_ = std::move(other.controls_);
+	}
+}
+
+/**
+ * \brief Replace the content of the ControlList with the content of \a other
+ * \param[in] other The ControlList to move content from
+ *
+ * The list stays attached to its arena, if any. If either list is attached to
+ * an arena, the values of \a other are copied to the storage of the list, as
+ * with the copy assignment operator, and \a other is cleared. Otherwise they
+ * are moved without copy.
+ *
+ * As for the move constructor, allocation failures when copying values are
+ * fatal, and the operator is noexcept.
+ *
+ * \return The ControlList with its content replaced with the one of \a other
+ */
+ControlList &ControlList::operator=(ControlList &&other) noexcept
+{
+	if (this == &other)
+		return *this;
+
+	if (arena_ || other.arena_) {
+		*this = static_cast<const ControlList &>(other);
+		other.clear();
+		return *this;
+	}
+
+	validator_ = other.validator_;
+	idmap_ = other.idmap_;
+	infoMap_ = other.infoMap_;
+	controls_ = std::move(other.controls_);
+
+	return *this;
 }
 
 /**
  * \typedef ControlList::iterator
  * \brief Iterator for the controls contained within the list
+ *
+ * The iterator gives access to pairs of control numerical ID and value. The
+ * control ID is constant, only the value can be modified through the iterator.
+ * Dereferencing the iterator returns a std::pair of references to the ID and
+ * value stored in the list, by value.
  */
 
 /**
@@ -918,8 +1124,7 @@ ControlList::ControlList(const ControlInfoMap &infoMap,
  * Only control lists created from the same ControlIdMap or ControlInfoMap may
  * be merged. Attempting to do otherwise results in undefined behaviour.
  *
- * \todo Reimplement or implement an overloaded version which internally uses
- * std::unordered_map::merge() and accepts a non-const argument.
+ * As both lists are sorted, they are merged in linear time.
  */
 void ControlList::merge(const ControlList &source)
 {
@@ -935,15 +1140,79 @@ void ControlList::merge(const ControlList &source)
 	 * See https://bugs.libcamera.org/show_bug.cgi?id=31 for further details
 	 */
 
-	for (const auto &ctrl : source) {
-		if (contains(ctrl.first)) {
-			const ControlId *id = idmap_->at(ctrl.first);
+	auto accept = [&](unsigned int id) {
+		if (validator_ && !validator_->validate(id)) {
+			LOG(Controls, Error)
+				<< "Control " << utils::hex(id)
+				<< " is not valid for " << validator_->name();
+			return false;
+		}
+
+		return true;
+	};
+
+	/*
+	 * Controls are commonly merged into an empty list or a list whose
+	 * controls all precede the ones of the source. Append them directly in
+	 * that case.
+	 */
+	if (source.empty())
+		return;
+
+	if (controls_.empty() || controls_.back().first < source.controls_.front().first) {
+		for (const auto &[id, value] : source) {
+			if (accept(id))
+				controls_.emplace_back(id, ControlValue{}).second.set(value, arena_);
+		}
+
+		return;
+	}
+
+	/*
+	 * Otherwise count the controls to be added, grow the list, and merge
+	 * both lists in place from the back.
+	 */
+	std::size_t size = controls_.size();
+	std::size_t added = 0;
+	std::size_t index = 0;
+
+	for (const auto &[id, value] : source.controls_) {
+		while (index < size && controls_[index].first < id)
+			index++;
+
+		if (index < size && controls_[index].first == id) {
 			LOG(Controls, Warning)
-				<< "Control " << id->name() << " not overwritten";
+				<< "Control " << idmap_->at(id)->name()
+				<< " not overwritten";
 			continue;
 		}
 
-		set(ctrl.first, ctrl.second);
+		if (accept(id))
+			added++;
+	}
+
+	if (!added)
+		return;
+
+	controls_.resize(size + added);
+
+	std::size_t dst = controls_.size();
+	index = size;
+
+	for (auto src = source.controls_.rbegin(); src != source.controls_.rend(); ++src) {
+		unsigned int id = src->first;
+
+		while (index && controls_[index - 1].first > id)
+			controls_[--dst] = std::move(controls_[--index]);
+
+		if ((index && controls_[index - 1].first == id) ||
+		    (validator_ && !validator_->validate(id)))
+			continue;
+
+		auto &entry = controls_[--dst];
+		entry.first = id;
+		entry.second = ControlValue{};
+		entry.second.set(src->second, arena_);
 	}
 }
 
@@ -955,7 +1224,7 @@ void ControlList::merge(const ControlList &source)
  */
 bool ControlList::contains(unsigned int id) const
 {
-	return controls_.find(id) != controls_.end();
+	return lookup(id) != controls_.end();
 }
 
 /**
@@ -1025,11 +1294,25 @@ const ControlValue &ControlList::get(unsigned int id) const
  */
 void ControlList::set(unsigned int id, const ControlValue &value)
 {
+	/*
+	 * Adding the control may move the values stored in the list. If
+	 * \a value is one of them, copy it first.
+	 */
+	const void *begin = controls_.data();
+	const void *end = controls_.data() + controls_.size();
+
+	if (std::less_equal<const void *>()(begin, &value) &&
+	    std::less<const void *>()(&value, end) && !contains(id)) {
+		ControlValue copy = value;
+		set(id, copy);
+		return;
+	}
+
 	ControlValue *val = find(id);
 	if (!val)
 		return;
 
-	*val = value;
+	val->set(value, arena_);
 }
 
 /**
@@ -1052,7 +1335,7 @@ void ControlList::set(unsigned int id, const ControlValue &value)
 
 const ControlValue *ControlList::find(unsigned int id) const
 {
-	const auto iter = controls_.find(id);
+	const auto iter = lookup(id);
 	if (iter == controls_.end()) {
 		LOG(Controls, Error)
 			<< "Control " << utils::hex(id) << " not found";
@@ -1072,7 +1355,269 @@ ControlValue *ControlList::find(unsigned int id)
 		return nullptr;
 	}
 
-	return &controls_[id];
+	/*
+	 * Controls are commonly set in increasing ID order, check the last
+	 * entry first to append them without searching.
+	 */
+	if (controls_.empty() || controls_.back().first < id) {
+		controls_.emplace_back(id, ControlValue{});
+		return &controls_.back().second;
+	}
+
+	auto iter = std::lower_bound(controls_.begin(), controls_.end(), id,
+				     [](const auto &entry, unsigned int key) {
+					     return entry.first < key;
+				     });
+	if (iter->first == id)
+		return &iter->second;
+
+	iter = controls_.emplace(iter, id, ControlValue{});
+	return &iter->second;
+}
+
+/**
+ * \class ControlListView
+ * \brief Read-only view of a serialized ControlList
+ *
+ * Deserializing a ControlList copies every control value it contains, even
+ * when the receiver only reads a few of them. The ControlListView class
+ * instead references a serialized ControlList in place, and only decodes the
+ * controls that are looked up. It is created by the ControlSerializer, and can
+ * be used as a parameter type in IPA interfaces for control lists that are
+ * passed on every frame but only sparsely read.
+ *
+ * A view created from a serialized buffer doesn't copy the buffer. It is only
+ * valid as long as the buffer is, which for views received as IPA interface
+ * parameters is the duration of the function call. Receivers that need to keep
+ * the controls shall copy them with toControlList().
+ *
+ * A view can also be constructed from a ControlList, in which case it takes
+ * ownership of the list and can be copied freely. This is used to pass
+ * ControlListView parameters without serialization.
+ *
+ * Lookups in views are not thread-safe.
+ */
+
+/**
+ * \brief Construct an empty ControlListView
+ */
+ControlListView::ControlListView()
+	: idmap_(nullptr), infoMap_(nullptr), entries_(nullptr), count_(0), sorted_(true)
+{
+}
+
+/**
+ * \brief Construct a ControlListView over a ControlList
+ * \param[in] list The control list
+ *
+ * The view takes ownership of \a list. Copies of the view share the list.
+ */
+ControlListView::ControlListView(ControlList list)
+	: idmap_(list.idMap()), infoMap_(nullptr), entries_(nullptr), count_(0), sorted_(true)
+{
+	list_ = std::make_shared<const ControlList>(std::move(list));
+}
+
+/*
+ * Construct a view over the \a count entries and the values data section of a
+ * serialized ControlList packet. The \a infoMap is the ControlInfoMap of the
+ * serialized list, if any. The entries are validated, the view is empty if any
+ * entry is invalid.
+ */
+ControlListView::ControlListView(const ControlIdMap &idmap,
+				 const ControlInfoMap *infoMap,
+				 Span<const uint8_t> entries, unsigned int count,
+				 Span<const uint8_t> values)
+	: idmap_(&idmap), infoMap_(infoMap), entries_(entries.data()), count_(0), values_(values),
+	  sorted_(true)
+{
+	if (entries.size() < count * sizeof(ipa_control_value_entry)) {
+		LOG(Controls, Error) << "Invalid serialized control list";
+		return;
+	}
+
+	uint32_t previous = 0;
+
+	for (unsigned int i = 0; i < count; ++i) {
+		ipa_control_value_entry entry;
+		memcpy(&entry, entries_ + i * sizeof(entry), sizeof(entry));
+
+		size_t size = entry.type <= ControlTypeSize
+			    ? entry.count * ControlValueSize[entry.type] : 0;
+		if (entry.type > ControlTypeSize ||
+		    (!entry.is_array && entry.count != 1) ||
+		    entry.offset + sizeof(ControlType) + size > values.size()) {
+			LOG(Controls, Error)
+				<< "Invalid serialized control "
+				<< utils::hex(entry.id);
+			return;
+		}
+
+		if (i && entry.id <= previous)
+			sorted_ = false;
+		previous = entry.id;
+	}
+
+	count_ = count;
+}
+
+/**
+ * \fn ControlListView::empty()
+ * \brief Identify if the view is empty
+ * \return True if the view does not contain any control, false otherwise
+ */
+
+/**
+ * \brief Retrieve the number of controls in the view
+ * \return The number of controls in the view
+ */
+std::size_t ControlListView::size() const
+{
+	return list_ ? list_->size() : count_;
+}
+
+/**
+ * \brief Check if the view contains a control with the specified \a id
+ * \param[in] id The control numerical ID
+ * \return True if the view contains a matching control, false otherwise
+ */
+bool ControlListView::contains(unsigned int id) const
+{
+	if (list_)
+		return list_->contains(id);
+
+	Element element;
+	return find(id, &element);
+}
+
+/**
+ * \fn ControlListView::get(const Control<T> &ctrl) const
+ * \brief Get the value of control \a ctrl
+ * \param[in] ctrl The control
+ *
+ * Only the value of \a ctrl is decoded. Array values are returned as a Span
+ * that references the serialized data directly when it is suitably aligned.
+ *
+ * \return A std::optional<T> containing the control value, or std::nullopt if
+ * the control \a ctrl is not present in the view or its type doesn't match
+ */
+
+/**
+ * \brief Get the value of control \a id
+ * \param[in] id The control numerical ID
+ * \return A copy of the control value, or an empty ControlValue if the control
+ * \a id is not present in the view
+ */
+ControlValue ControlListView::get(unsigned int id) const
+{
+	if (list_)
+		return list_->contains(id) ? list_->get(id) : ControlValue();
+
+	Element element;
+	if (!find(id, &element))
+		return {};
+
+	ControlValue value;
+	value.reserve(element.type, element.isArray, element.numElements);
+	memcpy(value.data().data(), element.data, value.data().size());
+
+	return value;
+}
+
+/**
+ * \fn ControlListView::idMap()
+ * \brief Retrieve the ControlId map of the serialized list
+ * \return The ControlId map, or nullptr for views created empty
+ */
+
+/**
+ * \fn ControlListView::infoMap()
+ * \brief Retrieve the ControlInfoMap of the list
+ * \return The ControlInfoMap of the list, or nullptr if the list has no
+ * ControlInfoMap
+ */
+
+/**
+ * \brief Copy the controls of the view to a ControlList
+ * \return A ControlList containing all the controls of the view
+ */
+ControlList ControlListView::toControlList() const
+{
+	if (list_)
+		return *list_;
+
+	if (!idmap_)
+		return {};
+
+	ControlList list = infoMap_ ? ControlList(*infoMap_) : ControlList(*idmap_);
+
+	for (unsigned int i = 0; i < count_; ++i) {
+		ipa_control_value_entry entry;
+		memcpy(&entry, entries_ + i * sizeof(entry), sizeof(entry));
+		list.set(entry.id, get(entry.id));
+	}
+
+	return list;
+}
+
+bool ControlListView::find(unsigned int id, Element *element) const
+{
+	ipa_control_value_entry entry;
+	unsigned int first = 0;
+	unsigned int last = count_;
+	bool found = false;
+
+	if (sorted_) {
+		/* Binary search the entries, sorted by ID. */
+		while (first < last) {
+			unsigned int mid = first + (last - first) / 2;
+			memcpy(&entry, entries_ + mid * sizeof(entry), sizeof(entry));
+
+			if (entry.id == id) {
+				found = true;
+				break;
+			}
+
+			if (entry.id < id)
+				first = mid + 1;
+			else
+				last = mid;
+		}
+	} else {
+		for (unsigned int i = 0; i < count_; ++i) {
+			memcpy(&entry, entries_ + i * sizeof(entry), sizeof(entry));
+			if (entry.id == id) {
+				found = true;
+				break;
+			}
+		}
+	}
+
+	if (!found)
+		return false;
+
+	element->type = static_cast<ControlType>(entry.type);
+	element->isArray = entry.is_array;
+	element->numElements = entry.count;
+	element->data = values_.data() + entry.offset + sizeof(ControlType);
+
+	return true;
+}
+
+const ControlValue &ControlListView::decode(unsigned int id,
+					    const Element &element) const
+{
+	for (const auto &[decodedId, value] : decoded_) {
+		if (decodedId == id)
+			return value;
+	}
+
+	ControlValue value;
+	value.reserve(element.type, element.isArray, element.numElements);
+	memcpy(value.data().data(), element.data, value.data().size());
+
+	decoded_.emplace_back(id, std::move(value));
+	return decoded_.back().second;
 }
 
 } /* namespace libcamera */
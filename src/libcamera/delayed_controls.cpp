@@ -13,6 +13,8 @@
 
 #include "libcamera/internal/v4l2_device.h"
 
+using namespace std::chrono_literals;
+
 /**
  * \file delayed_controls.h
  * \brief Helper to deal with controls that take effect with a delay
@@ -160,7 +162,7 @@ bool DelayedControls::push(const ControlList &controls)
 	for (const auto &control : controls) {
 		const auto &it = idmap.find(control.first);
 		if (it == idmap.end()) {
-			LOG(DelayedControls, Warning)
+			LOG_RATELIMITED(DelayedControls, Warning, 1s)
 				<< "Unknown control " << control.first;
 			return false;
 		}
@@ -7,9 +7,17 @@
 
 #include "libcamera/internal/device_enumerator.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <stdlib.h>
 #include <string.h>
+#include <thread>
 
 #include <libcamera/base/log.h>
+#include <libcamera/base/thread.h>
+#include <libcamera/base/utils.h>
 
 #include "libcamera/internal/device_enumerator_sysfs.h"
 #include "libcamera/internal/device_enumerator_udev.h"
@@ -228,6 +236,97 @@ std::unique_ptr<MediaDevice> DeviceEnumerator::createDevice(const std::string &d
 	return media;
 }
 
+namespace {
+
+/*
+ * Worker thread for createDevices(). Using a libcamera Thread instead of a
+ * std::thread gives the worker its own thread data, which the logger relies
+ * on.
+ */
+class DeviceEnumerationThread : public Thread
+{
+public:
+	DeviceEnumerationThread(std::function<void()> work)
+		: work_(std::move(work))
+	{
+	}
+
+protected:
+	void run() override
+	{
+		work_();
+	}
+
+private:
+	std::function<void()> work_;
+};
+
+} /* namespace */
+
+/**
+ * \brief Create media device instances in parallel
+ * \param[in] deviceNodes paths to the media devices to create
+ *
+ * Create media devices for all \a deviceNodes as createDevice() does. Opening
+ * a media device and retrieving its media graph can take a significant amount
+ * of time for some drivers, this function thus populates the media devices
+ * concurrently on a pool of worker threads. The number of threads defaults to
+ * the number of CPUs, up to 8, and can be overridden with the
+ * LIBCAMERA_DEVICE_ENUMERATION_THREADS environment variable. Setting it to 1
+ * populates the media devices sequentially in the calling thread.
+ *
+ * The media devices are returned in the order of \a deviceNodes, regardless
+ * of the order in which they have been populated, to keep the enumeration
+ * order deterministic.
+ *
+ * \return A vector of created media device instances, with a nullptr entry
+ * for each device that failed to be created
+ */
+std::vector<std::unique_ptr<MediaDevice>>
+DeviceEnumerator::createDevices(const std::vector<std::string> &deviceNodes)
+{
+	std::vector<std::unique_ptr<MediaDevice>> devices(deviceNodes.size());
+	unsigned int threads = std::clamp(std::thread::hardware_concurrency(), 1U, 8U);
+
+	const char *env = utils::secure_getenv("LIBCAMERA_DEVICE_ENUMERATION_THREADS");
+	if (env) {
+		char *end;
+		unsigned long value = strtoul(env, &end, 10);
+		if (*end == '\0' && value > 0)
+			threads = std::min(value, 64UL);
+	}
+
+	threads = std::min<size_t>(threads, deviceNodes.size());
+
+	auto start = std::chrono::steady_clock::now();
+
+	std::atomic<size_t> next = 0;
+	auto worker = [&]() {
+		for (size_t i = next++; i < deviceNodes.size(); i = next++)
+			devices[i] = createDevice(deviceNodes[i]);
+	};
+
+	std::vector<std::unique_ptr<DeviceEnumerationThread>> pool;
+	for (unsigned int i = 1; i < threads; ++i) {
+		pool.push_back(std::make_unique<DeviceEnumerationThread>(worker));
+		pool.back()->start();
+	}
+
+	worker();
+
+	for (std::unique_ptr<DeviceEnumerationThread> &thread : pool)
+		thread->wait();
+
+	auto end = std::chrono::steady_clock::now();
+
+	LOG(DeviceEnumerator, Debug)
+		<< "Populated " << deviceNodes.size() << " media devices in "
+		<< std::chrono::duration_cast<std::chrono::microseconds>(end - start).count()
+		<< " us with " << std::max(threads, 1U) << " threads";
+
+	return devices;
+}
+
 /**
 * \var DeviceEnumerator::devicesAdded
 * \brief Notify of new media devices being found
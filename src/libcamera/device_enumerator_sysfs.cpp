@@ -7,6 +7,7 @@
 
 #include "libcamera/internal/device_enumerator_sysfs.h"
 
+#include <algorithm>
 #include <dirent.h>
 #include <fcntl.h>
 #include <fstream>
@@ -16,6 +17,7 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include <vector>
 
 #include <libcamera/base/log.h>
 
@@ -53,6 +55,8 @@ int DeviceEnumeratorSysfs::enumerate()
 		return -ENODEV;
 	}
 
+	std::vector<unsigned int> indices;
+
 	while ((ent = readdir(dir)) != nullptr) {
 		if (strncmp(ent->d_name, "media", 5))
 			continue;
@@ -62,6 +66,17 @@ int DeviceEnumeratorSysfs::enumerate()
 		if (*end != '\0')
 			continue;
 
+		indices.push_back(idx);
+	}
+
+	closedir(dir);
+
+	/* Sort the devices to make the enumeration order deterministic. */
+	std::sort(indices.begin(), indices.end());
+
+	std::vector<std::string> devnodes;
+
+	for (unsigned int idx : indices) {
 		std::string devnode = "/dev/media" + std::to_string(idx);
 
 		/* Verify that the device node exists. */
@@ -73,7 +88,10 @@ int DeviceEnumeratorSysfs::enumerate()
 			continue;
 		}
 
-		std::unique_ptr<MediaDevice> media = createDevice(devnode);
+		devnodes.push_back(devnode);
+	}
+
+	for (std::unique_ptr<MediaDevice> &media : createDevices(devnodes)) {
 		if (!media)
 			continue;
 
@@ -88,8 +106,6 @@ int DeviceEnumeratorSysfs::enumerate()
 		addDevice(std::move(media));
 	}
 
-	closedir(dir);
-
 	return 0;
 }
 
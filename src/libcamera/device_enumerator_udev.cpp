@@ -17,6 +17,7 @@
 #include <sys/ioctl.h>
 #include <sys/sysmacros.h>
 #include <unistd.h>
+#include <vector>
 
 #include <libcamera/base/event_notifier.h>
 #include <libcamera/base/log.h>
@@ -76,52 +77,67 @@ int DeviceEnumeratorUdev::addUdevDevice(struct udev_device *dev)
 	if (!subsystem)
 		return -ENODEV;
 
-	if (!strcmp(subsystem, "media")) {
-		std::unique_ptr<MediaDevice> media =
-			createDevice(udev_device_get_devnode(dev));
-		if (!media)
-			return -ENODEV;
+	if (!strcmp(subsystem, "media"))
+		return addMediaDevice(createDevice(udev_device_get_devnode(dev)));
 
-		DependencyMap deps;
-		int ret = populateMediaDevice(media.get(), &deps);
-		if (ret < 0) {
-			LOG(DeviceEnumerator, Warning)
-				<< "Failed to populate media device "
-				<< media->deviceNode()
-				<< " (" << media->driver() << "), skipping";
-			return ret;
-		}
-
-		if (!deps.empty()) {
-			LOG(DeviceEnumerator, Debug)
-				<< "Defer media device " << media->deviceNode()
-				<< " due to " << deps.size()
-				<< " missing dependencies";
+	if (!strcmp(subsystem, "video4linux")) {
+		addV4L2Device(udev_device_get_devnum(dev));
+		return 0;
+	}
 
-			pending_.emplace_back(std::move(media), std::move(deps));
-			MediaDeviceDeps *mediaDeps = &pending_.back();
-			for (const auto &dep : mediaDeps->deps_)
-				devMap_[dep.first] = mediaDeps;
+	return -ENODEV;
+}
 
-			return 0;
-		}
+/**
+ * \brief Add a media device created by createDevice()
+ * \param[in] media The media device
+ *
+ * Associate the entities of \a media with their device nodes, and add it to
+ * the enumerator, or defer it until all its device nodes are available.
+ *
+ * \return 0 on success or a negative error code otherwise
+ */
+int DeviceEnumeratorUdev::addMediaDevice(std::unique_ptr<MediaDevice> media)
+{
+	if (!media)
+		return -ENODEV;
 
-		addDevice(std::move(media));
-		return 0;
+	DependencyMap deps;
+	int ret = populateMediaDevice(media.get(), &deps);
+	if (ret < 0) {
+		LOG(DeviceEnumerator, Warning)
+			<< "Failed to populate media device "
+			<< media->deviceNode()
+			<< " (" << media->driver() << "), skipping";
+		return ret;
 	}
 
-	if (!strcmp(subsystem, "video4linux")) {
-		addV4L2Device(udev_device_get_devnum(dev));
+	if (!deps.empty()) {
+		LOG(DeviceEnumerator, Debug)
+			<< "Defer media device " << media->deviceNode()
+			<< " due to " << deps.size()
+			<< " missing dependencies";
+
+		pending_.emplace_back(std::move(media), std::move(deps));
+		MediaDeviceDeps *mediaDeps = &pending_.back();
+		for (const auto &dep : mediaDeps->deps_)
+			devMap_[dep.first] = mediaDeps;
+
 		return 0;
 	}
 
-	return -ENODEV;
+	addDevice(std::move(media));
+	return 0;
 }
 
 int DeviceEnumeratorUdev::enumerate()
 {
 	struct udev_enumerate *udev_enum = nullptr;
 	struct udev_list_entry *ents, *ent;
+	std::vector<struct udev_device *> devices;
+	std::vector<std::string> mediaNodes;
+	std::vector<std::unique_ptr<MediaDevice>> media;
+	unsigned int mediaIndex = 0;
 	int ret;
 
 	udev_enum = udev_enumerate_new(udev_);
@@ -170,10 +186,32 @@ int DeviceEnumeratorUdev::enumerate()
 			continue;
 		}
 
-		if (addUdevDevice(dev) < 0)
+		devices.push_back(dev);
+
+		const char *subsystem = udev_device_get_subsystem(dev);
+		if (subsystem && !strcmp(subsystem, "media"))
+			mediaNodes.push_back(devnode);
+	}
+
+	/*
+	 * Populate all media devices concurrently, and then add them along with
+	 * the V4L2 devices in enumeration order.
+	 */
+	media = createDevices(mediaNodes);
+
+	for (struct udev_device *dev : devices) {
+		const char *subsystem = udev_device_get_subsystem(dev);
+		int err;
+
+		if (subsystem && !strcmp(subsystem, "media"))
+			err = addMediaDevice(std::move(media[mediaIndex++]));
+		else
+			err = addUdevDevice(dev);
+
+		if (err < 0)
 			LOG(DeviceEnumerator, Warning)
 				<< "Failed to add device for '"
-				<< syspath << "', skipping";
+				<< udev_device_get_syspath(dev) << "', skipping";
 
 		udev_device_unref(dev);
 	}
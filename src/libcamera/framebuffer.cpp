@@ -154,6 +154,18 @@ FrameBuffer::Private::~Private()
  * \return True if the planes are stored contiguously in memory, false otherwise
  */
 
+/**
+ * \fn FrameBuffer::Private::inode()
+ * \brief Retrieve the inode of the dmabuf of a plane
+ * \param[in] plane The plane index
+ *
+ * The inode identifies the dmabuf instance regardless of the file descriptor
+ * used to reference it. It is retrieved once when the frame buffer is created.
+ *
+ * \return The inode of the dmabuf of \a plane, or 0 if the plane file
+ * descriptor is invalid
+ */
+
 /**
  * \fn FrameBuffer::Private::fence()
  * \brief Retrieve a const pointer to the Fence
@@ -315,31 +327,31 @@ FrameBuffer::FrameBuffer(const std::vector<Plane> &planes, unsigned int cookie)
 FrameBuffer::FrameBuffer(std::unique_ptr<Private> d)
 	: Extensible(std::move(d))
 {
+	std::vector<ino_t> &inodes = _d()->inodes_;
 	unsigned int offset = 0;
 	bool isContiguous = true;
-	ino_t inode = 0;
 
+	/*
+	 * Two different dmabuf file descriptors may still refer to the same
+	 * dmabuf instance. Identify the dmabufs using inodes.
+	 */
 	for (const auto &plane : _d()->planes_) {
+		if (!inodes.empty() && plane.fd == _d()->planes_[0].fd)
+			inodes.push_back(inodes[0]);
+		else
+			inodes.push_back(fileDescriptorInode(plane.fd));
+	}
+
+	for (unsigned int i = 0; i < _d()->planes_.size(); ++i) {
+		const Plane &plane = _d()->planes_[i];
+
 		ASSERT(plane.offset != Plane::kInvalidOffset);
 
-		if (plane.offset != offset) {
+		if (plane.offset != offset || inodes[i] != inodes[0]) {
 			isContiguous = false;
 			break;
 		}
 
-		/*
-		 * Two different dmabuf file descriptors may still refer to the
-		 * same dmabuf instance. Check this using inodes.
-		 */
-		if (plane.fd != _d()->planes_[0].fd) {
-			if (!inode)
-				inode = fileDescriptorInode(_d()->planes_[0].fd);
-			if (fileDescriptorInode(plane.fd) != inode) {
-				isContiguous = false;
-				break;
-			}
-		}
-
 		offset += plane.length;
 	}
 
@@ -138,6 +138,27 @@ namespace libcamera {
  * \brief The current control serialization format version
  */
 
+/**
+ * \def IPA_CONTROLS_FLAG_DELTA
+ * \brief The ControlList packet only contains the controls that changed since
+ * the previous packet in the same stream
+ *
+ * A delta packet contains the controls that have been added or whose value
+ * has changed since the packet with sequence number
+ * ipa_controls_header::sequence - 1 for the same handle and id map type.
+ * Controls that have been removed are stored as entries flagged with
+ * IPA_CONTROL_ENTRY_FLAG_REMOVED, without value data. The list is
+ * reconstructed by applying the entries to the previous list.
+ */
+
+/**
+ * \def IPA_CONTROL_ENTRY_FLAG_REMOVED
+ * \brief The control has been removed from the list since the previous packet
+ *
+ * This flag is only valid in ControlList packets flagged with
+ * IPA_CONTROLS_FLAG_DELTA. The entry has no value data.
+ */
+
 /**
  * \var ipa_controls_id_map_type
  * \brief Enumerates the different control id map types
@@ -182,8 +203,13 @@ namespace libcamera {
  * Offset in bytes from the beginning of the packet of the data section start
  * \var ipa_controls_header::id_map_type
  * The id map type as defined by the ipa_controls_id_map_type enumeration
- * \var ipa_controls_header::reserved
- * Reserved for future extensions
+ * \var ipa_controls_header::flags
+ * Packet flags, a bitwise OR of IPA_CONTROLS_FLAG_* values (shall be set to 0
+ * for ControlInfoMap packets)
+ * \var ipa_controls_header::sequence
+ * For ControlList packets produced by a serializer in delta mode, the sequence
+ * number of the packet in the stream of lists serialized for the same handle
+ * and id map type, starting at 1. Set to 0 for stateless packets.
  */
 
 static_assert(sizeof(ipa_controls_header) == 32,
@@ -203,8 +229,8 @@ static_assert(sizeof(ipa_controls_header) == 32,
  * \var ipa_control_value_entry::offset
  * The offset in bytes from the beginning of the data section to the control
  * value data (shall be a multiple of 8 bytes).
- * \var ipa_control_value_entry::padding
- * Padding bytes (shall be set to 0)
+ * \var ipa_control_value_entry::flags
+ * Entry flags, a bitwise OR of IPA_CONTROL_ENTRY_FLAG_* values
  */
 
 static_assert(sizeof(ipa_control_value_entry) == 16,
@@ -48,6 +48,21 @@ namespace {
  * generated IPA proxies.
  */
 
+/**
+ * \fn template<typename T> void writePOD(std::vector<uint8_t> &vec, size_t pos, T val)
+ * \brief Overwrite POD in byte vector, in little-endian order
+ * \tparam T Type of POD to write
+ * \param[in] vec Byte vector to write to
+ * \param[in] pos Index in \a vec to start writing at
+ * \param[in] val Value to write
+ *
+ * This function is meant to be used by the IPA data serializer, and the
+ * generated IPA proxies, to fill size fields that have been reserved before
+ * serializing the data they describe in place.
+ *
+ * The bytes to overwrite must already be present in \a vec.
+ */
+
 /**
  * \fn template<typename T> T readPOD(std::vector<uint8_t>::iterator it, size_t pos,
  * 				      std::vector<uint8_t>::iterator end)
@@ -102,6 +117,49 @@ namespace {
  * of \a data
  */
 
+/**
+ * \fn template<typename T> IPADataSerializer<T>::serialize(
+ * 	const T &data,
+ * 	std::vector<uint8_t> &dataVec,
+ * 	std::vector<SharedFD> &fdsVec,
+ * 	ControlSerializer *cs = nullptr)
+ * \brief Serialize an object at the end of a byte vector and fd vector
+ * \tparam T Type of object to serialize
+ * \param[in] data Object to serialize
+ * \param[inout] dataVec Byte vector to append the serialized data to
+ * \param[inout] fdsVec Fd vector to append the serialized fds to
+ * \param[in] cs ControlSerializer
+ *
+ * This version of serialize() produces the same serialized form as the tuple
+ * version, but writes it directly into the caller's buffers. Nested objects
+ * are serialized in place, and the size fields that precede them are filled
+ * once their size is known. Callers that serialize multiple objects into a
+ * single message should reserve binarySize() bytes in \a dataVec beforehand
+ * to avoid reallocations.
+ *
+ * \a cs is only necessary if the object type \a T or its members contain
+ * ControlList or ControlInfoMap.
+ */
+
+/**
+ * \fn template<typename T> IPADataSerializer<T>::binarySize(
+ * 	const T &data,
+ * 	ControlSerializer *cs = nullptr)
+ * \brief Compute the size of the serialized form of an object
+ * \tparam T Type of object to serialize
+ * \param[in] data Object to compute the serialized size of
+ * \param[in] cs ControlSerializer
+ *
+ * The size is exact, except for objects containing ControlList or
+ * ControlInfoMap, for which it is an upper bound as the ControlSerializer may
+ * produce a more compact encoding.
+ *
+ * \a cs is only necessary if the object type \a T or its members contain
+ * ControlList or ControlInfoMap.
+ *
+ * \return The size of the serialized data, in bytes
+ */
+
 /**
  * \fn template<typename T> IPADataSerializer<T>::deserialize(
  * 	const std::vector<uint8_t> &data,
@@ -197,7 +255,23 @@ IPADataSerializer<type>::serialize(const type &data,			\
 	dataVec.reserve(sizeof(type));					\
 	appendPOD<type>(dataVec, data);					\
 									\
-	return { dataVec, {} };						\
+	return { std::move(dataVec), {} };				\
+}									\
+									\
+template<>								\
+void IPADataSerializer<type>::serialize(const type &data,		\
+					std::vector<uint8_t> &dataVec,	\
+					[[maybe_unused]] std::vector<SharedFD> &fdsVec, \
+					[[maybe_unused]] ControlSerializer *cs) \
+{									\
+	appendPOD<type>(dataVec, data);					\
+}									\
+									\
+template<>								\
+size_t IPADataSerializer<type>::binarySize([[maybe_unused]] const type &data, \
+					   [[maybe_unused]] ControlSerializer *cs) \
+{									\
+	return sizeof(type);						\
 }									\
 									\
 template<>								\
@@ -258,6 +332,22 @@ IPADataSerializer<std::string>::serialize(const std::string &data,
 	return { { data.cbegin(), data.end() }, {} };
 }
 
+template<>
+void IPADataSerializer<std::string>::serialize(const std::string &data,
+					       std::vector<uint8_t> &dataVec,
+					       [[maybe_unused]] std::vector<SharedFD> &fdsVec,
+					       [[maybe_unused]] ControlSerializer *cs)
+{
+	dataVec.insert(dataVec.end(), data.cbegin(), data.cend());
+}
+
+template<>
+size_t IPADataSerializer<std::string>::binarySize(const std::string &data,
+						  [[maybe_unused]] ControlSerializer *cs)
+{
+	return data.size();
+}
+
 template<>
 std::string
 IPADataSerializer<std::string>::deserialize(const std::vector<uint8_t> &data,
@@ -295,63 +385,119 @@ IPADataSerializer<std::string>::deserialize(std::vector<uint8_t>::const_iterator
 	return { dataBegin, dataEnd };
 }
 
+namespace {
+
 /*
- * ControlList is serialized as:
- *
- * 4 bytes - uint32_t Size of serialized ControlInfoMap, in bytes
- * 4 bytes - uint32_t Size of serialized ControlList, in bytes
- * X bytes - Serialized ControlInfoMap (using ControlSerializer)
- * X bytes - Serialized ControlList (using ControlSerializer)
- *
- * If data.infoMap() is nullptr, then the default controls::controls will
- * be used. The serialized ControlInfoMap will have zero length.
+ * Serialize a ControlList or a ControlListView, along with the ControlInfoMap
+ * \a infoMap of the list if it hasn't been serialized yet.
  */
-template<>
-std::tuple<std::vector<uint8_t>, std::vector<SharedFD>>
-IPADataSerializer<ControlList>::serialize(const ControlList &data, ControlSerializer *cs)
+template<typename T>
+void serializeControls(const T &data, const ControlInfoMap *infoMap,
+		       std::vector<uint8_t> &dataVec, ControlSerializer *cs)
 {
-	if (!cs)
-		LOG(IPADataSerializer, Fatal)
-			<< "ControlSerializer not provided for serialization of ControlList";
-
+	size_t offset = dataVec.size();
+	size_t infoSize = 0;
 	size_t size;
-	std::vector<uint8_t> infoData;
 	int ret;
 
+	/* Reserve the sizes, they are filled once the data is serialized. */
+	appendPOD<uint32_t>(dataVec, 0);
+	appendPOD<uint32_t>(dataVec, 0);
+
 	/*
 	 * \todo Revisit this opportunistic serialization of the
 	 * ControlInfoMap, as it could be fragile
 	 */
-	if (data.infoMap() && !cs->isCached(*data.infoMap())) {
-		size = cs->binarySize(*data.infoMap());
-		infoData.resize(size);
-		ByteStreamBuffer buffer(infoData.data(), infoData.size());
-		ret = cs->serialize(*data.infoMap(), buffer);
+	if (infoMap && !cs->isCached(*infoMap)) {
+		infoSize = cs->binarySize(*infoMap);
+		dataVec.resize(offset + 8 + infoSize);
+		ByteStreamBuffer buffer(dataVec.data() + offset + 8, infoSize);
+		ret = cs->serialize(*infoMap, buffer);
 
 		if (ret < 0 || buffer.overflow()) {
 			LOG(IPADataSerializer, Error) << "Failed to serialize ControlList's ControlInfoMap";
-			return { {}, {} };
+			dataVec.resize(offset);
+			return;
 		}
 	}
 
 	size = cs->binarySize(data);
-	std::vector<uint8_t> listData(size);
-	ByteStreamBuffer buffer(listData.data(), listData.size());
+	size_t listOffset = dataVec.size();
+	dataVec.resize(listOffset + size);
+	ByteStreamBuffer buffer(dataVec.data() + listOffset, size);
 	ret = cs->serialize(data, buffer);
 
 	if (ret < 0 || buffer.overflow()) {
 		LOG(IPADataSerializer, Error) << "Failed to serialize ControlList";
-		return { {}, {} };
+		dataVec.resize(offset);
+		return;
 	}
 
+	/* Delta-encoded lists are smaller than the binarySize() estimate. */
+	dataVec.resize(listOffset + buffer.offset());
+
+	writePOD<uint32_t>(dataVec, offset, infoSize);
+	writePOD<uint32_t>(dataVec, offset + 4, buffer.offset());
+}
+
+template<typename T>
+size_t controlsBinarySize(const T &data, const ControlInfoMap *infoMap,
+			  ControlSerializer *cs)
+{
+	size_t size = 8 + cs->binarySize(data);
+	if (infoMap && !cs->isCached(*infoMap))
+		size += cs->binarySize(*infoMap);
+
+	return size;
+}
+
+} /* namespace */
+
+/*
+ * ControlList is serialized as:
+ *
+ * 4 bytes - uint32_t Size of serialized ControlInfoMap, in bytes
+ * 4 bytes - uint32_t Size of serialized ControlList, in bytes
+ * X bytes - Serialized ControlInfoMap (using ControlSerializer)
+ * X bytes - Serialized ControlList (using ControlSerializer)
+ *
+ * If data.infoMap() is nullptr, then the default controls::controls will
+ * be used. The serialized ControlInfoMap will have zero length.
+ */
+template<>
+void IPADataSerializer<ControlList>::serialize(const ControlList &data,
+					       std::vector<uint8_t> &dataVec,
+					       [[maybe_unused]] std::vector<SharedFD> &fdsVec,
+					       ControlSerializer *cs)
+{
+	if (!cs)
+		LOG(IPADataSerializer, Fatal)
+			<< "ControlSerializer not provided for serialization of ControlList";
+
+	serializeControls(data, data.infoMap(), dataVec, cs);
+}
+
+template<>
+std::tuple<std::vector<uint8_t>, std::vector<SharedFD>>
+IPADataSerializer<ControlList>::serialize(const ControlList &data, ControlSerializer *cs)
+{
 	std::vector<uint8_t> dataVec;
-	dataVec.reserve(8 + infoData.size() + listData.size());
-	appendPOD<uint32_t>(dataVec, infoData.size());
-	appendPOD<uint32_t>(dataVec, listData.size());
-	dataVec.insert(dataVec.end(), infoData.begin(), infoData.end());
-	dataVec.insert(dataVec.end(), listData.begin(), listData.end());
+	std::vector<SharedFD> fdsVec;
+
+	serialize(data, dataVec, fdsVec, cs);
 
-	return { dataVec, {} };
+	return { std::move(dataVec), {} };
+}
+
+template<>
+size_t IPADataSerializer<ControlList>::binarySize(const ControlList &data,
+						  ControlSerializer *cs)
+{
+	if (!cs)
+		LOG(IPADataSerializer, Fatal)
+			<< "ControlSerializer not provided for serialization of ControlList";
+
+	return controlsBinarySize(data, data.infoMap(), cs);
 }
 
 template<>
@@ -424,6 +570,118 @@ IPADataSerializer<ControlList>::deserialize(std::vector<uint8_t>::const_iterator
 	return deserialize(dataBegin, dataEnd, cs);
 }
 
+/*
+ * ControlListView is serialized as a ControlList. Views that reference a
+ * serialized list are serialized by copying the serialized data. Deserializing
+ * creates a view that references the serialized data, which must stay valid
+ * for the lifetime of the view.
+ */
+template<>
+void IPADataSerializer<ControlListView>::serialize(const ControlListView &data,
+						   std::vector<uint8_t> &dataVec,
+						   [[maybe_unused]] std::vector<SharedFD> &fdsVec,
+						   ControlSerializer *cs)
+{
+	if (!cs)
+		LOG(IPADataSerializer, Fatal)
+			<< "ControlSerializer not provided for serialization of ControlListView";
+
+	serializeControls(data, data.infoMap(), dataVec, cs);
+}
+
+template<>
+std::tuple<std::vector<uint8_t>, std::vector<SharedFD>>
+IPADataSerializer<ControlListView>::serialize(const ControlListView &data,
+					      ControlSerializer *cs)
+{
+	std::vector<uint8_t> dataVec;
+	std::vector<SharedFD> fdsVec;
+
+	serialize(data, dataVec, fdsVec, cs);
+
+	return { std::move(dataVec), {} };
+}
+
+template<>
+size_t IPADataSerializer<ControlListView>::binarySize(const ControlListView &data,
+						      ControlSerializer *cs)
+{
+	if (!cs)
+		LOG(IPADataSerializer, Fatal)
+			<< "ControlSerializer not provided for serialization of ControlListView";
+
+	return controlsBinarySize(data, data.infoMap(), cs);
+}
+
+template<>
+ControlListView
+IPADataSerializer<ControlListView>::deserialize(std::vector<uint8_t>::const_iterator dataBegin,
+						std::vector<uint8_t>::const_iterator dataEnd,
+						ControlSerializer *cs)
+{
+	if (!cs)
+		LOG(IPADataSerializer, Fatal)
+			<< "ControlSerializer not provided for deserialization of ControlListView";
+
+	if (std::distance(dataBegin, dataEnd) < 8)
+		return {};
+
+	uint32_t infoDataSize = readPOD<uint32_t>(dataBegin, 0, dataEnd);
+	uint32_t listDataSize = readPOD<uint32_t>(dataBegin, 4, dataEnd);
+
+	std::vector<uint8_t>::const_iterator it = dataBegin + 8;
+
+	if (infoDataSize + listDataSize < infoDataSize ||
+	    static_cast<uint32_t>(std::distance(it, dataEnd)) < infoDataSize + listDataSize)
+		return {};
+
+	if (infoDataSize > 0) {
+		ByteStreamBuffer buffer(&*it, infoDataSize);
+		cs->deserialize<ControlInfoMap>(buffer);
+		if (buffer.overflow()) {
+			LOG(IPADataSerializer, Error)
+				<< "Failed to deserialize ControlListView's ControlInfoMap: buffer overflow";
+			return {};
+		}
+	}
+
+	it += infoDataSize;
+	ByteStreamBuffer buffer(&*it, listDataSize);
+	ControlListView view = cs->deserialize<ControlListView>(buffer);
+	if (buffer.overflow())
+		LOG(IPADataSerializer, Error) << "Failed to deserialize ControlListView: buffer overflow";
+
+	return view;
+}
+
+template<>
+ControlListView
+IPADataSerializer<ControlListView>::deserialize(const std::vector<uint8_t> &data,
+						ControlSerializer *cs)
+{
+	return deserialize(data.cbegin(), data.end(), cs);
+}
+
+template<>
+ControlListView
+IPADataSerializer<ControlListView>::deserialize(const std::vector<uint8_t> &data,
+						[[maybe_unused]] const std::vector<SharedFD> &fds,
+						ControlSerializer *cs)
+{
+	return deserialize(data.cbegin(), data.end(), cs);
+}
+
+template<>
+ControlListView
+IPADataSerializer<ControlListView>::deserialize(std::vector<uint8_t>::const_iterator dataBegin,
+						std::vector<uint8_t>::const_iterator dataEnd,
+						[[maybe_unused]] std::vector<SharedFD>::const_iterator fdsBegin,
+						[[maybe_unused]] std::vector<SharedFD>::const_iterator fdsEnd,
+						ControlSerializer *cs)
+{
+	return deserialize(dataBegin, dataEnd, cs);
+}
+
 /*
  * const ControlInfoMap is serialized as:
  *
@@ -431,29 +689,53 @@ IPADataSerializer<ControlList>::deserialize(std::vector<uint8_t>::const_iterator
  * X bytes - Serialized ControlInfoMap (using ControlSerializer)
  */
 template<>
-std::tuple<std::vector<uint8_t>, std::vector<SharedFD>>
-IPADataSerializer<ControlInfoMap>::serialize(const ControlInfoMap &map,
-					     ControlSerializer *cs)
+void IPADataSerializer<ControlInfoMap>::serialize(const ControlInfoMap &map,
+						  std::vector<uint8_t> &dataVec,
+						  [[maybe_unused]] std::vector<SharedFD> &fdsVec,
+						  ControlSerializer *cs)
 {
 	if (!cs)
 		LOG(IPADataSerializer, Fatal)
 			<< "ControlSerializer not provided for serialization of ControlInfoMap";
 
+	size_t offset = dataVec.size();
 	size_t size = cs->binarySize(map);
-	std::vector<uint8_t> infoData(size);
-	ByteStreamBuffer buffer(infoData.data(), infoData.size());
+
+	dataVec.resize(offset + 4 + size);
+	ByteStreamBuffer buffer(dataVec.data() + offset + 4, size);
 	int ret = cs->serialize(map, buffer);
 
 	if (ret < 0 || buffer.overflow()) {
 		LOG(IPADataSerializer, Error) << "Failed to serialize ControlInfoMap";
-		return { {}, {} };
+		dataVec.resize(offset);
+		return;
 	}
 
+	writePOD<uint32_t>(dataVec, offset, size);
+}
+
+template<>
+std::tuple<std::vector<uint8_t>, std::vector<SharedFD>>
+IPADataSerializer<ControlInfoMap>::serialize(const ControlInfoMap &map,
+					     ControlSerializer *cs)
+{
 	std::vector<uint8_t> dataVec;
-	appendPOD<uint32_t>(dataVec, infoData.size());
-	dataVec.insert(dataVec.end(), infoData.begin(), infoData.end());
+	std::vector<SharedFD> fdsVec;
+
+	serialize(map, dataVec, fdsVec, cs);
+
+	return { std::move(dataVec), {} };
+}
+
+template<>
+size_t IPADataSerializer<ControlInfoMap>::binarySize(const ControlInfoMap &map,
+						     ControlSerializer *cs)
+{
+	if (!cs)
+		LOG(IPADataSerializer, Fatal)
+			<< "ControlSerializer not provided for serialization of ControlInfoMap";
 
-	return { dataVec, {} };
+	return 4 + cs->binarySize(map);
 }
 
 template<>
@@ -521,13 +803,11 @@ IPADataSerializer<ControlInfoMap>::deserialize(std::vector<uint8_t>::const_itera
  * and it will be recursively consumed as necessary.
  */
 template<>
-std::tuple<std::vector<uint8_t>, std::vector<SharedFD>>
-IPADataSerializer<SharedFD>::serialize(const SharedFD &data,
-				       [[maybe_unused]] ControlSerializer *cs)
+void IPADataSerializer<SharedFD>::serialize(const SharedFD &data,
+					    std::vector<uint8_t> &dataVec,
+					    std::vector<SharedFD> &fdsVec,
+					    [[maybe_unused]] ControlSerializer *cs)
 {
-	std::vector<uint8_t> dataVec;
-	std::vector<SharedFD> fdVec;
-
 	/*
 	 * Store as uint32_t to prepare for conversion from validity flag
 	 * to index, and for alignment.
@@ -535,10 +815,27 @@ IPADataSerializer<SharedFD>::serialize(const SharedFD &data,
 	appendPOD<uint32_t>(dataVec, data.isValid());
 
 	if (data.isValid())
-		fdVec.push_back(data);
+		fdsVec.push_back(data);
+}
+
+template<>
+std::tuple<std::vector<uint8_t>, std::vector<SharedFD>>
+IPADataSerializer<SharedFD>::serialize(const SharedFD &data,
+				       ControlSerializer *cs)
+{
+	std::vector<uint8_t> dataVec;
+	std::vector<SharedFD> fdVec;
+
+	serialize(data, dataVec, fdVec, cs);
 
+	return { std::move(dataVec), std::move(fdVec) };
+}
 
-	return { dataVec, fdVec };
+template<>
+size_t IPADataSerializer<SharedFD>::binarySize([[maybe_unused]] const SharedFD &data,
+					       [[maybe_unused]] ControlSerializer *cs)
+{
+	return 4;
 }
 
 template<>
@@ -572,25 +869,37 @@ SharedFD IPADataSerializer<SharedFD>::deserialize(const std::vector<uint8_t> &da
  * 4 bytes - uint32_t Offset
  * 4 bytes - uint32_t Length
  */
+template<>
+void IPADataSerializer<FrameBuffer::Plane>::serialize(const FrameBuffer::Plane &data,
+						      std::vector<uint8_t> &dataVec,
+						      std::vector<SharedFD> &fdsVec,
+						      [[maybe_unused]] ControlSerializer *cs)
+{
+	IPADataSerializer<SharedFD>::serialize(data.fd, dataVec, fdsVec);
+
+	appendPOD<uint32_t>(dataVec, data.offset);
+	appendPOD<uint32_t>(dataVec, data.length);
+}
+
 template<>
 std::tuple<std::vector<uint8_t>, std::vector<SharedFD>>
 IPADataSerializer<FrameBuffer::Plane>::serialize(const FrameBuffer::Plane &data,
-						 [[maybe_unused]] ControlSerializer *cs)
+						 ControlSerializer *cs)
 {
 	std::vector<uint8_t> dataVec;
 	std::vector<SharedFD> fdsVec;
 
-	std::vector<uint8_t> fdBuf;
-	std::vector<SharedFD> fdFds;
-	std::tie(fdBuf, fdFds) =
-		IPADataSerializer<SharedFD>::serialize(data.fd);
-	dataVec.insert(dataVec.end(), fdBuf.begin(), fdBuf.end());
-	fdsVec.insert(fdsVec.end(), fdFds.begin(), fdFds.end());
+	dataVec.reserve(12);
+	serialize(data, dataVec, fdsVec, cs);
 
-	appendPOD<uint32_t>(dataVec, data.offset);
-	appendPOD<uint32_t>(dataVec, data.length);
+	return { std::move(dataVec), std::move(fdsVec) };
+}
 
-	return { dataVec, fdsVec };
+template<>
+size_t IPADataSerializer<FrameBuffer::Plane>::binarySize([[maybe_unused]] const FrameBuffer::Plane &data,
+							 [[maybe_unused]] ControlSerializer *cs)
+{
+	return 12;
 }
 
 template<>
@@ -8,16 +8,26 @@
 #include "libcamera/internal/ipa_manager.h"
 
 #include <algorithm>
+#include <deque>
 #include <dirent.h>
+#include <map>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
+#include <tuple>
 
 #include <libcamera/base/file.h>
 #include <libcamera/base/log.h>
+#include <libcamera/base/object.h>
+#include <libcamera/base/thread.h>
 #include <libcamera/base/utils.h>
 
+#include <libcamera/ipa/ipa_proxy_workers.h>
+
 #include "libcamera/internal/ipa_module.h"
 #include "libcamera/internal/ipa_proxy.h"
+#include "libcamera/internal/ipc_pipe_shm.h"
+#include "libcamera/internal/ipc_pipe_unixsocket.h"
 #include "libcamera/internal/pipeline_handler.h"
 
 /**
@@ -29,6 +39,200 @@ namespace libcamera {
 
 LOG_DEFINE_CATEGORY(IPAManager)
 
+namespace {
+
+constexpr unsigned long kMaxWorkerPoolSize = 8;
+
+std::unique_ptr<IPCPipe> spawnPipe(const std::string &modulePath,
+				   const std::string &workerPath,
+				   IPCPipe::Transport transport)
+{
+	if (transport == IPCPipe::Transport::SharedMemory)
+		return std::make_unique<IPCPipeShm>(modulePath.c_str(),
+						    workerPath.c_str());
+
+	return std::make_unique<IPCPipeUnixSocket>(modulePath.c_str(),
+						   workerPath.c_str());
+}
+
+} /* namespace */
+
+/*
+ * Pool of proxy workers started ahead of time. The workers of a pool entry
+ * have loaded their IPA module and wait for the proxy to connect to their
+ * IPCPipe. Entries are created for the isolated IPA modules known when the
+ * IPAManager is constructed, and the first time a pipe is requested for any
+ * other module, worker and transport combination.
+ *
+ * Workers are spawned from a dedicated thread, which owns the pipes until they
+ * are claimed, to keep the fork and exec out of the threads that construct the
+ * IPAManager and create IPA proxies. Claiming a worker moves its pipe to the
+ * thread of the caller. A pooled worker may die before being claimed, its pipe
+ * is then discarded.
+ */
+class IPAManager::WorkerPool
+{
+public:
+	WorkerPool(unsigned int size);
+	~WorkerPool();
+
+	void prestart(const std::string &modulePath,
+		      const std::string &workerPath,
+		      IPCPipe::Transport transport);
+	std::unique_ptr<IPCPipe> claim(const std::string &modulePath,
+				       const std::string &workerPath,
+				       IPCPipe::Transport transport);
+
+private:
+	using Key = std::tuple<std::string, std::string, IPCPipe::Transport>;
+
+	class Spawner : public Object
+	{
+	public:
+		Spawner(unsigned int size)
+			: size_(size), replenishing_(false)
+		{
+		}
+
+		void request(const Key &key);
+		IPCPipe *take(const Key &key, Thread *thread);
+		void clear();
+
+	private:
+		void replenish();
+
+		unsigned int size_;
+		bool replenishing_;
+		std::map<Key, std::deque<std::unique_ptr<IPCPipe>>> pipes_;
+	};
+
+	Thread thread_;
+	Spawner spawner_;
+};
+
+IPAManager::WorkerPool::WorkerPool(unsigned int size)
+	: spawner_(size)
+{
+	spawner_.moveToThread(&thread_);
+	thread_.start();
+}
+
+IPAManager::WorkerPool::~WorkerPool()
+{
+	/* Terminate the pooled workers from the thread they belong to. */
+	spawner_.invokeMethod(&Spawner::clear, ConnectionTypeBlocking);
+
+	thread_.exit();
+	thread_.wait();
+}
+
+void IPAManager::WorkerPool::prestart(const std::string &modulePath,
+				      const std::string &workerPath,
+				      IPCPipe::Transport transport)
+{
+	spawner_.invokeMethod(&Spawner::request, ConnectionTypeQueued,
+			      Key{ modulePath, workerPath, transport });
+}
+
+std::unique_ptr<IPCPipe>
+IPAManager::WorkerPool::claim(const std::string &modulePath,
+			      const std::string &workerPath,
+			      IPCPipe::Transport transport)
+{
+	Key key{ modulePath, workerPath, transport };
+
+	std::unique_ptr<IPCPipe> pipe{
+		spawner_.invokeMethod(&Spawner::take, ConnectionTypeBlocking,
+				      key, Thread::current())
+	};
+
+	/*
+	 * The worker may have died after being handed over, before the
+	 * notification reached the pipe in its new thread.
+	 */
+	if (pipe && pipe->isConnected()) {
+		LOG(IPAManager, Debug)
+			<< "Claimed pre-started worker " << workerPath
+			<< " for IPA module " << modulePath;
+	} else {
+		pipe = spawnPipe(modulePath, workerPath, transport);
+	}
+
+	spawner_.invokeMethod(&Spawner::request, ConnectionTypeQueued, key);
+
+	return pipe;
+}
+
+void IPAManager::WorkerPool::Spawner::request(const Key &key)
+{
+	/* Create the pool entry if needed. */
+	pipes_[key];
+
+	if (!replenishing_) {
+		replenishing_ = true;
+		invokeMethod(&Spawner::replenish, ConnectionTypeQueued);
+	}
+}
+
+IPCPipe *IPAManager::WorkerPool::Spawner::take(const Key &key, Thread *thread)
+{
+	auto it = pipes_.find(key);
+	if (it == pipes_.end())
+		return nullptr;
+
+	std::deque<std::unique_ptr<IPCPipe>> &pipes = it->second;
+
+	while (!pipes.empty()) {
+		std::unique_ptr<IPCPipe> pipe = std::move(pipes.front());
+		pipes.pop_front();
+
+		if (!pipe->isConnected()) {
+			LOG(IPAManager, Warning)
+				<< "Pre-started worker " << std::get<1>(key)
+				<< " died, discarding it";
+			continue;
+		}
+
+		pipe->moveToThread(thread);
+		return pipe.release();
+	}
+
+	return nullptr;
+}
+
+void IPAManager::WorkerPool::Spawner::clear()
+{
+	pipes_.clear();
+}
+
+void IPAManager::WorkerPool::Spawner::replenish()
+{
+	/*
+	 * Start one worker per invocation, and queue the next one, to let
+	 * claims be processed between two workers.
+	 */
+	for (auto &[key, pipes] : pipes_) {
+		if (pipes.size() >= size_)
+			continue;
+
+		const auto &[modulePath, workerPath, transport] = key;
+
+		std::unique_ptr<IPCPipe> pipe =
+			spawnPipe(modulePath, workerPath, transport);
+		if (!pipe->isConnected()) {
+			LOG(IPAManager, Warning)
+				<< "Failed to pre-start worker " << workerPath;
+			break;
+		}
+
+		pipes.push_back(std::move(pipe));
+		invokeMethod(&Spawner::replenish, ConnectionTypeQueued);
+		return;
+	}
+
+	replenishing_ = false;
+}
+
 /**
  * \class IPAManager
  * \brief Manager for IPA modules
@@ -93,6 +297,39 @@ LOG_DEFINE_CATEGORY(IPAManager)
  * serialized to Plain Old Data, either for the purpose of passing it to the IPA
  * context plain C API, or to transmit the data to the isolated process through
  * IPC.
+ *
+ * Isolated IPA modules communicate with their proxy worker through Unix sockets
+ * by default. Shared memory rings can be selected instead with the
+ * LIBCAMERA_IPA_IPC_TRANSPORT environment variable, see IPCPipe::Transport.
+ * Asynchronous calls issued in the same event loop iteration can be batched in
+ * a single transmission by setting the LIBCAMERA_IPA_IPC_BATCHING environment
+ * variable to 1, see IPCPipe::setBatching(). Control lists can be delta-encoded
+ * to only transmit the controls that change from one call to the next by
+ * setting the LIBCAMERA_IPA_IPC_DELTA environment variable to 1, see
+ * ControlSerializer::setDeltaEncoding(). The variable is read by both the proxy
+ * and the proxy worker.
+ *
+ * Modules loaded without isolation run in a dedicated thread by default, and
+ * asynchronous calls are queued to that thread. Trusted modules can instead be
+ * run inline, with all calls executed synchronously in the thread of the
+ * pipeline handler, by listing their name in the LIBCAMERA_IPA_INLINE
+ * environment variable. This saves two thread switches per asynchronous call,
+ * but the IPA processing time then adds to the pipeline handler event loop, and
+ * events are emitted before the calls that trigger them return.
+ *
+ * Starting an isolated IPA module requires spawning a proxy worker process,
+ * which then loads the IPA module. To hide this latency, the IPAManager can
+ * keep a pool of workers started ahead of time, whose size is set by the
+ * LIBCAMERA_IPA_WORKER_POOL environment variable. The pool is disabled by
+ * default. When enabled, workers are started in the background for all
+ * isolated IPA modules when the IPAManager is constructed, see createPipe()
+ * for details.
+ *
+ * Parsing the IPA modules and verifying their signatures can be skipped for
+ * modules that haven't changed by storing the results in an IPAModuleCache.
+ * The cache is enabled by setting the LIBCAMERA_IPA_MODULE_CACHE environment
+ * variable to the path of the cache file, and can be invalidated by setting
+ * LIBCAMERA_IPA_MODULE_CACHE_INVALIDATE to 1.
  */
 
 IPAManager *IPAManager::self_ = nullptr;
@@ -104,16 +341,62 @@ IPAManager *IPAManager::self_ = nullptr;
  * CameraManager.
  */
 IPAManager::IPAManager()
+	: transport_(IPCPipe::Transport::UnixSocket), batching_(false),
+	  deltaEncoding_(false), workerPoolSize_(0)
 {
 	if (self_)
 		LOG(IPAManager, Fatal)
 			<< "Multiple IPAManager objects are not allowed";
 
+	const char *transport = utils::secure_getenv("LIBCAMERA_IPA_IPC_TRANSPORT");
+	if (transport && !strcmp(transport, "shm"))
+		transport_ = IPCPipe::Transport::SharedMemory;
+	else if (transport && strcmp(transport, "socket"))
+		LOG(IPAManager, Warning)
+			<< "Unknown IPC transport '" << transport
+			<< "', using Unix sockets";
+
+	const char *batching = utils::secure_getenv("LIBCAMERA_IPA_IPC_BATCHING");
+	if (batching && !strcmp(batching, "1"))
+		batching_ = true;
+
+	const char *delta = utils::secure_getenv("LIBCAMERA_IPA_IPC_DELTA");
+	if (delta && !strcmp(delta, "1"))
+		deltaEncoding_ = true;
+
+	const char *poolSize = utils::secure_getenv("LIBCAMERA_IPA_WORKER_POOL");
+	if (poolSize)
+		workerPoolSize_ = std::min(strtoul(poolSize, nullptr, 10),
+					   kMaxWorkerPoolSize);
+
+	const char *inlineModules = utils::secure_getenv("LIBCAMERA_IPA_INLINE");
+	if (inlineModules) {
+		for (const auto &name : utils::split(inlineModules, ":")) {
+			if (!name.empty())
+				inlineModules_.push_back(name);
+		}
+	}
+
 #if HAVE_IPA_PUBKEY
 	if (!pubKey_.isValid())
 		LOG(IPAManager, Warning) << "Public key not valid";
 #endif
 
+	const char *cachePath = utils::secure_getenv("LIBCAMERA_IPA_MODULE_CACHE");
+	if (cachePath && cachePath[0] != '\0') {
+#if HAVE_IPA_PUBKEY
+		moduleCache_ = std::make_unique<IPAModuleCache>(cachePath, publicKey_);
+#else
+		moduleCache_ = std::make_unique<IPAModuleCache>(cachePath, Span<const uint8_t>{});
+#endif
+
+		const char *invalidate = utils::secure_getenv("LIBCAMERA_IPA_MODULE_CACHE_INVALIDATE");
+		if (invalidate && !strcmp(invalidate, "1"))
+			moduleCache_->invalidate();
+		else
+			moduleCache_->load();
+	}
+
 	unsigned int ipaCount = 0;
 
 	/* User-specified paths take precedence. */
@@ -154,11 +437,39 @@ IPAManager::IPAManager()
 		LOG(IPAManager, Warning)
 			<< "No IPA found in '" IPA_MODULE_DIR "'";
 
+	if (workerPoolSize_) {
+		workerPool_ = std::make_unique<WorkerPool>(workerPoolSize_);
+
+		for (IPAModule *module : modules_) {
+			if (isSignatureValid(module))
+				continue;
+
+			auto it = ipa::proxyWorkers.find(module->info().name);
+			if (it == ipa::proxyWorkers.end())
+				continue;
+
+			std::string workerPath = IPAProxy::resolvePath(it->second);
+			if (workerPath.empty())
+				continue;
+
+			workerPool_->prestart(module->path(), workerPath, transport_);
+		}
+	}
+
+	if (moduleCache_ && moduleCache_->isDirty())
+		moduleCache_->save();
+
 	self_ = this;
 }
 
 IPAManager::~IPAManager()
 {
+	workerPool_.reset();
+
+	/* Store the signatures verified since construction. */
+	if (moduleCache_ && moduleCache_->isDirty())
+		moduleCache_->save();
+
 	for (IPAModule *module : modules_)
 		delete module;
 
@@ -236,10 +547,16 @@ unsigned int IPAManager::addDir(const char *libDir, unsigned int maxDepth)
 
 	unsigned int count = 0;
 	for (const std::string &file : files) {
-		IPAModule *ipaModule = new IPAModule(file);
-		if (!ipaModule->isValid()) {
-			delete ipaModule;
-			continue;
+		IPAModule *ipaModule = moduleCache_ ? moduleCache_->module(file) : nullptr;
+		if (!ipaModule) {
+			ipaModule = new IPAModule(file);
+			if (!ipaModule->isValid()) {
+				delete ipaModule;
+				continue;
+			}
+
+			if (moduleCache_)
+				moduleCache_->addModule(*ipaModule);
 		}
 
 		LOG(IPAManager, Debug) << "Loaded IPA module '" << file << "'";
@@ -279,6 +596,46 @@ IPAModule *IPAManager::module(PipelineHandler *pipe, uint32_t minVersion,
  * found or if the IPA proxy fails to initialize
  */
 
+/**
+ * \brief Create an IPCPipe to an isolated IPA module
+ * \param[in] modulePath The path to the IPA module
+ * \param[in] workerPath The path to the IPA proxy worker
+ * \param[in] transport The IPC transport
+ *
+ * This function is used by IPA proxies to start the proxy worker for an
+ * isolated IPA module. When the worker pool is enabled, a worker started
+ * ahead of time for the same module, worker and transport is returned if
+ * available, and the pool is then replenished in the background. Workers are
+ * started ahead of time for the isolated IPA modules found when the IPAManager
+ * is constructed, using the transport selected by the environment, as well as
+ * for any combination that has been requested before. Pooled workers that died
+ * are skipped, and a new worker is started synchronously when the pool is
+ * empty.
+ *
+ * \return The IPCPipe to the proxy worker, which may not be connected if the
+ * worker failed to start
+ */
+std::unique_ptr<IPCPipe> IPAManager::createPipe(const std::string &modulePath,
+						const std::string &workerPath,
+						IPCPipe::Transport transport)
+{
+	if (!self_ || !self_->workerPool_)
+		return spawnPipe(modulePath, workerPath, transport);
+
+	return self_->workerPool_->claim(modulePath, workerPath, transport);
+}
+
+/**
+ * \brief Terminate the workers of the worker pool
+ *
+ * Workers that haven't been claimed are terminated, and no worker is started
+ * ahead of time after this function returns.
+ */
+void IPAManager::releaseWorkers()
+{
+	workerPool_.reset();
+}
+
 #if HAVE_IPA_PUBKEY
 /**
  * \fn IPAManager::pubKey()
@@ -303,6 +660,16 @@ bool IPAManager::isSignatureValid([[maybe_unused]] IPAModule *ipa) const
 		return false;
 	}
 
+	if (moduleCache_) {
+		std::optional<bool> cached = moduleCache_->signatureValid(*ipa);
+		if (cached) {
+			LOG(IPAManager, Debug)
+				<< "IPA module " << ipa->path() << " signature is "
+				<< (*cached ? "valid" : "not valid") << " (cached)";
+			return *cached;
+		}
+	}
+
 	File file{ ipa->path() };
 	if (!file.open(File::OpenModeFlag::ReadOnly))
 		return false;
@@ -317,10 +684,35 @@ bool IPAManager::isSignatureValid([[maybe_unused]] IPAModule *ipa) const
 		<< "IPA module " << ipa->path() << " signature is "
 		<< (valid ? "valid" : "not valid");
 
+	/*
+	 * Only mark the cache entry, the cache is saved when the IPAManager is
+	 * destroyed.
+	 */
+	if (moduleCache_)
+		moduleCache_->setSignatureValid(*ipa, valid);
+
 	return valid;
 #else
 	return false;
 #endif
 }
 
+/**
+ * \brief Check if an IPA module should run inline in the pipeline handler thread
+ * \param[in] ipa The IPA module
+ *
+ * Only modules loaded without isolation can run inline. This function doesn't
+ * check the module signature, the caller is responsible for that.
+ *
+ * \return True if the IPA module is listed in the LIBCAMERA_IPA_INLINE
+ * environment variable, false otherwise
+ */
+bool IPAManager::isInline(IPAModule *ipa) const
+{
+	const std::string name = ipa->info().name;
+
+	return std::find(inlineModules_.begin(), inlineModules_.end(), name) !=
+	       inlineModules_.end();
+}
+
 } /* namespace libcamera */
@@ -265,6 +265,23 @@ IPAModule::IPAModule(const std::string &libPath)
 	valid_ = true;
 }
 
+/**
+ * \brief Construct an IPAModule instance from known module information
+ * \param[in] libPath path to IPA module shared object
+ * \param[in] info The IPA module information
+ *
+ * This constructor skips parsing the IPA module shared object, and uses the
+ * module information \a info previously retrieved from a valid IPA module at
+ * \a libPath instead. It is meant to be used with information stored in an
+ * IPAModuleCache. The signature is loaded from the file system.
+ */
+IPAModule::IPAModule(const std::string &libPath, const struct IPAModuleInfo &info)
+	: info_(info), libPath_(libPath), valid_(true), loaded_(false),
+	  dlHandle_(nullptr), ipaCreate_(nullptr)
+{
+	loadSignature();
+}
+
 IPAModule::~IPAModule()
 {
 	if (dlHandle_)
@@ -320,20 +337,25 @@ int IPAModule::loadIPAModuleInfo()
 	}
 
 	/* Load the signature. Failures are not fatal. */
+	loadSignature();
+
+	return 0;
+}
+
+void IPAModule::loadSignature()
+{
 	File sign{ libPath_ + ".sign" };
 	if (!sign.open(File::OpenModeFlag::ReadOnly)) {
 		LOG(IPAModule, Debug)
 			<< "IPA module " << libPath_ << " is not signed";
-		return 0;
+		return;
 	}
 
-	data = sign.map(0, -1, File::MapFlag::Private);
+	Span<const uint8_t> data = sign.map(0, -1, File::MapFlag::Private);
 	signature_.resize(data.size());
 	memcpy(signature_.data(), data.data(), data.size());
 
 	LOG(IPAModule, Debug) << "IPA module " << libPath_ << " is signed";
-
-	return 0;
 }
 
 /**
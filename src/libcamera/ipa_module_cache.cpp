@@ -0,0 +1,409 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * ipa_module_cache.cpp - Persistent cache of IPA module information
+ */
+
+#include "libcamera/internal/ipa_module_cache.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <libcamera/base/file.h>
+#include <libcamera/base/log.h>
+#include <libcamera/base/unique_fd.h>
+
+#include "libcamera/internal/byte_stream_buffer.h"
+#include "libcamera/internal/ipa_module.h"
+
+/**
+ * \file ipa_module_cache.h
+ * \brief Persistent cache of IPA module information
+ */
+
+namespace libcamera {
+
+LOG_DECLARE_CATEGORY(IPAManager)
+
+namespace {
+
+constexpr char kMagic[8] = { 'L', 'C', 'I', 'P', 'A', 'M', 'C', '1' };
+
+struct CacheHeader {
+	char magic[8];
+	uint32_t apiVersion;
+	uint32_t count;
+	uint64_t keyHash;
+};
+
+/* 64-bit FNV-1a, used to detect changes of the signing public key. */
+uint64_t hashKey(Span<const uint8_t> key)
+{
+	uint64_t hash = 0xcbf29ce484222325ULL;
+
+	for (uint8_t byte : key) {
+		hash ^= byte;
+		hash *= 0x100000001b3ULL;
+	}
+
+	return hash;
+}
+
+} /* namespace */
+
+/**
+ * \class IPAModuleCache
+ * \brief Persistent cache of IPA module information and signature checks
+ *
+ * Creating an IPAModule parses the ELF shared object to retrieve the IPA
+ * module information, and checking the module signature requires hashing the
+ * whole shared object. The IPAModuleCache stores the module information and
+ * the result of the signature verification in a file, to skip those operations
+ * for modules that haven't changed since they were cached.
+ *
+ * Cache entries are keyed by the module path. An entry is only used if the
+ * device, inode, size, modification time and status change time of the module
+ * file, and the content of its signature file, match the cached values. As the
+ * status change time can't be set by users, any modification of the module
+ * invalidates its entry. The whole cache is discarded when the IPA module API
+ * version or the signing public key change.
+ *
+ * Entries are deliberately not keyed by a hash of the module contents. Hashing
+ * requires reading the whole module, which is the dominant cost of the
+ * signature verification that the cache aims to skip, leaving nothing to save.
+ * The status change time is a sufficient substitute: the kernel updates it on
+ * every write, truncation or metadata change of the file, and neither
+ * utimensat() nor any other system call lets unprivileged users set it. Moving
+ * a different file in place changes the inode number. Defeating the check
+ * would require changing the system clock, which is a privileged operation,
+ * or a filesystem that doesn't maintain the status change time, which isn't
+ * suitable to store IPA modules.
+ *
+ * As the cache records which modules are trusted to run without isolation, the
+ * cache file is ignored if it isn't owned by the user or is writable by other
+ * users.
+ */
+
+/**
+ * \brief Construct an IPAModuleCache
+ * \param[in] path The path to the cache file
+ * \param[in] key The public key used to verify the IPA module signatures
+ *
+ * The cache is empty after construction, call load() to populate it from the
+ * cache file.
+ */
+IPAModuleCache::IPAModuleCache(const std::string &path, Span<const uint8_t> key)
+	: path_(path), keyHash_(hashKey(key)), dirty_(false)
+{
+}
+
+/**
+ * \fn IPAModuleCache::path()
+ * \brief Retrieve the path to the cache file
+ * \return The path to the cache file
+ */
+
+/**
+ * \fn IPAModuleCache::isDirty()
+ * \brief Check if the cache has been modified since it was loaded or saved
+ * \return True if the cache needs to be saved, false otherwise
+ */
+
+bool IPAModuleCache::FileId::operator==(const FileId &other) const
+{
+	return dev == other.dev && ino == other.ino && size == other.size &&
+	       mtime == other.mtime && ctime == other.ctime;
+}
+
+int IPAModuleCache::fileId(const std::string &path, FileId *id)
+{
+	struct stat st;
+
+	if (stat(path.c_str(), &st) < 0)
+		return -errno;
+
+	id->dev = st.st_dev;
+	id->ino = st.st_ino;
+	id->size = st.st_size;
+	id->mtime = st.st_mtim.tv_sec * 1000000000ULL + st.st_mtim.tv_nsec;
+	id->ctime = st.st_ctim.tv_sec * 1000000000ULL + st.st_ctim.tv_nsec;
+
+	return 0;
+}
+
+/**
+ * \brief Load the cache from the cache file
+ *
+ * Entries loaded from a cache file that is missing, invalid, not owned by the
+ * user or created with a different IPA module API version or public key are
+ * discarded.
+ *
+ * \return 0 on success or a negative error code otherwise
+ */
+int IPAModuleCache::load()
+{
+	entries_.clear();
+	dirty_ = false;
+
+	struct stat st;
+	if (stat(path_.c_str(), &st) < 0)
+		return -errno;
+
+	if (st.st_uid != geteuid() || st.st_mode & (S_IWGRP | S_IWOTH)) {
+		LOG(IPAManager, Warning)
+			<< "Ignoring IPA module cache " << path_
+			<< ": unsafe ownership or permissions";
+		return -EPERM;
+	}
+
+	File file{ path_ };
+	if (!file.open(File::OpenModeFlag::ReadOnly))
+		return file.error();
+
+	Span<const uint8_t> data = file.map(0, -1, File::MapFlag::Private);
+	ByteStreamBuffer buffer(data.data(), data.size());
+
+	CacheHeader header;
+	if (buffer.read(&header) < 0 ||
+	    memcmp(header.magic, kMagic, sizeof(kMagic)) ||
+	    header.apiVersion != IPA_MODULE_API_VERSION ||
+	    header.keyHash != keyHash_) {
+		LOG(IPAManager, Debug) << "Discarding stale IPA module cache";
+		dirty_ = true;
+		return 0;
+	}
+
+	for (uint32_t i = 0; i < header.count; ++i) {
+		Entry entry = {};
+		uint32_t pathLength = 0;
+		uint32_t sigLength = 0;
+
+		buffer.read(&pathLength);
+		const char *libPath = buffer.read<char>(pathLength);
+		buffer.read(&entry.id);
+		buffer.read(&entry.info);
+		buffer.read(&sigLength);
+		const uint8_t *sig = buffer.read<uint8_t>(sigLength);
+		buffer.read(&entry.verification);
+
+		if (buffer.overflow() || !libPath || (sigLength && !sig)) {
+			LOG(IPAManager, Warning)
+				<< "Invalid IPA module cache " << path_;
+			entries_.clear();
+			dirty_ = true;
+			return -EINVAL;
+		}
+
+		entry.signature.assign(sig, sig + sigLength);
+		entries_[std::string(libPath, pathLength)] = std::move(entry);
+	}
+
+	LOG(IPAManager, Debug)
+		<< "Loaded " << entries_.size() << " entries from IPA module cache "
+		<< path_;
+
+	return 0;
+}
+
+/**
+ * \brief Save the cache to the cache file
+ *
+ * Only the entries that have been used since the cache was loaded are saved,
+ * to drop the modules that are not present anymore. The cache file is replaced
+ * atomically.
+ *
+ * \return 0 on success or a negative error code otherwise
+ */
+int IPAModuleCache::save()
+{
+	CacheHeader header;
+	memcpy(header.magic, kMagic, sizeof(kMagic));
+	header.apiVersion = IPA_MODULE_API_VERSION;
+	header.count = 0;
+	header.keyHash = keyHash_;
+
+	size_t size = sizeof(header);
+	for (const auto &[libPath, entry] : entries_) {
+		if (!entry.used)
+			continue;
+
+		size += sizeof(uint32_t) + libPath.size() + sizeof(entry.id)
+		      + sizeof(entry.info) + sizeof(uint32_t)
+		      + entry.signature.size() + sizeof(entry.verification);
+		header.count++;
+	}
+
+	std::vector<uint8_t> data(size);
+	ByteStreamBuffer buffer(data.data(), data.size());
+
+	buffer.write(&header);
+
+	for (const auto &[libPath, entry] : entries_) {
+		if (!entry.used)
+			continue;
+
+		uint32_t pathLength = libPath.size();
+		uint32_t sigLength = entry.signature.size();
+
+		buffer.write(&pathLength);
+		buffer.write(Span<const char>(libPath.data(), libPath.size()));
+		buffer.write(&entry.id);
+		buffer.write(&entry.info);
+		buffer.write(&sigLength);
+		buffer.write(Span<const uint8_t>(entry.signature));
+		buffer.write(&entry.verification);
+	}
+
+	std::string tmpPath = path_ + ".tmp";
+	UniqueFD fd(open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+			 S_IRUSR | S_IWUSR));
+	if (!fd.isValid()) {
+		int ret = -errno;
+		LOG(IPAManager, Warning)
+			<< "Failed to create IPA module cache " << tmpPath
+			<< ": " << strerror(-ret);
+		return ret;
+	}
+
+	ssize_t ret = write(fd.get(), data.data(), data.size());
+	if (ret != static_cast<ssize_t>(data.size()) ||
+	    rename(tmpPath.c_str(), path_.c_str()) < 0) {
+		ret = ret < 0 ? -errno : -EIO;
+		LOG(IPAManager, Warning)
+			<< "Failed to write IPA module cache " << path_;
+		unlink(tmpPath.c_str());
+		return ret;
+	}
+
+	dirty_ = false;
+
+	return 0;
+}
+
+/**
+ * \brief Invalidate the cache
+ *
+ * Drop all cache entries and remove the cache file. The cache is repopulated
+ * as modules are added.
+ */
+void IPAModuleCache::invalidate()
+{
+	entries_.clear();
+	unlink(path_.c_str());
+	dirty_ = true;
+}
+
+/**
+ * \brief Create an IPA module from the cache
+ * \param[in] libPath The path to the IPA module shared object
+ *
+ * Look up the cache entry for \a libPath, and create an IPAModule from the
+ * cached module information if the module hasn't changed.
+ *
+ * \return A new IPAModule, or nullptr if the module isn't cached or has
+ * changed
+ */
+IPAModule *IPAModuleCache::module(const std::string &libPath)
+{
+	auto iter = entries_.find(libPath);
+	if (iter == entries_.end())
+		return nullptr;
+
+	Entry &entry = iter->second;
+	FileId id;
+
+	if (fileId(libPath, &id) < 0 || !(id == entry.id)) {
+		entries_.erase(iter);
+		dirty_ = true;
+		return nullptr;
+	}
+
+	IPAModule *ipaModule = new IPAModule(libPath, entry.info);
+	if (ipaModule->signature() != entry.signature) {
+		delete ipaModule;
+		entries_.erase(iter);
+		dirty_ = true;
+		return nullptr;
+	}
+
+	entry.used = true;
+
+	return ipaModule;
+}
+
+/**
+ * \brief Add a valid IPA module to the cache
+ * \param[in] module The IPA module
+ */
+void IPAModuleCache::addModule(const IPAModule &module)
+{
+	Entry entry = {};
+
+	if (fileId(module.path(), &entry.id) < 0)
+		return;
+
+	entry.info = module.info();
+	entry.signature = module.signature();
+	entry.verification = Verification::Unknown;
+	entry.used = true;
+
+	entries_[module.path()] = std::move(entry);
+	dirty_ = true;
+}
+
+IPAModuleCache::Entry *IPAModuleCache::find(const IPAModule &module)
+{
+	auto iter = entries_.find(module.path());
+	if (iter == entries_.end())
+		return nullptr;
+
+	Entry &entry = iter->second;
+	FileId id;
+
+	if (fileId(module.path(), &id) < 0 || !(id == entry.id) ||
+	    module.signature() != entry.signature)
+		return nullptr;
+
+	return &entry;
+}
+
+/**
+ * \brief Retrieve the cached result of the signature verification of a module
+ * \param[in] module The IPA module
+ *
+ * \return The result of the signature verification if cached, or
+ * std::nullopt if the module hasn't been verified or has changed
+ */
+std::optional<bool> IPAModuleCache::signatureValid(const IPAModule &module)
+{
+	Entry *entry = find(module);
+	if (!entry || entry->verification == Verification::Unknown)
+		return std::nullopt;
+
+	return entry->verification == Verification::Valid;
+}
+
+/**
+ * \brief Store the result of the signature verification of a module
+ * \param[in] module The IPA module
+ * \param[in] valid The result of the signature verification
+ *
+ * The result is only stored if \a module has been added to the cache and
+ * hasn't changed since.
+ */
+void IPAModuleCache::setSignatureValid(const IPAModule &module, bool valid)
+{
+	Entry *entry = find(module);
+	if (!entry)
+		return;
+
+	entry->verification = valid ? Verification::Valid : Verification::Invalid;
+	dirty_ = true;
+}
+
+} /* namespace libcamera */
@@ -167,7 +167,7 @@ std::string IPAProxy::configurationFile(const std::string &name) const
  * \return The full path to the proxy worker executable, or an empty string if
  * no valid executable path
  */
-std::string IPAProxy::resolvePath(const std::string &file) const
+std::string IPAProxy::resolvePath(const std::string &file)
 {
 	std::string proxyFile = "/" + file;
 
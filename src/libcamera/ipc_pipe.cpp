@@ -7,6 +7,8 @@
 
 #include "libcamera/internal/ipc_pipe.h"
 
+#include <string.h>
+
 #include <libcamera/base/log.h>
 
 /**
@@ -18,6 +20,20 @@ namespace libcamera {
 
 LOG_DEFINE_CATEGORY(IPCPipe)
 
+namespace {
+
+/*
+ * Layout of each message packed in a batch, followed by the message data. The
+ * file descriptors of all messages are concatenated in the batch.
+ */
+struct BatchEntry {
+	IPCMessage::Header header;
+	uint32_t dataSize;
+	uint32_t fdsCount;
+};
+
+} /* namespace */
+
 /**
  * \struct IPCMessage::Header
  * \brief Container for an IPCMessage header
@@ -45,6 +61,15 @@ LOG_DEFINE_CATEGORY(IPCPipe)
  * \brief IPC message to be passed through IPC message pipe
  */
 
+/**
+ * \var IPCMessage::kBatchCmd
+ * \brief Command code of a message that packs multiple messages
+ *
+ * Messages with this command code are created by IPCPipe when batching is
+ * enabled, and carry a sequence of messages built with append(). The receiver
+ * unpacks them with split().
+ */
+
 /**
  * \brief Construct an empty IPCMessage instance
  */
@@ -118,6 +143,113 @@ IPCUnixSocket::Payload IPCMessage::payload() const
 	return payload;
 }
 
+/**
+ * \brief Describe the IPCMessage data as a scatter-gather list
+ *
+ * The returned buffers reference the header and data of the IPCMessage
+ * without copying them. Their concatenation has the same layout as the data
+ * of the payload() and can be sent with IPCUnixSocket::send(Span<const struct
+ * iovec>, Span<const int32_t>). The buffers are valid until the IPCMessage is
+ * modified or destroyed.
+ *
+ * \return The header and data buffers of the IPCMessage
+ */
+std::array<struct iovec, 2> IPCMessage::iov() const
+{
+	return { {
+		{ const_cast<Header *>(&header_), sizeof(header_) },
+		{ const_cast<uint8_t *>(data_.data()), data_.size() },
+	} };
+}
+
+/**
+ * \brief Retrieve the numerical values of the IPCMessage file descriptors
+ *
+ * The file descriptors are owned by the IPCMessage, and are valid until the
+ * IPCMessage is modified or destroyed.
+ *
+ * \return The file descriptors of the IPCMessage, to be sent alongside iov()
+ */
+std::vector<int32_t> IPCMessage::fdNumbers() const
+{
+	std::vector<int32_t> fds;
+
+	fds.reserve(fds_.size());
+	for (const SharedFD &fd : fds_)
+		fds.push_back(fd.get());
+
+	return fds;
+}
+
+/**
+ * \brief Pack a message at the end of the IPCMessage data
+ * \param[in] message The message to append
+ *
+ * The header and data of \a message are copied to the data of the IPCMessage,
+ * and its file descriptors are appended to the file descriptors of the
+ * IPCMessage. The messages can be extracted in order with split().
+ */
+void IPCMessage::append(const IPCMessage &message)
+{
+	BatchEntry entry = {
+		message.header_,
+		static_cast<uint32_t>(message.data_.size()),
+		static_cast<uint32_t>(message.fds_.size()),
+	};
+
+	size_t offset = data_.size();
+	data_.resize(offset + sizeof(entry) + message.data_.size());
+
+	memcpy(data_.data() + offset, &entry, sizeof(entry));
+	if (!message.data_.empty())
+		memcpy(data_.data() + offset + sizeof(entry),
+		       message.data_.data(), message.data_.size());
+
+	fds_.insert(fds_.end(), message.fds_.begin(), message.fds_.end());
+}
+
+/**
+ * \brief Extract the messages packed in the IPCMessage by append()
+ * \param[out] messages The extracted messages
+ *
+ * The messages are appended to \a messages in the order they have been packed.
+ *
+ * \return 0 on success, or -EINVAL if the IPCMessage data is malformed
+ */
+int IPCMessage::split(std::vector<IPCMessage> *messages) const
+{
+	size_t offset = 0;
+	size_t fdOffset = 0;
+
+	while (offset < data_.size()) {
+		BatchEntry entry;
+
+		if (data_.size() - offset < sizeof(entry))
+			return -EINVAL;
+
+		memcpy(&entry, data_.data() + offset, sizeof(entry));
+		offset += sizeof(entry);
+
+		if (entry.dataSize > data_.size() - offset ||
+		    entry.fdsCount > fds_.size() - fdOffset)
+			return -EINVAL;
+
+		IPCMessage &message = messages->emplace_back(entry.header);
+		message.data_.assign(data_.begin() + offset,
+				     data_.begin() + offset + entry.dataSize);
+		message.fds_.assign(fds_.begin() + fdOffset,
+				    fds_.begin() + fdOffset + entry.fdsCount);
+
+		offset += entry.dataSize;
+		fdOffset += entry.fdsCount;
+	}
+
+	if (fdOffset != fds_.size())
+		return -EINVAL;
+
+	return 0;
+}
+
 /**
  * \fn IPCMessage::header()
  * \brief Returns a reference to the header
@@ -155,13 +287,32 @@ IPCUnixSocket::Payload IPCMessage::payload() const
  * Virtual class to model an IPC message pipe for use by IPA proxies for IPA
  * isolation. sendSync() and sendAsync() must be implemented, and the recvMessage
  * signal must be emitted whenever new data is available.
+ *
+ * When batching is enabled with setBatching(), asynchronous messages are not
+ * sent immediately but packed in a single IPCMessage::kBatchCmd message, which
+ * is sent when control returns to the event loop of the thread the IPCPipe
+ * belongs to. This saves system calls when multiple asynchronous calls are
+ * issued in a row, for instance when queuing a request to the IPA and then
+ * filling its parameters buffer. Implementations of sendAsync() shall pass
+ * their message to batch() first, and send it only if batch() returns false.
+ * Implementations of sendSync() and of the destructor shall call flush() to
+ * preserve the ordering of messages.
+ */
+
+/**
+ * \enum IPCPipe::Transport
+ * \brief The transport used by an IPCPipe implementation
+ * \var IPCPipe::Transport::UnixSocket
+ * \brief Messages are passed through a Unix socket, see IPCPipeUnixSocket
+ * \var IPCPipe::Transport::SharedMemory
+ * \brief Messages are passed through shared memory rings, see IPCPipeShm
  */
 
 /**
  * \brief Construct an IPCPipe instance
  */
 IPCPipe::IPCPipe()
-	: connected_(false)
+	: connected_(false), batching_(false)
 {
 }
 
@@ -178,6 +329,91 @@ IPCPipe::~IPCPipe()
  * \return True if the IPCPipe is connected, false otherwise
  */
 
+/**
+ * \brief Enable or disable batching of asynchronous messages
+ * \param[in] enable True to enable batching, false to disable it
+ *
+ * Batching is disabled by default. Disabling batching sends the pending
+ * messages immediately.
+ */
+void IPCPipe::setBatching(bool enable)
+{
+	if (!enable)
+		flush();
+
+	batching_ = enable;
+}
+
+/**
+ * \var IPCPipe::kMaxBatchSize
+ * \brief Maximum size of the data of a batch message, in bytes
+ */
+
+/**
+ * \var IPCPipe::kMaxBatchFds
+ * \brief Maximum number of file descriptors carried by a batch message
+ */
+
+/**
+ * \brief Add an asynchronous message to the pending batch
+ * \param[in] message The message
+ *
+ * If batching is enabled, pack \a message in the pending batch, creating it
+ * and scheduling its transmission from the event loop if needed. Messages that
+ * would exceed the batch limits on their own are not batched, and cause the
+ * pending batch to be sent first.
+ *
+ * \return True if the message has been added to the batch, false if the
+ * caller shall send it
+ */
+bool IPCPipe::batch(const IPCMessage &message)
+{
+	if (!batching_ || message.header().cmd == IPCMessage::kBatchCmd)
+		return false;
+
+	if (message.data().size() + sizeof(BatchEntry) > kMaxBatchSize ||
+	    message.fds().size() > kMaxBatchFds) {
+		flush();
+		return false;
+	}
+
+	if (batch_ &&
+	    (batch_->data().size() + sizeof(BatchEntry) + message.data().size() > kMaxBatchSize ||
+	     batch_->fds().size() + message.fds().size() > kMaxBatchFds))
+		flush();
+
+	if (!batch_) {
+		batch_ = std::make_unique<IPCMessage>(IPCMessage::kBatchCmd);
+		invokeMethod(&IPCPipe::flush, ConnectionTypeQueued);
+	}
+
+	batch_->append(message);
+
+	return true;
+}
+
+/**
+ * \brief Send the pending batch of asynchronous messages, if any
+ *
+ * The messages of a batch have already been reported as sent to their callers,
+ * a failure to send the batch can't be propagated. It is logged, and the pipe
+ * is marked as disconnected.
+ */
+void IPCPipe::flush()
+{
+	if (!batch_)
+		return;
+
+	std::unique_ptr<IPCMessage> batch = std::move(batch_);
+	int ret = sendAsync(*batch);
+	if (ret) {
+		LOG(IPCPipe, Error)
+			<< "Failed to send batch of asynchronous messages: "
+			<< strerror(-ret);
+		connected_ = false;
+	}
+}
+
 /**
  * \fn IPCPipe::sendSync()
  * \brief Send a message over IPC synchronously
@@ -0,0 +1,188 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * ipc_pipe_shm.cpp - Image Processing Algorithm IPC module using shared memory
+ */
+
+#include "libcamera/internal/ipc_pipe_shm.h"
+
+#include <string>
+#include <string.h>
+#include <vector>
+
+#include <libcamera/base/event_dispatcher.h>
+#include <libcamera/base/log.h>
+#include <libcamera/base/thread.h>
+#include <libcamera/base/timer.h>
+
+#include "libcamera/internal/process.h"
+
+/**
+ * \file ipc_pipe_shm.h
+ * \brief IPCPipe implementation based on shared memory rings
+ */
+
+using namespace std::chrono_literals;
+
+namespace libcamera {
+
+LOG_DECLARE_CATEGORY(IPCPipe)
+
+/**
+ * \class IPCPipeShm
+ * \brief IPCPipe implementation based on an IPCShmChannel
+ *
+ * The IPCPipeShm class starts the proxy worker and communicates with it
+ * through an IPCShmChannel. Compared to IPCPipeUnixSocket, message data is
+ * passed through shared memory, and only messages that carry file descriptors
+ * go through a Unix socket.
+ *
+ * The proxy worker is passed the IPA module path, the channel file descriptor
+ * and the "shm" transport name as arguments.
+ */
+
+/**
+ * \brief Construct an IPCPipeShm instance and start the proxy worker
+ * \param[in] ipaModulePath The path to the IPA module
+ * \param[in] ipaProxyWorkerPath The path to the proxy worker executable
+ */
+IPCPipeShm::IPCPipeShm(const char *ipaModulePath,
+		       const char *ipaProxyWorkerPath)
+	: IPCPipe()
+{
+	std::vector<int> fds;
+	std::vector<std::string> args;
+	args.push_back(ipaModulePath);
+
+	channel_ = std::make_unique<IPCShmChannel>(this);
+	UniqueFD fd = channel_->create();
+	if (!fd.isValid()) {
+		LOG(IPCPipe, Error) << "Failed to create shared memory channel";
+		return;
+	}
+	channel_->readyRead.connect(this, &IPCPipeShm::readyRead);
+	args.push_back(std::to_string(fd.get()));
+	args.push_back("shm");
+	fds.push_back(fd.get());
+
+	proc_ = std::make_unique<Process>();
+	proc_->finished.connect(this, [this](enum Process::ExitStatus, int) {
+		connected_ = false;
+	});
+	int ret = proc_->start(ipaProxyWorkerPath, args, fds);
+	if (ret) {
+		LOG(IPCPipe, Error)
+			<< "Failed to start proxy worker process";
+		return;
+	}
+
+	connected_ = true;
+}
+
+IPCPipeShm::~IPCPipeShm()
+{
+	flush();
+}
+
+int IPCPipeShm::sendSync(const IPCMessage &in, IPCMessage *out)
+{
+	IPCShmChannel::Payload response;
+
+	/* Deliver pending asynchronous messages first. */
+	flush();
+
+	int ret = call(in, &response, in.header().cookie);
+	if (ret) {
+		LOG(IPCPipe, Error) << "Failed to call sync";
+		return ret;
+	}
+
+	if (out)
+		*out = IPCMessage(response);
+
+	return 0;
+}
+
+int IPCPipeShm::sendAsync(const IPCMessage &data)
+{
+	if (batch(data))
+		return 0;
+
+	int ret = channel_->send(data.iov(), data.fdNumbers());
+	if (ret) {
+		LOG(IPCPipe, Error) << "Failed to call async";
+		return ret;
+	}
+
+	return 0;
+}
+
+void IPCPipeShm::readyRead()
+{
+	IPCShmChannel::Payload payload;
+	int ret = channel_->receive(&payload);
+	if (ret) {
+		LOG(IPCPipe, Error) << "Receive message failed" << ret;
+		if (!channel_->isBound())
+			connected_ = false;
+		return;
+	}
+
+	if (payload.data.size() < sizeof(IPCMessage::Header)) {
+		LOG(IPCPipe, Error) << "Not enough data received";
+		return;
+	}
+
+	/*
+	 * Look the cookie up before constructing an IPCMessage, which takes
+	 * ownership of the file descriptors of the payload.
+	 */
+	IPCMessage::Header header;
+	memcpy(&header, payload.data.data(), sizeof(header));
+
+	auto callData = callData_.find(header.cookie);
+	if (callData != callData_.end()) {
+		*callData->second.response = std::move(payload);
+		callData->second.done = true;
+		return;
+	}
+
+	/* Received unexpected data, this means it's a call from the IPA. */
+	IPCMessage ipcMessage(payload);
+	recv.emit(ipcMessage);
+}
+
+int IPCPipeShm::call(const IPCMessage &message,
+		     IPCShmChannel::Payload *response, uint32_t cookie)
+{
+	Timer timeout;
+	int ret;
+
+	const auto result = callData_.insert({ cookie, { response, false } });
+	const auto &iter = result.first;
+
+	ret = channel_->send(message.iov(), message.fdNumbers());
+	if (ret) {
+		callData_.erase(iter);
+		return ret;
+	}
+
+	/* \todo Make this less dangerous, see IPCPipe::sendSync() */
+	timeout.start(2000ms);
+	while (!iter->second.done) {
+		if (!timeout.isRunning()) {
+			LOG(IPCPipe, Error) << "Call timeout!";
+			callData_.erase(iter);
+			return -ETIMEDOUT;
+		}
+
+		Thread::current()->eventDispatcher()->processEvents();
+	}
+
+	callData_.erase(iter);
+
+	return 0;
+}
+
+} /* namespace libcamera */
@@ -7,6 +7,7 @@
 
 #include "libcamera/internal/ipc_pipe_unixsocket.h"
 
+#include <string.h>
 #include <vector>
 
 #include <libcamera/base/event_dispatcher.h>
@@ -32,7 +33,7 @@ IPCPipeUnixSocket::IPCPipeUnixSocket(const char *ipaModulePath,
 	std::vector<std::string> args;
 	args.push_back(ipaModulePath);
 
-	socket_ = std::make_unique<IPCUnixSocket>();
+	socket_ = std::make_unique<IPCUnixSocket>(this);
 	UniqueFD fd = socket_->create();
 	if (!fd.isValid()) {
 		LOG(IPCPipe, Error) << "Failed to create socket";
@@ -43,6 +44,9 @@ IPCPipeUnixSocket::IPCPipeUnixSocket(const char *ipaModulePath,
 	fds.push_back(fd.get());
 
 	proc_ = std::make_unique<Process>();
+	proc_->finished.connect(this, [this](enum Process::ExitStatus, int) {
+		connected_ = false;
+	});
 	int ret = proc_->start(ipaProxyWorkerPath, args, fds);
 	if (ret) {
 		LOG(IPCPipe, Error)
@@ -55,13 +59,17 @@ IPCPipeUnixSocket::IPCPipeUnixSocket(const char *ipaModulePath,
 
 IPCPipeUnixSocket::~IPCPipeUnixSocket()
 {
+	flush();
 }
 
 int IPCPipeUnixSocket::sendSync(const IPCMessage &in, IPCMessage *out)
 {
 	IPCUnixSocket::Payload response;
 
-	int ret = call(in.payload(), &response, in.header().cookie);
+	/* Deliver pending asynchronous messages first. */
+	flush();
+
+	int ret = call(in, &response, in.header().cookie);
 	if (ret) {
 		LOG(IPCPipe, Error) << "Failed to call sync";
 		return ret;
@@ -75,7 +83,10 @@ int IPCPipeUnixSocket::sendSync(const IPCMessage &in, IPCMessage *out)
 
 int IPCPipeUnixSocket::sendAsync(const IPCMessage &data)
 {
-	int ret = socket_->send(data.payload());
+	if (batch(data))
+		return 0;
+
+	int ret = socket_->send(data.iov(), data.fdNumbers());
 	if (ret) {
 		LOG(IPCPipe, Error) << "Failed to call async";
 		return ret;
@@ -93,15 +104,19 @@ void IPCPipeUnixSocket::readyRead()
 		return;
 	}
 
-	/* \todo Use span to avoid the double copy when callData is found. */
 	if (payload.data.size() < sizeof(IPCMessage::Header)) {
 		LOG(IPCPipe, Error) << "Not enough data received";
 		return;
 	}
 
-	IPCMessage ipcMessage(payload);
+	/*
+	 * Look the cookie up before constructing an IPCMessage, which takes
+	 * ownership of the file descriptors of the payload.
+	 */
+	IPCMessage::Header header;
+	memcpy(&header, payload.data.data(), sizeof(header));
 
-	auto callData = callData_.find(ipcMessage.header().cookie);
+	auto callData = callData_.find(header.cookie);
 	if (callData != callData_.end()) {
 		*callData->second.response = std::move(payload);
 		callData->second.done = true;
@@ -109,10 +124,11 @@ void IPCPipeUnixSocket::readyRead()
 	}
 
 	/* Received unexpected data, this means it's a call from the IPA. */
+	IPCMessage ipcMessage(payload);
 	recv.emit(ipcMessage);
 }
 
-int IPCPipeUnixSocket::call(const IPCUnixSocket::Payload &message,
+int IPCPipeUnixSocket::call(const IPCMessage &message,
 			    IPCUnixSocket::Payload *response, uint32_t cookie)
 {
 	Timer timeout;
@@ -121,7 +137,7 @@ int IPCPipeUnixSocket::call(const IPCUnixSocket::Payload &message,
 	const auto result = callData_.insert({ cookie, { response, false } });
 	const auto &iter = result.first;
 
-	ret = socket_->send(message);
+	ret = socket_->send(message.iov(), message.fdNumbers());
 	if (ret) {
 		callData_.erase(iter);
 		return ret;
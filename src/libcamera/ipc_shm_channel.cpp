@@ -0,0 +1,645 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * ipc_shm_channel.cpp - IPC mechanism based on shared memory rings
+ */
+
+#include "libcamera/internal/ipc_shm_channel.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <errno.h>
+#include <fcntl.h>
+#include <new>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <libcamera/base/event_notifier.h>
+#include <libcamera/base/log.h>
+
+/**
+ * \file ipc_shm_channel.h
+ * \brief IPC mechanism based on shared memory rings
+ */
+
+namespace libcamera {
+
+LOG_DEFINE_CATEGORY(IPCShmChannel)
+
+namespace {
+
+constexpr uint32_t kSetupMagic = 0x4d485343; /* "CSHM" */
+constexpr uint16_t kRecordSocket = 1 << 0;
+constexpr unsigned int kMaxRecordFds = 253; /* SCM_MAX_FD */
+
+struct Setup {
+	uint32_t magic;
+	uint32_t ringSize;
+};
+
+struct Record {
+	uint32_t size;
+	uint16_t fds;
+	uint16_t flags;
+};
+
+constexpr size_t alignRecord(size_t size)
+{
+	return (size + alignof(uint64_t) - 1) & ~(alignof(uint64_t) - 1);
+}
+
+} /* namespace */
+
+/*
+ * A single-producer single-consumer ring, located in shared memory and
+ * immediately followed by its data area. The head and tail are free-running
+ * byte counters, the data area size is a power of two.
+ */
+struct IPCShmChannel::Ring {
+	alignas(64) std::atomic<uint64_t> head;
+	alignas(64) std::atomic<uint64_t> tail;
+	alignas(64) std::atomic<uint32_t> pending;
+
+	Ring()
+		: head(0), tail(0), pending(0)
+	{
+	}
+
+	uint8_t *data() { return reinterpret_cast<uint8_t *>(this + 1); }
+
+	void write(uint64_t pos, const void *src, size_t length, size_t size)
+	{
+		size_t offset = pos & (size - 1);
+		size_t first = std::min(length, size - offset);
+
+		memcpy(data() + offset, src, first);
+		memcpy(data(), static_cast<const uint8_t *>(src) + first,
+		       length - first);
+	}
+
+	void read(uint64_t pos, void *dst, size_t length, size_t size)
+	{
+		size_t offset = pos & (size - 1);
+		size_t first = std::min(length, size - offset);
+
+		memcpy(dst, data() + offset, first);
+		memcpy(static_cast<uint8_t *>(dst) + first, data(),
+		       length - first);
+	}
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free &&
+	      std::atomic<uint32_t>::is_always_lock_free,
+	      "Shared memory rings require lock-free atomics");
+
+/**
+ * \class IPCShmChannel
+ * \brief IPC mechanism based on shared memory rings
+ *
+ * The IPCShmChannel class implements the same bidirectional message passing
+ * model as IPCUnixSocket, but carries message data through two
+ * single-producer single-consumer rings stored in a memfd shared between the
+ * two sides of the channel, one for each direction. Sending a message copies
+ * its data to the transmit ring and rings an eventfd doorbell, which is only
+ * written when the receiver has consumed the previous doorbell. Receiving a
+ * message copies its data out of the receive ring. No system call is thus
+ * needed on the data path when messages are sent faster than they are
+ * processed.
+ *
+ * File descriptors can't be passed through shared memory. Messages that carry
+ * file descriptors, as well as messages too large to fit in the free space of
+ * the ring, are sent in full through a Unix socket, and the ring only stores a
+ * record that preserves message ordering.
+ *
+ * Establishment of the channel follows the IPCUnixSocket model. The side that
+ * initiates communication creates the channel with create(), which returns a
+ * socket file descriptor for the remote side. The shared memory and doorbell
+ * file descriptors are passed through that socket, and retrieved when the
+ * remote side binds to the channel with bind().
+ *
+ * \context This class is \threadbound.
+ */
+
+/**
+ * \brief Construct an IPCShmChannel instance
+ * \param[in] parent The parent Object of the channel's internal event notifier
+ *
+ * As for IPCUnixSocket, the \a parent shall be set when the channel is owned
+ * by an Object that may be moved to a different thread.
+ */
+IPCShmChannel::IPCShmChannel(Object *parent)
+	: parent_(parent), notifier_(nullptr), mem_(nullptr), memSize_(0), ringSize_(0),
+	  tx_(nullptr), rx_(nullptr)
+{
+}
+
+IPCShmChannel::~IPCShmChannel()
+{
+	close();
+}
+
+/**
+ * \brief Create a new IPC channel
+ * \param[in] ringSize The minimum size of the data area of each ring, in bytes
+ *
+ * This function creates a new IPC channel. The channel instance is bound to the
+ * local side of the channel, and the function returns a file descriptor bound
+ * to the remote side. The caller is responsible for passing the file descriptor
+ * to the remote process, where it can be used with IPCShmChannel::bind() to
+ * bind the remote side channel.
+ *
+ * The \a ringSize is rounded up to the next power of two.
+ *
+ * \return A file descriptor. It is valid on success or invalid otherwise.
+ */
+UniqueFD IPCShmChannel::create(size_t ringSize)
+{
+	if (isBound())
+		return {};
+
+	size_t size = 4096;
+	while (size < ringSize)
+		size <<= 1;
+
+	int sockets[2];
+	int ret = socketpair(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK, 0, sockets);
+	if (ret) {
+		ret = -errno;
+		LOG(IPCShmChannel, Error)
+			<< "Failed to create socket pair: " << strerror(-ret);
+		return {};
+	}
+
+	UniqueFD local(sockets[0]);
+	UniqueFD remote(sockets[1]);
+
+	UniqueFD memfd(memfd_create("libcamera-ipc", MFD_CLOEXEC | MFD_ALLOW_SEALING));
+	UniqueFD doorbells[2] = {
+		UniqueFD(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)),
+		UniqueFD(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)),
+	};
+
+	if (!memfd.isValid() || !doorbells[0].isValid() ||
+	    !doorbells[1].isValid()) {
+		ret = -errno;
+		LOG(IPCShmChannel, Error)
+			<< "Failed to create shared memory: " << strerror(-ret);
+		return {};
+	}
+
+	/* Prevent the remote side from resizing the memory under our feet. */
+	if (ftruncate(memfd.get(), 2 * (sizeof(Ring) + size)) < 0 ||
+	    fcntl(memfd.get(), F_ADD_SEALS,
+		  F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) < 0) {
+		ret = -errno;
+		LOG(IPCShmChannel, Error)
+			<< "Failed to size shared memory: " << strerror(-ret);
+		return {};
+	}
+
+	socket_ = std::move(local);
+
+	Setup setup = { kSetupMagic, static_cast<uint32_t>(size) };
+	struct iovec iov = { &setup, sizeof(setup) };
+	const int32_t fds[3] = { memfd.get(), doorbells[0].get(), doorbells[1].get() };
+	ret = sendSocket({ &iov, 1 }, fds, 3);
+	if (ret < 0) {
+		socket_.reset();
+		return {};
+	}
+
+	txDoorbell_ = std::move(doorbells[0]);
+	rxDoorbell_ = std::move(doorbells[1]);
+
+	if (map(std::move(memfd), size, 0) < 0) {
+		close();
+		return {};
+	}
+
+	return remote;
+}
+
+/**
+ * \brief Bind to an existing IPC channel
+ * \param[in] fd File descriptor
+ *
+ * This function binds the channel instance to an existing IPC channel
+ * identified by the file descriptor \a fd. The file descriptor is obtained
+ * from the IPCShmChannel::create() function.
+ *
+ * \return 0 on success or a negative error code otherwise
+ */
+int IPCShmChannel::bind(UniqueFD fd)
+{
+	if (isBound())
+		return -EINVAL;
+
+	socket_ = std::move(fd);
+
+	Setup setup = {};
+	int32_t fds[3] = { -1, -1, -1 };
+	int ret = recvSocket(&setup, sizeof(setup), fds, 3);
+
+	UniqueFD memfd(fds[0]);
+	UniqueFD doorbells[2] = { UniqueFD(fds[1]), UniqueFD(fds[2]) };
+
+	if (ret < 0 || setup.magic != kSetupMagic || !memfd.isValid() ||
+	    !doorbells[0].isValid() || !doorbells[1].isValid() ||
+	    !setup.ringSize || setup.ringSize & (setup.ringSize - 1)) {
+		LOG(IPCShmChannel, Error) << "Invalid channel setup";
+		socket_.reset();
+		return ret < 0 ? ret : -EINVAL;
+	}
+
+	txDoorbell_ = std::move(doorbells[1]);
+	rxDoorbell_ = std::move(doorbells[0]);
+
+	ret = map(std::move(memfd), setup.ringSize, 1);
+	if (ret < 0) {
+		close();
+		return ret;
+	}
+
+	return 0;
+}
+
+/**
+ * \brief Close the IPC channel
+ *
+ * No communication is possible after close() has been called.
+ */
+void IPCShmChannel::close()
+{
+	delete notifier_;
+	notifier_ = nullptr;
+
+	drop();
+}
+
+/*
+ * Release the resources of the channel. This is used to close the channel when
+ * the remote side misbehaves, from within the readyRead handler, where the
+ * notifier can't be deleted as it is being activated. It is only disabled, and
+ * deleted by close().
+ */
+void IPCShmChannel::drop()
+{
+	if (notifier_)
+		notifier_->setEnabled(false);
+
+	if (mem_)
+		munmap(mem_, memSize_);
+
+	mem_ = nullptr;
+	tx_ = nullptr;
+	rx_ = nullptr;
+
+	socket_.reset();
+	txDoorbell_.reset();
+	rxDoorbell_.reset();
+}
+
+/**
+ * \brief Check if the IPC channel is bound
+ * \return True if the IPC channel is bound, false otherwise
+ */
+bool IPCShmChannel::isBound() const
+{
+	return mem_ != nullptr;
+}
+
+/**
+ * \brief Send a message payload
+ * \param[in] payload Message payload to send
+ *
+ * This function queues the message payload for transmission to the other end
+ * of the IPC channel. It returns immediately, before the message is delivered
+ * to the remote side.
+ *
+ * \return 0 on success or a negative error code otherwise
+ * \retval -ENOBUFS The transmit ring is full
+ */
+int IPCShmChannel::send(const Payload &payload)
+{
+	struct iovec iov = {
+		const_cast<uint8_t *>(payload.data.data()),
+		payload.data.size(),
+	};
+
+	return send({ &iov, 1 }, payload.fds);
+}
+
+/**
+ * \brief Send a message payload gathered from multiple buffers
+ * \param[in] iov Buffers containing the message data
+ * \param[in] fds File descriptors to send with the message
+ *
+ * This function sends the concatenation of the \a iov buffers as a single
+ * message payload. The buffers are copied directly to the transmit ring, or
+ * gathered by the socket for messages that don't fit in the ring. It
+ * otherwise behaves as send(const Payload &).
+ *
+ * \return 0 on success or a negative error code otherwise
+ * \retval -ENOBUFS The transmit ring is full
+ */
+int IPCShmChannel::send(Span<const struct iovec> iov, Span<const int32_t> fds)
+{
+	if (!isBound())
+		return -ENOTCONN;
+
+	size_t length = 0;
+	for (const struct iovec &buffer : iov)
+		length += buffer.iov_len;
+
+	if (!length && fds.empty())
+		return -EINVAL;
+
+	Record record = {
+		static_cast<uint32_t>(length),
+		static_cast<uint16_t>(fds.size()),
+		0,
+	};
+	size_t recordSize = sizeof(record) + alignRecord(record.size);
+
+	uint64_t head = tx_->head.load(std::memory_order_relaxed);
+	uint64_t tail = tx_->tail.load(std::memory_order_acquire);
+	size_t space = ringSize_ - (head - tail);
+
+	if (record.fds || recordSize > space) {
+		if (sizeof(record) > space) {
+			LOG(IPCShmChannel, Error) << "Transmit ring full";
+			return -ENOBUFS;
+		}
+
+		int ret = sendSocket(iov, fds.data(), record.fds);
+		if (ret < 0)
+			return ret;
+
+		record.flags = kRecordSocket;
+		recordSize = sizeof(record);
+	}
+
+	tx_->write(head, &record, sizeof(record), ringSize_);
+	if (!(record.flags & kRecordSocket)) {
+		uint64_t pos = head + sizeof(record);
+
+		for (const struct iovec &buffer : iov) {
+			tx_->write(pos, buffer.iov_base, buffer.iov_len, ringSize_);
+			pos += buffer.iov_len;
+		}
+	}
+
+	tx_->head.store(head + recordSize, std::memory_order_seq_cst);
+
+	/* Ring the doorbell unless the receiver hasn't processed it yet. */
+	if (tx_->pending.exchange(1, std::memory_order_seq_cst))
+		return 0;
+
+	uint64_t value = 1;
+	if (::write(txDoorbell_.get(), &value, sizeof(value)) < 0) {
+		int ret = -errno;
+		LOG(IPCShmChannel, Error)
+			<< "Failed to ring doorbell: " << strerror(-ret);
+		return ret;
+	}
+
+	return 0;
+}
+
+/**
+ * \brief Receive a message payload
+ * \param[out] payload Payload where to write the received message
+ *
+ * This function receives the message payload from the IPC channel and writes it
+ * to the \a payload. If no message payload is available, it returns
+ * immediately with -EAGAIN. The \ref readyRead signal shall be used to receive
+ * notification of message availability.
+ *
+ * \return 0 on success or a negative error code otherwise
+ * \retval -EAGAIN No message payload is available
+ * \retval -ENOTCONN The channel is not connected (neither create() nor bind()
+ * has been called)
+ * \retval -EPROTO The remote side wrote an invalid message, the channel has
+ * been closed
+ */
+int IPCShmChannel::receive(Payload *payload)
+{
+	if (!isBound())
+		return -ENOTCONN;
+
+	uint64_t tail = rx_->tail.load(std::memory_order_relaxed);
+	uint64_t head = rx_->head.load(std::memory_order_acquire);
+	uint64_t available = head - tail;
+
+	if (!available)
+		return -EAGAIN;
+
+	Record record;
+	if (available < sizeof(record) || available > ringSize_) {
+		LOG(IPCShmChannel, Error) << "Receive ring corrupted";
+		drop();
+		return -EPROTO;
+	}
+
+	rx_->read(tail, &record, sizeof(record), ringSize_);
+
+	/*
+	 * The record is written by the remote side, validate it before sizing
+	 * the payload.
+	 */
+	if (record.flags & kRecordSocket) {
+		/* Consume the record even on error to keep the ring in sync. */
+		rx_->tail.store(tail + sizeof(record), std::memory_order_release);
+
+		ssize_t size = recv(socket_.get(), nullptr, 0, MSG_PEEK | MSG_TRUNC);
+		if (size < 0 || static_cast<size_t>(size) != record.size ||
+		    record.fds > kMaxRecordFds) {
+			LOG(IPCShmChannel, Error) << "Invalid socket record";
+			drop();
+			return -EPROTO;
+		}
+
+		payload->data.resize(record.size);
+		payload->fds.resize(record.fds);
+
+		int ret = recvSocket(payload->data.data(), record.size,
+				     payload->fds.data(), record.fds);
+		return ret < 0 ? ret : 0;
+	}
+
+	size_t recordSize = sizeof(record) + alignRecord(record.size);
+	if (record.fds || recordSize > available) {
+		LOG(IPCShmChannel, Error) << "Invalid record in receive ring";
+		drop();
+		return -EPROTO;
+	}
+
+	payload->data.resize(record.size);
+	payload->fds.clear();
+
+	rx_->read(tail + sizeof(record), payload->data.data(), record.size,
+		  ringSize_);
+	rx_->tail.store(tail + recordSize, std::memory_order_release);
+
+	return 0;
+}
+
+/**
+ * \var IPCShmChannel::readyRead
+ * \brief A Signal emitted when a message is ready to be read
+ */
+
+int IPCShmChannel::map(UniqueFD memfd, size_t ringSize, unsigned int tx)
+{
+	size_t size = 2 * (sizeof(Ring) + ringSize);
+
+	void *mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+			 memfd.get(), 0);
+	if (mem == MAP_FAILED) {
+		int ret = -errno;
+		LOG(IPCShmChannel, Error)
+			<< "Failed to map shared memory: " << strerror(-ret);
+		return ret;
+	}
+
+	std::array<Ring *, 2> rings = {
+		static_cast<Ring *>(mem),
+		reinterpret_cast<Ring *>(static_cast<uint8_t *>(mem) +
+					 sizeof(Ring) + ringSize),
+	};
+
+	/* The creator initializes the rings before the remote side maps them. */
+	if (tx == 0) {
+		new (rings[0]) Ring();
+		new (rings[1]) Ring();
+	}
+
+	mem_ = mem;
+	memSize_ = size;
+	ringSize_ = ringSize;
+	tx_ = rings[tx];
+	rx_ = rings[tx ^ 1];
+
+	delete notifier_;
+	notifier_ = new EventNotifier(rxDoorbell_.get(), EventNotifier::Read,
+				      parent_);
+	notifier_->activated.connect(this, &IPCShmChannel::doorbell);
+
+	return 0;
+}
+
+int IPCShmChannel::sendSocket(Span<const struct iovec> iov,
+			      const int32_t *fds, unsigned int num)
+{
+	std::vector<uint8_t> control(CMSG_SPACE(num * sizeof(int32_t)));
+
+	struct msghdr msg = {};
+	msg.msg_iov = const_cast<struct iovec *>(iov.data());
+	msg.msg_iovlen = iov.size();
+
+	if (num) {
+		msg.msg_control = control.data();
+		msg.msg_controllen = control.size();
+
+		struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+		cmsg->cmsg_len = CMSG_LEN(num * sizeof(int32_t));
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		memcpy(CMSG_DATA(cmsg), fds, num * sizeof(int32_t));
+	}
+
+	if (sendmsg(socket_.get(), &msg, 0) < 0) {
+		int ret = -errno;
+		LOG(IPCShmChannel, Error)
+			<< "Failed to sendmsg: " << strerror(-ret);
+		return ret;
+	}
+
+	return 0;
+}
+
+int IPCShmChannel::recvSocket(void *data, size_t length,
+			      int32_t *fds, unsigned int num)
+{
+	struct iovec iov = { data, length };
+
+	std::vector<uint8_t> control(CMSG_SPACE(num * sizeof(int32_t)));
+
+	struct msghdr msg = {};
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.data();
+	msg.msg_controllen = control.size();
+
+	ssize_t size = recvmsg(socket_.get(), &msg, 0);
+	if (size < 0) {
+		int ret = -errno;
+		LOG(IPCShmChannel, Error)
+			<< "Failed to recvmsg: " << strerror(-ret);
+		return ret;
+	}
+
+	std::vector<int32_t> received;
+	struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+	if (cmsg && cmsg->cmsg_level == SOL_SOCKET &&
+	    cmsg->cmsg_type == SCM_RIGHTS) {
+		received.resize((cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int32_t));
+		memcpy(received.data(), CMSG_DATA(cmsg),
+		       received.size() * sizeof(int32_t));
+	}
+
+	if (static_cast<size_t>(size) != length || received.size() != num ||
+	    msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) {
+		LOG(IPCShmChannel, Error) << "Socket message size mismatch";
+
+		for (int32_t fd : received)
+			::close(fd);
+
+		return -EPROTO;
+	}
+
+	std::copy(received.begin(), received.end(), fds);
+
+	return 0;
+}
+
+void IPCShmChannel::doorbell()
+{
+	/*
+	 * Clear the pending flag before reading the doorbell, to ensure that
+	 * messages sent from now on will ring it again.
+	 */
+	rx_->pending.store(0, std::memory_order_seq_cst);
+
+	uint64_t value;
+	if (::read(rxDoorbell_.get(), &value, sizeof(value)) < 0 &&
+	    errno != EAGAIN) {
+		int ret = -errno;
+		LOG(IPCShmChannel, Error)
+			<< "Failed to read doorbell: " << strerror(-ret);
+	}
+
+	dispatch();
+}
+
+void IPCShmChannel::dispatch()
+{
+	while (isBound()) {
+		uint64_t tail = rx_->tail.load(std::memory_order_relaxed);
+		if (rx_->head.load(std::memory_order_seq_cst) == tail)
+			break;
+
+		readyRead.emit();
+
+		/* Stop if the message hasn't been consumed, to avoid looping. */
+		if (isBound() && rx_->tail.load(std::memory_order_relaxed) == tail)
+			break;
+	}
+}
+
+} /* namespace libcamera */
@@ -68,8 +68,17 @@ LOG_DEFINE_CATEGORY(IPCUnixSocket)
  * \context This class is \threadbound.
  */
 
-IPCUnixSocket::IPCUnixSocket()
-	: headerReceived_(false), notifier_(nullptr)
+/**
+ * \brief Construct an IPCUnixSocket instance
+ * \param[in] parent The parent Object of the socket's internal event notifier
+ *
+ * The socket isn't an Object itself, but relies on an EventNotifier bound to
+ * the thread that binds the socket. When the socket is owned by an Object that
+ * may be moved to a different thread, the owner shall be passed as \a parent
+ * to move the event notifier along with it.
+ */
+IPCUnixSocket::IPCUnixSocket(Object *parent)
+	: headerReceived_(false), parent_(parent), notifier_(nullptr)
 {
 }
 
@@ -129,7 +138,8 @@ int IPCUnixSocket::bind(UniqueFD fd)
 		return -EINVAL;
 
 	fd_ = std::move(fd);
-	notifier_ = new EventNotifier(fd_.get(), EventNotifier::Read);
+	notifier_ = new EventNotifier(fd_.get(), EventNotifier::Read,
+				      parent_);
 	notifier_->activated.connect(this, &IPCUnixSocket::dataNotifier);
 
 	return 0;
@@ -172,6 +182,27 @@ bool IPCUnixSocket::isBound() const
  * \return 0 on success or a negative error code otherwise
  */
 int IPCUnixSocket::send(const Payload &payload)
+{
+	struct iovec iov = {
+		const_cast<uint8_t *>(payload.data.data()),
+		payload.data.size(),
+	};
+
+	return send({ &iov, 1 }, payload.fds);
+}
+
+/**
+ * \brief Send a message payload gathered from multiple buffers
+ * \param[in] iov Buffers containing the message data
+ * \param[in] fds File descriptors to send with the message
+ *
+ * This function sends the concatenation of the \a iov buffers as a single
+ * message payload, without copying them to an intermediate buffer. It
+ * otherwise behaves as send(const Payload &).
+ *
+ * \return 0 on success or a negative error code otherwise
+ */
+int IPCUnixSocket::send(Span<const struct iovec> iov, Span<const int32_t> fds)
 {
 	int ret;
 
@@ -179,8 +210,9 @@ int IPCUnixSocket::send(const Payload &payload)
 		return -ENOTCONN;
 
 	Header hdr = {};
-	hdr.data = payload.data.size();
-	hdr.fds = payload.fds.size();
+	for (const struct iovec &buffer : iov)
+		hdr.data += buffer.iov_len;
+	hdr.fds = fds.size();
 
 	if (!hdr.data && !hdr.fds)
 		return -EINVAL;
@@ -193,7 +225,7 @@ int IPCUnixSocket::send(const Payload &payload)
 		return ret;
 	}
 
-	return sendData(payload.data.data(), hdr.data, payload.fds.data(), hdr.fds);
+	return sendData(iov, fds.data(), hdr.fds);
 }
 
 /**
@@ -240,13 +272,9 @@ int IPCUnixSocket::receive(Payload *payload)
  * \brief A Signal emitted when a message is ready to be read
  */
 
-int IPCUnixSocket::sendData(const void *buffer, size_t length,
+int IPCUnixSocket::sendData(Span<const struct iovec> iov,
 			    const int32_t *fds, unsigned int num)
 {
-	struct iovec iov[1];
-	iov[0].iov_base = const_cast<void *>(buffer);
-	iov[0].iov_len = length;
-
 	char buf[CMSG_SPACE(num * sizeof(uint32_t))];
 	memset(buf, 0, sizeof(buf));
 
@@ -258,8 +286,8 @@ int IPCUnixSocket::sendData(const void *buffer, size_t length,
 	struct msghdr msg;
 	msg.msg_name = nullptr;
 	msg.msg_namelen = 0;
-	msg.msg_iov = iov;
-	msg.msg_iovlen = 1;
+	msg.msg_iov = const_cast<struct iovec *>(iov.data());
+	msg.msg_iovlen = iov.size();
 	msg.msg_control = cmsg;
 	msg.msg_controllen = cmsg->cmsg_len;
 	msg.msg_flags = 0;
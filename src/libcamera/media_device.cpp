@@ -217,6 +217,7 @@ int MediaDevice::populate()
 
 	driver_ = info.driver;
 	model_ = info.model;
+	busInfo_ = info.bus_info;
 	version_ = info.media_version;
 	hwRevision_ = info.hw_revision;
 
@@ -302,6 +303,16 @@ done:
  * \return The MediaDevice model name
  */
 
+/**
+ * \fn MediaDevice::busInfo()
+ * \brief Retrieve the media device bus information
+ *
+ * The bus information identifies the location of the device in the system,
+ * such as the PCI or platform bus address of the device.
+ *
+ * \return The MediaDevice bus information
+ */
+
 /**
  * \fn MediaDevice::version()
  * \brief Retrieve the media device API version
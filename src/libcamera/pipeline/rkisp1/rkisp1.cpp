@@ -1202,6 +1202,13 @@ bool PipelineHandlerRkISP1::match(DeviceEnumerator *enumerator)
 	if (param_->open() < 0)
 		return false;
 
+	/*
+	 * Dequeue all completed stats and params buffers in a single event
+	 * loop iteration when the pipeline handler thread falls behind.
+	 */
+	stat_->setDequeueDrain(true);
+	param_->setDequeueDrain(true);
+
 	/* Locate and open the ISP main and self paths. */
 	if (!mainPath_.init(media_))
 		return false;
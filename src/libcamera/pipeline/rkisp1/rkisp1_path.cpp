@@ -75,6 +75,8 @@ bool RkISP1Path::init(MediaDevice *media)
 	if (video_->open() < 0)
 		return false;
 
+	video_->setDequeueDrain(true);
+
 	populateFormats();
 
 	link_ = media->link("rkisp1_isp", 2, resizer, 0);
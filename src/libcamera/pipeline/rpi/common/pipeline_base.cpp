@@ -1298,7 +1298,7 @@ void CameraData::metadataReady(const ControlList &metadata)
 void CameraData::setDelayedControls(const ControlList &controls, uint32_t delayContext)
 {
 	if (!delayedCtrls_->push(controls, delayContext))
-		LOG(RPI, Error) << "V4L2 DelayedControl set failed";
+		LOG_RATELIMITED(RPI, Error, 1s) << "V4L2 DelayedControl set failed";
 }
 
 void CameraData::setLensControls(const ControlList &controls)
@@ -225,20 +225,33 @@ const BufferObject &Stream::acquireBuffer()
 
 int Stream::queueAllBuffers()
 {
+	std::vector<FrameBuffer *> buffers;
 	int ret;
 
 	if ((flags_ & StreamFlag::External) || (flags_ & StreamFlag::Recurrent))
 		return 0;
 
+	buffers.reserve(availableBuffers_.size());
 	while (!availableBuffers_.empty()) {
-		ret = queueBuffer(availableBuffers_.front());
-		if (ret < 0)
-			return ret;
-
+		buffers.push_back(availableBuffers_.front());
 		availableBuffers_.pop();
 	}
 
-	return 0;
+	LOG(RPISTREAM, Debug) << "Queuing " << buffers.size()
+			      << " buffers for " << name_;
+
+	unsigned int queued;
+	ret = dev_->queueBuffers(buffers, &queued);
+	if (ret) {
+		LOG(RPISTREAM, Error) << "Failed to queue buffers for "
+				      << name_;
+
+		/* Keep the buffers that haven't been queued available. */
+		for (unsigned int i = queued; i < buffers.size(); ++i)
+			availableBuffers_.push(buffers[i]);
+	}
+
+	return ret;
 }
 
 void Stream::releaseBuffers()
@@ -95,6 +95,7 @@ public:
 		  dev_(std::make_unique<V4L2VideoDevice>(dev)), id_(0),
 		  swDownscale_(0)
 	{
+		dev_->setDequeueDrain(true);
 	}
 
 	void setFlags(StreamFlags flags);
@@ -1243,8 +1243,15 @@ int SimplePipelineHandler::start(Camera *camera, [[maybe_unused]] const ControlL
 		}
 
 		/* Queue all internal buffers for capture. */
+		std::vector<FrameBuffer *> buffers;
 		for (std::unique_ptr<FrameBuffer> &buffer : data->converterBuffers_)
-			video->queueBuffer(buffer.get());
+			buffers.push_back(buffer.get());
+
+		ret = video->queueBuffers(buffers);
+		if (ret < 0) {
+			stop(camera);
+			return ret;
+		}
 	}
 
 	return 0;
@@ -1473,6 +1480,8 @@ bool SimplePipelineHandler::match(DeviceEnumerator *enumerator)
 					<< ": " << strerror(-ret);
 				return false;
 			}
+
+			video->setDequeueDrain(true);
 			break;
 
 		case MediaEntity::Type::V4L2Subdevice:
@@ -52,6 +52,7 @@ public:
 	}
 
 	int init();
+	int initIPA();
 	int allocateMockIPABuffers();
 	void bufferReady(FrameBuffer *buffer);
 	void paramsBufferReady(unsigned int id, const Flags<ipa::vimc::TestFlag> flags);
@@ -98,6 +99,9 @@ public:
 
 	bool match(DeviceEnumerator *enumerator) override;
 
+protected:
+	int initializeDevice(Camera *camera) override;
+
 private:
 	int processControls(VimcCameraData *data, Request *request);
 
@@ -464,35 +468,29 @@ bool PipelineHandlerVimc::match(DeviceEnumerator *enumerator)
 	if (data->init())
 		return false;
 
-	data->ipa_ = IPAManager::createIPA<ipa::vimc::IPAProxyVimc>(this, 0, 0);
-	if (!data->ipa_) {
-		LOG(VIMC, Error) << "no matching IPA found";
+	/*
+	 * Loading the IPA isn't needed to register the camera, defer it to
+	 * the first acquire() in lazy initialization mode.
+	 */
+	bool initialized = !lazyCameraInit();
+	if (initialized && data->initIPA())
 		return false;
-	}
-
-	data->ipa_->paramsBufferReady.connect(data.get(), &VimcCameraData::paramsBufferReady);
-
-	std::string conf = data->ipa_->configurationFile("vimc.conf");
-	Flags<ipa::vimc::TestFlag> inFlags = ipa::vimc::TestFlag::Flag2;
-	Flags<ipa::vimc::TestFlag> outFlags;
-	data->ipa_->init(IPASettings{ conf, data->sensor_->model() },
-			 ipa::vimc::IPAOperationInit, inFlags, &outFlags);
-
-	LOG(VIMC, Debug)
-		<< "Flag 1 was "
-		<< (outFlags & ipa::vimc::TestFlag::Flag1 ? "" : "not ")
-		<< "set";
 
 	/* Create and register the camera. */
 	std::set<Stream *> streams{ &data->stream_ };
 	const std::string &id = data->sensor_->id();
 	std::shared_ptr<Camera> camera =
 		Camera::create(std::move(data), id, streams);
-	registerCamera(std::move(camera));
+	registerCamera(std::move(camera), initialized);
 
 	return true;
 }
 
+int PipelineHandlerVimc::initializeDevice(Camera *camera)
+{
+	return cameraData(camera)->initIPA();
+}
+
 int VimcCameraData::init()
 {
 	int ret;
@@ -575,6 +573,30 @@ int VimcCameraData::init()
 	return 0;
 }
 
+int VimcCameraData::initIPA()
+{
+	ipa_ = IPAManager::createIPA<ipa::vimc::IPAProxyVimc>(pipe(), 0, 0);
+	if (!ipa_) {
+		LOG(VIMC, Error) << "no matching IPA found";
+		return -ENOENT;
+	}
+
+	ipa_->paramsBufferReady.connect(this, &VimcCameraData::paramsBufferReady);
+
+	std::string conf = ipa_->configurationFile("vimc.conf");
+	Flags<ipa::vimc::TestFlag> inFlags = ipa::vimc::TestFlag::Flag2;
+	Flags<ipa::vimc::TestFlag> outFlags;
+	ipa_->init(IPASettings{ conf, sensor_->model() },
+		   ipa::vimc::IPAOperationInit, inFlags, &outFlags);
+
+	LOG(VIMC, Debug)
+		<< "Flag 1 was "
+		<< (outFlags & ipa::vimc::TestFlag::Flag1 ? "" : "not ")
+		<< "set";
+
+	return 0;
+}
+
 void VimcCameraData::bufferReady(FrameBuffer *buffer)
 {
 	PipelineHandlerVimc *pipe =
@@ -8,6 +8,7 @@
 #include "libcamera/internal/pipeline_handler.h"
 
 #include <chrono>
+#include <string.h>
 #include <sys/stat.h>
 #include <sys/sysmacros.h>
 
@@ -223,6 +224,70 @@ void PipelineHandler::releaseDevice([[maybe_unused]] Camera *camera)
 {
 }
 
+/**
+ * \brief Complete the deferred initialization of a camera
+ * \param[in] camera The camera to initialize
+ *
+ * This function completes the initialization of a camera whose initialization
+ * has been deferred by the pipeline handler at registration time, see
+ * registerCamera(). It calls initializeDevice() the first time the camera is
+ * acquired, and is a no-op for cameras that are already fully initialized.
+ * The time spent in initializeDevice() is logged, to report the cost that has
+ * been deferred from camera manager startup.
+ *
+ * Pipeline handlers shall not call this function directly as the Camera class
+ * handles initialization internally.
+ *
+ * \context This function shall be called from the pipeline handler thread.
+ *
+ * \return 0 on success or a negative error code otherwise
+ */
+int PipelineHandler::initialize(Camera *camera)
+{
+	Camera::Private *data = camera->_d();
+
+	if (data->initialized_)
+		return 0;
+
+	auto start = std::chrono::steady_clock::now();
+
+	int ret = initializeDevice(camera);
+	if (ret) {
+		LOG(Pipeline, Error)
+			<< "Failed to initialize camera " << camera->id()
+			<< ": " << strerror(-ret);
+		return ret;
+	}
+
+	auto end = std::chrono::steady_clock::now();
+
+	data->initialized_ = true;
+
+	LOG(Pipeline, Info)
+		<< "Deferred initialization of camera " << camera->id()
+		<< " took "
+		<< std::chrono::duration_cast<std::chrono::microseconds>(end - start).count()
+		<< " us";
+
+	return 0;
+}
+
+/**
+ * \brief Complete the initialization of a camera
+ * \param[in] camera The camera to initialize
+ *
+ * Pipeline handlers that register cameras with deferred initialization shall
+ * override this function to perform the initialization steps skipped at
+ * registration time, such as loading and initializing the IPA module. It is
+ * called once, when the camera is acquired for the first time.
+ *
+ * \return 0 on success or a negative error code otherwise
+ */
+int PipelineHandler::initializeDevice([[maybe_unused]] Camera *camera)
+{
+	return 0;
+}
+
 void PipelineHandler::unlockMediaDevices()
 {
 	for (std::shared_ptr<MediaDevice> &media : mediaDevices_)
@@ -595,16 +660,28 @@ std::string PipelineHandler::configurationFile(const std::string &subdir,
 /**
  * \brief Register a camera to the camera manager and pipeline handler
  * \param[in] camera The camera to be added
+ * \param[in] initialized Whether the camera has been fully initialized
  *
  * This function is called by pipeline handlers to register the cameras they
  * handle with the camera manager.
  *
+ * When lazy camera initialization is enabled, see lazyCameraInit(), pipeline
+ * handlers may register cameras with only the information required to expose
+ * their ID, properties, controls and streams, and set \a initialized to false.
+ * The remaining initialization is then performed by initializeDevice() when
+ * the camera is first acquired.
+ *
  * \context This function shall be called from the CameraManager thread.
  */
-void PipelineHandler::registerCamera(std::shared_ptr<Camera> camera)
+void PipelineHandler::registerCamera(std::shared_ptr<Camera> camera,
+				     bool initialized)
 {
 	cameras_.push_back(camera);
 
+	if (!initialized)
+		LOG(Pipeline, Debug)
+			<< "Deferring initialization of camera " << camera->id();
+
 	if (mediaDevices_.empty())
 		LOG(Pipeline, Fatal)
 			<< "Registering camera with no media devices!";
@@ -631,6 +708,7 @@ void PipelineHandler::registerCamera(std::shared_ptr<Camera> camera)
 	 */
 	Camera::Private *data = camera->_d();
 	data->properties_.set(properties::SystemDevices, devnums);
+	data->initialized_ = initialized;
 
 	manager_->_d()->addCamera(std::move(camera));
 }
@@ -652,6 +730,23 @@ void PipelineHandler::hotplugMediaDevice(MediaDevice *media)
 	media->disconnected.connect(this, [=]() { mediaDeviceDisconnected(media); });
 }
 
+/**
+ * \brief Check if lazy camera initialization is enabled
+ *
+ * Lazy camera initialization is enabled by setting the
+ * LIBCAMERA_LAZY_CAMERA_INIT environment variable to 1. When enabled, pipeline
+ * handlers should defer the initialization steps that are not needed to
+ * register the camera, such as IPA module loading and tuning file parsing, to
+ * initializeDevice(). This reduces the camera manager startup time when only
+ * a subset of the cameras is used.
+ *
+ * \return True if lazy camera initialization is enabled, false otherwise
+ */
+bool PipelineHandler::lazyCameraInit() const
+{
+	return manager_->_d()->lazyCameraInit();
+}
+
 /**
  * \brief Slot for the MediaDevice disconnected signal
  */
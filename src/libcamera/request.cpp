@@ -356,6 +356,15 @@ Request::Request(Camera *camera, uint64_t cookie)
 	 */
 	metadata_ = new ControlList(controls::controls);
 
+	/*
+	 * Allocate storage for the control values from the request arenas, to
+	 * avoid memory allocations when the request is reused. The controls
+	 * and metadata are accessed from different threads and use separate
+	 * arenas.
+	 */
+	_d()->controlsArena_.attach(controls_);
+	_d()->metadataArena_.attach(metadata_);
+
 	LIBCAMERA_TRACEPOINT(request_construct, this);
 
 	LOG(Request, Debug) << "Created request - cookie: " << cookie_;
@@ -378,6 +387,10 @@ Request::~Request()
  * prior to queueing the request to the camera, in lieu of constructing a new
  * request. The application can reuse the buffers that were previously added
  * to the request via addBuffer() by setting \a flags to ReuseBuffers.
+ *
+ * The memory used to store the values of the request controls and metadata is
+ * recycled, references to values retrieved from the request before calling this
+ * function become invalid.
  */
 void Request::reuse(ReuseFlag flags)
 {
@@ -399,6 +412,8 @@ void Request::reuse(ReuseFlag flags)
 
 	controls_->clear();
 	metadata_->clear();
+	_d()->controlsArena_.reset();
+	_d()->metadataArena_.reset();
 }
 
 /**
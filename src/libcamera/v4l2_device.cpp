@@ -197,7 +197,7 @@ ControlList V4L2Device::getControls(const std::vector<uint32_t> &ids)
 	memset(v4l2Ctrls.data(), 0, sizeof(v4l2_ext_control) * ctrls.size());
 
 	unsigned int i = 0;
-	for (auto &ctrl : ctrls) {
+	for (auto ctrl : ctrls) {
 		unsigned int id = ctrl.first;
 		const struct v4l2_query_ext_ctrl &info = controlInfo_[id];
 
@@ -0,0 +1,382 @@
+/* SPDX-License-Identifier: LGPL-2.1-or-later */
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * v4l2_format_cache.cpp - Persistent cache of V4L2 format enumeration results
+ */
+
+#include "libcamera/internal/v4l2_format_cache.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <iomanip>
+#include <sstream>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+
+#include <libcamera/base/file.h>
+#include <libcamera/base/log.h>
+#include <libcamera/base/unique_fd.h>
+
+#include "libcamera/internal/byte_stream_buffer.h"
+#include "libcamera/internal/media_device.h"
+#include "libcamera/internal/media_object.h"
+
+/**
+ * \file v4l2_format_cache.h
+ * \brief Persistent cache of V4L2 format enumeration results
+ */
+
+namespace libcamera {
+
+LOG_DECLARE_CATEGORY(V4L2)
+
+namespace {
+
+constexpr char kMagic[8] = { 'L', 'C', 'V', '4', 'L', 'F', 'C', '1' };
+
+struct CacheHeader {
+	char magic[8];
+	uint32_t count;
+	uint32_t kernelLength;
+};
+
+struct CacheSizeRange {
+	uint32_t minWidth;
+	uint32_t minHeight;
+	uint32_t maxWidth;
+	uint32_t maxHeight;
+	uint32_t hStep;
+	uint32_t vStep;
+};
+
+std::string kernelVersion()
+{
+	struct utsname name;
+
+	if (uname(&name) < 0)
+		return {};
+
+	return std::string(name.release) + " " + name.version;
+}
+
+/* 64-bit FNV-1a, used to detect changes of the media graph topology. */
+uint64_t hashString(const std::string &str, uint64_t hash = 0xcbf29ce484222325ULL)
+{
+	for (char c : str) {
+		hash ^= static_cast<uint8_t>(c);
+		hash *= 0x100000001b3ULL;
+	}
+
+	return hash;
+}
+
+} /* namespace */
+
+/**
+ * \class V4L2FormatCache
+ * \brief Persistent cache of V4L2 format enumeration results
+ *
+ * Enumerating the formats supported by V4L2 video devices and subdevices
+ * requires one ioctl per format and per frame size, which adds up to hundreds
+ * of ioctls per camera when the camera manager starts. The V4L2FormatCache
+ * stores the enumeration results in a file, and V4L2VideoDevice::formats()
+ * and V4L2Subdevice::formats() retrieve them from the cache when one has been
+ * created.
+ *
+ * Cache entries are keyed by the driver name, model, bus information and
+ * hardware revision of the media device, a hash of the names of all entities
+ * in the media graph, and the name of the entity the formats have been
+ * enumerated on. The whole cache is discarded when the kernel version changes.
+ * Validating the cache thus doesn't require any ioctl beyond the ones needed
+ * to enumerate media devices.
+ *
+ * Only the format enumeration results are cached. Control information is
+ * always queried from the device, as the control limits depend on the device
+ * state, such as the sensor format, which can be modified by other users.
+ *
+ * A single instance of the cache can exist at a time. It is created by the
+ * CameraManager when the LIBCAMERA_V4L2_FORMAT_CACHE environment variable is
+ * set.
+ */
+
+V4L2FormatCache *V4L2FormatCache::self_ = nullptr;
+
+/**
+ * \typedef V4L2FormatCache::Formats
+ * \brief A map of format codes to supported frame size ranges
+ *
+ * The format codes are V4L2 pixel formats for video devices and media bus
+ * codes for subdevices.
+ */
+
+/**
+ * \brief Construct a V4L2FormatCache
+ * \param[in] path The path to the cache file
+ *
+ * The cache is empty after construction, call load() to populate it from the
+ * cache file.
+ */
+V4L2FormatCache::V4L2FormatCache(const std::string &path)
+	: path_(path), kernel_(kernelVersion()), dirty_(false)
+{
+	if (self_)
+		LOG(V4L2, Fatal)
+			<< "Multiple V4L2FormatCache objects are not allowed";
+
+	self_ = this;
+}
+
+V4L2FormatCache::~V4L2FormatCache()
+{
+	self_ = nullptr;
+}
+
+/**
+ * \fn V4L2FormatCache::instance()
+ * \brief Retrieve the format cache instance
+ * \return The format cache instance, or nullptr if no cache has been created
+ */
+
+/**
+ * \fn V4L2FormatCache::path()
+ * \brief Retrieve the path to the cache file
+ * \return The path to the cache file
+ */
+
+/**
+ * \fn V4L2FormatCache::isDirty()
+ * \brief Check if the cache has been modified since it was loaded or saved
+ * \return True if the cache needs to be saved, false otherwise
+ */
+
+/**
+ * \brief Load the cache from the cache file
+ *
+ * Entries loaded from a cache file that is missing, invalid or created with a
+ * different kernel version are discarded.
+ *
+ * \return 0 on success or a negative error code otherwise
+ */
+int V4L2FormatCache::load()
+{
+	entries_.clear();
+	dirty_ = false;
+
+	File file{ path_ };
+	if (!file.open(File::OpenModeFlag::ReadOnly))
+		return file.error();
+
+	Span<const uint8_t> data = file.map(0, -1, File::MapFlag::Private);
+	ByteStreamBuffer buffer(data.data(), data.size());
+
+	CacheHeader header;
+	const char *kernel = nullptr;
+	if (!buffer.read(&header) && !memcmp(header.magic, kMagic, sizeof(kMagic)))
+		kernel = buffer.read<char>(header.kernelLength);
+
+	if (!kernel || std::string(kernel, header.kernelLength) != kernel_) {
+		LOG(V4L2, Debug) << "Discarding stale V4L2 format cache";
+		dirty_ = true;
+		return 0;
+	}
+
+	for (uint32_t i = 0; i < header.count; ++i) {
+		uint32_t keyLength = 0;
+		uint32_t formatCount = 0;
+
+		buffer.read(&keyLength);
+		const char *key = buffer.read<char>(keyLength);
+		buffer.read(&formatCount);
+
+		Formats formats;
+
+		for (uint32_t j = 0; j < formatCount && !buffer.overflow(); ++j) {
+			uint32_t code = 0;
+			uint32_t sizeCount = 0;
+
+			buffer.read(&code);
+			buffer.read(&sizeCount);
+			const CacheSizeRange *sizes = buffer.read<CacheSizeRange>(sizeCount);
+			if (!sizes)
+				break;
+
+			std::vector<SizeRange> &ranges = formats[code];
+			for (uint32_t k = 0; k < sizeCount; ++k) {
+				const CacheSizeRange &size = sizes[k];
+				ranges.emplace_back(Size(size.minWidth, size.minHeight),
+						    Size(size.maxWidth, size.maxHeight),
+						    size.hStep, size.vStep);
+			}
+		}
+
+		if (buffer.overflow() || !key) {
+			LOG(V4L2, Warning) << "Invalid V4L2 format cache " << path_;
+			entries_.clear();
+			dirty_ = true;
+			return -EINVAL;
+		}
+
+		entries_[std::string(key, keyLength)] = std::move(formats);
+	}
+
+	LOG(V4L2, Debug)
+		<< "Loaded " << entries_.size() << " entries from V4L2 format cache "
+		<< path_;
+
+	return 0;
+}
+
+/**
+ * \brief Save the cache to the cache file
+ *
+ * The cache file is replaced atomically.
+ *
+ * \return 0 on success or a negative error code otherwise
+ */
+int V4L2FormatCache::save()
+{
+	CacheHeader header;
+	memcpy(header.magic, kMagic, sizeof(kMagic));
+	header.count = entries_.size();
+	header.kernelLength = kernel_.size();
+
+	size_t size = sizeof(header) + kernel_.size();
+	for (const auto &[key, formats] : entries_) {
+		size += sizeof(uint32_t) * 2 + key.size();
+		for (const auto &[code, sizes] : formats)
+			size += sizeof(uint32_t) * 2 + sizes.size() * sizeof(CacheSizeRange);
+	}
+
+	std::vector<uint8_t> data(size);
+	ByteStreamBuffer buffer(data.data(), data.size());
+
+	buffer.write(&header);
+	buffer.write(Span<const char>(kernel_.data(), kernel_.size()));
+
+	for (const auto &[key, formats] : entries_) {
+		uint32_t keyLength = key.size();
+		uint32_t formatCount = formats.size();
+
+		buffer.write(&keyLength);
+		buffer.write(Span<const char>(key.data(), key.size()));
+		buffer.write(&formatCount);
+
+		for (const auto &[code, sizes] : formats) {
+			uint32_t sizeCount = sizes.size();
+
+			buffer.write(&code);
+			buffer.write(&sizeCount);
+
+			for (const SizeRange &range : sizes) {
+				CacheSizeRange cached = {
+					range.min.width, range.min.height,
+					range.max.width, range.max.height,
+					range.hStep, range.vStep,
+				};
+				buffer.write(&cached);
+			}
+		}
+	}
+
+	std::string tmpPath = path_ + ".tmp";
+	UniqueFD fd(open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+			 S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH));
+	if (!fd.isValid()) {
+		int ret = -errno;
+		LOG(V4L2, Warning)
+			<< "Failed to create V4L2 format cache " << tmpPath
+			<< ": " << strerror(-ret);
+		return ret;
+	}
+
+	ssize_t ret = write(fd.get(), data.data(), data.size());
+	if (ret != static_cast<ssize_t>(data.size()) ||
+	    rename(tmpPath.c_str(), path_.c_str()) < 0) {
+		ret = ret < 0 ? -errno : -EIO;
+		LOG(V4L2, Warning)
+			<< "Failed to write V4L2 format cache " << path_;
+		unlink(tmpPath.c_str());
+		return ret;
+	}
+
+	dirty_ = false;
+
+	return 0;
+}
+
+/**
+ * \brief Invalidate the cache
+ *
+ * Drop all cache entries and remove the cache file. The cache is repopulated
+ * as formats are enumerated.
+ */
+void V4L2FormatCache::invalidate()
+{
+	entries_.clear();
+	unlink(path_.c_str());
+	dirty_ = true;
+}
+
+/**
+ * \brief Compute the cache key for formats enumerated on a media entity
+ * \param[in] entity The media entity
+ * \param[in] type The type of enumeration
+ * \param[in] index The index of the enumeration, such as a pad number
+ *
+ * The \a type and \a index identify which enumeration results are stored for
+ * \a entity, for instance the formats supported on a subdevice pad, or the
+ * pixel formats supported by a video device for a media bus code.
+ *
+ * \return The cache key
+ */
+std::string V4L2FormatCache::key(const MediaEntity *entity, const char *type,
+				 unsigned int index)
+{
+	const MediaDevice *media = entity->device();
+
+	uint64_t topology = 0xcbf29ce484222325ULL;
+	for (const MediaEntity *e : media->entities())
+		topology = hashString(e->name() + '\n', topology);
+
+	std::stringstream ss;
+	ss << media->driver() << "|" << media->model() << "|"
+	   << media->busInfo() << "|" << media->hwRevision() << "|"
+	   << std::hex << std::setw(16) << std::setfill('0') << topology << "|"
+	   << entity->name() << "|" << type << ":" << std::dec << index;
+
+	return ss.str();
+}
+
+/**
+ * \brief Retrieve cached formats
+ * \param[in] key The cache key, as computed by key()
+ *
+ * The returned pointer is valid until the cache is modified.
+ *
+ * \return The cached formats, or nullptr if no formats are cached for \a key
+ */
+const V4L2FormatCache::Formats *V4L2FormatCache::formats(const std::string &key) const
+{
+	auto iter = entries_.find(key);
+	if (iter == entries_.end())
+		return nullptr;
+
+	return &iter->second;
+}
+
+/**
+ * \brief Store formats in the cache
+ * \param[in] key The cache key, as computed by key()
+ * \param[in] formats The enumerated formats
+ */
+void V4L2FormatCache::setFormats(const std::string &key, const Formats &formats)
+{
+	entries_[key] = formats;
+	dirty_ = true;
+}
+
+} /* namespace libcamera */
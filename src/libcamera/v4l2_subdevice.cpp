@@ -26,6 +26,7 @@
 #include "libcamera/internal/formats.h"
 #include "libcamera/internal/media_device.h"
 #include "libcamera/internal/media_object.h"
+#include "libcamera/internal/v4l2_format_cache.h"
 
 /**
  * \file v4l2_subdevice.h
@@ -466,6 +467,16 @@ V4L2Subdevice::Formats V4L2Subdevice::formats(unsigned int pad)
 		return {};
 	}
 
+	V4L2FormatCache *cache = V4L2FormatCache::instance();
+	std::string key;
+
+	if (cache) {
+		key = V4L2FormatCache::key(entity_, "pad", pad);
+		const V4L2FormatCache::Formats *cached = cache->formats(key);
+		if (cached)
+			return *cached;
+	}
+
 	for (unsigned int code : enumPadCodes(pad)) {
 		std::vector<SizeRange> sizes = enumPadSizes(pad, code);
 		if (sizes.empty())
@@ -480,6 +491,9 @@ V4L2Subdevice::Formats V4L2Subdevice::formats(unsigned int pad)
 		}
 	}
 
+	if (cache)
+		cache->setFormats(key, formats);
+
 	return formats;
 }
 
@@ -31,6 +31,9 @@
 #include "libcamera/internal/framebuffer.h"
 #include "libcamera/internal/media_device.h"
 #include "libcamera/internal/media_object.h"
+#include "libcamera/internal/v4l2_format_cache.h"
+
+using namespace std::chrono_literals;
 
 /**
  * \file v4l2_videodevice.h
@@ -162,6 +165,32 @@ LOG_DECLARE_CATEGORY(V4L2)
  * index associations to help selecting V4L2 buffers. It tracks, for every
  * entry, if the V4L2 buffer is in use, and offers lookup of the best free V4L2
  * buffer for a set of dmabufs.
+ *
+ * Entries are indexed by a hash of the identity of their dmabufs, made of the
+ * dmabuf inode, offset and length of each plane, and free entries are kept in
+ * a list ordered by release time. Both lookup and selection of the least
+ * recently used free entry thus run in constant time.
+ *
+ * The cache counts hits, misses, and evictions of a previous association to
+ * reuse an entry for different dmabufs. As every eviction causes the kernel to
+ * unmap and map dmabufs again, those counters help detecting inefficient buffer
+ * usage patterns, see statistics().
+ */
+
+/**
+ * \struct V4L2BufferCache::Statistics
+ * \brief Usage statistics of a V4L2BufferCache
+ *
+ * \var V4L2BufferCache::Statistics::hits
+ * \brief Number of lookups that found a free V4L2 buffer previously used with
+ * the same dmabufs
+ *
+ * \var V4L2BufferCache::Statistics::misses
+ * \brief Number of lookups that didn't find a matching free V4L2 buffer
+ *
+ * \var V4L2BufferCache::Statistics::evictions
+ * \brief Number of misses that replaced the association of a V4L2 buffer with
+ * different dmabufs
  */
 
 /**
@@ -173,9 +202,11 @@ LOG_DECLARE_CATEGORY(V4L2)
  * buffer import, with buffers added to the cache as they are queued.
  */
 V4L2BufferCache::V4L2BufferCache(unsigned int numEntries)
-	: lastUsedCounter_(1), missCounter_(0)
+	: cache_(numEntries), freeHead_(kNoEntry), freeTail_(kNoEntry),
+	  used_(0), stats_{}
 {
-	cache_.resize(numEntries);
+	for (unsigned int index = 0; index < cache_.size(); index++)
+		release(index);
 }
 
 /**
@@ -187,18 +218,25 @@ V4L2BufferCache::V4L2BufferCache(unsigned int numEntries)
  * allocated.
  */
 V4L2BufferCache::V4L2BufferCache(const std::vector<std::unique_ptr<FrameBuffer>> &buffers)
-	: lastUsedCounter_(1), missCounter_(0)
+	: cache_(buffers.size()), freeHead_(kNoEntry), freeTail_(kNoEntry),
+	  used_(0), stats_{}
 {
-	for (const std::unique_ptr<FrameBuffer> &buffer : buffers)
-		cache_.emplace_back(true,
-				    lastUsedCounter_.fetch_add(1, std::memory_order_acq_rel),
-				    *buffer.get());
+	for (unsigned int index = 0; index < cache_.size(); index++) {
+		uint64_t key = Entry::hash(*buffers[index]);
+
+		cache_[index].set(*buffers[index], key);
+		index_.emplace(key, index);
+		release(index);
+	}
 }
 
 V4L2BufferCache::~V4L2BufferCache()
 {
-	if (missCounter_ > cache_.size())
-		LOG(V4L2, Debug) << "Cache misses: " << missCounter_;
+	if (stats_.misses > cache_.size())
+		LOG(V4L2, Debug)
+			<< "Cache hits: " << stats_.hits
+			<< ", misses: " << stats_.misses
+			<< ", evictions: " << stats_.evictions;
 }
 
 /**
@@ -206,12 +244,7 @@ V4L2BufferCache::~V4L2BufferCache()
  */
 bool V4L2BufferCache::isEmpty() const
 {
-	for (auto const &entry : cache_) {
-		if (!entry.free_)
-			return false;
-	}
-
-	return true;
+	return used_ == 0;
 }
 
 /**
@@ -221,48 +254,54 @@ bool V4L2BufferCache::isEmpty() const
  * Find the best V4L2 buffer index to be used for the FrameBuffer \a buffer
  * based on previous mappings of frame buffers to V4L2 buffers. If a free V4L2
  * buffer previously used with the same dmabufs as \a buffer is found in the
- * cache, return its index. Otherwise return the index of the first free V4L2
- * buffer and record its association with the dmabufs of \a buffer.
+ * cache, return its index. Otherwise return the index of the least recently
+ * released free V4L2 buffer and record its association with the dmabufs of
+ * \a buffer.
  *
  * \return The index of the best V4L2 buffer, or -ENOENT if no free V4L2 buffer
  * is available
  */
 int V4L2BufferCache::get(const FrameBuffer &buffer)
 {
-	bool hit = false;
-	int use = -1;
-	uint64_t oldest = UINT64_MAX;
+	uint64_t key = Entry::hash(buffer);
 
-	for (unsigned int index = 0; index < cache_.size(); index++) {
+	auto [begin, end] = index_.equal_range(key);
+	for (auto it = begin; it != end; ++it) {
+		unsigned int index = it->second;
 		const Entry &entry = cache_[index];
 
-		if (!entry.free_)
-			continue;
-
-		/* Try to find a cache hit by comparing the planes. */
-		if (entry == buffer) {
-			hit = true;
-			use = index;
-			break;
-		}
-
-		if (entry.lastUsed_ < oldest) {
-			use = index;
-			oldest = entry.lastUsed_;
+		if (entry.free_ && entry == buffer) {
+			stats_.hits++;
+			take(index);
+			return index;
 		}
 	}
 
-	if (!hit)
-		missCounter_++;
+	stats_.misses++;
 
-	if (use < 0)
+	if (freeHead_ == kNoEntry)
 		return -ENOENT;
 
-	cache_[use] = Entry(false,
-			    lastUsedCounter_.fetch_add(1, std::memory_order_acq_rel),
-			    buffer);
+	unsigned int index = freeHead_;
+	Entry &entry = cache_[index];
+
+	if (entry.isValid()) {
+		stats_.evictions++;
+
+		auto [first, last] = index_.equal_range(entry.key_);
+		for (auto it = first; it != last; ++it) {
+			if (it->second == index) {
+				index_.erase(it);
+				break;
+			}
+		}
+	}
 
-	return use;
+	entry.set(buffer, key);
+	index_.emplace(key, index);
+	take(index);
+
+	return index;
 }
 
 /**
@@ -272,19 +311,89 @@ int V4L2BufferCache::get(const FrameBuffer &buffer)
 void V4L2BufferCache::put(unsigned int index)
 {
 	ASSERT(index < cache_.size());
-	cache_[index].free_ = true;
+
+	if (cache_[index].free_)
+		return;
+
+	release(index);
+}
+
+/**
+ * \fn V4L2BufferCache::statistics()
+ * \brief Retrieve the cache usage statistics
+ * \return The cache usage statistics
+ */
+
+/* Remove the free entry at \a index from the free list and mark it as used. */
+void V4L2BufferCache::take(unsigned int index)
+{
+	Entry &entry = cache_[index];
+
+	if (entry.prev_ != kNoEntry)
+		cache_[entry.prev_].next_ = entry.next_;
+	else
+		freeHead_ = entry.next_;
+
+	if (entry.next_ != kNoEntry)
+		cache_[entry.next_].prev_ = entry.prev_;
+	else
+		freeTail_ = entry.prev_;
+
+	entry.free_ = false;
+	used_++;
+}
+
+/* Mark the entry at \a index as free and append it to the free list. */
+void V4L2BufferCache::release(unsigned int index)
+{
+	Entry &entry = cache_[index];
+
+	entry.prev_ = freeTail_;
+	entry.next_ = kNoEntry;
+
+	if (freeTail_ != kNoEntry)
+		cache_[freeTail_].next_ = index;
+	else
+		freeHead_ = index;
+
+	freeTail_ = index;
+
+	if (!entry.free_)
+		used_--;
+
+	entry.free_ = true;
 }
 
 V4L2BufferCache::Entry::Entry()
-	: free_(true), lastUsed_(0)
+	: free_(true), key_(0), prev_(kNoEntry), next_(kNoEntry)
+{
+}
+
+uint64_t V4L2BufferCache::Entry::hash(const FrameBuffer &buffer)
 {
+	const std::vector<FrameBuffer::Plane> &planes = buffer.planes();
+	uint64_t key = planes.size();
+
+	for (unsigned int i = 0; i < planes.size(); i++) {
+		for (uint64_t value : { static_cast<uint64_t>(buffer._d()->inode(i)),
+					static_cast<uint64_t>(planes[i].offset),
+					static_cast<uint64_t>(planes[i].length) })
+			key ^= value + 0x9e3779b97f4a7c15ULL + (key << 6) + (key >> 2);
+	}
+
+	return key;
 }
 
-V4L2BufferCache::Entry::Entry(bool free, uint64_t lastUsed, const FrameBuffer &buffer)
-	: free_(free), lastUsed_(lastUsed)
+void V4L2BufferCache::Entry::set(const FrameBuffer &buffer, uint64_t key)
 {
-	for (const FrameBuffer::Plane &plane : buffer.planes())
-		planes_.emplace_back(plane);
+	const std::vector<FrameBuffer::Plane> &planes = buffer.planes();
+
+	planes_.resize(planes.size());
+	for (unsigned int i = 0; i < planes.size(); i++)
+		planes_[i] = { buffer._d()->inode(i), planes[i].offset,
+			       planes[i].length };
+
+	key_ = key;
 }
 
 bool V4L2BufferCache::Entry::operator==(const FrameBuffer &buffer) const
@@ -295,7 +404,8 @@ bool V4L2BufferCache::Entry::operator==(const FrameBuffer &buffer) const
 		return false;
 
 	for (unsigned int i = 0; i < planes.size(); i++)
-		if (planes_[i].fd != planes[i].fd.get() ||
+		if (planes_[i].inode != buffer._d()->inode(i) ||
+		    planes_[i].offset != planes[i].offset ||
 		    planes_[i].length != planes[i].length)
 			return false;
 	return true;
@@ -533,9 +643,9 @@ std::ostream &operator<<(std::ostream &out, const V4L2DeviceFormat &f)
  * \param[in] deviceNode The file-system path to the video device node
  */
 V4L2VideoDevice::V4L2VideoDevice(const std::string &deviceNode)
-	: V4L2Device(deviceNode), formatInfo_(nullptr), cache_(nullptr),
-	  fdBufferNotifier_(nullptr), state_(State::Stopped),
-	  watchdogDuration_(0.0)
+	: V4L2Device(deviceNode), entity_(nullptr), formatInfo_(nullptr), cache_(nullptr),
+	  fdBufferNotifier_(nullptr), drain_(false), dequeueStats_({}),
+	  state_(State::Stopped), watchdogDuration_(0.0)
 {
 	/*
 	 * We default to an MMAP based CAPTURE video device, however this will
@@ -554,6 +664,7 @@ V4L2VideoDevice::V4L2VideoDevice(const std::string &deviceNode)
 V4L2VideoDevice::V4L2VideoDevice(const MediaEntity *entity)
 	: V4L2VideoDevice(entity->deviceNode())
 {
+	entity_ = entity;
 	watchdog_.timeout.connect(this, &V4L2VideoDevice::watchdogExpired);
 }
 
@@ -1077,7 +1188,19 @@ int V4L2VideoDevice::trySetFormatSingleplane(V4L2DeviceFormat *format, bool set)
  */
 V4L2VideoDevice::Formats V4L2VideoDevice::formats(uint32_t code)
 {
+	V4L2FormatCache *cache = entity_ ? V4L2FormatCache::instance() : nullptr;
 	Formats formats;
+	std::string key;
+
+	if (cache) {
+		key = V4L2FormatCache::key(entity_, "code", code);
+		const V4L2FormatCache::Formats *cached = cache->formats(key);
+		if (cached) {
+			for (const auto &[fourcc, sizes] : *cached)
+				formats.emplace(V4L2PixelFormat(fourcc), sizes);
+			return formats;
+		}
+	}
 
 	for (V4L2PixelFormat pixelFormat : enumPixelformats(code)) {
 		std::vector<SizeRange> sizes = enumSizes(pixelFormat);
@@ -1094,6 +1217,13 @@ V4L2VideoDevice::Formats V4L2VideoDevice::formats(uint32_t code)
 		formats.emplace(pixelFormat, sizes);
 	}
 
+	if (cache) {
+		V4L2FormatCache::Formats cached;
+		for (const auto &[pixelFormat, sizes] : formats)
+			cached.emplace(pixelFormat.fourcc(), sizes);
+		cache->setFormats(key, cached);
+	}
+
 	return formats;
 }
 
@@ -1563,9 +1693,32 @@ int V4L2VideoDevice::releaseBuffers()
  */
 int V4L2VideoDevice::queueBuffer(FrameBuffer *buffer)
 {
-	struct v4l2_plane v4l2Planes[VIDEO_MAX_PLANES] = {};
-	struct v4l2_buffer buf = {};
-	int ret;
+	return queueBuffers({ &buffer, 1 });
+}
+
+/**
+ * \brief Queue multiple buffers to the video device
+ * \param[in] buffers The buffers to be queued
+ * \param[out] queued The number of buffers that have been queued
+ *
+ * This function queues all \a buffers to the device in order, as if
+ * queueBuffer() was called for each of them. The device state is checked, and
+ * the buffer completion notifier and dequeue watchdog are armed, once for the
+ * whole batch. It should be preferred over queueBuffer() when multiple buffers
+ * are queued to the same device at once, for instance when starting a stream.
+ *
+ * If queuing a buffer fails, the buffers that precede it in \a buffers stay
+ * queued, and the buffers that follow it are not queued. When \a queued is
+ * not null, it is set to the number of buffers that have been queued, allowing
+ * the caller to reclaim the buffers that haven't.
+ *
+ * \return 0 on success or a negative error code otherwise
+ */
+int V4L2VideoDevice::queueBuffers(Span<FrameBuffer *const> buffers,
+				  unsigned int *queued)
+{
+	if (queued)
+		*queued = 0;
 
 	if (state_ == State::Stopping) {
 		LOG(V4L2, Error) << "Device is in a stopping state.";
@@ -1582,6 +1735,33 @@ int V4L2VideoDevice::queueBuffer(FrameBuffer *buffer)
 		return -ENOENT;
 	}
 
+	bool wasIdle = queuedBuffers_.empty();
+	int ret = 0;
+
+	for (FrameBuffer *buffer : buffers) {
+		ret = doQueueBuffer(buffer);
+		if (ret < 0)
+			break;
+
+		if (queued)
+			(*queued)++;
+	}
+
+	if (wasIdle && !queuedBuffers_.empty()) {
+		fdBufferNotifier_->setEnabled(true);
+		if (watchdogDuration_)
+			watchdog_.start(std::chrono::duration_cast<std::chrono::milliseconds>(watchdogDuration_));
+	}
+
+	return ret;
+}
+
+int V4L2VideoDevice::doQueueBuffer(FrameBuffer *buffer)
+{
+	struct v4l2_plane v4l2Planes[VIDEO_MAX_PLANES] = {};
+	struct v4l2_buffer buf = {};
+	int ret;
+
 	ret = cache_->get(*buffer);
 	if (ret < 0)
 		return ret;
@@ -1700,12 +1880,6 @@ int V4L2VideoDevice::queueBuffer(FrameBuffer *buffer)
 		return ret;
 	}
 
-	if (queuedBuffers_.empty()) {
-		fdBufferNotifier_->setEnabled(true);
-		if (watchdogDuration_)
-			watchdog_.start(std::chrono::duration_cast<std::chrono::milliseconds>(watchdogDuration_));
-	}
-
 	queuedBuffers_[buf.index] = buffer;
 
 	return 0;
@@ -1717,17 +1891,27 @@ int V4L2VideoDevice::queueBuffer(FrameBuffer *buffer)
  * When this slot is called, a Buffer has become available from the device, and
  * will be emitted through the bufferReady Signal.
  *
+ * In drain mode, all the buffers that are ready are dequeued and emitted in
+ * order in a single call. The bufferReady handlers may requeue buffers or
+ * stop the stream, so the device state is checked before every dequeue.
+ *
  * For Capture video devices the FrameBuffer will contain valid data.
  * For Output video devices the FrameBuffer can be considered empty.
  */
 void V4L2VideoDevice::bufferAvailable()
 {
-	FrameBuffer *buffer = dequeueBuffer();
-	if (!buffer)
-		return;
+	dequeueStats_.wakeups++;
+
+	do {
+		FrameBuffer *buffer = dequeueBuffer();
+		if (!buffer)
+			return;
 
-	/* Notify anyone listening to the device. */
-	bufferReady.emit(buffer);
+		dequeueStats_.buffers++;
+
+		/* Notify anyone listening to the device. */
+		bufferReady.emit(buffer);
+	} while (drain_ && state_ == State::Streaming && !queuedBuffers_.empty());
 }
 
 /**
@@ -1756,8 +1940,10 @@ FrameBuffer *V4L2VideoDevice::dequeueBuffer()
 
 	ret = ioctl(VIDIOC_DQBUF, &buf);
 	if (ret < 0) {
-		LOG(V4L2, Error)
-			<< "Failed to dequeue buffer: " << strerror(-ret);
+		/* Running out of buffers is expected when draining the queue. */
+		if (ret != -EAGAIN)
+			LOG(V4L2, Error)
+				<< "Failed to dequeue buffer: " << strerror(-ret);
 		return nullptr;
 	}
 
@@ -1891,6 +2077,51 @@ FrameBuffer *V4L2VideoDevice::dequeueBuffer()
  * \brief A Signal emitted when a framebuffer completes
  */
 
+/**
+ * \brief Retrieve the usage statistics of the V4L2 buffer cache
+ *
+ * The V4L2 buffer cache associates the dmabufs of the frame buffers queued to
+ * the device with V4L2 buffers. A high number of evictions indicates that the
+ * dmabufs are mapped again by the kernel on a regular basis, typically because
+ * more frame buffers are cycled through the device than the number of V4L2
+ * buffers allocated with allocateBuffers(), exportBuffers() or
+ * importBuffers().
+ *
+ * The statistics are reset when buffers are allocated, exported or imported.
+ *
+ * \return The usage statistics of the buffer cache, or zeroed statistics if
+ * no buffers have been set up
+ */
+V4L2BufferCache::Statistics V4L2VideoDevice::bufferCacheStatistics() const
+{
+	if (!cache_)
+		return {};
+
+	return cache_->statistics();
+}
+
+/**
+ * \struct V4L2VideoDevice::DequeueStatistics
+ * \brief Buffer dequeue statistics of a video device
+ *
+ * \var V4L2VideoDevice::DequeueStatistics::wakeups
+ * \brief Number of times the event loop woke up to dequeue buffers
+ *
+ * \var V4L2VideoDevice::DequeueStatistics::buffers
+ * \brief Number of buffers dequeued and emitted through bufferReady
+ */
+
+/**
+ * \fn V4L2VideoDevice::dequeueStatistics()
+ * \brief Retrieve the buffer dequeue statistics
+ *
+ * The ratio between the number of wakeups and the number of dequeued buffers
+ * measures how many round trips through the event loop are needed per frame.
+ * The statistics are reset when the stream is started.
+ *
+ * \return The buffer dequeue statistics since the stream was last started
+ */
+
 /**
  * \brief Start the video stream
  * \return 0 on success or a negative error code otherwise
@@ -1900,6 +2131,7 @@ int V4L2VideoDevice::streamOn()
 	int ret;
 
 	firstFrame_.reset();
+	dequeueStats_ = {};
 
 	ret = ioctl(VIDIOC_STREAMON, &bufferType_);
 	if (ret < 0) {
@@ -1991,6 +2223,22 @@ void V4L2VideoDevice::setDequeueTimeout(utils::Duration timeout)
 		watchdog_.start(std::chrono::duration_cast<std::chrono::milliseconds>(timeout));
 }
 
+/**
+ * \fn V4L2VideoDevice::setDequeueDrain()
+ * \brief Enable or disable draining of the buffer queue
+ * \param[in] drain True to enable drain mode, false to disable it
+ *
+ * By default a single buffer is dequeued each time the device signals buffer
+ * completion, and the event loop has to go through one iteration for every
+ * completed buffer. When drain mode is enabled, all the completed buffers are
+ * dequeued in a single event loop iteration and the bufferReady signal is
+ * emitted for each of them in completion order.
+ *
+ * Drain mode reduces the number of event loop wakeups per frame when buffers
+ * complete faster than the event loop handles them, for instance when the
+ * thread is busy processing other devices. The mode can be changed at any time.
+ */
+
 /**
  * \var V4L2VideoDevice::dequeueTimeout
  * \brief A Signal emitted when the dequeue watchdog timer expires
@@ -2004,7 +2252,7 @@ void V4L2VideoDevice::setDequeueTimeout(utils::Duration timeout)
  */
 void V4L2VideoDevice::watchdogExpired()
 {
-	LOG(V4L2, Warning)
+	LOG_RATELIMITED(V4L2, Warning, 1s)
 		<< "Dequeue timer of " << watchdogDuration_ << " has expired!";
 
 	dequeueTimeout.emit();
@@ -0,0 +1,127 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * libcamera lazy camera initialization test
+ */
+
+#include <iostream>
+#include <stdlib.h>
+
+#include <libcamera/camera.h>
+#include <libcamera/camera_manager.h>
+#include <libcamera/framebuffer_allocator.h>
+#include <libcamera/property_ids.h>
+
+#include "test.h"
+
+using namespace libcamera;
+using namespace std;
+
+namespace {
+
+class LazyInit : public Test
+{
+protected:
+	int init() override
+	{
+		setenv("LIBCAMERA_LAZY_CAMERA_INIT", "1", 1);
+
+		cm_ = new CameraManager();
+		if (cm_->start()) {
+			cerr << "Failed to start camera manager" << endl;
+			return TestFail;
+		}
+
+		camera_ = cm_->get("platform/vimc.0 Sensor B");
+		if (!camera_) {
+			cerr << "Can not find VIMC camera" << endl;
+			return TestSkip;
+		}
+
+		return TestPass;
+	}
+
+	int capture()
+	{
+		unique_ptr<CameraConfiguration> config =
+			camera_->generateConfiguration({ StreamRole::VideoRecording });
+		if (!config || config->validate() == CameraConfiguration::Invalid) {
+			cerr << "Failed to generate configuration" << endl;
+			return TestFail;
+		}
+
+		if (camera_->configure(config.get())) {
+			cerr << "Failed to configure camera" << endl;
+			return TestFail;
+		}
+
+		Stream *stream = config->at(0).stream();
+		FrameBufferAllocator allocator(camera_);
+		if (allocator.allocate(stream) < 0) {
+			cerr << "Failed to allocate buffers" << endl;
+			return TestFail;
+		}
+
+		if (camera_->start()) {
+			cerr << "Failed to start camera" << endl;
+			return TestFail;
+		}
+
+		if (camera_->stop()) {
+			cerr << "Failed to stop camera" << endl;
+			return TestFail;
+		}
+
+		return TestPass;
+	}
+
+	int run() override
+	{
+		/* Static information is available before the camera is acquired. */
+		if (camera_->streams().empty() || camera_->controls().empty() ||
+		    !camera_->properties().get(properties::Model)) {
+			cerr << "Camera static information missing" << endl;
+			return TestFail;
+		}
+
+		/*
+		 * The first acquire() completes initialization, the second one
+		 * reuses it.
+		 */
+		for (unsigned int i = 0; i < 2; ++i) {
+			if (camera_->acquire()) {
+				cerr << "Failed to acquire camera" << endl;
+				return TestFail;
+			}
+
+			if (capture() != TestPass)
+				return TestFail;
+
+			if (camera_->release()) {
+				cerr << "Failed to release camera" << endl;
+				return TestFail;
+			}
+		}
+
+		return TestPass;
+	}
+
+	void cleanup() override
+	{
+		camera_.reset();
+
+		cm_->stop();
+		delete cm_;
+
+		unsetenv("LIBCAMERA_LAZY_CAMERA_INIT");
+	}
+
+private:
+	CameraManager *cm_;
+	shared_ptr<Camera> camera_;
+};
+
+} /* namespace */
+
+TEST_REGISTER(LazyInit)
@@ -0,0 +1,190 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * control_arena.cpp - ControlList arena allocation tests
+ */
+
+#include <array>
+#include <atomic>
+#include <iostream>
+#include <new>
+#include <stdlib.h>
+#include <type_traits>
+
+#include <libcamera/control_ids.h>
+#include <libcamera/controls.h>
+
+#include "libcamera/internal/control_arena.h"
+
+#include "test.h"
+
+using namespace std;
+using namespace libcamera;
+
+static_assert(std::is_nothrow_move_constructible_v<ControlList>);
+static_assert(std::is_nothrow_move_assignable_v<ControlList>);
+
+static std::atomic<unsigned int> allocations;
+
+void *operator new(size_t size)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+
+	void *ptr = malloc(size ? size : 1);
+	if (!ptr)
+		throw std::bad_alloc();
+
+	return ptr;
+}
+
+void operator delete(void *ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete(void *ptr, [[maybe_unused]] size_t size) noexcept
+{
+	free(ptr);
+}
+
+class ControlArenaTest : public Test
+{
+protected:
+	static constexpr unsigned int kFrames = 10;
+
+	/*
+	 * Simulate the life of a reused request: the application sets
+	 * controls, the pipeline handler fills metadata, partly by merging the
+	 * metadata produced by the IPA, and the request is then cleared.
+	 */
+	void frame(ControlList &ctrls, ControlList &metadata,
+		   const ControlList &ipaMetadata, unsigned int sequence)
+	{
+		float gain = sequence;
+
+		ctrls.set(controls::ExposureTime, 10000);
+		ctrls.set(controls::ColourGains, { gain, gain + 1.0f });
+		ctrls.set(controls::AfWindows, Span<const Rectangle>(windows_));
+
+		metadata.set(controls::ColourCorrectionMatrix, ccm_);
+		metadata.set(controls::SensorBlackLevels, { 4096, 4096, 4096, 4096 });
+		metadata.merge(ipaMetadata);
+		metadata.set(controls::ColourGains, { gain, gain + 1.0f });
+	}
+
+	int run()
+	{
+		ControlArena ctrlsArena;
+		ControlArena arena;
+		ControlList ctrls(controls::controls);
+		ControlList metadata(controls::controls);
+
+		ctrlsArena.attach(&ctrls);
+		arena.attach(&metadata);
+
+		ControlList ipaMetadata(controls::controls);
+		ipaMetadata.set(controls::ColourGains, { 1.0f, 2.0f });
+		ipaMetadata.set(controls::AfWindows, Span<const Rectangle>(windows_));
+
+		/* Reserve list capacity and size the arena with a first frame. */
+		frame(ctrls, metadata, ipaMetadata, 0);
+		ctrls.clear();
+		metadata.clear();
+		ctrlsArena.reset();
+		arena.reset();
+
+		unsigned int before = allocations.load();
+
+		for (unsigned int i = 1; i <= kFrames; ++i) {
+			frame(ctrls, metadata, ipaMetadata, i);
+
+			Span<const float> gains = metadata.get(controls::ColourGains).value();
+			if (gains[0] != i || gains[1] != i + 1.0f) {
+				cerr << "Invalid colour gains in frame " << i << endl;
+				return TestFail;
+			}
+
+			if (metadata.get(controls::AfWindows)->size() != windows_.size()) {
+				cerr << "Invalid merged AF windows in frame " << i << endl;
+				return TestFail;
+			}
+
+			if (i == kFrames)
+				break;
+
+			ctrls.clear();
+			metadata.clear();
+			ctrlsArena.reset();
+			arena.reset();
+		}
+
+		unsigned int count = allocations.load() - before;
+		if (count) {
+			cerr << "Reused control lists caused " << count
+			     << " allocations" << endl;
+			return TestFail;
+		}
+
+		/* A copy of the list must not reference the arena memory. */
+		ControlList copy = metadata;
+		if (arena.isAttached(copy)) {
+			cerr << "Copied list attached to arena" << endl;
+			return TestFail;
+		}
+
+		metadata.clear();
+		arena.reset();
+		metadata.set(controls::ColourCorrectionMatrix, std::array<float, 9>{});
+
+		Span<const float> ccm = copy.get(controls::ColourCorrectionMatrix).value();
+		if (ccm[0] != ccm_[0] || ccm[8] != ccm_[8]) {
+			cerr << "Copied value overwritten after arena reset" << endl;
+			return TestFail;
+		}
+
+		/* Copying to a list attached to an arena allocates from it. */
+		before = allocations.load();
+		metadata = copy;
+
+		if (allocations.load() != before ||
+		    metadata.get(controls::ColourCorrectionMatrix).value()[0] != ccm_[0]) {
+			cerr << "Invalid copy to arena-backed list" << endl;
+			return TestFail;
+		}
+
+		/* A list moved out of an arena-backed list must own its values. */
+		ControlList moved = std::move(metadata);
+		if (arena.isAttached(moved) || !metadata.empty()) {
+			cerr << "Invalid move from arena-backed list" << endl;
+			return TestFail;
+		}
+
+		arena.reset();
+		metadata.set(controls::ColourCorrectionMatrix, std::array<float, 9>{});
+
+		ccm = moved.get(controls::ColourCorrectionMatrix).value();
+		if (ccm[0] != ccm_[0] || ccm[8] != ccm_[8]) {
+			cerr << "Moved value overwritten after arena reset" << endl;
+			return TestFail;
+		}
+
+		metadata.clear();
+
+		return TestPass;
+	}
+
+private:
+	std::array<Rectangle, 3> windows_ = { {
+		{ 0, 0, 640, 480 },
+		{ 640, 0, 640, 480 },
+		{ 1280, 0, 640, 480 },
+	} };
+	std::array<float, 9> ccm_ = {
+		1.5f, -0.3f, -0.2f,
+		-0.2f, 1.4f, -0.2f,
+		0.0f, -0.5f, 1.5f,
+	};
+};
+
+TEST_REGISTER(ControlArenaTest)
@@ -196,6 +196,24 @@ protected:
 			return TestFail;
 		}
 
+		/*
+		 * Set a control to the value of another control of the same
+		 * list. Adding the control before the existing ones moves
+		 * them, including the value being set.
+		 */
+		ControlList selfList(controls::controls);
+		selfList.set(controls::Contrast, 1.1f);
+		selfList.set(controls::Saturation, 0.4f);
+
+		selfList.set(controls::BRIGHTNESS, selfList.get(controls::SATURATION));
+
+		if (selfList.get(controls::Brightness) != 0.4f ||
+		    selfList.get(controls::Contrast) != 1.1f ||
+		    selfList.get(controls::Saturation) != 0.4f) {
+			cout << "Failed to set a control from the same list" << endl;
+			return TestFail;
+		}
+
 		return TestPass;
 	}
 };
@@ -0,0 +1,187 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * control_list_benchmark.cpp - ControlList storage tests and benchmark
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <libcamera/controls.h>
+
+#include "test.h"
+
+using namespace std;
+using namespace libcamera;
+
+class ControlListBenchmark : public Test
+{
+protected:
+	static constexpr unsigned int kMaxControls = 100;
+	static constexpr unsigned int kIterations = 10000;
+
+	int init()
+	{
+		/* Create sparse control IDs, as for real controls. */
+		for (unsigned int i = 0; i < kMaxControls; ++i) {
+			unsigned int id = 1 + i * 3;
+			ids_.push_back(make_unique<ControlId>(id, "Control" + to_string(id),
+							      ControlTypeInteger32));
+			idmap_[id] = ids_.back().get();
+		}
+
+		return TestPass;
+	}
+
+	int testStorage()
+	{
+		std::vector<unsigned int> order;
+		for (const auto &id : ids_)
+			order.push_back(id->id());
+
+		std::mt19937 random(42);
+		std::shuffle(order.begin(), order.end(), random);
+
+		ControlList list(idmap_);
+		for (unsigned int id : order)
+			list.set(id, ControlValue(static_cast<int32_t>(id)));
+
+		if (list.size() != kMaxControls) {
+			cerr << "List contains " << list.size() << " controls" << endl;
+			return TestFail;
+		}
+
+		/* Iteration must visit controls in increasing ID order. */
+		unsigned int previous = 0;
+		for (const auto &[id, value] : list) {
+			if (id <= previous) {
+				cerr << "Controls not iterated in ID order" << endl;
+				return TestFail;
+			}
+
+			if (value.get<int32_t>() != static_cast<int32_t>(id)) {
+				cerr << "Invalid value for control " << id << endl;
+				return TestFail;
+			}
+
+			previous = id;
+		}
+
+		if (list.contains(2) || !list.contains(4)) {
+			cerr << "Invalid contains() result" << endl;
+			return TestFail;
+		}
+
+		/* Overwriting a control must not add an entry. */
+		list.set(4, ControlValue(static_cast<int32_t>(0)));
+		if (list.size() != kMaxControls || list.get(4).get<int32_t>() != 0) {
+			cerr << "Failed to update control" << endl;
+			return TestFail;
+		}
+
+		/* Merging must not overwrite existing controls. */
+		ControlList odd(idmap_);
+		ControlList even(idmap_);
+		for (unsigned int i = 0; i < kMaxControls; ++i) {
+			unsigned int id = ids_[i]->id();
+			ControlList &target = i % 2 ? odd : even;
+			target.set(id, ControlValue(static_cast<int32_t>(i)));
+		}
+
+		even.set(4, ControlValue(static_cast<int32_t>(-1)));
+		even.merge(odd);
+
+		if (even.size() != kMaxControls ||
+		    even.get(4).get<int32_t>() != -1) {
+			cerr << "Invalid merge result" << endl;
+			return TestFail;
+		}
+
+		return TestPass;
+	}
+
+	template<typename Func>
+	static unsigned int measure(Func func)
+	{
+		auto start = chrono::steady_clock::now();
+
+		for (unsigned int i = 0; i < kIterations; ++i)
+			func();
+
+		auto end = chrono::steady_clock::now();
+		return chrono::duration_cast<chrono::nanoseconds>(end - start).count() / kIterations;
+	}
+
+	void benchmark(unsigned int count)
+	{
+		std::vector<unsigned int> order;
+		for (unsigned int i = 0; i < count; ++i)
+			order.push_back(ids_[i]->id());
+
+		/* Per-frame metadata lists are cleared and refilled. */
+		ControlList list(idmap_);
+		unsigned int set = measure([&]() {
+			list.clear();
+			for (unsigned int id : order)
+				list.set(id, ControlValue(static_cast<int32_t>(id)));
+		});
+
+		int64_t sum = 0;
+		unsigned int get = measure([&]() {
+			for (unsigned int id : order)
+				sum += list.get(id).get<int32_t>();
+		});
+
+		unsigned int iterate = measure([&]() {
+			for (const auto &[id, value] : list)
+				sum += value.get<int32_t>();
+		});
+
+		ControlList first(idmap_);
+		ControlList second(idmap_);
+		for (unsigned int i = 0; i < count; ++i) {
+			ControlList &target = i % 2 ? second : first;
+			target.set(order[i], ControlValue(static_cast<int32_t>(i)));
+		}
+
+		unsigned int merge = measure([&]() {
+			ControlList merged = first;
+			merged.merge(second);
+			sum += merged.size();
+		});
+
+		cout << setw(8) << count
+		     << setw(10) << set
+		     << setw(10) << get
+		     << setw(10) << iterate
+		     << setw(10) << merge
+		     << (sum ? "" : " ") << endl;
+	}
+
+	int run()
+	{
+		int ret = testStorage();
+		if (ret != TestPass)
+			return ret;
+
+		cout << "controls  set (ns)  get (ns)  iter (ns) merge (ns)" << endl;
+
+		for (unsigned int count : { 10, 25, 50, 100 })
+			benchmark(count);
+
+		return TestPass;
+	}
+
+private:
+	std::vector<std::unique_ptr<ControlId>> ids_;
+	ControlIdMap idmap_;
+};
+
+TEST_REGISTER(ControlListBenchmark)
@@ -0,0 +1,292 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * event-dispatcher-epoll.cpp - Epoll event dispatcher test and benchmark
+ */
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <vector>
+
+#include <libcamera/base/event_dispatcher_epoll.h>
+#include <libcamera/base/event_dispatcher_poll.h>
+#include <libcamera/base/event_notifier.h>
+#include <libcamera/base/thread.h>
+#include <libcamera/base/timer.h>
+#include <libcamera/base/unique_fd.h>
+
+#include "test.h"
+
+using namespace libcamera;
+using namespace std;
+using namespace std::chrono_literals;
+
+class EventSource : public Object
+{
+public:
+	EventSource()
+		: count_(0)
+	{
+		fd_ = UniqueFD(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK));
+		notifier_ = std::make_unique<EventNotifier>(fd_.get(),
+							    EventNotifier::Read);
+		notifier_->activated.connect(this, &EventSource::readReady);
+	}
+
+	bool isValid() const { return fd_.isValid(); }
+
+	void trigger()
+	{
+		uint64_t value = 1;
+		ssize_t ret = write(fd_.get(), &value, sizeof(value));
+		if (ret != sizeof(value))
+			cerr << "Failed to write to eventfd" << endl;
+	}
+
+	void disable() { notifier_->setEnabled(false); }
+
+	unsigned int count() const { return count_; }
+
+	Signal<EventSource *> activated;
+
+private:
+	void readReady()
+	{
+		uint64_t value;
+		ssize_t ret = read(fd_.get(), &value, sizeof(value));
+		if (ret == sizeof(value))
+			count_++;
+
+		activated.emit(this);
+	}
+
+	UniqueFD fd_;
+	std::unique_ptr<EventNotifier> notifier_;
+	unsigned int count_;
+};
+
+class DispatcherThread : public Thread
+{
+public:
+	int result() const { return result_; }
+
+protected:
+	void run() override
+	{
+		result_ = work();
+	}
+
+	virtual int work() = 0;
+
+private:
+	int result_ = TestFail;
+};
+
+class FunctionalThread : public DispatcherThread
+{
+protected:
+	int work() override
+	{
+		EventDispatcher *dispatcher = eventDispatcher();
+
+		/* Test event notification. */
+		EventSource source;
+		source.trigger();
+		dispatcher->processEvents();
+
+		if (source.count() != 1) {
+			cout << "Event notification failed" << endl;
+			return TestFail;
+		}
+
+		/*
+		 * Test unregistration of a notifier with a pending event from
+		 * the activation handler of another notifier.
+		 */
+		EventSource first;
+		EventSource second;
+		bool disabled = false;
+
+		auto disableOther = [&](EventSource *src) {
+			if (disabled)
+				return;
+
+			(src == &first ? second : first).disable();
+			disabled = true;
+		};
+
+		first.activated.connect(this, disableOther);
+		second.activated.connect(this, disableOther);
+
+		first.trigger();
+		second.trigger();
+		dispatcher->processEvents();
+
+		if (first.count() + second.count() != 1) {
+			cout << "Disabled notifier has been activated" << endl;
+			return TestFail;
+		}
+
+		/* Test timers. */
+		Timer timer;
+		bool timeout = false;
+		timer.timeout.connect(this, [&]() { timeout = true; });
+
+		utils::time_point start = utils::clock::now();
+		timer.start(100ms);
+
+		while (!timeout)
+			dispatcher->processEvents();
+
+		utils::duration duration = utils::clock::now() - start;
+		int msecs = std::chrono::duration_cast<std::chrono::milliseconds>(duration).count();
+
+		if (msecs < 100 || msecs > 150) {
+			cout << "Timer expired after " << msecs << "ms" << endl;
+			return TestFail;
+		}
+
+		/* Test interruption. */
+		timer.start(1000ms);
+		dispatcher->interrupt();
+		dispatcher->processEvents();
+
+		if (!timer.isRunning()) {
+			cout << "Event processing immediate interruption failed" << endl;
+			return TestFail;
+		}
+
+		return TestPass;
+	}
+};
+
+class BenchmarkThread : public DispatcherThread
+{
+public:
+	BenchmarkThread(unsigned int count, unsigned int iterations)
+		: count_(count), iterations_(iterations), duration_(0)
+	{
+	}
+
+	utils::duration duration() const { return duration_; }
+
+protected:
+	int work() override
+	{
+		EventDispatcher *dispatcher = eventDispatcher();
+
+		/*
+		 * Monitor count_ file descriptors, and activate one of them on
+		 * each iteration.
+		 */
+		std::vector<std::unique_ptr<EventSource>> sources;
+		for (unsigned int i = 0; i < count_; ++i) {
+			sources.push_back(std::make_unique<EventSource>());
+			if (!sources.back()->isValid()) {
+				cout << "Failed to create eventfd" << endl;
+				return TestFail;
+			}
+		}
+
+		utils::time_point start = utils::clock::now();
+
+		for (unsigned int i = 0; i < iterations_; ++i) {
+			sources[i % count_]->trigger();
+			dispatcher->processEvents();
+		}
+
+		duration_ = utils::clock::now() - start;
+
+		unsigned int total = 0;
+		for (const auto &source : sources)
+			total += source->count();
+
+		if (total != iterations_) {
+			cout << "Missed " << iterations_ - total << " events" << endl;
+			return TestFail;
+		}
+
+		return TestPass;
+	}
+
+private:
+	unsigned int count_;
+	unsigned int iterations_;
+	utils::duration duration_;
+};
+
+class EventDispatcherEpollTest : public Test
+{
+protected:
+	int runFunctional()
+	{
+		FunctionalThread thread;
+		thread.setEventDispatcher(std::make_unique<EventDispatcherEpoll>());
+
+		if (thread.setEventDispatcher(std::make_unique<EventDispatcherPoll>()) != -EBUSY) {
+			cout << "Event dispatcher replaced" << endl;
+			return TestFail;
+		}
+
+		thread.start();
+		thread.wait();
+
+		return thread.result();
+	}
+
+	template<typename Dispatcher>
+	int runBenchmark(unsigned int count, utils::duration *duration)
+	{
+		static constexpr unsigned int kIterations = 2000;
+
+		BenchmarkThread thread(count, kIterations);
+		thread.setEventDispatcher(std::make_unique<Dispatcher>());
+		thread.start();
+		thread.wait();
+
+		*duration = thread.duration() / kIterations;
+		return thread.result();
+	}
+
+	int run()
+	{
+		int ret = runFunctional();
+		if (ret != TestPass)
+			return ret;
+
+		/*
+		 * Compare the cost of an event loop iteration with the poll and
+		 * epoll backends as the number of monitored file descriptors
+		 * grows. The results are informative only.
+		 */
+		cout << "fds     poll (ns)  epoll (ns)" << endl;
+
+		for (unsigned int count : { 1, 8, 32, 128, 256 }) {
+			utils::duration pollDuration;
+			utils::duration epollDuration;
+
+			ret = runBenchmark<EventDispatcherPoll>(count, &pollDuration);
+			if (ret != TestPass)
+				return ret;
+
+			ret = runBenchmark<EventDispatcherEpoll>(count, &epollDuration);
+			if (ret != TestPass)
+				return ret;
+
+			cout << std::setw(3) << count << "  "
+			     << std::setw(11) << std::chrono::nanoseconds(pollDuration).count() << " "
+			     << std::setw(11) << std::chrono::nanoseconds(epollDuration).count()
+			     << endl;
+		}
+
+		return TestPass;
+	}
+};
+
+TEST_REGISTER(EventDispatcherEpollTest)
@@ -0,0 +1,298 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * ipa_module_cache.cpp - IPA module cache test and startup benchmark
+ */
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include <libcamera/base/file.h>
+
+#include "libcamera/internal/ipa_manager.h"
+#include "libcamera/internal/ipa_module.h"
+#include "libcamera/internal/ipa_module_cache.h"
+
+#include "test.h"
+
+using namespace std;
+using namespace libcamera;
+
+class IPAModuleCacheTest : public Test
+{
+protected:
+	static constexpr unsigned int kIterations = 20;
+
+	struct Result {
+		string name;
+		bool valid;
+	};
+
+	static Span<const uint8_t> key()
+	{
+		static const uint8_t data[] = { 0x01, 0x02, 0x03, 0x04 };
+		return data;
+	}
+
+	static bool verify(const IPAModule &ipaModule)
+	{
+#if HAVE_IPA_PUBKEY
+		File file{ ipaModule.path() };
+		if (!file.open(File::OpenModeFlag::ReadOnly))
+			return false;
+
+		return IPAManager::pubKey().verify(file.map(), ipaModule.signature());
+#else
+		return false;
+#endif
+	}
+
+	/*
+	 * Load the IPA modules and verify their signatures the way the
+	 * IPAManager does, with an optional cache.
+	 */
+	vector<Result> startup(IPAModuleCache *cache)
+	{
+		vector<Result> results;
+
+		if (cache)
+			cache->load();
+
+		for (const string &path : modules_) {
+			unique_ptr<IPAModule> ipaModule;
+
+			if (cache)
+				ipaModule.reset(cache->module(path));
+
+			if (!ipaModule) {
+				ipaModule = make_unique<IPAModule>(path);
+				if (!ipaModule->isValid())
+					continue;
+
+				if (cache)
+					cache->addModule(*ipaModule);
+			}
+
+			optional<bool> valid;
+			if (cache)
+				valid = cache->signatureValid(*ipaModule);
+
+			if (!valid) {
+				valid = verify(*ipaModule);
+				if (cache)
+					cache->setSignatureValid(*ipaModule, *valid);
+			}
+
+			results.push_back({ ipaModule->info().name, *valid });
+		}
+
+		if (cache && cache->isDirty())
+			cache->save();
+
+		return results;
+	}
+
+	static bool equal(const vector<Result> &a, const vector<Result> &b)
+	{
+		if (a.size() != b.size())
+			return false;
+
+		for (size_t i = 0; i < a.size(); ++i) {
+			if (a[i].name != b[i].name || a[i].valid != b[i].valid)
+				return false;
+		}
+
+		return true;
+	}
+
+	static int copyFile(const string &from, const string &to)
+	{
+		File in{ from };
+		File out{ to };
+
+		if (!in.open(File::OpenModeFlag::ReadOnly) ||
+		    !out.open(File::OpenModeFlag::WriteOnly))
+			return -EIO;
+
+		Span<const uint8_t> data = in.map();
+		return out.write(data) == static_cast<ssize_t>(data.size()) ? 0 : -EIO;
+	}
+
+	int init() override
+	{
+		for (const char *path : { "src/ipa/ipu3/ipa_ipu3.so",
+					  "src/ipa/rkisp1/ipa_rkisp1.so",
+					  "src/ipa/vimc/ipa_vimc.so" }) {
+			if (File::exists(path))
+				modules_.push_back(path);
+		}
+
+		if (modules_.empty()) {
+			cerr << "No IPA module found" << endl;
+			return TestSkip;
+		}
+
+		char tmpl[] = "/tmp/libcamera.ipa_module_cache.XXXXXX";
+		if (!mkdtemp(tmpl)) {
+			cerr << "Failed to create temporary directory" << endl;
+			return TestFail;
+		}
+
+		dir_ = tmpl;
+
+		return TestPass;
+	}
+
+	int testInvalidation()
+	{
+		string cachePath = dir_ + "/invalidation";
+		string libPath = dir_ + "/ipa_copy.so";
+
+		if (copyFile(modules_.back(), libPath) < 0 ||
+		    copyFile(modules_.back() + ".sign", libPath + ".sign") < 0) {
+			cerr << "Failed to copy IPA module" << endl;
+			return TestFail;
+		}
+
+		IPAModuleCache cache(cachePath, key());
+		IPAModule original(libPath);
+		bool valid = verify(original);
+
+		cache.addModule(original);
+		cache.setSignatureValid(original, valid);
+		cache.save();
+
+		/* Tampering with the module must invalidate its entry. */
+		File file{ libPath };
+		if (!file.open(File::OpenModeFlag::ReadWrite) || file.seek(file.size()) < 0 ||
+		    file.write(Span<const uint8_t>(key())) < 0) {
+			cerr << "Failed to modify IPA module" << endl;
+			return TestFail;
+		}
+		file.close();
+
+		cache.load();
+
+		unique_ptr<IPAModule> ipaModule(cache.module(libPath));
+		if (ipaModule) {
+			cerr << "Modified IPA module retrieved from cache" << endl;
+			return TestFail;
+		}
+
+		IPAModule modified(libPath);
+		if (cache.signatureValid(modified)) {
+			cerr << "Cached signature check used for modified module" << endl;
+			return TestFail;
+		}
+
+		if (verify(modified)) {
+			cerr << "Modified IPA module signature is valid" << endl;
+			return TestFail;
+		}
+
+		/* Cache files writable by other users are ignored. */
+		cache.addModule(original);
+		cache.save();
+		chmod(cachePath.c_str(), 0666);
+		if (cache.load() != -EPERM) {
+			cerr << "Unsafe cache file loaded" << endl;
+			return TestFail;
+		}
+
+		/* Invalidation removes the cache file. */
+		cache.invalidate();
+		if (File::exists(cachePath)) {
+			cerr << "Cache file not removed by invalidate()" << endl;
+			return TestFail;
+		}
+
+		unlink(libPath.c_str());
+		unlink((libPath + ".sign").c_str());
+
+		return TestPass;
+	}
+
+	template<typename Func>
+	static unsigned int measure(Func func)
+	{
+		auto start = chrono::steady_clock::now();
+
+		for (unsigned int i = 0; i < kIterations; ++i)
+			func();
+
+		auto end = chrono::steady_clock::now();
+		return chrono::duration_cast<chrono::microseconds>(end - start).count() / kIterations;
+	}
+
+	int run() override
+	{
+		string cachePath = dir_ + "/cache";
+
+		vector<Result> reference = startup(nullptr);
+
+		IPAModuleCache cache(cachePath, key());
+		if (!equal(startup(&cache), reference)) {
+			cerr << "Cold cache results mismatch" << endl;
+			return TestFail;
+		}
+
+		/* A new cache instance must retrieve all results from the file. */
+		IPAModuleCache warm(cachePath, key());
+		if (!equal(startup(&warm), reference) || warm.isDirty()) {
+			cerr << "Warm cache results mismatch" << endl;
+			return TestFail;
+		}
+
+		/* A different public key discards the cache. */
+		IPAModuleCache otherKey(cachePath, {});
+		otherKey.load();
+		unique_ptr<IPAModule> ipaModule(otherKey.module(modules_.back()));
+		if (ipaModule) {
+			cerr << "Cache used with a different public key" << endl;
+			return TestFail;
+		}
+
+		if (testInvalidation() != TestPass)
+			return TestFail;
+
+		unsigned int uncached = measure([&]() { startup(nullptr); });
+		unsigned int cold = measure([&]() {
+			IPAModuleCache c(cachePath, key());
+			c.invalidate();
+			startup(&c);
+		});
+		unsigned int cached = measure([&]() {
+			IPAModuleCache c(cachePath, key());
+			startup(&c);
+		});
+
+		cout << "IPA module startup for " << modules_.size()
+		     << " modules: uncached " << uncached << " us, cold cache "
+		     << cold << " us, warm cache " << cached << " us" << endl;
+
+		return TestPass;
+	}
+
+	void cleanup() override
+	{
+		if (dir_.empty())
+			return;
+
+		unlink((dir_ + "/cache").c_str());
+		unlink((dir_ + "/invalidation").c_str());
+		rmdir(dir_.c_str());
+	}
+
+private:
+	vector<string> modules_;
+	string dir_;
+};
+
+TEST_REGISTER(IPAModuleCacheTest)
@@ -0,0 +1,649 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * ipc_benchmark.cpp - IPC transport latency and throughput benchmark
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <vector>
+
+#include <libcamera/base/event_dispatcher.h>
+#include <libcamera/base/file.h>
+#include <libcamera/base/thread.h>
+#include <libcamera/base/timer.h>
+#include <libcamera/base/utils.h>
+
+#include <libcamera/control_ids.h>
+#include <libcamera/ipa/test_ipa_proxy.h>
+#include <libcamera/ipa/vimc_ipa_proxy.h>
+
+#include "libcamera/internal/ipa_module.h"
+#include "libcamera/internal/ipc_pipe.h"
+#include "libcamera/internal/ipc_pipe_shm.h"
+#include "libcamera/internal/ipc_pipe_unixsocket.h"
+#include "libcamera/internal/ipc_shm_channel.h"
+#include "libcamera/internal/ipc_unixsocket.h"
+#include "libcamera/internal/process.h"
+
+#include "test.h"
+
+using namespace std;
+using namespace std::chrono_literals;
+using namespace libcamera;
+
+enum {
+	CmdExit = 0,
+	CmdEcho = 1,
+	CmdSink = 2,
+};
+
+template<typename Channel>
+class EchoIPCWorker
+{
+public:
+	EchoIPCWorker()
+		: exit_(false)
+	{
+		dispatcher_ = Thread::current()->eventDispatcher();
+		ipc_.readyRead.connect(this, &EchoIPCWorker::readyRead);
+	}
+
+	int run(UniqueFD fd)
+	{
+		if (ipc_.bind(std::move(fd))) {
+			cerr << "Failed to connect to IPC channel" << endl;
+			return EXIT_FAILURE;
+		}
+
+		while (!exit_)
+			dispatcher_->processEvents();
+
+		ipc_.close();
+
+		return EXIT_SUCCESS;
+	}
+
+private:
+	void readyRead()
+	{
+		IPCUnixSocket::Payload payload;
+
+		int ret = ipc_.receive(&payload);
+		if (ret) {
+			cerr << "Receive message failed: " << ret << endl;
+			return;
+		}
+
+		IPCMessage message(payload);
+		if (message.header().cmd != IPCMessage::kBatchCmd) {
+			process(message);
+			return;
+		}
+
+		vector<IPCMessage> messages;
+		if (message.split(&messages) < 0) {
+			cerr << "Invalid batch message" << endl;
+			return;
+		}
+
+		for (const IPCMessage &msg : messages)
+			process(msg);
+	}
+
+	void process(const IPCMessage &message)
+	{
+		switch (message.header().cmd) {
+		case CmdExit:
+			exit_ = true;
+			break;
+
+		case CmdEcho: {
+			IPCMessage response(message.header());
+			response.data() = message.data();
+			response.fds() = message.fds();
+			ipc_.send(response.payload());
+			break;
+		}
+
+		case CmdSink:
+			break;
+		}
+	}
+
+	Channel ipc_;
+	EventDispatcher *dispatcher_;
+	bool exit_;
+};
+
+class IPCBenchmark : public Test, public Object
+{
+protected:
+	static constexpr size_t kMiB = 1024 * 1024;
+
+	/* Latency distribution of a set of samples, in nanoseconds. */
+	struct Stats {
+		Stats(vector<int64_t> &samples)
+		{
+			sort(samples.begin(), samples.end());
+
+			auto percentile = [&](unsigned int p) {
+				return samples[(samples.size() - 1) * p / 100];
+			};
+
+			p50 = percentile(50);
+			p90 = percentile(90);
+			p99 = percentile(99);
+			max = samples.back();
+		}
+
+		int64_t p50;
+		int64_t p90;
+		int64_t p99;
+		int64_t max;
+	};
+
+	static string formatSize(size_t size)
+	{
+		if (size >= kMiB)
+			return to_string(size / kMiB) + " MiB";
+		if (size >= 1024)
+			return to_string(size / 1024) + " KiB";
+		return to_string(size) + " B";
+	}
+
+	static void printHeader(const char *title, const char *unit)
+	{
+		cout << endl << title << endl
+		     << setw(22) << "" << setw(10) << "p50 us" << setw(10) << "p90 us"
+		     << setw(10) << "p99 us" << setw(10) << "max us"
+		     << setw(12) << unit << endl;
+	}
+
+	static void printStats(const string &name, vector<int64_t> &samples,
+			       double extra = -1.0)
+	{
+		cout << setw(22) << name;
+
+		if (samples.empty()) {
+			cout << "  unsupported" << endl;
+			return;
+		}
+
+		Stats stats(samples);
+
+		cout << fixed << setprecision(1)
+		     << setw(10) << stats.p50 / 1000.0
+		     << setw(10) << stats.p90 / 1000.0
+		     << setw(10) << stats.p99 / 1000.0
+		     << setw(10) << stats.max / 1000.0;
+
+		if (extra >= 0)
+			cout << setw(12) << extra;
+
+		cout << endl;
+	}
+
+	/*
+	 * Time func() over a number of iterations, after a few warm up runs.
+	 * Return an empty set of samples if any call fails.
+	 */
+	template<typename Func>
+	static vector<int64_t> measure(unsigned int iterations, Func func)
+	{
+		vector<int64_t> samples;
+		samples.reserve(iterations);
+
+		for (unsigned int i = 0; i < 10; ++i) {
+			if (func() < 0)
+				return {};
+		}
+
+		for (unsigned int i = 0; i < iterations; ++i) {
+			auto start = chrono::steady_clock::now();
+			int ret = func();
+			auto end = chrono::steady_clock::now();
+
+			if (ret < 0)
+				return {};
+
+			samples.push_back(chrono::duration_cast<chrono::nanoseconds>(end - start).count());
+		}
+
+		return samples;
+	}
+
+	static unsigned int iterations(size_t size)
+	{
+		return clamp<size_t>(64 * kMiB / max<size_t>(size, 1), 50, 2000);
+	}
+
+	static SharedFD createMemFd(size_t size)
+	{
+		UniqueFD fd(memfd_create("ipc_benchmark", MFD_CLOEXEC));
+		if (!fd.isValid() || ftruncate(fd.get(), size) < 0)
+			return SharedFD();
+
+		return SharedFD(std::move(fd));
+	}
+
+	int echo(IPCPipe *ipc, const vector<uint8_t> &data,
+		 const vector<SharedFD> &fds)
+	{
+		IPCMessage msg({ CmdEcho, cookie_++ });
+		IPCMessage response;
+
+		msg.data() = data;
+		msg.fds() = fds;
+
+		int ret = ipc->sendSync(msg, &response);
+		if (ret < 0)
+			return ret;
+
+		if (response.data().size() != data.size() ||
+		    response.fds().size() != fds.size())
+			return -EINVAL;
+
+		return 0;
+	}
+
+	/*
+	 * Send \a count asynchronous messages of \a size bytes, in windows of
+	 * \a window messages each terminated by a synchronous call to make
+	 * sure the peer keeps up. Return the throughput in messages per second.
+	 */
+	double throughput(IPCPipe *ipc, size_t size, unsigned int window,
+			  unsigned int count)
+	{
+		vector<uint8_t> data(size);
+
+		auto start = chrono::steady_clock::now();
+
+		for (unsigned int i = 0; i < count; i += window) {
+			for (unsigned int j = 0; j < window; ++j) {
+				IPCMessage msg({ CmdSink, cookie_++ });
+				msg.data() = data;
+
+				if (ipc->sendAsync(msg) < 0)
+					return -1.0;
+			}
+
+			if (echo(ipc, {}, {}) < 0)
+				return -1.0;
+		}
+
+		auto end = chrono::steady_clock::now();
+
+		return count / chrono::duration<double>(end - start).count();
+	}
+
+	void benchmarkPipe(const char *name, IPCPipe *ipc, bool socket)
+	{
+		string title = string("IPCPipe ") + name + " sendSync() round trip";
+		printHeader(title.c_str(), "MiB/s");
+
+		for (size_t size : { 64UL, 1024UL, 4096UL, 65536UL, 256 * 1024UL, kMiB }) {
+			vector<uint8_t> data(size);
+
+			vector<int64_t> samples = measure(iterations(size), [&]() {
+				return echo(ipc, data, {});
+			});
+
+			double bandwidth = -1.0;
+			if (!samples.empty()) {
+				Stats stats(samples);
+				bandwidth = 2.0 * size / stats.p50 * 1e9 / kMiB;
+			}
+
+			printStats(formatSize(size), samples, bandwidth);
+		}
+
+		SharedFD memfd = createMemFd(4096);
+
+		for (unsigned int count : { 0, 1, 4, 16 }) {
+			vector<SharedFD> fds(count, memfd);
+			vector<uint8_t> data(64);
+
+			vector<int64_t> samples = measure(2000, [&]() {
+				return echo(ipc, data, fds);
+			});
+
+			printStats("64 B, " + to_string(count) + " fds", samples);
+		}
+
+		cout << endl << "IPCPipe " << name << " sendAsync() throughput" << endl;
+
+		for (bool batching : { false, true }) {
+			ipc->setBatching(batching);
+
+			for (size_t size : { 64UL, 4096UL }) {
+				/*
+				 * The socket queue only holds a few messages, batches
+				 * and the shared memory ring absorb larger bursts.
+				 */
+				unsigned int window = socket && !batching
+						    ? 4 : clamp<size_t>(128 * 1024 / (size + 64), 4, 256);
+				double rate = throughput(ipc, size, window, 20000);
+
+				cout << setw(22)
+				     << formatSize(size) + (batching ? ", batched" : "");
+				if (rate < 0)
+					cout << setw(10) << "failed" << endl;
+				else
+					cout << setw(10) << static_cast<unsigned int>(rate)
+					     << " msg/s, window " << window << endl;
+			}
+		}
+
+		ipc->setBatching(false);
+	}
+
+	/*
+	 * Wait for \a count events to be received, processing events for at
+	 * most one second.
+	 */
+	int waitEvents(unsigned int count)
+	{
+		if (events_ >= count)
+			return 0;
+
+		EventDispatcher *dispatcher = Thread::current()->eventDispatcher();
+		Timer timer;
+
+		timer.start(1000ms);
+		while (timer.isRunning()) {
+			/*
+			 * Events emitted from the IPA thread are queued as
+			 * messages, deliver them without waiting for another
+			 * event loop iteration.
+			 */
+			Thread::current()->dispatchMessages();
+			if (events_ >= count)
+				return 0;
+
+			dispatcher->processEvents();
+		}
+
+		return -ETIMEDOUT;
+	}
+
+	void eventReceived()
+	{
+		events_++;
+	}
+
+	int benchmarkTestProxy()
+	{
+		string modulePath = utils::dirname(self()) + "/ipa_ipc_benchmark.so";
+		IPAModule module(modulePath);
+		if (!module.isValid()) {
+			cerr << "Failed to load " << modulePath << endl;
+			return TestFail;
+		}
+
+		auto ipa = make_unique<ipa::test::IPAProxyTest>(&module, true);
+		if (!ipa->isValid() || ipa->init({}) < 0) {
+			cerr << "Failed to create test IPA proxy" << endl;
+			return TestFail;
+		}
+
+		ipa->dummyEvent.connect(this, [this](uint32_t) { eventReceived(); });
+
+		printHeader("test.mojom proxy round trip", "");
+
+		vector<int64_t> samples = measure(2000, [&]() { return ipa->start(); });
+		printStats("start()", samples);
+
+		samples = measure(2000, [&]() { ipa->stop(); return 0; });
+		printStats("stop()", samples);
+
+		for (size_t size : { 64UL, 4096UL, 65536UL }) {
+			ipa::test::TestStruct s;
+			s.s1 = string(size, 'x');
+
+			samples = measure(iterations(size), [&]() {
+				ipa->test(s);
+				return 0;
+			});
+			printStats("test(), " + formatSize(size), samples);
+		}
+
+		/* Each call emits an event, received before the call returns. */
+		uint32_t frame = 0;
+		events_ = 0;
+		samples = measure(2000, [&]() {
+			ControlList controls(controls::controls);
+			controls.set(controls::ExposureTime, 10000 + frame % 16);
+			controls.set(controls::AnalogueGain, 2.0f);
+			controls.set(controls::AeEnable, true);
+
+			ipa::test::TestControlsStruct s{ frame++, ControlListView(std::move(controls)) };
+			ipa->testControls(s);
+
+			return events_ == frame ? 0 : -EINVAL;
+		});
+		printStats("testControls() + event", samples);
+
+		return samples.empty() ? TestFail : TestPass;
+	}
+
+	unique_ptr<ipa::vimc::IPAProxyVimc> createVimcProxy(IPAModule *module,
+							    bool isolate, bool inlined)
+	{
+		auto ipa = make_unique<ipa::vimc::IPAProxyVimc>(module, isolate,
+								IPCPipe::Transport::UnixSocket,
+								false, inlined);
+		if (!ipa->isValid()) {
+			cerr << "Failed to create vimc IPA proxy" << endl;
+			return nullptr;
+		}
+
+		Flags<ipa::vimc::TestFlag> outFlags;
+		int ret = ipa->init(IPASettings{ ipa->configurationFile("vimc.conf"), "vimc" },
+				    ipa::vimc::IPAOperationInit, {}, &outFlags);
+		if (ret < 0) {
+			cerr << "vimc IPA init() failed" << endl;
+			return nullptr;
+		}
+
+		ipa->paramsBufferReady.connect(this, [this](uint32_t, const Flags<ipa::vimc::TestFlag>) {
+			eventReceived();
+		});
+
+		return ipa;
+	}
+
+	/*
+	 * Compare the per-frame latency of the isolated, threaded and inline
+	 * proxy modes, from queueing a request to the parameters buffer being
+	 * ready.
+	 */
+	int benchmarkVimcModes(IPAModule *module)
+	{
+		static const struct {
+			const char *name;
+			bool isolate;
+			bool inlined;
+		} modes[] = {
+			{ "isolated", true, false },
+			{ "threaded", false, false },
+			{ "inline", false, true },
+		};
+
+		printHeader("vimc.mojom per-frame latency", "");
+
+		for (const auto &mode : modes) {
+			auto ipa = createVimcProxy(module, mode.isolate, mode.inlined);
+			if (!ipa || ipa->start() < 0)
+				return TestFail;
+
+			FrameBuffer::Plane plane;
+			plane.fd = createMemFd(4096);
+			plane.offset = 0;
+			plane.length = 4096;
+			ipa->mapBuffers({ IPABuffer{ 1, { plane } } });
+
+			uint32_t frame = 0;
+			events_ = 0;
+			vector<int64_t> samples = measure(2000, [&]() {
+				ControlList controls(controls::controls);
+				controls.set(controls::ExposureTime, 10000 + frame % 16);
+
+				ipa->queueRequest(frame, controls);
+				ipa->fillParamsBuffer(frame++, 1);
+				return waitEvents(frame);
+			});
+			printStats(mode.name, samples);
+
+			ipa->unmapBuffers({ 1 });
+			ipa->stop();
+
+			if (samples.empty())
+				return TestFail;
+		}
+
+		return TestPass;
+	}
+
+	int benchmarkVimcProxy()
+	{
+		IPAModule module("src/ipa/vimc/ipa_vimc.so");
+		if (!module.isValid()) {
+			cout << endl << "vimc IPA module not found, skipping" << endl;
+			return TestPass;
+		}
+
+		/*
+		 * The vimc IPA traces operations to the FIFO of the IPA interface
+		 * test when it exists, and would block without a reader.
+		 */
+		if (File::exists(ipa::vimc::VimcIPAFIFOPath)) {
+			cout << endl << "vimc IPA test FIFO in use, skipping" << endl;
+			return TestPass;
+		}
+
+		auto ipa = createVimcProxy(&module, true, false);
+		if (!ipa)
+			return TestFail;
+
+		printHeader("vimc.mojom proxy round trip", "");
+
+		vector<int64_t> samples = measure(2000, [&]() { return ipa->start(); });
+		printStats("start()", samples);
+
+		samples = measure(2000, [&]() { ipa->stop(); return 0; });
+		printStats("stop()", samples);
+
+		/* Map and unmap buffers with a growing number of planes. */
+		for (unsigned int planes : { 1, 4, 16 }) {
+			IPABuffer buffer{ 1, {} };
+			for (unsigned int i = 0; i < planes; ++i) {
+				FrameBuffer::Plane plane;
+				plane.fd = createMemFd(4096);
+				plane.offset = 0;
+				plane.length = 4096;
+				buffer.planes.push_back(plane);
+			}
+
+			samples = measure(500, [&]() {
+				ipa->mapBuffers({ buffer });
+				ipa->unmapBuffers({ buffer.id });
+				return 0;
+			});
+			printStats("map+unmap, " + to_string(planes) + " fds", samples);
+		}
+
+		/* Asynchronous call followed by the corresponding event. */
+		FrameBuffer::Plane plane;
+		plane.fd = createMemFd(4096);
+		plane.offset = 0;
+		plane.length = 4096;
+		ipa->mapBuffers({ IPABuffer{ 1, { plane } } });
+
+		uint32_t frame = 0;
+		events_ = 0;
+		samples = measure(2000, [&]() {
+			ipa->fillParamsBuffer(frame++, 1);
+			return waitEvents(frame);
+		});
+		printStats("fillParamsBuffer()", samples);
+
+		ipa->unmapBuffers({ 1 });
+
+		if (samples.empty())
+			return TestFail;
+
+		return benchmarkVimcModes(&module);
+	}
+
+	int init() override
+	{
+		/* Look the test IPA proxy worker up next to the benchmark. */
+		setenv("LIBCAMERA_IPA_PROXY_PATH", utils::dirname(self()).c_str(), 1);
+
+		return TestPass;
+	}
+
+	int run() override
+	{
+		const char *transports[] = { "socket", "shm" };
+		unique_ptr<IPCPipe> pipes[2] = {
+			make_unique<IPCPipeUnixSocket>("", self().c_str()),
+			make_unique<IPCPipeShm>("", self().c_str()),
+		};
+
+		for (unsigned int i = 0; i < 2; ++i) {
+			if (!pipes[i]->isConnected()) {
+				cerr << "Failed to create " << transports[i]
+				     << " IPCPipe" << endl;
+				return TestFail;
+			}
+
+			benchmarkPipe(transports[i], pipes[i].get(), i == 0);
+			pipes[i]->sendAsync(IPCMessage(CmdExit));
+		}
+
+		if (benchmarkTestProxy() != TestPass)
+			return TestFail;
+
+		if (benchmarkVimcProxy() != TestPass)
+			return TestFail;
+
+		return TestPass;
+	}
+
+private:
+	ProcessManager processManager_;
+	uint32_t cookie_ = 0;
+	unsigned int events_ = 0;
+};
+
+/*
+ * Can't use TEST_REGISTER() as single binary needs to act as both client and
+ * server
+ */
+int main(int argc, char **argv)
+{
+	/* The IPCPipe passes the IPA module path in argv[1] */
+	if (argc == 3) {
+		EchoIPCWorker<IPCUnixSocket> worker;
+		return worker.run(UniqueFD(std::stoi(argv[2])));
+	}
+
+	if (argc == 4 && !strcmp(argv[3], "shm")) {
+		EchoIPCWorker<IPCShmChannel> worker;
+		return worker.run(UniqueFD(std::stoi(argv[2])));
+	}
+
+	IPCBenchmark test;
+	test.setArgs(argc, argv);
+	return test.execute();
+}
@@ -0,0 +1,55 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * ipc_benchmark_ipa.cpp - Test IPA module for the IPC benchmark
+ */
+
+#include <libcamera/ipa/ipa_interface.h>
+#include <libcamera/ipa/ipa_module_info.h>
+#include <libcamera/ipa/test_ipa_interface.h>
+
+namespace libcamera {
+
+class IPABenchmark : public ipa::test::IPATestInterface
+{
+public:
+	int32_t init([[maybe_unused]] const IPASettings &settings) override
+	{
+		return 0;
+	}
+
+	int32_t start() override
+	{
+		return 0;
+	}
+
+	void stop() override
+	{
+	}
+
+	void test([[maybe_unused]] const ipa::test::TestStruct &s) override
+	{
+	}
+
+	void testControls(const ipa::test::TestControlsStruct &s) override
+	{
+		dummyEvent.emit(s.frame);
+	}
+};
+
+extern "C" {
+const struct IPAModuleInfo ipaModuleInfo = {
+	IPA_MODULE_API_VERSION,
+	0,
+	"ipc_benchmark",
+	"test",
+};
+
+IPAInterface *ipaCreate()
+{
+	return new IPABenchmark();
+}
+}
+
+} /* namespace libcamera */
@@ -0,0 +1,234 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * ipa_worker_pool.cpp - IPA proxy worker pool test
+ */
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <stdlib.h>
+
+#include <libcamera/base/event_dispatcher.h>
+#include <libcamera/base/thread.h>
+#include <libcamera/base/timer.h>
+
+#include "libcamera/internal/ipa_data_serializer.h"
+#include "libcamera/internal/ipa_manager.h"
+#include "libcamera/internal/ipc_pipe.h"
+#include "libcamera/internal/ipc_unixsocket.h"
+#include "libcamera/internal/process.h"
+
+#include "test.h"
+
+using namespace std;
+using namespace std::chrono_literals;
+using namespace libcamera;
+
+enum {
+	CmdExit = 0,
+	CmdGetStartTime = 1,
+};
+
+static int64_t now()
+{
+	return chrono::duration_cast<chrono::nanoseconds>(
+		chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+class PoolTestIPCWorker
+{
+public:
+	PoolTestIPCWorker()
+		: startTime_(now()), exit_(false)
+	{
+		dispatcher_ = Thread::current()->eventDispatcher();
+		ipc_.readyRead.connect(this, &PoolTestIPCWorker::readyRead);
+	}
+
+	int run(UniqueFD fd)
+	{
+		if (ipc_.bind(std::move(fd))) {
+			cerr << "Failed to connect to IPC channel" << endl;
+			return EXIT_FAILURE;
+		}
+
+		while (!exit_)
+			dispatcher_->processEvents();
+
+		ipc_.close();
+
+		return EXIT_SUCCESS;
+	}
+
+private:
+	void readyRead()
+	{
+		IPCUnixSocket::Payload payload;
+
+		int ret = ipc_.receive(&payload);
+		if (ret) {
+			cerr << "Receive message failed: " << ret << endl;
+			return;
+		}
+
+		IPCMessage message(payload);
+
+		switch (message.header().cmd) {
+		case CmdExit:
+			exit_ = true;
+			break;
+
+		case CmdGetStartTime: {
+			IPCMessage response(message.header());
+			tie(response.data(), ignore) =
+				IPADataSerializer<int64_t>::serialize(startTime_);
+			ipc_.send(response.payload());
+			break;
+		}
+		}
+	}
+
+	IPCUnixSocket ipc_;
+	EventDispatcher *dispatcher_;
+	int64_t startTime_;
+	bool exit_;
+};
+
+class IPAWorkerPoolTest : public Test
+{
+protected:
+	int init() override
+	{
+		setenv("LIBCAMERA_IPA_WORKER_POOL", "2", 1);
+		ipaManager_ = make_unique<IPAManager>();
+
+		return TestPass;
+	}
+
+	/*
+	 * Create a pipe, and retrieve the time at which its worker started
+	 * relative to the creation request and the latency of the first call.
+	 */
+	int claim(unique_ptr<IPCPipe> *pipe, int64_t *started, int64_t *latency)
+	{
+		int64_t start = now();
+
+		*pipe = IPAManager::createPipe(self(), self(), IPCPipe::Transport::UnixSocket);
+		if (!(*pipe)->isConnected())
+			return -ENOTCONN;
+
+		IPCMessage response;
+		int ret = (*pipe)->sendSync(IPCMessage({ CmdGetStartTime, 0 }), &response);
+		if (ret < 0)
+			return ret;
+
+		*latency = now() - start;
+		*started = IPADataSerializer<int64_t>::deserialize(response.data()) - start;
+
+		return 0;
+	}
+
+	/*
+	 * Run the event loop to process the termination of workers while the
+	 * pool is replenished in the background.
+	 */
+	void wait()
+	{
+		EventDispatcher *dispatcher = Thread::current()->eventDispatcher();
+		Timer timer;
+
+		timer.start(500ms);
+		while (timer.isRunning())
+			dispatcher->processEvents();
+	}
+
+	int run() override
+	{
+		unique_ptr<IPCPipe> pipes[4];
+		int64_t latency[4];
+		int64_t started;
+
+		/* The first pipe for an unknown module is created on demand. */
+		if (claim(&pipes[0], &started, &latency[0]) < 0)
+			return TestFail;
+
+		if (started < 0) {
+			cerr << "Worker started before the first request" << endl;
+			return TestFail;
+		}
+
+		/*
+		 * Give the workers time to start before claiming them. The
+		 * workers started to replenish the pool from now on exit
+		 * immediately.
+		 */
+		wait();
+		setenv("IPA_WORKER_POOL_TEST_EXIT", "1", 1);
+
+		for (unsigned int i = 1; i < 3; ++i) {
+			if (claim(&pipes[i], &started, &latency[i]) < 0)
+				return TestFail;
+
+			if (started >= 0) {
+				cerr << "Worker " << i << " not pre-started" << endl;
+				return TestFail;
+			}
+
+			wait();
+		}
+
+		cout << "First call latency: cold " << latency[0] / 1000
+		     << " us, warm " << latency[1] / 1000 << " us, "
+		     << latency[2] / 1000 << " us" << endl;
+
+		/* The pooled workers have died, a new one must be started. */
+		unsetenv("IPA_WORKER_POOL_TEST_EXIT");
+
+		if (claim(&pipes[3], &started, &latency[3]) < 0) {
+			cerr << "Dead pre-started worker claimed" << endl;
+			return TestFail;
+		}
+
+		if (started < 0) {
+			cerr << "Dead pre-started worker not replaced" << endl;
+			return TestFail;
+		}
+
+		for (auto &pipe : pipes)
+			pipe->sendAsync(IPCMessage(CmdExit));
+
+		return TestPass;
+	}
+
+	void cleanup() override
+	{
+		ipaManager_->releaseWorkers();
+		ipaManager_.reset();
+	}
+
+private:
+	ProcessManager processManager_;
+	unique_ptr<IPAManager> ipaManager_;
+};
+
+/*
+ * Can't use TEST_REGISTER() as single binary needs to act as both client and
+ * server
+ */
+int main(int argc, char **argv)
+{
+	/* The IPCPipe passes the IPA module path in argv[1] */
+	if (argc == 3) {
+		if (getenv("IPA_WORKER_POOL_TEST_EXIT"))
+			return EXIT_FAILURE;
+
+		PoolTestIPCWorker worker;
+		return worker.run(UniqueFD(std::stoi(argv[2])));
+	}
+
+	IPAWorkerPoolTest test;
+	test.setArgs(argc, argv);
+	return test.execute();
+}
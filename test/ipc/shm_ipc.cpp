@@ -0,0 +1,391 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * shm_ipc.cpp - Shared memory IPC test and transport benchmark
+ */
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include <libcamera/base/event_dispatcher.h>
+#include <libcamera/base/thread.h>
+
+#include "libcamera/internal/ipa_data_serializer.h"
+#include "libcamera/internal/ipc_pipe.h"
+#include "libcamera/internal/ipc_pipe_shm.h"
+#include "libcamera/internal/ipc_pipe_unixsocket.h"
+#include "libcamera/internal/ipc_shm_channel.h"
+#include "libcamera/internal/ipc_unixsocket.h"
+#include "libcamera/internal/process.h"
+
+#include "test.h"
+
+using namespace std;
+using namespace libcamera;
+
+enum {
+	CmdExit = 0,
+	CmdEcho = 1,
+	CmdCount = 2,
+	CmdGetCount = 3,
+	CmdGetBatches = 4,
+};
+
+template<typename Channel>
+class ShmTestIPCWorker
+{
+public:
+	ShmTestIPCWorker()
+		: count_(0), batches_(0), exitCode_(EXIT_SUCCESS), exit_(false)
+	{
+		dispatcher_ = Thread::current()->eventDispatcher();
+		ipc_.readyRead.connect(this, &ShmTestIPCWorker::readyRead);
+	}
+
+	int run(UniqueFD fd)
+	{
+		if (ipc_.bind(std::move(fd))) {
+			cerr << "Failed to connect to IPC channel" << endl;
+			return EXIT_FAILURE;
+		}
+
+		while (!exit_)
+			dispatcher_->processEvents();
+
+		ipc_.close();
+
+		return exitCode_;
+	}
+
+private:
+	void reply(const IPCMessage &message)
+	{
+		int ret = ipc_.send(message.payload());
+		if (ret < 0) {
+			cerr << "Reply failed" << endl;
+			exitCode_ = EXIT_FAILURE;
+			exit_ = true;
+		}
+	}
+
+	void readyRead()
+	{
+		IPCUnixSocket::Payload payload;
+
+		int ret = ipc_.receive(&payload);
+		if (ret) {
+			cerr << "Receive message failed: " << ret << endl;
+			return;
+		}
+
+		IPCMessage message(payload);
+		if (message.header().cmd != IPCMessage::kBatchCmd) {
+			process(message);
+			return;
+		}
+
+		vector<IPCMessage> messages;
+		ret = message.split(&messages);
+		if (ret) {
+			cerr << "Invalid batch message: " << ret << endl;
+			exitCode_ = EXIT_FAILURE;
+			exit_ = true;
+			return;
+		}
+
+		batches_++;
+
+		for (const IPCMessage &msg : messages)
+			process(msg);
+	}
+
+	void process(const IPCMessage &message)
+	{
+		IPCMessage::Header header = message.header();
+
+		switch (header.cmd) {
+		case CmdExit:
+			exit_ = true;
+			break;
+
+		case CmdEcho: {
+			IPCMessage response(header);
+			response.data() = message.data();
+			response.fds() = message.fds();
+			reply(response);
+			break;
+		}
+
+		case CmdCount:
+			count_++;
+			break;
+
+		case CmdGetCount: {
+			IPCMessage response(header);
+			tie(response.data(), ignore) =
+				IPADataSerializer<uint32_t>::serialize(count_);
+			reply(response);
+			break;
+		}
+
+		case CmdGetBatches: {
+			IPCMessage response(header);
+			tie(response.data(), ignore) =
+				IPADataSerializer<uint32_t>::serialize(batches_);
+			reply(response);
+			break;
+		}
+		}
+	}
+
+	Channel ipc_;
+	EventDispatcher *dispatcher_;
+	uint32_t count_;
+	uint32_t batches_;
+	int exitCode_;
+	bool exit_;
+};
+
+class ShmTestIPC : public Test
+{
+protected:
+	static constexpr unsigned int kIterations = 5000;
+
+	int echo(IPCPipe *ipc, uint32_t cookie, const vector<uint8_t> &data,
+		 const vector<SharedFD> &fds, IPCMessage *response)
+	{
+		IPCMessage msg({ CmdEcho, cookie });
+		msg.data() = data;
+		msg.fds() = fds;
+
+		int ret = ipc->sendSync(msg, response);
+		if (ret < 0)
+			return ret;
+
+		if (response->data() != data ||
+		    response->fds().size() != fds.size()) {
+			cerr << "Echo mismatch" << endl;
+			return -EINVAL;
+		}
+
+		return 0;
+	}
+
+	int testTransport(IPCPipe *ipc, unsigned int burst)
+	{
+		uint32_t cookie = 0;
+		IPCMessage response;
+
+		if (echo(ipc, cookie++, { 1, 2, 3, 4 }, {}, &response) < 0)
+			return TestFail;
+
+		/* Messages that carry file descriptors go through the socket. */
+		int pipefds[2];
+		if (pipe(pipefds) < 0)
+			return TestFail;
+
+		SharedFD readfd(UniqueFD{ pipefds[0] });
+		SharedFD writefd(UniqueFD{ pipefds[1] });
+
+		if (echo(ipc, cookie++, { 5, 6 }, { readfd, writefd }, &response) < 0)
+			return TestFail;
+
+		struct stat orig, received;
+		fstat(writefd.get(), &orig);
+		fstat(response.fds()[1].get(), &received);
+		if (orig.st_ino != received.st_ino) {
+			cerr << "Invalid file descriptor received" << endl;
+			return TestFail;
+		}
+
+		/* Messages larger than the ring also go through the socket. */
+		vector<uint8_t> large(IPCShmChannel::kDefaultRingSize / 4 * 3);
+		for (size_t i = 0; i < large.size(); ++i)
+			large[i] = i * 7;
+
+		for (unsigned int i = 0; i < 3; ++i) {
+			if (echo(ipc, cookie++, large, {}, &response) < 0) {
+				cerr << "Large message echo failed" << endl;
+				return TestFail;
+			}
+		}
+
+		/* Async messages must be delivered in order with sync calls. */
+		for (unsigned int i = 0; i < burst; ++i) {
+			IPCMessage msg({ CmdCount, cookie++ });
+			if (ipc->sendAsync(msg) < 0)
+				return TestFail;
+		}
+
+		IPCMessage msg({ CmdGetCount, cookie++ });
+		if (ipc->sendSync(msg, &response) < 0)
+			return TestFail;
+
+		uint32_t count = IPADataSerializer<uint32_t>::deserialize(response.data());
+		if (count != burst) {
+			cerr << "Received " << count << " async messages" << endl;
+			return TestFail;
+		}
+
+		return TestPass;
+	}
+
+	int testBatching(IPCPipe *ipc)
+	{
+		constexpr unsigned int burst = 1000;
+		uint32_t cookie = 0x8000;
+		IPCMessage response;
+
+		IPCMessage msg({ CmdGetCount, cookie++ });
+		if (ipc->sendSync(msg, &response) < 0)
+			return TestFail;
+
+		uint32_t base = IPADataSerializer<uint32_t>::deserialize(response.data());
+
+		ipc->setBatching(true);
+
+		/*
+		 * Async messages sent in a row are packed in batches, which are
+		 * flushed before the sync call, and don't overflow the socket
+		 * queue. One message carries file descriptors.
+		 */
+		for (unsigned int i = 0; i < burst; ++i) {
+			IPCMessage message({ CmdCount, cookie++ });
+			if (i == burst / 2)
+				message.fds().push_back(SharedFD(UniqueFD(dup(0))));
+
+			if (ipc->sendAsync(message) < 0)
+				return TestFail;
+		}
+
+		msg = IPCMessage({ CmdGetCount, cookie++ });
+		if (ipc->sendSync(msg, &response) < 0)
+			return TestFail;
+
+		uint32_t count = IPADataSerializer<uint32_t>::deserialize(response.data());
+		if (count != base + burst) {
+			cerr << "Received " << count - base
+			     << " batched async messages" << endl;
+			return TestFail;
+		}
+
+		/* Messages sent from the event loop are flushed by the next iteration. */
+		IPCMessage countMsg({ CmdCount, cookie++ });
+		if (ipc->sendAsync(countMsg) < 0)
+			return TestFail;
+
+		Thread::current()->eventDispatcher()->processEvents();
+
+		msg = IPCMessage({ CmdGetBatches, cookie++ });
+		if (ipc->sendSync(msg, &response) < 0)
+			return TestFail;
+
+		uint32_t batches = IPADataSerializer<uint32_t>::deserialize(response.data());
+		if (batches != 2) {
+			cerr << "Received " << batches << " batches" << endl;
+			return TestFail;
+		}
+
+		ipc->setBatching(false);
+
+		return TestPass;
+	}
+
+	void benchmark(const char *name, IPCPipe *ipc)
+	{
+		IPCMessage response;
+		uint32_t cookie = 0x10000;
+
+		cout << setw(8) << name;
+
+		for (size_t size : { 64, 4096, 65536 }) {
+			vector<uint8_t> data(size);
+
+			auto start = chrono::steady_clock::now();
+			for (unsigned int i = 0; i < kIterations; ++i)
+				echo(ipc, cookie++, data, {}, &response);
+			auto end = chrono::steady_clock::now();
+
+			cout << setw(12)
+			     << chrono::duration_cast<chrono::nanoseconds>(end - start).count()
+				/ kIterations / 1000.0;
+		}
+
+		cout << endl;
+	}
+
+	int run()
+	{
+		const char *transports[] = { "socket", "shm" };
+
+		/*
+		 * Each message takes two datagrams on the socket, whose queue
+		 * is limited by net.unix.max_dgram_qlen (10 by default), while
+		 * the shared memory ring can absorb large bursts.
+		 */
+		const unsigned int bursts[] = { 4, 1000 };
+		unique_ptr<IPCPipe> pipes[2] = {
+			make_unique<IPCPipeUnixSocket>("", self().c_str()),
+			make_unique<IPCPipeShm>("", self().c_str()),
+		};
+
+		for (unsigned int i = 0; i < 2; ++i) {
+			if (!pipes[i]->isConnected()) {
+				cerr << "Failed to create " << transports[i]
+				     << " IPCPipe" << endl;
+				return TestFail;
+			}
+
+			if (testTransport(pipes[i].get(), bursts[i]) != TestPass) {
+				cerr << "Transport " << transports[i] << " failed" << endl;
+				return TestFail;
+			}
+
+			if (testBatching(pipes[i].get()) != TestPass) {
+				cerr << "Batching on " << transports[i] << " failed" << endl;
+				return TestFail;
+			}
+		}
+
+		cout << "Round trip latency (us): 64 B, 4 KiB, 64 KiB" << endl;
+		for (unsigned int i = 0; i < 2; ++i)
+			benchmark(transports[i], pipes[i].get());
+
+		for (auto &pipe : pipes)
+			pipe->sendAsync(IPCMessage(CmdExit));
+
+		return TestPass;
+	}
+
+private:
+	ProcessManager processManager_;
+};
+
+/*
+ * Can't use TEST_REGISTER() as single binary needs to act as both client and
+ * server
+ */
+int main(int argc, char **argv)
+{
+	/* The IPCPipe passes the IPA module path in argv[1] */
+	if (argc == 3) {
+		ShmTestIPCWorker<IPCUnixSocket> worker;
+		return worker.run(UniqueFD(std::stoi(argv[2])));
+	}
+
+	if (argc == 4 && !strcmp(argv[3], "shm")) {
+		ShmTestIPCWorker<IPCShmChannel> worker;
+		return worker.run(UniqueFD(std::stoi(argv[2])));
+	}
+
+	ShmTestIPC test;
+	test.setArgs(argc, argv);
+	return test.execute();
+}
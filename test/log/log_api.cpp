@@ -14,7 +14,9 @@
 #include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <thread>
 #include <unistd.h>
+#include <vector>
 
 #include <libcamera/base/log.h>
 
@@ -23,6 +25,7 @@
 #include "test.h"
 
 using namespace std;
+using namespace std::chrono_literals;
 using namespace libcamera;
 
 LOG_DEFINE_CATEGORY(LogAPITest)
@@ -118,6 +121,122 @@ protected:
 		return verifyOutput(log);
 	}
 
+	int testBinary()
+	{
+		int fd = open("/tmp", O_TMPFILE | O_RDWR, S_IRUSR | S_IWUSR);
+		if (fd < 0) {
+			cerr << "Failed to open tmp log file" << endl;
+			return TestFail;
+		}
+
+		char path[32];
+		snprintf(path, sizeof(path), "/proc/self/fd/%u", fd);
+
+		if (logSetBinaryFile(path) < 0) {
+			cerr << "Failed to set binary log file" << endl;
+			close(fd);
+			return TestFail;
+		}
+
+		doLogging();
+
+		/*
+		 * Binary log files are only flushed on errors, the last warning
+		 * must not have been written yet.
+		 */
+		vector<uint8_t> data(4096);
+		ssize_t size = pread(fd, data.data(), data.size(), 0);
+		string flushed(reinterpret_cast<char *>(data.data()), max<ssize_t>(size, 0));
+		if (flushed.find("good 3") == string::npos ||
+		    flushed.find("good 5") != string::npos) {
+			cerr << "Binary log not flushed on error" << endl;
+			close(fd);
+			return TestFail;
+		}
+
+		/* Closing the log file flushes it. */
+		logSetTarget(LoggingTargetNone);
+
+		lseek(fd, 0, SEEK_SET);
+		size = read(fd, data.data(), data.size());
+		close(fd);
+		if (size < 0) {
+			cerr << "Failed to read tmp log file" << endl;
+			return TestFail;
+		}
+
+		data.resize(size);
+
+		/* Decode the records and extract the message text. */
+		auto readValue = [&](size_t *offset, auto *value) {
+			if (*offset + sizeof(*value) > data.size())
+				return false;
+			memcpy(value, &data[*offset], sizeof(*value));
+			*offset += sizeof(*value);
+			return true;
+		};
+
+		size_t offset = 0;
+		uint32_t magic, version;
+		if (!readValue(&offset, &magic) || !readValue(&offset, &version) ||
+		    magic != 0x4c42434c || version != 1) {
+			cerr << "Invalid binary log header" << endl;
+			return TestFail;
+		}
+
+		stringstream messages;
+		unsigned int categories = 0;
+		unsigned int locations = 0;
+
+		while (offset < data.size()) {
+			uint8_t type = data[offset++];
+			uint16_t length16;
+			uint32_t length32;
+
+			switch (type) {
+			case 1:
+				offset += sizeof(uint16_t);
+				readValue(&offset, &length16);
+				offset += length16;
+				categories++;
+				break;
+			case 2:
+				offset += sizeof(uint32_t);
+				readValue(&offset, &length16);
+				offset += length16;
+				locations++;
+				break;
+			case 3: {
+				offset += sizeof(uint64_t) + sizeof(uint32_t) +
+					  sizeof(uint16_t) + sizeof(uint8_t) +
+					  sizeof(uint32_t);
+				readValue(&offset, &length16);
+				readValue(&offset, &length32);
+				offset += length16;
+				if (offset + length32 > data.size()) {
+					cerr << "Truncated binary log record" << endl;
+					return TestFail;
+				}
+
+				messages << string(reinterpret_cast<char *>(&data[offset]), length32)
+					 << endl;
+				offset += length32;
+				break;
+			}
+			default:
+				cerr << "Invalid binary log record type " << type << endl;
+				return TestFail;
+			}
+		}
+
+		if (categories != 1 || locations != 3) {
+			cerr << "Invalid number of interned strings" << endl;
+			return TestFail;
+		}
+
+		return verifyOutput(messages);
+	}
+
 	int testTarget()
 	{
 		logSetTarget(LoggingTargetNone);
@@ -130,6 +249,73 @@ protected:
 		if (!logSetTarget(LoggingTargetStream))
 			return TestFail;
 
+		if (!logSetTarget(LoggingTargetBinary))
+			return TestFail;
+
+		return TestPass;
+	}
+
+	void logRateLimited(unsigned int count)
+	{
+		for (unsigned int i = 0; i < count; ++i)
+			LOG_RATELIMITED(LogAPITest, Info, 100ms) << "limited " << i;
+	}
+
+	int testRateLimit()
+	{
+		stringstream log;
+		logSetStream(&log);
+
+		/* Messages below the log level must not consume tokens. */
+		logSetLevel("LogAPITest", "WARN");
+		logRateLimited(10);
+
+		logSetLevel("LogAPITest", "INFO");
+		logRateLimited(100);
+
+		this_thread::sleep_for(150ms);
+		logRateLimited(1);
+
+		vector<string> lines;
+		string line;
+		while (getline(log, line))
+			lines.push_back(line);
+
+		unsigned int burst = LogRateLimiter::kDefaultBurst;
+		if (lines.size() != burst + 1) {
+			cout << "Rate limiting logged " << lines.size()
+			     << " messages, expected " << burst + 1 << endl;
+			return TestFail;
+		}
+
+		string summary = "limited 0 (" + to_string(100 - burst)
+			       + " similar messages suppressed)";
+		if (lines.back().find(summary) == string::npos) {
+			cout << "Invalid summary line: " << lines.back() << endl;
+			return TestFail;
+		}
+
+		/*
+		 * Messages still suppressed when the rate limiter is destroyed
+		 * are reported in a summary message.
+		 */
+		stringstream exitLog;
+		logSetStream(&exitLog);
+
+		{
+			LogRateLimiter limiter(_LOG_CATEGORY(LogAPITest)(), LogInfo);
+			for (unsigned int i = 0; i < 10; ++i)
+				limiter.limit(100ms);
+		}
+
+		logSetTarget(LoggingTargetNone);
+
+		summary = to_string(10 - burst) + " similar messages suppressed";
+		if (exitLog.str().find(summary) == string::npos) {
+			cout << "Invalid exit summary: " << exitLog.str() << endl;
+			return TestFail;
+		}
+
 		return TestPass;
 	}
 
@@ -143,10 +329,18 @@ protected:
 		if (ret != TestPass)
 			return TestFail;
 
+		ret = testBinary();
+		if (ret != TestPass)
+			return TestFail;
+
 		ret = testTarget();
 		if (ret != TestPass)
 			return TestFail;
 
+		ret = testRateLimit();
+		if (ret != TestPass)
+			return TestFail;
+
 		return TestPass;
 	}
 };
@@ -0,0 +1,250 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * log_async.cpp - Asynchronous log output test
+ */
+
+#include <atomic>
+#include <chrono>
+#include <fcntl.h>
+#include <iostream>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/syscall.h>
+#include <thread>
+#include <unistd.h>
+
+#include <libcamera/base/log.h>
+#include <libcamera/base/utils.h>
+
+#include <libcamera/logging.h>
+
+#include "test.h"
+
+using namespace std;
+using namespace libcamera;
+
+LOG_DEFINE_CATEGORY(LogAsyncTest)
+
+/* A stream buffer that simulates slow I/O. */
+class SlowBuffer : public stringbuf
+{
+protected:
+	streamsize xsputn(const char *s, streamsize count) override
+	{
+		this_thread::sleep_for(chrono::microseconds(500));
+		return stringbuf::xsputn(s, count);
+	}
+};
+
+class LogAsyncTest : public Test
+{
+protected:
+	static constexpr unsigned int kMessages = 2000;
+	/* Smaller than the ring buffer size set by the test environment. */
+	static constexpr unsigned int kBinaryMessages = 48;
+
+	int init() override
+	{
+		const char *policy = utils::secure_getenv("LIBCAMERA_LOG_ASYNC");
+		if (!policy) {
+			cout << "Asynchronous logging not enabled" << endl;
+			return TestSkip;
+		}
+
+		block_ = !strcmp(policy, "block");
+
+		return TestPass;
+	}
+
+	int testText()
+	{
+		SlowBuffer buffer;
+		ostream stream(&buffer);
+
+		logSetStream(&stream);
+		logSetLevel("LogAsyncTest", "INFO");
+
+		utils::time_point start = utils::clock::now();
+
+		for (unsigned int i = 0; i < kMessages; ++i)
+			LOG(LogAsyncTest, Info) << "message " << i;
+
+		utils::duration duration = utils::clock::now() - start;
+
+		/* Replacing the output drains the queued messages. */
+		logSetTarget(LoggingTargetNone);
+
+		cout << chrono::duration_cast<chrono::nanoseconds>(duration).count() / kMessages
+		     << " ns per message" << endl;
+
+		istringstream log(buffer.str());
+		unsigned int received = 0;
+		unsigned int dropped = 0;
+		int last = -1;
+		string line;
+
+		while (getline(log, line)) {
+			size_t pos = line.find(" log messages dropped");
+			if (pos != string::npos) {
+				size_t begin = line.rfind(' ', pos - 1) + 1;
+				dropped += stoul(line.substr(begin, pos - begin));
+
+				/* Drops are reported for the logging thread. */
+				begin = line.find("] [") + 3;
+				pid_t tid = stoi(line.substr(begin));
+				if (tid != syscall(SYS_gettid)) {
+					cout << "Dropped messages reported for thread "
+					     << tid << endl;
+					return TestFail;
+				}
+
+				continue;
+			}
+
+			pos = line.find("message ");
+			if (pos == string::npos) {
+				cout << "Unexpected log line: " << line << endl;
+				return TestFail;
+			}
+
+			int index = stoi(line.substr(pos + 8));
+			if (index <= last) {
+				cout << "Messages written out of order" << endl;
+				return TestFail;
+			}
+
+			last = index;
+			received++;
+		}
+
+		cout << received << " messages written, " << dropped
+		     << " dropped" << endl;
+
+		if (received + dropped != kMessages) {
+			cout << "Lost " << kMessages - received - dropped
+			     << " messages" << endl;
+			return TestFail;
+		}
+
+		if (last != kMessages - 1) {
+			cout << "Last message not written" << endl;
+			return TestFail;
+		}
+
+		if (block_ && dropped) {
+			cout << "Messages dropped with the block policy" << endl;
+			return TestFail;
+		}
+
+		return TestPass;
+	}
+
+	/*
+	 * Binary log files always use the block policy, all messages must be
+	 * written in order. Write them to a pipe that is only read after all
+	 * messages have been logged, with a pipe and stream buffers smaller
+	 * than the messages. If the records were written from the logging
+	 * thread, logging would block until the reader gives up waiting.
+	 */
+	int testBinary()
+	{
+		int fds[2];
+		if (pipe2(fds, O_CLOEXEC) < 0) {
+			cerr << "Failed to create pipe" << endl;
+			return TestFail;
+		}
+
+		fcntl(fds[1], F_SETPIPE_SZ, 4096);
+
+		char path[32];
+		snprintf(path, sizeof(path), "/proc/self/fd/%u", fds[1]);
+
+		if (logSetBinaryFile(path) < 0) {
+			cerr << "Failed to set binary log file" << endl;
+			close(fds[0]);
+			close(fds[1]);
+			return TestFail;
+		}
+
+		atomic<bool> logged = false;
+		bool timedOut = false;
+		string log;
+
+		thread reader([&]() {
+			auto timeout = chrono::steady_clock::now() + chrono::seconds(2);
+
+			while (!logged) {
+				if (chrono::steady_clock::now() > timeout) {
+					timedOut = true;
+					break;
+				}
+
+				this_thread::sleep_for(chrono::milliseconds(10));
+			}
+
+			char buf[4096];
+			ssize_t ret;
+			while ((ret = read(fds[0], buf, sizeof(buf))) > 0)
+				log.append(buf, ret);
+		});
+
+		const string padding(512, '.');
+
+		for (unsigned int i = 0; i < kBinaryMessages; ++i)
+			LOG(LogAsyncTest, Info) << "message " << i << " " << padding;
+
+		logged = true;
+
+		logSetTarget(LoggingTargetNone);
+		close(fds[1]);
+
+		reader.join();
+		close(fds[0]);
+
+		if (timedOut) {
+			cout << "Binary messages written synchronously" << endl;
+			return TestFail;
+		}
+
+		/* Find the message texts, they are stored verbatim. */
+		unsigned int received = 0;
+		size_t pos = 0;
+
+		while ((pos = log.find("message ", pos)) != string::npos) {
+			pos += 8;
+			if (stoul(log.substr(pos)) != received) {
+				cout << "Binary message missing or out of order" << endl;
+				return TestFail;
+			}
+
+			received++;
+		}
+
+		if (received != kBinaryMessages) {
+			cout << "Lost " << kBinaryMessages - received
+			     << " binary messages" << endl;
+			return TestFail;
+		}
+
+		return TestPass;
+	}
+
+	int run() override
+	{
+		int ret = testText();
+		if (ret != TestPass)
+			return ret;
+
+		return testBinary();
+	}
+
+private:
+	bool block_;
+};
+
+TEST_REGISTER(LogAsyncTest)
@@ -0,0 +1,116 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * media_device_enumeration.cpp - Test parallel population of media devices
+ */
+
+#include <glob.h>
+#include <iostream>
+#include <memory>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include "libcamera/internal/device_enumerator.h"
+#include "libcamera/internal/media_device.h"
+
+#include "test.h"
+
+using namespace libcamera;
+using namespace std;
+
+namespace {
+
+class TestDeviceEnumerator : public DeviceEnumerator
+{
+public:
+	int init() override { return 0; }
+	int enumerate() override { return 0; }
+
+	vector<unique_ptr<MediaDevice>> populate(const vector<string> &deviceNodes,
+						 const char *threads)
+	{
+		setenv("LIBCAMERA_DEVICE_ENUMERATION_THREADS", threads, 1);
+		vector<unique_ptr<MediaDevice>> devices = createDevices(deviceNodes);
+		unsetenv("LIBCAMERA_DEVICE_ENUMERATION_THREADS");
+
+		return devices;
+	}
+};
+
+} /* namespace */
+
+class MediaDeviceEnumerationTest : public Test
+{
+protected:
+	int init() override
+	{
+		glob_t globbuf;
+		if (glob("/dev/media*", 0, nullptr, &globbuf)) {
+			cerr << "No media device found: skip test" << endl;
+			return TestSkip;
+		}
+
+		/*
+		 * Populate each media device several times to give all worker
+		 * threads some work.
+		 */
+		for (unsigned int i = 0; i < 4; ++i) {
+			for (size_t j = 0; j < globbuf.gl_pathc; ++j)
+				deviceNodes_.push_back(globbuf.gl_pathv[j]);
+		}
+
+		globfree(&globbuf);
+
+		return TestPass;
+	}
+
+	int run() override
+	{
+		TestDeviceEnumerator enumerator;
+
+		vector<unique_ptr<MediaDevice>> serial =
+			enumerator.populate(deviceNodes_, "1");
+		vector<unique_ptr<MediaDevice>> parallel =
+			enumerator.populate(deviceNodes_, "4");
+
+		if (serial.size() != deviceNodes_.size() ||
+		    parallel.size() != deviceNodes_.size()) {
+			cerr << "Invalid number of media devices" << endl;
+			return TestFail;
+		}
+
+		for (size_t i = 0; i < deviceNodes_.size(); ++i) {
+			const MediaDevice *a = serial[i].get();
+			const MediaDevice *b = parallel[i].get();
+
+			if (!a != !b) {
+				cerr << "Media device " << deviceNodes_[i]
+				     << " populated in one mode only" << endl;
+				return TestFail;
+			}
+
+			if (!a)
+				continue;
+
+			if (a->deviceNode() != deviceNodes_[i] ||
+			    b->deviceNode() != deviceNodes_[i] ||
+			    a->driver() != b->driver() ||
+			    a->model() != b->model() ||
+			    a->entities().size() != b->entities().size()) {
+				cerr << "Media device " << deviceNodes_[i]
+				     << " differs between serial and parallel population"
+				     << endl;
+				return TestFail;
+			}
+		}
+
+		return TestPass;
+	}
+
+private:
+	vector<string> deviceNodes_;
+};
+
+TEST_REGISTER(MediaDeviceEnumerationTest)
@@ -0,0 +1,211 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * message-pool.cpp - Cross-thread invocation allocation test
+ */
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+#include <libcamera/base/message.h>
+#include <libcamera/base/object.h>
+#include <libcamera/base/signal.h>
+#include <libcamera/base/thread.h>
+
+#include "test.h"
+
+using namespace std;
+using namespace libcamera;
+
+class Receiver : public Object
+{
+public:
+	Receiver()
+		: count_(0)
+	{
+	}
+
+	void add(unsigned int value)
+	{
+		count_.fetch_add(value, std::memory_order_release);
+	}
+
+	unsigned int sum(unsigned int a, unsigned int b)
+	{
+		return a + b;
+	}
+
+	unsigned int count() const { return count_.load(std::memory_order_acquire); }
+
+private:
+	std::atomic<unsigned int> count_;
+};
+
+class MessagePoolTest : public Test
+{
+protected:
+	static constexpr unsigned int kBatchSize = 64;
+	static constexpr unsigned int kBatches = 16;
+	static constexpr unsigned int kBurstSize = 1024;
+
+	bool waitFor(const Receiver &receiver, unsigned int count)
+	{
+		auto timeout = chrono::steady_clock::now() + chrono::seconds(5);
+
+		while (receiver.count() != count) {
+			if (chrono::steady_clock::now() > timeout)
+				return false;
+			this_thread::sleep_for(chrono::microseconds(100));
+		}
+
+		return true;
+	}
+
+	int init()
+	{
+		receiver_.moveToThread(&thread_);
+
+		return TestPass;
+	}
+
+	int run()
+	{
+		unsigned int expected = 0;
+
+		signal_.connect(&receiver_, &Receiver::add);
+
+		/*
+		 * Fill the pool with enough blocks for two full batches of
+		 * queued invocations and signal emissions. Queue them before
+		 * starting the thread to make sure they are all in flight at
+		 * the same time, and leave margin for the last messages of a
+		 * batch that may not have been freed yet when the next batch
+		 * starts.
+		 */
+		for (unsigned int i = 0; i < kBatchSize; ++i) {
+			receiver_.invokeMethod(&Receiver::add, ConnectionTypeQueued, 1);
+			signal_.emit(1);
+		}
+
+		thread_.start();
+
+		expected += 2 * kBatchSize;
+		if (!waitFor(receiver_, expected)) {
+			cout << "Warm-up invocations not delivered" << endl;
+			return TestFail;
+		}
+
+		details::MessagePoolStatistics before = details::messagePoolStatistics();
+
+		for (unsigned int batch = 0; batch < kBatches; ++batch) {
+			for (unsigned int i = 0; i < kBatchSize / 2; ++i) {
+				receiver_.invokeMethod(&Receiver::add,
+						       ConnectionTypeQueued, 1);
+				signal_.emit(1);
+			}
+
+			expected += kBatchSize;
+			if (!waitFor(receiver_, expected)) {
+				cout << "Queued invocations not delivered" << endl;
+				return TestFail;
+			}
+		}
+
+		unsigned int sum = receiver_.invokeMethod(&Receiver::sum,
+							  ConnectionTypeBlocking,
+							  20, 22);
+		if (sum != 42) {
+			cout << "Blocking invocation returned " << sum << endl;
+			return TestFail;
+		}
+
+		details::MessagePoolStatistics after = details::messagePoolStatistics();
+		uint64_t heap = after.heapAllocations - before.heapAllocations;
+		uint64_t oversized = after.oversizedAllocations - before.oversizedAllocations;
+
+		cout << kBatches * kBatchSize + 1 << " invocations, "
+		     << heap << " heap allocations, "
+		     << oversized << " oversized allocations" << endl;
+
+		if (heap || oversized) {
+			cout << "Steady-state invocations allocated memory" << endl;
+			return TestFail;
+		}
+
+		/*
+		 * Stop the receiving thread and check that the blocks it freed
+		 * are reused for invocations to an object living in a new
+		 * thread.
+		 */
+		thread_.exit(0);
+		thread_.wait();
+
+		Thread thread;
+		Receiver receiver;
+		receiver.moveToThread(&thread);
+		thread.start();
+
+		before = details::messagePoolStatistics();
+
+		for (unsigned int i = 0; i < kBatchSize / 2; ++i)
+			receiver.invokeMethod(&Receiver::add, ConnectionTypeQueued, 1);
+
+		if (!waitFor(receiver, kBatchSize / 2)) {
+			cout << "Invocations after thread exit not delivered" << endl;
+			return TestFail;
+		}
+
+		after = details::messagePoolStatistics();
+		if (after.heapAllocations != before.heapAllocations) {
+			cout << "Blocks freed by exited thread not reused" << endl;
+			return TestFail;
+		}
+
+		/*
+		 * Queue a burst of invocations larger than the free list cap
+		 * with the thread stopped, and check that the blocks in excess
+		 * are returned to the heap once delivered.
+		 */
+		thread.exit(0);
+		thread.wait();
+
+		before = details::messagePoolStatistics();
+
+		for (unsigned int i = 0; i < kBurstSize; ++i)
+			receiver.invokeMethod(&Receiver::add, ConnectionTypeQueued, 1);
+
+		thread.start();
+
+		if (!waitFor(receiver, kBatchSize / 2 + kBurstSize)) {
+			cout << "Burst invocations not delivered" << endl;
+			return TestFail;
+		}
+
+		thread.exit(0);
+		thread.wait();
+
+		after = details::messagePoolStatistics();
+		if (after.heapFrees == before.heapFrees) {
+			cout << "Pool not trimmed after burst" << endl;
+			return TestFail;
+		}
+
+		return TestPass;
+	}
+
+	void cleanup()
+	{
+		thread_.exit(0);
+		thread_.wait();
+	}
+
+private:
+	Thread thread_;
+	Receiver receiver_;
+	Signal<unsigned int> signal_;
+};
+
+TEST_REGISTER(MessagePoolTest)
@@ -0,0 +1,177 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * message-queue.cpp - Cross-thread message queue test and benchmark
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <libcamera/base/message.h>
+#include <libcamera/base/object.h>
+#include <libcamera/base/thread.h>
+#include <libcamera/base/utils.h>
+
+#include "test.h"
+
+using namespace std;
+using namespace libcamera;
+
+class SequenceMessage : public Message
+{
+public:
+	SequenceMessage(unsigned int producer, unsigned int sequence)
+		: Message(type()), producer_(producer), sequence_(sequence),
+		  timestamp_(utils::clock::now())
+	{
+	}
+
+	static Message::Type type()
+	{
+		static Message::Type type = Message::registerMessageType();
+		return type;
+	}
+
+	unsigned int producer_;
+	unsigned int sequence_;
+	utils::time_point timestamp_;
+};
+
+class SequenceReceiver : public Object
+{
+public:
+	SequenceReceiver(unsigned int producers, unsigned int messages)
+		: sequences_(producers, 0), ordered_(true), received_(0)
+	{
+		latencies_.reserve(producers * messages);
+	}
+
+	bool ordered() const { return ordered_; }
+	unsigned int received() const { return received_.load(std::memory_order_acquire); }
+	utils::time_point last() const { return last_; }
+	std::vector<utils::duration> &latencies() { return latencies_; }
+
+protected:
+	void message(Message *msg) override
+	{
+		if (msg->type() != SequenceMessage::type()) {
+			Object::message(msg);
+			return;
+		}
+
+		SequenceMessage *seqMsg = static_cast<SequenceMessage *>(msg);
+
+		last_ = utils::clock::now();
+		latencies_.push_back(last_ - seqMsg->timestamp_);
+
+		/* Messages from each producer must be delivered in order. */
+		if (seqMsg->sequence_ != sequences_[seqMsg->producer_])
+			ordered_ = false;
+		sequences_[seqMsg->producer_] = seqMsg->sequence_ + 1;
+
+		received_.fetch_add(1, std::memory_order_release);
+	}
+
+private:
+	std::vector<unsigned int> sequences_;
+	std::vector<utils::duration> latencies_;
+	utils::time_point last_;
+	bool ordered_;
+	std::atomic<unsigned int> received_;
+};
+
+class MessageQueueTest : public Test
+{
+protected:
+	int runProducers(unsigned int producers)
+	{
+		static constexpr unsigned int kMessages = 20000;
+
+		const unsigned int perProducer = kMessages / producers;
+		const unsigned int total = perProducer * producers;
+
+		Thread thread;
+		SequenceReceiver receiver(producers, perProducer);
+		receiver.moveToThread(&thread);
+		thread.start();
+
+		utils::time_point start = utils::clock::now();
+
+		std::vector<std::thread> threads;
+		for (unsigned int i = 0; i < producers; ++i) {
+			threads.emplace_back([&receiver, i, perProducer]() {
+				for (unsigned int j = 0; j < perProducer; ++j)
+					receiver.postMessage(std::make_unique<SequenceMessage>(i, j));
+			});
+		}
+
+		for (std::thread &producer : threads)
+			producer.join();
+
+		/* Wait for all messages to be delivered. */
+		utils::time_point timeout = utils::clock::now() + std::chrono::seconds(10);
+		while (receiver.received() != total && utils::clock::now() < timeout)
+			this_thread::sleep_for(chrono::milliseconds(1));
+
+		thread.exit(0);
+		thread.wait();
+
+		if (receiver.received() != total) {
+			cout << "Received " << receiver.received() << " messages, "
+			     << total << " expected" << endl;
+			return TestFail;
+		}
+
+		if (!receiver.ordered()) {
+			cout << "Messages delivered out of order" << endl;
+			return TestFail;
+		}
+
+		std::vector<utils::duration> &latencies = receiver.latencies();
+		std::sort(latencies.begin(), latencies.end());
+
+		auto percentile = [&](unsigned int pct) {
+			size_t index = std::min(latencies.size() - 1,
+						latencies.size() * pct / 100);
+			return chrono::duration_cast<chrono::microseconds>(latencies[index]).count();
+		};
+
+		double seconds = chrono::duration<double>(receiver.last() - start).count();
+
+		cout << std::setw(9) << producers
+		     << std::setw(12) << static_cast<unsigned int>(total / seconds)
+		     << std::setw(10) << percentile(50)
+		     << std::setw(10) << percentile(99)
+		     << std::setw(10) << percentile(100)
+		     << endl;
+
+		return TestPass;
+	}
+
+	int run()
+	{
+		/*
+		 * Measure the throughput and latency of message delivery with a
+		 * growing number of producer threads, verifying ordering along
+		 * the way. Performance figures are informative only.
+		 */
+		cout << "producers    msgs/s   p50 (us)  p99 (us)  max (us)" << endl;
+
+		for (unsigned int producers : { 1, 2, 4, 8 }) {
+			int ret = runProducers(producers);
+			if (ret != TestPass)
+				return ret;
+		}
+
+		return TestPass;
+	}
+};
+
+TEST_REGISTER(MessageQueueTest)
@@ -9,6 +9,7 @@
 #include <iostream>
 #include <memory>
 #include <thread>
+#include <vector>
 
 #include <libcamera/base/message.h>
 #include <libcamera/base/thread.h>
@@ -111,6 +112,37 @@ protected:
 	}
 };
 
+class OrderedMessageReceiver : public Object
+{
+public:
+	OrderedMessageReceiver(Message::Type repostType)
+		: repostType_(repostType)
+	{
+	}
+
+	const std::vector<Message::Type> &received() const { return received_; }
+
+protected:
+	void message(Message *msg)
+	{
+		/*
+		 * Post one message of each type when receiving the first
+		 * message of the repost type.
+		 */
+		if (msg->type() == repostType_ && repostType_ != Message::None) {
+			postMessage(std::make_unique<Message>(repostType_));
+			postMessage(std::make_unique<Message>(Message::Type(repostType_ + 1)));
+			repostType_ = Message::None;
+		}
+
+		received_.push_back(msg->type());
+	}
+
+private:
+	Message::Type repostType_;
+	std::vector<Message::Type> received_;
+};
+
 class MessageTest : public Test
 {
 protected:
@@ -182,6 +214,32 @@ protected:
 			return TestFail;
 		}
 
+		/*
+		 * Test dispatching messages of a given type. Messages of other
+		 * types shall stay queued in their original order, and messages
+		 * of the type posted during dispatch shall be delivered.
+		 */
+		OrderedMessageReceiver orderedReceiver(msgType[0]);
+
+		for (unsigned int i = 0; i < 4; ++i)
+			orderedReceiver.postMessage(std::make_unique<Message>(msgType[i % 2]));
+
+		Thread::current()->dispatchMessages(msgType[0]);
+
+		std::vector<Message::Type> expected(3, msgType[0]);
+		if (orderedReceiver.received() != expected) {
+			cout << "Typed message dispatch failed" << endl;
+			return TestFail;
+		}
+
+		Thread::current()->dispatchMessages();
+
+		expected.insert(expected.end(), 3, msgType[1]);
+		if (orderedReceiver.received() != expected) {
+			cout << "Messages left by typed dispatch not delivered" << endl;
+			return TestFail;
+		}
+
 		return TestPass;
 	}
 
@@ -0,0 +1,250 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * control_delta_serialization.cpp - Delta-encoded ControlList serialization
+ */
+
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include <linux/v4l2-controls.h>
+
+#include <libcamera/control_ids.h>
+#include <libcamera/controls.h>
+
+#include "libcamera/internal/byte_stream_buffer.h"
+#include "libcamera/internal/control_serializer.h"
+
+#include "test.h"
+
+using namespace std;
+using namespace libcamera;
+
+class ControlDeltaSerializationTest : public Test
+{
+protected:
+	static constexpr unsigned int kFrames = 300;
+
+	int init() override
+	{
+		/* Model the sensor controls of a Raspberry Pi camera sensor. */
+		static const struct {
+			unsigned int id;
+			int32_t min;
+			int32_t max;
+		} sensorControls[] = {
+			{ V4L2_CID_EXPOSURE, 4, 65515 },
+			{ V4L2_CID_ANALOGUE_GAIN, 0, 978 },
+			{ V4L2_CID_VBLANK, 32, 65311 },
+			{ V4L2_CID_HBLANK, 1816, 1816 },
+		};
+
+		ControlInfoMap::Map map;
+
+		for (const auto &ctrl : sensorControls) {
+			ids_.push_back(make_unique<ControlId>(ctrl.id, "",
+							      ControlTypeInteger32));
+			idmap_[ctrl.id] = ids_.back().get();
+			map.emplace(ids_.back().get(), ControlInfo(ctrl.min, ctrl.max));
+		}
+
+		sensorInfo_ = ControlInfoMap(std::move(map), idmap_);
+
+		return TestPass;
+	}
+
+	/*
+	 * Generate the sensor controls and metadata of a frame, modelled after
+	 * a Raspberry Pi capture session: AGC and AWB converge during the first
+	 * frames, then only adjust occasionally, while statistics-derived
+	 * values and timestamps change on every frame.
+	 */
+	void generate(unsigned int frame, ControlList &sensor, ControlList &metadata)
+	{
+		bool converging = frame < 30;
+		unsigned int step = converging ? frame : 30 + (frame - 30) / 20;
+
+		int32_t exposure = 1000 + step * 150;
+		int32_t gain = 200 + (step % 7) * 10;
+		float colourTemp = 4500 + (converging ? frame * 20 : 600 + (frame / 50) * 10);
+
+		sensor.set(V4L2_CID_EXPOSURE, ControlValue(exposure));
+		sensor.set(V4L2_CID_ANALOGUE_GAIN, ControlValue(gain));
+		if (frame % 100 == 0)
+			sensor.set(V4L2_CID_VBLANK, ControlValue(static_cast<int32_t>(1000 + frame)));
+
+		metadata.set(controls::SensorTimestamp, 1000000000LL + frame * 33333333LL);
+		metadata.set(controls::FrameDuration, 33333);
+		metadata.set(controls::ExposureTime, exposure * 10);
+		metadata.set(controls::AnalogueGain, 1.0f + gain / 100.0f);
+		metadata.set(controls::DigitalGain, 1.0f);
+		metadata.set(controls::AeLocked, !converging);
+		metadata.set(controls::Lux, 400.0f + 5.0f * std::sin(frame / 3.0f));
+		metadata.set(controls::ColourTemperature, static_cast<int32_t>(colourTemp));
+		metadata.set(controls::ColourGains, { 1.5f + colourTemp / 10000.0f, 1.8f });
+		metadata.set(controls::SensorBlackLevels, { 4096, 4096, 4096, 4096 });
+
+		float ccm[9] = {
+			1.6f, -0.4f, -0.2f,
+			-0.3f, 1.5f, -0.2f,
+			0.0f, -0.6f, colourTemp / 3000.0f,
+		};
+		metadata.set(controls::ColourCorrectionMatrix, ccm);
+		metadata.set(controls::ScalerCrop, Rectangle(0, 0, 4056, 3040));
+		metadata.set(controls::FocusFoM, static_cast<int32_t>(1200 + frame % 13));
+
+		/* Exercise removal of controls from the list. */
+		if (frame % 64 == 63)
+			metadata = ControlList(controls::controls);
+	}
+
+	static bool equal(const ControlList &a, const ControlList &b)
+	{
+		if (a.size() != b.size())
+			return false;
+
+		auto it = b.begin();
+		for (const auto &[id, value] : a) {
+			if (it->first != id || it->second != value)
+				return false;
+			++it;
+		}
+
+		return true;
+	}
+
+	static size_t serialize(ControlSerializer &serializer,
+				const ControlList &list, vector<uint8_t> &data)
+	{
+		data.resize(serializer.binarySize(list));
+
+		ByteStreamBuffer buffer(data.data(), data.size());
+		if (serializer.serialize(list, buffer) < 0 || buffer.overflow())
+			return 0;
+
+		data.resize(buffer.offset());
+		return data.size();
+	}
+
+	int run() override
+	{
+		ControlSerializer full(ControlSerializer::Role::Worker);
+		ControlSerializer delta(ControlSerializer::Role::Worker);
+		ControlSerializer peer(ControlSerializer::Role::Proxy);
+		vector<uint8_t> data;
+
+		delta.setDeltaEncoding(ControlSerializer::kDefaultKeyframeInterval);
+
+		/* Serialize the sensor ControlInfoMap to both serializers. */
+		data.resize(ControlSerializer::binarySize(sensorInfo_));
+		ByteStreamBuffer infoBuffer(data.data(), data.size());
+		if (delta.serialize(sensorInfo_, infoBuffer) < 0) {
+			cerr << "Failed to serialize ControlInfoMap" << endl;
+			return TestFail;
+		}
+
+		ByteStreamBuffer infoReader(const_cast<const uint8_t *>(data.data()),
+					    data.size());
+		peer.deserialize<ControlInfoMap>(infoReader);
+
+		data.resize(ControlSerializer::binarySize(sensorInfo_));
+		ByteStreamBuffer fullInfoBuffer(data.data(), data.size());
+		full.serialize(sensorInfo_, fullInfoBuffer);
+
+		size_t fullBytes = 0;
+		size_t deltaBytes = 0;
+
+		ControlList sensor(sensorInfo_);
+		ControlList metadata(controls::controls);
+
+		for (unsigned int frame = 0; frame < kFrames; ++frame) {
+			generate(frame, sensor, metadata);
+
+			for (const ControlList *list : { &sensor, &metadata }) {
+				size_t size = serialize(full, *list, data);
+				if (!size) {
+					cerr << "Full serialization failed" << endl;
+					return TestFail;
+				}
+				fullBytes += size;
+
+				size = serialize(delta, *list, data);
+				if (!size) {
+					cerr << "Delta serialization failed" << endl;
+					return TestFail;
+				}
+				deltaBytes += size;
+
+				ByteStreamBuffer buffer(const_cast<const uint8_t *>(data.data()),
+							data.size());
+				ControlList result = peer.deserialize<ControlList>(buffer);
+
+				if (!equal(result, *list)) {
+					cerr << "Delta deserialization mismatch at frame "
+					     << frame << endl;
+					return TestFail;
+				}
+			}
+		}
+
+		cout << "Bytes per frame: full " << fullBytes / kFrames
+		     << ", delta " << deltaBytes / kFrames << endl;
+
+		if (deltaBytes * 2 > fullBytes) {
+			cerr << "Delta encoding saved less than 50%" << endl;
+			return TestFail;
+		}
+
+		/* A delta that doesn't follow the previous packet must be rejected. */
+		metadata.set(controls::Lux, 1.0f);
+		serialize(delta, metadata, data);
+		metadata.set(controls::Lux, 2.0f);
+		serialize(delta, metadata, data);
+
+		ByteStreamBuffer buffer(const_cast<const uint8_t *>(data.data()),
+					data.size());
+		ControlList result = peer.deserialize<ControlList>(buffer);
+		if (!result.empty()) {
+			cerr << "Out of sequence delta accepted" << endl;
+			return TestFail;
+		}
+
+		/* Forcing a keyframe must resynchronize the peer. */
+		delta.forceKeyframe();
+		metadata.set(controls::Lux, 3.0f);
+		serialize(delta, metadata, data);
+
+		ByteStreamBuffer keyframe(const_cast<const uint8_t *>(data.data()),
+					  data.size());
+		result = peer.deserialize<ControlList>(keyframe);
+		if (!equal(result, metadata)) {
+			cerr << "Keyframe didn't resynchronize the peer" << endl;
+			return TestFail;
+		}
+
+		/* Controls set to an empty value must not be treated as removed. */
+		metadata.set(controls::Lux, 4.0f);
+		metadata.set(controls::FOCUS_FO_M, ControlValue());
+		serialize(delta, metadata, data);
+
+		ByteStreamBuffer none(const_cast<const uint8_t *>(data.data()),
+				      data.size());
+		result = peer.deserialize<ControlList>(none);
+		if (!equal(result, metadata) || !result.contains(controls::FOCUS_FO_M)) {
+			cerr << "Empty control value lost in delta" << endl;
+			return TestFail;
+		}
+
+		return TestPass;
+	}
+
+private:
+	vector<unique_ptr<ControlId>> ids_;
+	ControlIdMap idmap_;
+	ControlInfoMap sensorInfo_;
+};
+
+TEST_REGISTER(ControlDeltaSerializationTest)
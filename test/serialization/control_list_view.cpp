@@ -0,0 +1,324 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * control_list_view.cpp - Zero-copy ControlListView deserialization tests
+ */
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include <linux/v4l2-controls.h>
+
+#include <libcamera/control_ids.h>
+#include <libcamera/controls.h>
+
+#include "libcamera/internal/byte_stream_buffer.h"
+#include "libcamera/internal/control_serializer.h"
+#include "libcamera/internal/ipa_data_serializer.h"
+
+#include "test.h"
+
+using namespace std;
+using namespace libcamera;
+
+class ControlListViewTest : public Test
+{
+protected:
+	static constexpr unsigned int kIterations = 10000;
+
+	int init() override
+	{
+		static const unsigned int sensorControls[] = {
+			V4L2_CID_EXPOSURE,
+			V4L2_CID_ANALOGUE_GAIN,
+			V4L2_CID_VBLANK,
+		};
+
+		ControlInfoMap::Map map;
+
+		for (unsigned int id : sensorControls) {
+			ids_.push_back(make_unique<ControlId>(id, "", ControlTypeInteger32));
+			idmap_[id] = ids_.back().get();
+			map.emplace(ids_.back().get(), ControlInfo(0, 65535));
+		}
+
+		sensorInfo_ = ControlInfoMap(std::move(map), idmap_);
+
+		return TestPass;
+	}
+
+	/* Per-frame metadata as produced by a Raspberry Pi IPA. */
+	static ControlList metadata(unsigned int frame)
+	{
+		ControlList list(controls::controls);
+
+		list.set(controls::SensorTimestamp, 1000000000LL + frame * 33333333LL);
+		list.set(controls::FrameDuration, 33333);
+		list.set(controls::ExposureTime, 10000 + frame);
+		list.set(controls::AnalogueGain, 2.0f);
+		list.set(controls::DigitalGain, 1.0f);
+		list.set(controls::AeLocked, true);
+		list.set(controls::Lux, 400.0f);
+		list.set(controls::ColourTemperature, 5000);
+		list.set(controls::ColourGains, { 1.9f, 1.7f });
+		list.set(controls::SensorBlackLevels, { 4096, 4096, 4096, 4096 });
+		list.set(controls::ColourCorrectionMatrix, {
+			1.6f, -0.4f, -0.2f,
+			-0.3f, 1.5f, -0.2f,
+			0.0f, -0.6f, 1.6f,
+		});
+		list.set(controls::ScalerCrop, Rectangle(0, 0, 4056, 3040));
+		list.set(controls::FocusFoM, 1200);
+
+		return list;
+	}
+
+	static bool equal(const ControlList &a, const ControlList &b)
+	{
+		if (a.size() != b.size())
+			return false;
+
+		auto it = b.begin();
+		for (const auto &[id, value] : a) {
+			if (it->first != id || it->second != value)
+				return false;
+			++it;
+		}
+
+		return true;
+	}
+
+	int testView(ControlSerializer &serializer, ControlSerializer &peer,
+		     unsigned int frame)
+	{
+		ControlList list = metadata(frame);
+		vector<uint8_t> data;
+
+		tie(data, ignore) = IPADataSerializer<ControlList>::serialize(list, &serializer);
+
+		ControlListView view = IPADataSerializer<ControlListView>::deserialize(data, &peer);
+
+		if (view.size() != list.size()) {
+			cerr << "Invalid view size " << view.size() << endl;
+			return TestFail;
+		}
+
+		if (!view.contains(controls::LUX) || view.contains(controls::AE_ENABLE)) {
+			cerr << "Invalid contains() result" << endl;
+			return TestFail;
+		}
+
+		if (view.get(controls::ExposureTime) != 10000 + static_cast<int>(frame) ||
+		    view.get(controls::SensorTimestamp) != 1000000000LL + frame * 33333333LL ||
+		    view.get(controls::AeLocked) != true ||
+		    view.get(controls::ScalerCrop) != Rectangle(0, 0, 4056, 3040)) {
+			cerr << "Invalid scalar value" << endl;
+			return TestFail;
+		}
+
+		auto ccm = view.get(controls::ColourCorrectionMatrix);
+		if (!ccm || (*ccm)[0] != 1.6f || (*ccm)[8] != 1.6f) {
+			cerr << "Invalid array value" << endl;
+			return TestFail;
+		}
+
+		if (view.get(controls::AeEnable)) {
+			cerr << "Missing control returned a value" << endl;
+			return TestFail;
+		}
+
+		if (view.get(controls::LUX).get<float>() != 400.0f) {
+			cerr << "Invalid value retrieved by ID" << endl;
+			return TestFail;
+		}
+
+		if (!equal(view.toControlList(), list)) {
+			cerr << "Invalid conversion to ControlList" << endl;
+			return TestFail;
+		}
+
+		return TestPass;
+	}
+
+	/*
+	 * Send V4L2 controls from \a serializer to \a peer as a view, and send
+	 * the view back.
+	 */
+	int testV4L2(ControlSerializer &serializer, ControlSerializer &peer,
+		     unsigned int frame)
+	{
+		ControlList list(sensorInfo_);
+		list.set(V4L2_CID_EXPOSURE, ControlValue(static_cast<int32_t>(1000 + frame)));
+		list.set(V4L2_CID_ANALOGUE_GAIN, ControlValue(200));
+		list.set(V4L2_CID_VBLANK, ControlValue(32));
+
+		vector<uint8_t> data;
+		tie(data, ignore) = IPADataSerializer<ControlList>::serialize(list, &serializer);
+
+		ControlListView view = IPADataSerializer<ControlListView>::deserialize(data, &peer);
+		if (!view.infoMap() || view.infoMap()->idmap().count(V4L2_CID_EXPOSURE) != 1) {
+			cerr << "V4L2 view lost its ControlInfoMap" << endl;
+			return TestFail;
+		}
+
+		vector<uint8_t> copy;
+		tie(copy, ignore) = IPADataSerializer<ControlListView>::serialize(view, &peer);
+
+		ControlList copied = IPADataSerializer<ControlList>::deserialize(copy, &serializer);
+		if (copied.infoMap() != &sensorInfo_ || !equal(copied, list)) {
+			cerr << "Invalid round-trip of a V4L2 view" << endl;
+			return TestFail;
+		}
+
+		return TestPass;
+	}
+
+	template<typename Func>
+	static unsigned int measure(Func func)
+	{
+		auto start = chrono::steady_clock::now();
+
+		for (unsigned int i = 0; i < kIterations; ++i)
+			func();
+
+		auto end = chrono::steady_clock::now();
+		return chrono::duration_cast<chrono::nanoseconds>(end - start).count() / kIterations;
+	}
+
+	int run() override
+	{
+		ControlSerializer serializer(ControlSerializer::Role::Worker);
+		ControlSerializer peer(ControlSerializer::Role::Proxy);
+
+		/* Stateless streams are accessed in place. */
+		if (testView(serializer, peer, 0) != TestPass)
+			return TestFail;
+
+		/*
+		 * Values are packed in the serialized data, arrays are only
+		 * accessed in place when suitably aligned. This is guaranteed
+		 * when all values are 32-bit wide.
+		 */
+		ControlList list(controls::controls);
+		list.set(controls::ExposureTime, 10000);
+		list.set(controls::ColourGains, { 1.9f, 1.7f });
+		list.set(controls::ColourCorrectionMatrix, {
+			1.6f, -0.4f, -0.2f,
+			-0.3f, 1.5f, -0.2f,
+			0.0f, -0.6f, 1.6f,
+		});
+
+		vector<uint8_t> data;
+		tie(data, ignore) = IPADataSerializer<ControlList>::serialize(list, &serializer);
+
+		ControlListView view = IPADataSerializer<ControlListView>::deserialize(data, &peer);
+		auto ccm = view.get(controls::ColourCorrectionMatrix);
+		const uint8_t *ptr = reinterpret_cast<const uint8_t *>(ccm->data());
+		if (ptr < data.data() || ptr >= data.data() + data.size()) {
+			cerr << "Array value copied out of the serialized buffer" << endl;
+			return TestFail;
+		}
+
+		/* Delta-encoded streams must keep the serializer state in sync. */
+		ControlSerializer delta(ControlSerializer::Role::Worker);
+		ControlSerializer deltaPeer(ControlSerializer::Role::Proxy);
+		delta.setDeltaEncoding(ControlSerializer::kDefaultKeyframeInterval);
+
+		for (unsigned int frame = 0; frame < 10; ++frame) {
+			if (testView(delta, deltaPeer, frame) != TestPass) {
+				cerr << "Delta stream failed at frame " << frame << endl;
+				return TestFail;
+			}
+		}
+
+		/* Full lists of delta-encoded streams are accessed in place. */
+		ControlSerializer keyframe(ControlSerializer::Role::Worker);
+		ControlSerializer keyframePeer(ControlSerializer::Role::Proxy);
+		keyframe.setDeltaEncoding(ControlSerializer::kDefaultKeyframeInterval);
+
+		tie(data, ignore) = IPADataSerializer<ControlList>::serialize(list, &keyframe);
+
+		view = IPADataSerializer<ControlListView>::deserialize(data, &keyframePeer);
+		ccm = view.get(controls::ColourCorrectionMatrix);
+		ptr = reinterpret_cast<const uint8_t *>(ccm->data());
+		if (ptr < data.data() || ptr >= data.data() + data.size()) {
+			cerr << "Keyframe copied out of the serialized buffer" << endl;
+			return TestFail;
+		}
+
+		/* Views of serialized lists are serialized back verbatim. */
+		vector<uint8_t> copy;
+		tie(copy, ignore) = IPADataSerializer<ControlListView>::serialize(view, &serializer);
+
+		ControlList copied = IPADataSerializer<ControlList>::deserialize(copy, &peer);
+		if (!equal(copied, list)) {
+			cerr << "Invalid serialization of a view" << endl;
+			return TestFail;
+		}
+
+		/* Views of V4L2 controls carry their ControlInfoMap back. */
+		ControlSerializer v4l2(ControlSerializer::Role::Worker);
+		ControlSerializer v4l2Peer(ControlSerializer::Role::Proxy);
+
+		if (testV4L2(v4l2, v4l2Peer, 0) != TestPass)
+			return TestFail;
+
+		ControlSerializer v4l2Delta(ControlSerializer::Role::Worker);
+		ControlSerializer v4l2DeltaPeer(ControlSerializer::Role::Proxy);
+		v4l2Delta.setDeltaEncoding(ControlSerializer::kDefaultKeyframeInterval);
+		v4l2DeltaPeer.setDeltaEncoding(ControlSerializer::kDefaultKeyframeInterval);
+
+		for (unsigned int frame = 0; frame < 10; ++frame) {
+			if (testV4L2(v4l2Delta, v4l2DeltaPeer, frame) != TestPass) {
+				cerr << "V4L2 delta stream failed at frame " << frame << endl;
+				return TestFail;
+			}
+		}
+
+		/* Views of V4L2 controls without a ControlInfoMap are rejected. */
+		ControlListView orphan{ ControlList(idmap_) };
+		vector<uint8_t> buffer(ControlSerializer::binarySize(orphan));
+		ByteStreamBuffer stream(buffer.data(), buffer.size());
+		if (v4l2.serialize(orphan, stream) != -EINVAL) {
+			cerr << "V4L2 view without ControlInfoMap serialized" << endl;
+			return TestFail;
+		}
+
+		/* Compare full deserialization with a view for a few lookups. */
+		tie(data, ignore) = IPADataSerializer<ControlList>::serialize(metadata(0),
+									   &serializer);
+		int64_t sum = 0;
+
+		unsigned int full = measure([&]() {
+			ControlList result =
+				IPADataSerializer<ControlList>::deserialize(data, &peer);
+			sum += result.get(controls::ExposureTime).value_or(0);
+			sum += result.get(controls::SensorTimestamp).value_or(0);
+			sum += result.get(controls::ColourGains)->size();
+		});
+
+		unsigned int lazy = measure([&]() {
+			ControlListView result =
+				IPADataSerializer<ControlListView>::deserialize(data, &peer);
+			sum += result.get(controls::ExposureTime).value_or(0);
+			sum += result.get(controls::SensorTimestamp).value_or(0);
+			sum += result.get(controls::ColourGains)->size();
+		});
+
+		cout << "Deserialize and read 3 controls: ControlList " << full
+		     << " ns, ControlListView " << lazy << " ns"
+		     << (sum ? "" : " ") << endl;
+
+		return TestPass;
+	}
+
+private:
+	vector<unique_ptr<ControlId>> ids_;
+	ControlIdMap idmap_;
+	ControlInfoMap sensorInfo_;
+};
+
+TEST_REGISTER(ControlListViewTest)
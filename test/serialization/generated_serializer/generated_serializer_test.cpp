@@ -123,6 +123,93 @@ if (struct1.field != struct2.field) {				\
 		TEST_SCOPED_ENUM_EQUALITY(v[1], w[1], e);
 		TEST_SCOPED_ENUM_EQUALITY(v[1], w[1], f);
 
+		if (testFixedLayout() != TestPass)
+			return TestFail;
+
+		return TestPass;
+	}
+
+	int testFixedLayout()
+	{
+		/*
+		 * Structs with a fixed layout are serialized with memcpy(), check
+		 * that the result is identical to field by field serialization.
+		 */
+		ipa::test::TestFixedStruct t, u;
+
+		t.u32 = 0xdeadbeef;
+		t.i16 = -1234;
+		t.u16 = 0xcafe;
+		t.i64 = -0x123456789abcLL;
+		t.f = 3.14f;
+		t.i32 = -42;
+		t.d = 2.718281828;
+
+		std::vector<uint8_t> expected;
+		appendPOD<uint32_t>(expected, t.u32);
+		appendPOD<int16_t>(expected, t.i16);
+		appendPOD<uint16_t>(expected, t.u16);
+		appendPOD<int64_t>(expected, t.i64);
+		appendPOD<float>(expected, t.f);
+		appendPOD<int32_t>(expected, t.i32);
+		appendPOD<double>(expected, t.d);
+
+		std::vector<uint8_t> serialized;
+
+		std::tie(serialized, ignore) =
+			IPADataSerializer<ipa::test::TestFixedStruct>::serialize(t);
+
+		if (serialized != expected ||
+		    IPADataSerializer<ipa::test::TestFixedStruct>::binarySize(t) != expected.size()) {
+			cerr << "Fixed layout serialization mismatch" << endl;
+			return TestFail;
+		}
+
+		u = IPADataSerializer<ipa::test::TestFixedStruct>::deserialize(serialized);
+
+		TEST_FIELD_EQUALITY(t, u, u32);
+		TEST_FIELD_EQUALITY(t, u, i16);
+		TEST_FIELD_EQUALITY(t, u, u16);
+		TEST_FIELD_EQUALITY(t, u, i64);
+		TEST_FIELD_EQUALITY(t, u, f);
+		TEST_FIELD_EQUALITY(t, u, i32);
+		TEST_FIELD_EQUALITY(t, u, d);
+
+		/* Nested in containers, fixed layout structs keep their size. */
+		std::vector<ipa::test::TestFixedStruct> v = { t, t };
+		std::vector<ipa::test::TestFixedStruct> w;
+
+		std::tie(serialized, ignore) =
+			IPADataSerializer<vector<ipa::test::TestFixedStruct>>::serialize(v);
+
+		w = IPADataSerializer<vector<ipa::test::TestFixedStruct>>::deserialize(serialized);
+		if (w.size() != 2 || w[1].i64 != t.i64 || w[1].d != t.d) {
+			cerr << "Fixed layout vector serialization mismatch" << endl;
+			return TestFail;
+		}
+
+		/* Structs with padding are serialized field by field. */
+		ipa::test::TestPaddedStruct p = { 0x12, 0x34567890 };
+
+		std::tie(serialized, ignore) =
+			IPADataSerializer<ipa::test::TestPaddedStruct>::serialize(p);
+
+		expected.clear();
+		appendPOD<uint8_t>(expected, p.u8);
+		appendPOD<uint32_t>(expected, p.u32);
+
+		if (serialized != expected) {
+			cerr << "Padded struct serialization mismatch" << endl;
+			return TestFail;
+		}
+
+		ipa::test::TestPaddedStruct q =
+			IPADataSerializer<ipa::test::TestPaddedStruct>::deserialize(serialized);
+		if (q.u8 != p.u8 || q.u32 != p.u32) {
+			cerr << "Padded struct deserialization mismatch" << endl;
+			return TestFail;
+		}
+
 		return TestPass;
 	}
 
@@ -0,0 +1,285 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * raspberrypi_serialization.cpp - Raspberry Pi IPA message serialization
+ */
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+#include <linux/v4l2-controls.h>
+
+#include <libcamera/control_ids.h>
+#include <libcamera/controls.h>
+#include <libcamera/ipa/raspberrypi_ipa_serializer.h>
+
+#include "libcamera/internal/control_serializer.h"
+#include "libcamera/internal/ipa_data_serializer.h"
+#include "libcamera/internal/ipc_pipe.h"
+
+#include "test.h"
+
+using namespace std;
+using namespace libcamera;
+using namespace libcamera::ipa::RPi;
+
+class RaspberryPiSerializationTest : public Test
+{
+protected:
+	static constexpr unsigned int kIterations = 20000;
+
+	int init() override
+	{
+		static const struct {
+			unsigned int id;
+			int32_t min;
+			int32_t max;
+		} sensorControls[] = {
+			{ V4L2_CID_EXPOSURE, 4, 65515 },
+			{ V4L2_CID_ANALOGUE_GAIN, 0, 978 },
+			{ V4L2_CID_VBLANK, 32, 65311 },
+			{ V4L2_CID_HBLANK, 1816, 1816 },
+		};
+
+		ControlInfoMap::Map map;
+
+		for (const auto &ctrl : sensorControls) {
+			ids_.push_back(make_unique<ControlId>(ctrl.id, "",
+							      ControlTypeInteger32));
+			idmap_[ctrl.id] = ids_.back().get();
+			map.emplace(ids_.back().get(), ControlInfo(ctrl.min, ctrl.max));
+		}
+
+		sensorInfo_ = ControlInfoMap(std::move(map), idmap_);
+
+		return TestPass;
+	}
+
+	PrepareParams prepareParams(unsigned int frame)
+	{
+		PrepareParams params;
+
+		params.buffers = { frame % 4, frame % 4 + 4, frame % 4 + 8 };
+		params.ipaContext = frame % 16;
+		params.delayContext = (frame + 14) % 16;
+
+		params.sensorControls = ControlList(sensorInfo_);
+		params.sensorControls.set(V4L2_CID_EXPOSURE, ControlValue(1000 + static_cast<int32_t>(frame)));
+		params.sensorControls.set(V4L2_CID_ANALOGUE_GAIN, ControlValue(200));
+		params.sensorControls.set(V4L2_CID_VBLANK, ControlValue(1000));
+
+		params.requestControls = ControlList(controls::controls);
+		params.requestControls.set(controls::AeEnable, true);
+		params.requestControls.set(controls::ExposureTime, 10000);
+		params.requestControls.set(controls::AnalogueGain, 2.0f);
+		params.requestControls.set(controls::ColourGains, { 1.9f, 1.7f });
+		params.requestControls.set(controls::ScalerCrop, Rectangle(0, 0, 4056, 3040));
+
+		return params;
+	}
+
+	static bool equal(const ControlList &a, const ControlList &b)
+	{
+		if (a.size() != b.size())
+			return false;
+
+		auto it = b.begin();
+		for (const auto &[id, value] : a) {
+			if (it->first != id || it->second != value)
+				return false;
+			++it;
+		}
+
+		return true;
+	}
+
+	static bool equal(const BufferIds &a, const BufferIds &b)
+	{
+		return a.bayer == b.bayer && a.embedded == b.embedded &&
+		       a.stats == b.stats;
+	}
+
+	static void nestedBufferIds(const BufferIds &buffers, vector<uint8_t> &data)
+	{
+		vector<uint8_t> buffersData;
+		vector<uint8_t> field;
+
+		for (uint32_t id : { buffers.bayer, buffers.embedded, buffers.stats }) {
+			tie(field, ignore) = IPADataSerializer<uint32_t>::serialize(id);
+			buffersData.insert(buffersData.end(), field.begin(), field.end());
+		}
+
+		appendPOD<uint32_t>(data, buffersData.size());
+		data.insert(data.end(), buffersData.begin(), buffersData.end());
+	}
+
+	/*
+	 * Serialize a PrepareParams the way the proxies did before serializing
+	 * in place: every field is serialized to its own vector, concatenated to
+	 * the parameter data, which is then copied to the message and to the
+	 * payload sent over IPC.
+	 */
+	static IPCUnixSocket::Payload nestedPayload(const PrepareParams &params,
+						    ControlSerializer *cs)
+	{
+		vector<uint8_t> paramsData;
+		vector<uint8_t> field;
+
+		nestedBufferIds(params.buffers, paramsData);
+
+		for (const ControlList *list : { &params.sensorControls,
+						 &params.requestControls }) {
+			tie(field, ignore) = IPADataSerializer<ControlList>::serialize(*list, cs);
+			appendPOD<uint32_t>(paramsData, field.size());
+			paramsData.insert(paramsData.end(), field.begin(), field.end());
+		}
+
+		for (uint32_t context : { params.ipaContext, params.delayContext }) {
+			tie(field, ignore) = IPADataSerializer<uint32_t>::serialize(context);
+			paramsData.insert(paramsData.end(), field.begin(), field.end());
+		}
+
+		IPCMessage msg({ 0, 0 });
+		msg.data().insert(msg.data().end(), paramsData.begin(), paramsData.end());
+
+		return msg.payload();
+	}
+
+	template<typename Func>
+	static unsigned int measure(Func func)
+	{
+		auto start = chrono::steady_clock::now();
+
+		for (unsigned int i = 0; i < kIterations; ++i)
+			func(i);
+
+		auto end = chrono::steady_clock::now();
+		return chrono::duration_cast<chrono::nanoseconds>(end - start).count() / kIterations;
+	}
+
+	int testRoundTrip()
+	{
+		ControlSerializer serializer(ControlSerializer::Role::Proxy);
+		ControlSerializer peer(ControlSerializer::Role::Worker);
+
+		for (unsigned int frame = 0; frame < 4; ++frame) {
+			PrepareParams params = prepareParams(frame);
+
+			/* Serialize after existing data, as the proxies do. */
+			vector<uint8_t> data = { 0xde, 0xad, 0xbe, 0xef };
+			vector<SharedFD> fds;
+
+			size_t size = IPADataSerializer<PrepareParams>::binarySize(params, &serializer);
+			IPADataSerializer<PrepareParams>::serialize(params, data, fds, &serializer);
+
+			if (data.size() - 4 > size) {
+				cerr << "Serialized size " << data.size() - 4
+				     << " exceeds binarySize() " << size << endl;
+				return TestFail;
+			}
+
+			PrepareParams result =
+				IPADataSerializer<PrepareParams>::deserialize(data.cbegin() + 4,
+									      data.cend(),
+									      &peer);
+
+			if (!equal(result.buffers, params.buffers) ||
+			    result.ipaContext != params.ipaContext ||
+			    result.delayContext != params.delayContext ||
+			    !equal(result.sensorControls, params.sensorControls) ||
+			    !equal(result.requestControls, params.requestControls)) {
+				cerr << "PrepareParams mismatch at frame " << frame << endl;
+				return TestFail;
+			}
+		}
+
+		/* Structures without controls must serialize to the exact size. */
+		ProcessParams process = { { 1, 5, 9 }, 3 };
+		vector<uint8_t> data;
+		vector<SharedFD> fds;
+
+		tie(data, fds) = IPADataSerializer<ProcessParams>::serialize(process);
+		if (data.size() != IPADataSerializer<ProcessParams>::binarySize(process)) {
+			cerr << "Invalid ProcessParams binarySize()" << endl;
+			return TestFail;
+		}
+
+		ProcessParams processResult = IPADataSerializer<ProcessParams>::deserialize(data);
+		if (!equal(processResult.buffers, process.buffers) ||
+		    processResult.ipaContext != process.ipaContext) {
+			cerr << "ProcessParams mismatch" << endl;
+			return TestFail;
+		}
+
+		return TestPass;
+	}
+
+	int run() override
+	{
+		if (testRoundTrip() != TestPass)
+			return TestFail;
+
+		ControlSerializer serializer(ControlSerializer::Role::Proxy);
+		size_t sum = 0;
+
+		unsigned int nested = measure([&](unsigned int i) {
+			IPCUnixSocket::Payload payload =
+				nestedPayload(prepareParams(i), &serializer);
+			sum += payload.data.size();
+		});
+
+		unsigned int inPlace = measure([&](unsigned int i) {
+			PrepareParams params = prepareParams(i);
+			IPCMessage msg({ 0, 0 });
+
+			msg.data().reserve(IPADataSerializer<PrepareParams>::binarySize(params, &serializer));
+			IPADataSerializer<PrepareParams>::serialize(params, msg.data(),
+								    msg.fds(), &serializer);
+			sum += msg.iov()[1].iov_len;
+		});
+
+		cout << "PrepareParams: nested " << nested << " ns, in place "
+		     << inPlace << " ns" << (sum ? "" : " ") << endl;
+
+		ProcessParams process = { { 1, 5, 9 }, 3 };
+
+		nested = measure([&](unsigned int i) {
+			vector<uint8_t> paramsData;
+			vector<uint8_t> field;
+
+			process.ipaContext = i;
+			nestedBufferIds(process.buffers, paramsData);
+			tie(field, ignore) = IPADataSerializer<uint32_t>::serialize(process.ipaContext);
+			paramsData.insert(paramsData.end(), field.begin(), field.end());
+
+			IPCMessage msg({ 0, 0 });
+			msg.data().insert(msg.data().end(), paramsData.begin(), paramsData.end());
+			sum += msg.payload().data.size();
+		});
+
+		inPlace = measure([&](unsigned int i) {
+			IPCMessage msg({ 0, 0 });
+
+			process.ipaContext = i;
+			msg.data().reserve(IPADataSerializer<ProcessParams>::binarySize(process));
+			IPADataSerializer<ProcessParams>::serialize(process, msg.data(), msg.fds());
+			sum += msg.iov()[1].iov_len;
+		});
+
+		cout << "ProcessParams: nested " << nested << " ns, in place "
+		     << inPlace << " ns" << (sum ? "" : " ") << endl;
+
+		return TestPass;
+	}
+
+private:
+	vector<unique_ptr<ControlId>> ids_;
+	ControlIdMap idmap_;
+	ControlInfoMap sensorInfo_;
+};
+
+TEST_REGISTER(RaspberryPiSerializationTest)
@@ -0,0 +1,143 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * signal-emit.cpp - Signal emission allocation test and benchmark
+ */
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <new>
+#include <stdlib.h>
+
+#include <libcamera/base/object.h>
+#include <libcamera/base/signal.h>
+
+#include "test.h"
+
+using namespace std;
+using namespace libcamera;
+
+static std::atomic<unsigned int> allocations;
+
+void *operator new(size_t size)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+
+	void *ptr = malloc(size ? size : 1);
+	if (!ptr)
+		throw std::bad_alloc();
+
+	return ptr;
+}
+
+void operator delete(void *ptr) noexcept
+{
+	free(ptr);
+}
+
+void operator delete(void *ptr, [[maybe_unused]] size_t size) noexcept
+{
+	free(ptr);
+}
+
+class SlotObject : public Object
+{
+public:
+	SlotObject()
+		: count_(0)
+	{
+	}
+
+	void slot(unsigned int value) { count_ += value; }
+
+	unsigned int count() const { return count_; }
+
+private:
+	unsigned int count_;
+};
+
+class SignalEmitTest : public Test
+{
+protected:
+	int run()
+	{
+		static constexpr unsigned int kEmissions = 100000;
+
+		Signal<unsigned int> signal;
+		SlotObject objects[4];
+		unsigned int lambdaCount = 0;
+
+		for (SlotObject &object : objects)
+			signal.connect(&object, &SlotObject::slot);
+
+		signal.connect(this, [&](unsigned int value) { lambdaCount += value; });
+
+		/* Warm up, to exclude one-time allocations from the count. */
+		signal.emit(1);
+
+		unsigned int before = allocations.load(std::memory_order_relaxed);
+		auto start = chrono::steady_clock::now();
+
+		for (unsigned int i = 0; i < kEmissions; ++i)
+			signal.emit(1);
+
+		auto end = chrono::steady_clock::now();
+		unsigned int count = allocations.load(std::memory_order_relaxed) - before;
+
+		cout << "Allocations per emit: "
+		     << static_cast<double>(count) / kEmissions << endl;
+		cout << "Time per emit: "
+		     << chrono::duration_cast<chrono::nanoseconds>(end - start).count() / kEmissions
+		     << " ns (5 slots)" << endl;
+
+		for (const SlotObject &object : objects) {
+			if (object.count() != kEmissions + 1) {
+				cout << "Slot called " << object.count()
+				     << " times, expected " << kEmissions + 1 << endl;
+				return TestFail;
+			}
+		}
+
+		if (lambdaCount != kEmissions + 1) {
+			cout << "Lambda slot called " << lambdaCount
+			     << " times, expected " << kEmissions + 1 << endl;
+			return TestFail;
+		}
+
+		if (count) {
+			cout << "Signal emission allocated memory" << endl;
+			return TestFail;
+		}
+
+		/*
+		 * Connections modified during emission must not affect the
+		 * emission in progress, and must take effect for the next one.
+		 */
+		Signal<> reentrant;
+		unsigned int calls = 0;
+
+		reentrant.connect(this, [&]() {
+			calls++;
+			reentrant.connect(this, [&]() { calls += 10; });
+		});
+
+		reentrant.emit();
+		if (calls != 1) {
+			cout << "Slot connected during emission has been called" << endl;
+			return TestFail;
+		}
+
+		reentrant.disconnect();
+		reentrant.emit();
+		if (calls != 1) {
+			cout << "Disconnected slot has been called" << endl;
+			return TestFail;
+		}
+
+		return TestPass;
+	}
+};
+
+TEST_REGISTER(SignalEmitTest)
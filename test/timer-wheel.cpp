@@ -0,0 +1,178 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * timer-wheel.cpp - Timer stress test with a large number of re-armed timers
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include <libcamera/base/event_dispatcher.h>
+#include <libcamera/base/thread.h>
+#include <libcamera/base/timer.h>
+#include <libcamera/base/utils.h>
+
+#include "test.h"
+
+using namespace libcamera;
+using namespace std;
+using namespace std::chrono_literals;
+
+/*
+ * A timer re-armed on every expiry, mimicking a per-frame event at 120fps.
+ * Each frame also restarts a watchdog timer that never expires as long as
+ * frames keep coming.
+ */
+class FrameTimer : public Timer
+{
+public:
+	FrameTimer(std::chrono::milliseconds interval, vector<utils::duration> *lateness)
+		: interval_(interval), lateness_(lateness), early_(0), frames_(0)
+	{
+		timeout.connect(this, &FrameTimer::frame);
+		watchdog_.timeout.connect(this, &FrameTimer::watchdogExpired);
+	}
+
+	void start()
+	{
+		Timer::start(interval_);
+		watchdog_.start(500ms);
+	}
+
+	void stop()
+	{
+		Timer::stop();
+		watchdog_.stop();
+	}
+
+	unsigned int early() const { return early_; }
+	unsigned int frames() const { return frames_; }
+	bool watchdogFired() const { return watchdogFired_; }
+
+private:
+	void frame()
+	{
+		utils::time_point now = utils::clock::now();
+
+		if (now < deadline())
+			early_++;
+		else
+			lateness_->push_back(now - deadline());
+
+		frames_++;
+		start();
+	}
+
+	void watchdogExpired()
+	{
+		watchdogFired_ = true;
+	}
+
+	std::chrono::milliseconds interval_;
+	vector<utils::duration> *lateness_;
+	Timer watchdog_;
+
+	unsigned int early_;
+	unsigned int frames_;
+	bool watchdogFired_ = false;
+};
+
+class TimerWheelTest : public Test
+{
+protected:
+	static constexpr unsigned int kTimers = 1000;
+
+	int run()
+	{
+		EventDispatcher *dispatcher = Thread::current()->eventDispatcher();
+		vector<utils::duration> lateness;
+		vector<unique_ptr<FrameTimer>> timers;
+
+		lateness.reserve(kTimers * 150);
+
+		for (unsigned int i = 0; i < kTimers; ++i)
+			timers.push_back(make_unique<FrameTimer>(8ms, &lateness));
+
+		for (unique_ptr<FrameTimer> &timer : timers)
+			timer->start();
+
+		/*
+		 * Measure the cost of re-arming timers in the event dispatcher,
+		 * excluding the overhead of the Timer class.
+		 */
+		utils::time_point start = utils::clock::now();
+
+		for (unsigned int i = 0; i < 100; ++i) {
+			for (unique_ptr<FrameTimer> &timer : timers) {
+				dispatcher->unregisterTimer(timer.get());
+				dispatcher->registerTimer(timer.get());
+			}
+		}
+
+		utils::duration rearm = utils::clock::now() - start;
+
+		/* Let the timers run for one second. */
+		utils::time_point end = utils::clock::now() + 1s;
+		while (utils::clock::now() < end)
+			dispatcher->processEvents();
+
+		unsigned int early = 0;
+		unsigned int frames = 0;
+		bool watchdog = false;
+
+		for (unique_ptr<FrameTimer> &timer : timers) {
+			timer->stop();
+			early += timer->early();
+			frames += timer->frames();
+			watchdog |= timer->watchdogFired();
+		}
+
+		std::sort(lateness.begin(), lateness.end());
+
+		auto percentile = [&](unsigned int pct) {
+			size_t index = std::min(lateness.size() - 1,
+						lateness.size() * pct / 100);
+			return chrono::duration_cast<chrono::microseconds>(lateness[index]).count();
+		};
+
+		cout << kTimers * 2 << " timers, "
+		     << chrono::duration_cast<chrono::nanoseconds>(rearm).count() / (kTimers * 100)
+		     << " ns per re-arm, " << frames << " expiries" << endl;
+
+		if (lateness.empty()) {
+			cout << "No timer expired" << endl;
+			return TestFail;
+		}
+
+		cout << "Lateness p50 " << percentile(50) << " us, p99 "
+		     << percentile(99) << " us, max " << percentile(100)
+		     << " us" << endl;
+
+		if (early) {
+			cout << early << " timers expired before their deadline" << endl;
+			return TestFail;
+		}
+
+		if (watchdog) {
+			cout << "Re-armed watchdog timer expired" << endl;
+			return TestFail;
+		}
+
+		/*
+		 * Each timer should have expired close to 125 times, leave a large
+		 * margin to account for loaded test machines.
+		 */
+		if (frames < kTimers * 50) {
+			cout << "Timers expired too rarely" << endl;
+			return TestFail;
+		}
+
+		return TestPass;
+	}
+};
+
+TEST_REGISTER(TimerWheelTest)
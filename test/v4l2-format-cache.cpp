@@ -0,0 +1,245 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * v4l2-format-cache.cpp - V4L2 format cache test and startup benchmark
+ */
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include <libcamera/base/file.h>
+
+#include "libcamera/internal/device_enumerator.h"
+#include "libcamera/internal/media_device.h"
+#include "libcamera/internal/v4l2_format_cache.h"
+#include "libcamera/internal/v4l2_subdevice.h"
+#include "libcamera/internal/v4l2_videodevice.h"
+
+#include "test.h"
+
+using namespace std;
+using namespace libcamera;
+
+class V4L2FormatCacheTest : public Test
+{
+protected:
+	static constexpr unsigned int kIterations = 20;
+
+	int init() override
+	{
+		char tmpl[] = "/tmp/libcamera.v4l2_format_cache.XXXXXX";
+		if (!mkdtemp(tmpl)) {
+			cerr << "Failed to create temporary directory" << endl;
+			return TestFail;
+		}
+
+		dir_ = tmpl;
+
+		return TestPass;
+	}
+
+	int testCache()
+	{
+		string cachePath = dir_ + "/cache";
+		V4L2FormatCache::Formats formats = {
+			{ 0x2006, { SizeRange(Size(640, 480), Size(4096, 3072), 2, 2) } },
+			{ 0x3007, { SizeRange(Size(1920, 1080)), SizeRange(Size(3840, 2160)) } },
+		};
+
+		{
+			V4L2FormatCache cache(cachePath);
+			if (cache.load() != -ENOENT) {
+				cerr << "Missing cache file not reported" << endl;
+				return TestFail;
+			}
+
+			cache.setFormats("sensor|pad:0", formats);
+			cache.setFormats("sensor|pad:1", {});
+			if (!cache.isDirty() || cache.save() < 0) {
+				cerr << "Failed to save cache" << endl;
+				return TestFail;
+			}
+		}
+
+		{
+			V4L2FormatCache cache(cachePath);
+			if (cache.load() < 0 || cache.isDirty()) {
+				cerr << "Failed to load cache" << endl;
+				return TestFail;
+			}
+
+			const V4L2FormatCache::Formats *cached = cache.formats("sensor|pad:0");
+			if (!cached || *cached != formats) {
+				cerr << "Cached formats mismatch" << endl;
+				return TestFail;
+			}
+
+			cached = cache.formats("sensor|pad:1");
+			if (!cached || !cached->empty()) {
+				cerr << "Cached empty formats mismatch" << endl;
+				return TestFail;
+			}
+
+			if (cache.formats("sensor|pad:2")) {
+				cerr << "Formats retrieved for unknown key" << endl;
+				return TestFail;
+			}
+		}
+
+		/* Truncated cache files are rejected. */
+		struct stat st;
+		if (stat(cachePath.c_str(), &st) < 0 ||
+		    truncate(cachePath.c_str(), st.st_size - 4) < 0) {
+			cerr << "Failed to truncate cache file" << endl;
+			return TestFail;
+		}
+
+		{
+			V4L2FormatCache cache(cachePath);
+			if (cache.load() != -EINVAL || cache.formats("sensor|pad:0")) {
+				cerr << "Truncated cache file loaded" << endl;
+				return TestFail;
+			}
+
+			/* Invalidation removes the cache file. */
+			cache.invalidate();
+			if (File::exists(cachePath)) {
+				cerr << "Cache file not removed by invalidate()" << endl;
+				return TestFail;
+			}
+		}
+
+		return TestPass;
+	}
+
+	struct Device {
+		unique_ptr<V4L2Subdevice> subdev;
+		unique_ptr<V4L2VideoDevice> video;
+	};
+
+	/* Enumerate the formats of all devices the way CameraSensor and pipeline handlers do. */
+	static vector<V4L2FormatCache::Formats> enumerate(const vector<Device> &devices)
+	{
+		vector<V4L2FormatCache::Formats> results;
+
+		for (const Device &device : devices) {
+			if (device.subdev) {
+				const MediaEntity *entity = device.subdev->entity();
+				for (unsigned int pad = 0; pad < entity->pads().size(); ++pad)
+					results.push_back(device.subdev->formats(pad));
+			} else {
+				V4L2FormatCache::Formats formats;
+				for (const auto &[pixelFormat, sizes] : device.video->formats())
+					formats[pixelFormat.fourcc()] = sizes;
+				results.push_back(std::move(formats));
+			}
+		}
+
+		return results;
+	}
+
+	template<typename Func>
+	static unsigned int measure(Func func)
+	{
+		auto start = chrono::steady_clock::now();
+
+		for (unsigned int i = 0; i < kIterations; ++i)
+			func();
+
+		auto end = chrono::steady_clock::now();
+		return chrono::duration_cast<chrono::microseconds>(end - start).count() / kIterations;
+	}
+
+	int benchmark()
+	{
+		unique_ptr<DeviceEnumerator> enumerator = DeviceEnumerator::create();
+		if (!enumerator || enumerator->enumerate()) {
+			cout << "Failed to enumerate media devices, skipping benchmark" << endl;
+			return TestPass;
+		}
+
+		DeviceMatch dm("vimc");
+		shared_ptr<MediaDevice> media = enumerator->search(dm);
+		if (!media) {
+			cout << "No VIMC media device found, skipping benchmark" << endl;
+			return TestPass;
+		}
+
+		vector<Device> devices;
+		for (MediaEntity *entity : media->entities()) {
+			Device device;
+
+			if (entity->type() == MediaEntity::Type::V4L2Subdevice) {
+				device.subdev = make_unique<V4L2Subdevice>(entity);
+				if (device.subdev->open() < 0)
+					return TestFail;
+			} else if (entity->type() == MediaEntity::Type::V4L2VideoDevice) {
+				device.video = make_unique<V4L2VideoDevice>(entity);
+				if (device.video->open() < 0)
+					return TestFail;
+			} else {
+				continue;
+			}
+
+			devices.push_back(std::move(device));
+		}
+
+		string cachePath = dir_ + "/benchmark";
+		vector<V4L2FormatCache::Formats> reference = enumerate(devices);
+
+		unsigned int uncached = measure([&]() { enumerate(devices); });
+		unsigned int cold = measure([&]() {
+			V4L2FormatCache cache(cachePath);
+			cache.invalidate();
+			enumerate(devices);
+			cache.save();
+		});
+		unsigned int warm = measure([&]() {
+			V4L2FormatCache cache(cachePath);
+			cache.load();
+			enumerate(devices);
+		});
+
+		V4L2FormatCache cache(cachePath);
+		cache.load();
+		if (enumerate(devices) != reference || cache.isDirty()) {
+			cerr << "Warm cache results mismatch" << endl;
+			return TestFail;
+		}
+
+		cout << "Format enumeration for " << devices.size()
+		     << " devices: uncached " << uncached << " us, cold cache "
+		     << cold << " us, warm cache " << warm << " us" << endl;
+
+		return TestPass;
+	}
+
+	int run() override
+	{
+		if (testCache() != TestPass)
+			return TestFail;
+
+		return benchmark();
+	}
+
+	void cleanup() override
+	{
+		if (dir_.empty())
+			return;
+
+		unlink((dir_ + "/cache").c_str());
+		unlink((dir_ + "/benchmark").c_str());
+		rmdir(dir_.c_str());
+	}
+
+private:
+	string dir_;
+};
+
+TEST_REGISTER(V4L2FormatCacheTest)
@@ -7,6 +7,8 @@
 
 #include <iostream>
 #include <random>
+#include <sys/mman.h>
+#include <unistd.h>
 #include <vector>
 
 #include <libcamera/formats.h>
@@ -155,6 +157,90 @@ public:
 		return TestPass;
 	}
 
+	/*
+	 * Test the cache statistics with buffers backed by memfds, which
+	 * doesn't require a video device.
+	 */
+	int testStatistics()
+	{
+		const unsigned int numBuffers = 32;
+		std::vector<std::unique_ptr<FrameBuffer>> buffers;
+		std::vector<std::unique_ptr<FrameBuffer>> duplicates;
+
+		for (unsigned int i = 0; i < numBuffers; i++) {
+			UniqueFD fd(memfd_create("buffer_cache", MFD_CLOEXEC));
+			if (!fd.isValid() || ftruncate(fd.get(), 8192) < 0) {
+				std::cout << "Failed to create memfd" << std::endl;
+				return TestFail;
+			}
+
+			FrameBuffer::Plane plane;
+			plane.fd = SharedFD(std::move(fd));
+			plane.offset = 0;
+			plane.length = 4096;
+
+			FrameBuffer::Plane plane2 = plane;
+			plane2.offset = 4096;
+
+			buffers.push_back(std::make_unique<FrameBuffer>(
+				std::vector<FrameBuffer::Plane>{ plane, plane2 }));
+
+			/* Reference the same memory through different fds. */
+			plane.fd = SharedFD(plane.fd.get());
+			plane2.fd = plane.fd;
+			duplicates.push_back(std::make_unique<FrameBuffer>(
+				std::vector<FrameBuffer::Plane>{ plane, plane2 }));
+		}
+
+		V4L2BufferCache cache(numBuffers);
+
+		for (unsigned int i = 0; i < numBuffers * 10; i++) {
+			const auto &list = i % 2 ? duplicates : buffers;
+			int index = cache.get(*list[i % numBuffers]);
+			if (index < 0) {
+				std::cout << "Failed lookup from cache" << std::endl;
+				return TestFail;
+			}
+
+			cache.put(index);
+		}
+
+		V4L2BufferCache::Statistics stats = cache.statistics();
+		if (stats.misses != numBuffers || stats.evictions != 0 ||
+		    stats.hits != numBuffers * 9) {
+			std::cout << "Invalid statistics " << stats.hits << "/"
+				  << stats.misses << "/" << stats.evictions
+				  << std::endl;
+			return TestFail;
+		}
+
+		/* Cycling through more buffers than entries evicts entries. */
+		V4L2BufferCache small(numBuffers / 2);
+
+		for (unsigned int i = 0; i < numBuffers * 2; i++) {
+			int index = small.get(*buffers[i % numBuffers]);
+			small.put(index);
+		}
+
+		stats = small.statistics();
+		if (stats.hits != 0 || stats.misses != numBuffers * 2 ||
+		    stats.evictions != numBuffers * 2 - numBuffers / 2) {
+			std::cout << "Invalid eviction statistics" << std::endl;
+			return TestFail;
+		}
+
+		/* A full cache fails lookups. */
+		for (unsigned int i = 0; i < numBuffers / 2; i++)
+			small.get(*buffers[i]);
+
+		if (small.get(*buffers[numBuffers / 2]) != -ENOENT) {
+			std::cout << "Lookup succeeded on full cache" << std::endl;
+			return TestFail;
+		}
+
+		return TestPass;
+	}
+
 	int init() override
 	{
 		std::random_device rd;
@@ -171,6 +257,9 @@ public:
 	{
 		const unsigned int numBuffers = 8;
 
+		if (testStatistics() != TestPass)
+			return TestFail;
+
 		StreamConfiguration cfg;
 		cfg.pixelFormat = formats::YUYV;
 		cfg.size = Size(600, 800);
@@ -0,0 +1,152 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Copyright (C) 2026, agent <agent@local>
+ *
+ * libcamera V4L2 dequeue drain mode test
+ */
+
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <libcamera/base/event_dispatcher.h>
+#include <libcamera/base/thread.h>
+#include <libcamera/base/timer.h>
+
+#include <libcamera/framebuffer.h>
+
+#include "v4l2_videodevice_test.h"
+
+using namespace libcamera;
+using namespace std::chrono_literals;
+
+class DequeueDrainTest : public V4L2VideoDeviceTest
+{
+public:
+	DequeueDrainTest()
+		: V4L2VideoDeviceTest("vimc", "Raw Capture 0"), frames_(0),
+		  lastSequence_(0), ordered_(true) {}
+
+protected:
+	static constexpr unsigned int kFrames = 30;
+
+	/*
+	 * Capture frames with the event loop periodically stalled to let
+	 * multiple buffers complete between two iterations, and return the
+	 * number of event loop wakeups per frame.
+	 */
+	int capture(bool drain, float *wakeupsPerFrame)
+	{
+		EventDispatcher *dispatcher = Thread::current()->eventDispatcher();
+		Timer timeout;
+
+		capture_->setDequeueDrain(drain);
+
+		std::vector<FrameBuffer *> buffers;
+		for (const std::unique_ptr<FrameBuffer> &buffer : buffers_)
+			buffers.push_back(buffer.get());
+
+		if (capture_->queueBuffers(buffers)) {
+			std::cout << "Failed to queue buffers" << std::endl;
+			return TestFail;
+		}
+
+		frames_ = 0;
+		ordered_ = true;
+
+		if (capture_->streamOn()) {
+			std::cout << "Failed to start streaming" << std::endl;
+			return TestFail;
+		}
+
+		timeout.start(10000ms);
+		while (timeout.isRunning() && frames_ < kFrames) {
+			std::this_thread::sleep_for(50ms);
+			dispatcher->processEvents();
+		}
+
+		V4L2VideoDevice::DequeueStatistics stats = capture_->dequeueStatistics();
+
+		if (capture_->streamOff())
+			return TestFail;
+
+		if (frames_ < kFrames) {
+			std::cout << "Failed to capture " << kFrames
+				  << " frames within timeout" << std::endl;
+			return TestFail;
+		}
+
+		if (!ordered_) {
+			std::cout << "Buffers completed out of order" << std::endl;
+			return TestFail;
+		}
+
+		if (stats.buffers != frames_) {
+			std::cout << "Dequeued " << stats.buffers << " buffers, expected "
+				  << frames_ << std::endl;
+			return TestFail;
+		}
+
+		*wakeupsPerFrame = static_cast<float>(stats.wakeups) / stats.buffers;
+
+		return TestPass;
+	}
+
+	int run()
+	{
+		constexpr unsigned int bufferCount = 8;
+		float single, drain;
+
+		int ret = capture_->allocateBuffers(bufferCount, &buffers_);
+		if (ret < 0) {
+			std::cout << "Failed to allocate buffers" << std::endl;
+			return TestFail;
+		}
+
+		capture_->bufferReady.connect(this, &DequeueDrainTest::receiveBuffer);
+
+		if (capture(false, &single) != TestPass)
+			return TestFail;
+
+		if (capture(true, &drain) != TestPass)
+			return TestFail;
+
+		std::cout << "Event loop wakeups per frame: single " << single
+			  << ", drain " << drain << std::endl;
+
+		if (single < 1.0f) {
+			std::cout << "Multiple buffers dequeued per wakeup without drain"
+				  << std::endl;
+			return TestFail;
+		}
+
+		if (drain >= 1.0f) {
+			std::cout << "Buffers not drained" << std::endl;
+			return TestFail;
+		}
+
+		return TestPass;
+	}
+
+private:
+	void receiveBuffer(FrameBuffer *buffer)
+	{
+		if (buffer->metadata().status == FrameMetadata::FrameCancelled)
+			return;
+
+		unsigned int sequence = buffer->metadata().sequence;
+		if (frames_ && sequence <= lastSequence_)
+			ordered_ = false;
+
+		lastSequence_ = sequence;
+		frames_++;
+
+		capture_->queueBuffer(buffer);
+	}
+
+	unsigned int frames_;
+	unsigned int lastSequence_;
+	bool ordered_;
+};
+
+TEST_REGISTER(DequeueDrainTest)
@@ -0,0 +1,132 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: GPL-2.0-or-later
+# Copyright (C) 2026, agent <agent@local>
+#
+# decode-log.py - Convert a binary libcamera log file to text
+
+import argparse
+import struct
+import sys
+
+MAGIC = 0x4c42434c
+VERSION = 1
+
+RECORD_CATEGORY = 1
+RECORD_LOCATION = 2
+RECORD_MESSAGE = 3
+RECORD_TEXT = 4
+
+SEVERITIES = ['DEBUG', ' INFO', ' WARN', 'ERROR', 'FATAL']
+
+
+class DecodeError(Exception):
+    pass
+
+
+class LogDecoder(object):
+    def __init__(self, data):
+        self.data = data
+        self.offset = 0
+        self.categories = {}
+        self.locations = {}
+
+        magic, version = struct.unpack_from('<II', data, 0)
+        if magic == MAGIC:
+            self.order = '<'
+        else:
+            magic, version = struct.unpack_from('>II', data, 0)
+            if magic != MAGIC:
+                raise DecodeError('Not a binary libcamera log file')
+            self.order = '>'
+
+        if version != VERSION:
+            raise DecodeError(f'Unsupported log format version {version}')
+
+        self.offset = 8
+
+    def read(self, fmt):
+        fmt = self.order + fmt
+        values = struct.unpack_from(fmt, self.data, self.offset)
+        self.offset += struct.calcsize(fmt)
+        return values
+
+    def read_string(self, length):
+        value = self.data[self.offset:self.offset + length]
+        if len(value) != length:
+            raise DecodeError('Truncated record')
+        self.offset += length
+        return value.decode('utf-8', errors='replace')
+
+    @staticmethod
+    def timestamp(nsecs):
+        secs = nsecs // 1000000000
+        return f'{secs // 3600}:{(secs // 60) % 60:02}:{secs % 60:02}.{nsecs % 1000000000:09}'
+
+    def records(self):
+        while self.offset < len(self.data):
+            record_type, = self.read('B')
+
+            if record_type == RECORD_CATEGORY:
+                index, length = self.read('HH')
+                self.categories[index] = self.read_string(length)
+
+            elif record_type == RECORD_LOCATION:
+                index, length = self.read('IH')
+                self.locations[index] = self.read_string(length)
+
+            elif record_type == RECORD_MESSAGE:
+                timestamp, tid, category, severity, location, prefix_len, msg_len = \
+                    self.read('QIHBIHI')
+                prefix = self.read_string(prefix_len)
+                msg = self.read_string(msg_len)
+
+                if severity < len(SEVERITIES):
+                    severity = SEVERITIES[severity]
+                else:
+                    severity = 'UNKWN'
+
+                line = f'[{self.timestamp(timestamp)}] [{tid}] {severity} ' \
+                       f'{self.categories.get(category, "?")} ' \
+                       f'{self.locations.get(location, "?")} '
+                if prefix:
+                    line += f'{prefix}: '
+                line += msg
+
+                yield line + '\n'
+
+            elif record_type == RECORD_TEXT:
+                length, = self.read('I')
+                yield self.read_string(length)
+
+            else:
+                raise DecodeError(f'Invalid record type {record_type} at offset {self.offset - 1}')
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(description='Convert a binary libcamera log file to text')
+    parser.add_argument('-o', '--output', type=str,
+                        help='Output file (defaults to standard output)')
+    parser.add_argument('input', type=str, help='Binary log file')
+    args = parser.parse_args(argv[1:])
+
+    with open(args.input, 'rb') as f:
+        data = f.read()
+
+    output = open(args.output, 'w') if args.output else sys.stdout
+
+    try:
+        decoder = LogDecoder(data)
+        for line in decoder.records():
+            output.write(line)
+    except (DecodeError, struct.error) as e:
+        print(f'{args.input}: {e}', file=sys.stderr)
+        return 1
+    finally:
+        if args.output:
+            output.close()
+
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
@@ -131,10 +131,10 @@ def GetAllAttrs(element):
 
 def NeedsControlSerializer(element):
     types = GetAllTypes(element)
-    for type in ['ControlList', 'ControlInfoMap']:
+    for type in ['ControlList', 'ControlListView', 'ControlInfoMap']:
         if f'x:{type}' in types:
             raise Exception(f'Unknown type "{type}" in {element.mojom_name}, did you mean "libcamera.{type}"?')
-    return "ControlList" in types or "ControlInfoMap" in types
+    return "ControlList" in types or "ControlListView" in types or "ControlInfoMap" in types
 
 def HasFd(element):
     attrs = GetAllAttrs(element)
@@ -217,6 +217,7 @@ def IsArray(element):
 
 def IsControls(element):
     return mojom.IsStructKind(element.kind) and (element.kind.mojom_name == "ControlList" or
+                                                 element.kind.mojom_name == "ControlListView" or
                                                  element.kind.mojom_name == "ControlInfoMap")
 
 def IsEnum(element):
@@ -265,6 +266,27 @@ def BitWidth(element):
         return '32'
     return ''
 
+# Get the serialized size of a struct that only contains numerical fields laid
+# out without padding, in which case its memory representation is identical to
+# its serialized form. Return 0 for all other structs.
+def FixedLayoutSize(element):
+    if not mojom.IsStructKind(element) or len(element.fields) == 0:
+        return 0
+    size = 0
+    alignment = 1
+    for field in element.fields:
+        # bool can't be deserialized from arbitrary bytes with memcpy
+        if field.kind not in _bit_widths or field.kind == mojom.BOOL:
+            return 0
+        width = int(_bit_widths[field.kind]) // 8
+        if size % width:
+            return 0
+        size += width
+        alignment = max(alignment, width)
+    if size % alignment:
+        return 0
+    return size
+
 def ByteWidthFromCppType(t):
     key = None
     for mojo_type, cpp_type in _kind_to_cpp_type.items():
@@ -429,6 +451,7 @@ class Generator(generator.Generator):
             'choose': Choose,
             'comma_sep': CommaSep,
             'default_value': GetDefaultValue,
+            'fixed_layout_size': FixedLayoutSize,
             'has_default_fields': HasDefaultFields,
             'has_fd': HasFd,
             'is_async': IsAsync,